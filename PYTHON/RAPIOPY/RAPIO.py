@@ -10,6 +10,11 @@ import mmap, sys, json, os
 # Global base passed in from RAPIO
 rapioBaseFileName="pythonoutput"
 
+# Shared memory of the JSON metadata.  Set by the worker, otherwise
+# we use the key of the RAPIO process that ran us.
+rapioJSONKey=None
+rapioJSONLength=0
+
 class rJsonDimension:
   """ Store info for dimensions of a datatype """
   def __init__(me, json):
@@ -70,13 +75,18 @@ class RAPIO_DataType:
     # Attempt to read JSON metadata information
 
     # Called from rapio c++, get parent ppid
-    ppid = os.getppid()
-    key = "/dev/shm/"+str(ppid)+"-JSON"  # Match C++ code
+    if rapioJSONKey is None:
+      key = "/dev/shm/"+str(os.getppid())+"-JSON"  # Match C++ code
+    else:
+      key = "/dev/shm/"+rapioJSONKey
     #me.metammap = open("/dev/shm/BoostJSON", "r+b")
     try:
       me.metammap = open(key, "r+b")
       me.metamm = mmap.mmap(me.metammap.fileno(), 0) # Entire thing
       aSize = me.metamm.size()
+      # Worker segments are reused, so only part may be ours
+      if (rapioJSONLength > 0) and (rapioJSONLength < aSize):
+        aSize = rapioJSONLength
       me.jsonText = me.metamm.read(aSize)
       me.jsonDict = json.loads(me.jsonText)
 
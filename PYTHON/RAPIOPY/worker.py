@@ -0,0 +1,77 @@
+# -----------------------------------------------------------
+# RAPIO python worker
+# Run by RAPIO as 'python -u -m RAPIOPY.worker script'.  This keeps
+# python, numpy and the script loaded between products, so we only
+# pay startup once.  RAPIO talks to us over stdin/stdout:
+#
+#   We print    RAPIO_WORKER_READY
+#   RAPIO sends RUN jsonkey jsonlength
+#   We print    the output of the script, then RAPIO_WORKER_DONE status
+#
+# We exit when stdin closes.
+#
+# @author Robert Toomey
+#
+import sys, os, io, traceback, contextlib
+import RAPIOPY.RAPIO as RAPIO
+
+class ScriptRunner:
+  """ Compile a script once, run it per product """
+  def __init__(me, path):
+    me.path = os.path.abspath(path)
+    me.code = None
+    me.mtime = None
+    # Like 'python script', allow imports next to the script
+    sys.path.insert(0, os.path.dirname(me.path))
+
+  def compile(me):
+    """ Compile the script, again if it changed on disk """
+    mtime = os.path.getmtime(me.path)
+    if (me.code is None) or (mtime != me.mtime):
+      with open(me.path, "r") as f:
+        me.code = compile(f.read(), me.path, "exec")
+      me.mtime = mtime
+
+  def run(me):
+    """ Run the script as __main__, return 0 on success """
+    try:
+      me.compile()
+      exec(me.code, { "__name__": "__main__", "__file__": me.path })
+    except SystemExit as e:
+      if e.code not in (None, 0):
+        return 1
+    except Exception:
+      traceback.print_exc()
+      return 1
+    return 0
+
+def main():
+  if len(sys.argv) < 2:
+    print("Usage: python -m RAPIOPY.worker script", file=sys.stderr)
+    return 1
+  out = sys.stdout
+  runner = ScriptRunner(sys.argv[1])
+  out.write("RAPIO_WORKER_READY\n")
+  out.flush()
+
+  for line in sys.stdin:
+    pieces = line.split()
+    if (len(pieces) < 3) or (pieces[0] != "RUN"):
+      continue
+    RAPIO.rapioJSONKey = pieces[1]
+    RAPIO.rapioJSONLength = int(pieces[2])
+
+    # Script prints are output lines back to RAPIO
+    captured = io.StringIO()
+    with contextlib.redirect_stdout(captured):
+      status = runner.run()
+    text = captured.getvalue()
+    if text and not text.endswith("\n"):
+      text += "\n"
+    out.write(text)
+    out.write("RAPIO_WORKER_DONE "+str(status)+"\n")
+    out.flush()
+  return 0
+
+if __name__ == "__main__":
+  sys.exit(main())
@@ -6,6 +6,9 @@
 #include "rOS.h"
 #include "rError.h"
 
+#include <cctype>
+#include <cstdlib>
+
 using namespace rapio;
 
 void
@@ -148,32 +151,11 @@ ConfigRecord::readXML(Record& rec, const PTreeNode& item,
       fractional = time.getAttr("fractional", 1.0f);
 
       // Params as <params> and selections as <selections>
-      haveParams = true;
       const auto paramTag   = item.getChild("params");
       const auto p          = item.get("params", std::string("")); // direct
       const auto changeAttr = paramTag.getAttr("changes", std::string(""));
-      ConfigRecord::readParams(p, changeAttr, theParams, indexPath);
       const auto selections = item.get("selections", std::string(""));
-      Strings::split(selections, &theSelections);
-
-      // Special check Lak's message format, convert the event number and
-      // text to our message.  Note, messages don't have selections
-      // and have empty params.
-      if ((theParams.size() > 0) && (theParams[0] == "Event")) {
-        // Event 12345.  Store as Count
-        if (theParams.size() > 1) {
-          rec.setValue("Count", theParams[1]);
-        }
-
-        // Selections: timestamp 'message', where message is say NewVolume
-        if (theSelections.size() > 1) {
-          rec.setValue("MessageText", theSelections[1]);
-        }
-
-        theSelections.clear(); // Don't need these and might break
-        theParams.clear();
-        haveParams = false;
-      }
+      return readLegacyFields(rec, timelong, fractional, p, changeAttr, selections, indexPath, indexLabel);
     }
 
     // Finalize the record
@@ -200,6 +182,222 @@ ConfigRecord::readXML(Record& rec, const PTreeNode& item,
   return false;
 } // Record::readXML
 
+bool
+ConfigRecord::readLegacyFields(Record& rec, long timelong, float fractional,
+  const std::string& p, const std::string& changeAttr,
+  const std::string& selections,
+  const std::string& indexPath, size_t indexLabel)
+{
+  std::vector<std::string> theParams;
+  std::vector<std::string> theSelections;
+  bool haveParams = true;
+
+  ConfigRecord::readParams(p, changeAttr, theParams, indexPath);
+  Strings::split(selections, &theSelections);
+
+  // Special check Lak's message format, convert the event number and
+  // text to our message.  Note, messages don't have selections
+  // and have empty params.
+  if ((theParams.size() > 0) && (theParams[0] == "Event")) {
+    // Event 12345.  Store as Count
+    if (theParams.size() > 1) {
+      rec.setValue("Count", theParams[1]);
+    }
+
+    // Selections: timestamp 'message', where message is say NewVolume
+    if (theSelections.size() > 1) {
+      rec.setValue("MessageText", theSelections[1]);
+    }
+
+    theSelections.clear(); // Don't need these and might break
+    theParams.clear();
+    haveParams = false;
+  }
+
+  // Finalize the record
+  rec.setIndexNumber(indexLabel);
+  rec.setTime(Time::SecondsSinceEpoch(timelong, fractional));
+  if (haveParams) {
+    rec.setParams(theParams);
+    rec.setSelections(theSelections);
+
+    // FIXME: Do we need to filter messages?  For now we won't.
+    // Records representing data are filtered. Messages aren't
+    if (Record::theRecordFilter != nullptr) {
+      if (!Record::theRecordFilter->wanted(rec)) {
+        return false;
+      }
+    }
+  }
+  return true;
+} // ConfigRecord::readLegacyFields
+
+namespace {
+/** Tiny cursor over the text of a FML file.  Anything unexpected
+ * fails, and the caller goes to the full XML reader. */
+class FMLCursor {
+public:
+  FMLCursor(const char * b, const char * e) : at(b), end(e){ }
+
+  /** Skip white space */
+  void
+  skipSpace()
+  {
+    while (at < end && isspace(static_cast<unsigned char>(*at))) { at++; }
+  }
+
+  /** Match exact text, moving past it */
+  bool
+  match(const char * text)
+  {
+    const char * p = at;
+
+    for (; *text; ++text, ++p) {
+      if ((p >= end) || (*p != *text)) { return false; }
+    }
+    at = p;
+    return true;
+  }
+
+  /** Text up to the next '<', false on entities or end of input.
+   * Trimmed, like the XML reader does. */
+  bool
+  text(const char *& b, const char *& e)
+  {
+    b = at;
+    while (at < end && *at != '<') {
+      if (*at == '&') { return false; }
+      at++;
+    }
+    if (at >= end) { return false; }
+    e = at;
+    while (b < e && isspace(static_cast<unsigned char>(*b))) { b++; }
+    while (e > b && isspace(static_cast<unsigned char>(e[-1]))) { e--; }
+    return true;
+  }
+
+  /** Quoted attribute value, false on entities */
+  bool
+  quoted(const char *& b, const char *& e)
+  {
+    if (!match("\"")) { return false; }
+    b = at;
+    while (at < end && *at != '"') {
+      if ((*at == '&') || (*at == '<')) { return false; }
+      at++;
+    }
+    if (at >= end) { return false; }
+    e = at++;
+    return true;
+  }
+
+  /** Current position */
+  const char * at;
+
+  /** End of input */
+  const char * end;
+};
+
+/** Does text have white space the XML reader would collapse? */
+bool
+hasCollapsibleSpace(const char * b, const char * e)
+{
+  for (const char * p = b; p < e; ++p) {
+    if (isspace(static_cast<unsigned char>(*p)) &&
+      ((*p != ' ') || ((p + 1 < e) && isspace(static_cast<unsigned char>(p[1])))))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+}
+
+bool
+ConfigRecord::readFML(Record& rec, const char * begin, const char * end,
+  const std::string& indexPath, size_t indexLabel, bool& handled)
+{
+  // The legacy item FMLRecordNotifier writes:
+  // <item>
+  //  <time fractional="0.057"> 925767275 </time>
+  //  <params>netcdf /RADIALTEST Velocity 00.50 19990503-213435.netcdf </params>
+  //  <selections>19990503-213435.057 Velocity 00.50 </selections>
+  //  <v n="Key">Value</v>
+  // </item>
+  handled = false;
+  FMLCursor c(begin, end);
+
+  c.skipSpace();
+  if (c.match("<?xml")) {
+    while (c.at < c.end && *c.at != '>') { c.at++; }
+    c.at++;
+    c.skipSpace();
+  }
+  if (!c.match("<item>")) { return false; }
+
+  const char * tb = nullptr, * te = nullptr; // time text
+  const char * fb = nullptr, * fe = nullptr; // fractional attribute
+  const char * pb = nullptr, * pe = nullptr; // params text
+  const char * sb = nullptr, * se = nullptr; // selections text
+
+  // Values are few, so fixed storage keeps us allocation free
+  const size_t maxValues = 16;
+  const char * vals[maxValues][4];
+  size_t valueCount = 0;
+
+  for (;;) {
+    c.skipSpace();
+    if (c.match("</item>")) {
+      break;
+    } else if (c.match("<time")) {
+      c.skipSpace();
+      if (c.match("fractional=")) {
+        if (!c.quoted(fb, fe)) { return false; }
+        c.skipSpace();
+      }
+      if (!c.match(">") || !c.text(tb, te) || !c.match("</time>")) { return false; }
+    } else if (c.match("<params>")) {
+      if (!c.text(pb, pe) || !c.match("</params>")) { return false; }
+    } else if (c.match("<selections>")) {
+      if (!c.text(sb, se) || !c.match("</selections>")) { return false; }
+    } else if (c.match("<v n=")) {
+      if (valueCount >= maxValues) { return false; }
+      auto& v = vals[valueCount++];
+      if (!c.quoted(v[0], v[1]) || !c.match(">") || !c.text(v[2], v[3]) || !c.match("</v>")) { return false; }
+      if (hasCollapsibleSpace(v[2], v[3])) { return false; }
+    } else {
+      return false; // Some other tag or text, use the XML reader
+    }
+  }
+  c.skipSpace();
+  if ((c.at != c.end) || (tb == nullptr) || (pb == nullptr)) { return false; }
+
+  // Time must be just a number
+  char * stop;
+  const long timelong = strtol(tb, &stop, 10);
+
+  if ((stop != te) || (tb == te)) { return false; }
+  float fractional = 1.0f; // Matches the XML reader default
+
+  if (fb != nullptr) {
+    fractional = strtof(fb, &stop);
+    if ((stop != fe) || (fb == fe)) { return false; }
+  }
+
+  // Everything parsed, so this is ours now
+  handled = true;
+  for (size_t i = 0; i < valueCount; ++i) {
+    auto& v = vals[i];
+    if (v[0] != v[1]) {
+      rec.setValue(std::string(v[0], v[1]), std::string(v[2], v[3]));
+    }
+  }
+  return readLegacyFields(rec, timelong, fractional,
+           std::string(pb, pe), "",
+           (sb != nullptr) ? std::string(sb, se) : std::string(),
+           indexPath, indexLabel);
+} // ConfigRecord::readFML
+
 void
 ConfigRecord::constructXMLString(const Record& rec, std::ostream& ss, const std::string& indexPath)
 {
@@ -23,6 +23,23 @@ public:
     const std::string    &indexPath,
     size_t indexLabel);
 
+  /** Fill a record from the legacy \<item\> fields, shared by the
+   * readers.  Converts the old 'Event' params to a message. */
+  static bool
+  readLegacyFields(Record& rec, long timelong, float fractional,
+    const std::string& params, const std::string& changes,
+    const std::string& selections,
+    const std::string& indexPath, size_t indexLabel);
+
+  /** Read a record directly from the text of a FML file, as written by
+   * FMLRecordNotifier, without building a property tree.  Sets handled
+   * false if the text is anything other than the plain legacy item
+   * schema (entities, new format, extra tags) so the caller can fall
+   * back to the PTree reader. */
+  static bool
+  readFML(Record& rec, const char * begin, const char * end,
+    const std::string& indexPath, size_t indexLabel, bool& handled);
+
   /** Dump XML to stream for a Record */
   static void
   constructXMLString(const Record& rec, std::ostream&, const std::string& indexPath);
@@ -6,6 +6,8 @@
 
 #include "rError.h"
 
+#include <typeinfo>
+
 using namespace rapio;
 using namespace std;
 
@@ -61,6 +63,16 @@ DataGrid::Clone()
   return nsp;
 }
 
+std::shared_ptr<DataType>
+DataGrid::cloneDataType()
+{
+  // A subclass we don't know would be sliced
+  if (typeid(*this) != typeid(DataGrid)) {
+    return nullptr;
+  }
+  return Clone();
+}
+
 bool
 DataGrid::init(const std::string & aTypeName,
   const std::string              & Units,
@@ -212,7 +224,7 @@ setAttributes(std::shared_ptr<PTreeData> json, std::shared_ptr<DataAttributeList
 }
 
 std::shared_ptr<PTreeData>
-DataGrid::createMetadata()
+DataGrid::createMetadata(const std::string& shmPrefix)
 {
   // Create a JSON tree from datagrid.  Passed to python
   // for the python experiment
@@ -246,7 +258,8 @@ DataGrid::createMetadata()
   // Arrays
   auto arrays = getArrays();
   PTreeNode theArrays;
-  auto pid  = OS::getProcessID();
+  const std::string prefix = shmPrefix.empty() ?
+    std::to_string(OS::getProcessID()) : shmPrefix;
   int count = 1;
 
   for (auto& ar:arrays) {
@@ -276,7 +289,7 @@ DataGrid::createMetadata()
 
     // Create a unique array key for shared memory
     // FIXME: Create shared_memory unique name
-    anArray.put("shm", "/dev/shm/" + std::to_string(pid) + "-array" + std::to_string(count));
+    anArray.put("shm", "/dev/shm/" + prefix + "-array" + std::to_string(count));
     count++;
 
     // Dimension Index Arrays
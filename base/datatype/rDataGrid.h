@@ -141,6 +141,10 @@ public:
   std::shared_ptr<DataGrid>
   Clone();
 
+  /** Deep copy as a DataType, if we're exactly a DataGrid */
+  virtual std::shared_ptr<DataType>
+  cloneDataType() override;
+
   /** Resize existing dimensions given a vector list */
   void
   resize(const std::vector<size_t>& dimsizes);
@@ -366,9 +370,10 @@ public:
   getAttributes(
     const std::string& name);
 
-  /** Create metadata Ptree for sending to python */
+  /** Create metadata Ptree for sending to python.  Arrays are named
+   * /dev/shm/prefix-arrayN, with the process id as the default prefix. */
   std::shared_ptr<PTreeData>
-  createMetadata();
+  createMetadata(const std::string& shmPrefix = "");
 
   /** Default header for RAPIO */
   static double SparseThreshold;
@@ -46,6 +46,11 @@ public:
   /** Destroy a DataType */
   virtual ~DataType(){ }
 
+  /** Deep copy as our own subclass, or nullptr if this subclass can't be
+   * copied.  Used to give background writers their own copy. */
+  virtual std::shared_ptr<DataType>
+  cloneDataType(){ return nullptr; }
+
   /** Format a subtype string utility function */
   static std::string
   formatString(float spec,
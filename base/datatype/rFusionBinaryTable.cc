@@ -14,6 +14,51 @@ size_t FusionBinaryTable::BLOCK_LEVEL;
 
 bool FusionBinaryTable::myStreamRead = false;
 
+size_t FusionBinaryTable::myWriteVersion = FusionBinaryTable::Version;
+
+namespace {
+/** Column alignment in version 2 files */
+const uint64_t COLUMN_ALIGN = 8;
+
+inline uint64_t
+alignColumn(uint64_t at)
+{
+  return ((at + COLUMN_ALIGN - 1) / COLUMN_ALIGN) * COLUMN_ALIGN;
+}
+
+/** Write a column at the given offset, padding up to it first */
+template <typename T>
+bool
+writeColumn(const std::vector<T>& v, uint64_t offset, FILE * fp)
+{
+  long at = ftell(fp);
+
+  while (at < (long) offset) {
+    fputc(0, fp);
+    at++;
+  }
+  if (v.empty()) {
+    return true;
+  }
+  return (fwrite(v.data(), sizeof(T), v.size(), fp) == v.size());
+}
+
+/** Read a column from the given offset in one call */
+template <typename T>
+bool
+readColumn(std::vector<T>& v, size_t count, uint64_t offset, FILE * fp)
+{
+  v.resize(count);
+  if (count == 0) {
+    return true;
+  }
+  if (fseek(fp, offset, SEEK_SET) != 0) {
+    return false;
+  }
+  return (fread(v.data(), sizeof(T), count, fp) == count);
+}
+}
+
 FusionBinaryTable::~FusionBinaryTable()
 {
   // Ensure any open stream file is closed
@@ -48,7 +93,7 @@ FusionBinaryTable::readBlock(const std::string& path, FILE * fp)
 
     // Adding a version number for future use
     BinaryIO::read_type<size_t>(myVersionID, fp);
-    if (myVersionID != Version) {
+    if ((myVersionID < 1) || (myVersionID > Version)) {
       fLogSevere("Error reading raw file.  Version is unknown {}", myVersionID);
       return false;
     }
@@ -86,51 +131,25 @@ FusionBinaryTable::readBlock(const std::string& path, FILE * fp)
     BinaryIO::read_type<size_t>(myValueSize, fp);
     BinaryIO::read_type<size_t>(myMissingSize, fp);
 
-    // If not streaming, store in our internal fields (which can be large),
-    // otherwise we wait for a get() call
-    if (!myStreamRead) {
-      myDataPosition = 0; // which marks it since we always have a header
-
-      myXs.resize(myValueSize);
-      myYs.resize(myValueSize);
-      myZs.resize(myValueSize);
-      myNums.resize(myValueSize);
-      myDems.resize(myValueSize);
-      myXMissings.resize(myMissingSize);
-      myYMissings.resize(myMissingSize);
-      myZMissings.resize(myMissingSize);
-      myLMissings.resize(myMissingSize);
-      for (size_t i = 0; i < myValueSize; ++i) {
-        BinaryIO::read_type<short>(myXs[i], fp);
-        BinaryIO::read_type<short>(myYs[i], fp);
-        BinaryIO::read_type<char>(myZs[i], fp);
-        BinaryIO::read_type<float>(myNums[i], fp);
-        BinaryIO::read_type<float>(myDems[i], fp);
-      }
-      for (size_t i = 0; i < myMissingSize; ++i) {
-        BinaryIO::read_type<short>(myXMissings[i], fp);
-        BinaryIO::read_type<short>(myYMissings[i], fp);
-        BinaryIO::read_type<char>(myZMissings[i], fp);
-        BinaryIO::read_type<short>(myLMissings[i], fp);
+    // Version 2 is columns with an index
+    if (myVersionID >= 2) {
+      if (!readColumns(fp)) {
+        fLogSevere("Error reading columns of raw file {}", path);
+        return false;
       }
+    } else if (!myStreamRead) {
+      // If not streaming, store in our internal fields (which can be large),
+      // otherwise we wait for a get() call
+      readRecords(fp);
+    }
 
-      /*
-       *  // The data fields
-       *  BinaryIO::read_vector(myXs, fp);
-       *  BinaryIO::read_vector(myYs, fp);
-       *  BinaryIO::read_vector(myZs, fp);
-       *  BinaryIO::read_vector(myNums, fp);
-       *  BinaryIO::read_vector(myDems, fp);
-       *
-       *  BinaryIO::read_vector(myXMissings, fp);
-       *  BinaryIO::read_vector(myYMissings, fp);
-       *  BinaryIO::read_vector(myZMissings, fp);
-       *  BinaryIO::read_vector(myLMissings, fp);
-       */
+    if (!myStreamRead) {
+      myDataPosition = 0; // which marks it since we always have a header
     } else {
       myDataPosition = ftell(fp);
       myFilePath     = path;
       myFile         = 0;
+      myMap          = nullptr;
       myValueAt      = 0;
       myMissingAt    = 0;
       myRLECounter   = 0;
@@ -140,6 +159,120 @@ FusionBinaryTable::readBlock(const std::string& path, FILE * fp)
   return false;
 } // FusionBinaryTable::readBlock
 
+void
+FusionBinaryTable::readRecords(FILE * fp)
+{
+  myXs.resize(myValueSize);
+  myYs.resize(myValueSize);
+  myZs.resize(myValueSize);
+  myNums.resize(myValueSize);
+  myDems.resize(myValueSize);
+  myXMissings.resize(myMissingSize);
+  myYMissings.resize(myMissingSize);
+  myZMissings.resize(myMissingSize);
+  myLMissings.resize(myMissingSize);
+  for (size_t i = 0; i < myValueSize; ++i) {
+    BinaryIO::read_type<short>(myXs[i], fp);
+    BinaryIO::read_type<short>(myYs[i], fp);
+    BinaryIO::read_type<char>(myZs[i], fp);
+    BinaryIO::read_type<float>(myNums[i], fp);
+    BinaryIO::read_type<float>(myDems[i], fp);
+  }
+  for (size_t i = 0; i < myMissingSize; ++i) {
+    BinaryIO::read_type<short>(myXMissings[i], fp);
+    BinaryIO::read_type<short>(myYMissings[i], fp);
+    BinaryIO::read_type<char>(myZMissings[i], fp);
+    BinaryIO::read_type<short>(myLMissings[i], fp);
+  }
+}
+
+bool
+FusionBinaryTable::readColumns(FILE * fp)
+{
+  // Column index
+  uint32_t count = 0;
+
+  BinaryIO::read_type<uint32_t>(count, fp);
+  if (count != NumColumns) {
+    fLogSevere("Expected {} columns in raw file, got {}", NumColumns, count);
+    return false;
+  }
+  myColumnOffsets.resize(NumColumns);
+  if (fread(myColumnOffsets.data(), sizeof(uint64_t), NumColumns, fp) != NumColumns) {
+    return false;
+  }
+
+  // Streaming will map the columns on the first get()
+  if (myStreamRead) {
+    return true;
+  }
+
+  // One read call per column
+  const auto& o = myColumnOffsets;
+
+  return (readColumn(myXs, myValueSize, o[0], fp) &&
+         readColumn(myYs, myValueSize, o[1], fp) &&
+         readColumn(myZs, myValueSize, o[2], fp) &&
+         readColumn(myNums, myValueSize, o[3], fp) &&
+         readColumn(myDems, myValueSize, o[4], fp) &&
+         readColumn(myXMissings, myMissingSize, o[5], fp) &&
+         readColumn(myYMissings, myMissingSize, o[6], fp) &&
+         readColumn(myZMissings, myMissingSize, o[7], fp) &&
+         readColumn(myLMissings, myMissingSize, o[8], fp));
+}
+
+bool
+FusionBinaryTable::mapColumns()
+{
+  myMap = MemoryMappedFile::Create(myFilePath);
+  if (myMap == nullptr) {
+    fLogSevere("Couldn't map {} for streaming.", myFilePath);
+    return false;
+  }
+  myMap->adviseSequential();
+  const auto& o = myColumnOffsets;
+
+  myMapX  = myMap->getPointer<short>(o[0], myValueSize);
+  myMapY  = myMap->getPointer<short>(o[1], myValueSize);
+  myMapZ  = myMap->getPointer<char>(o[2], myValueSize);
+  myMapN  = myMap->getPointer<float>(o[3], myValueSize);
+  myMapD  = myMap->getPointer<float>(o[4], myValueSize);
+  myMapXM = myMap->getPointer<short>(o[5], myMissingSize);
+  myMapYM = myMap->getPointer<short>(o[6], myMissingSize);
+  myMapZM = myMap->getPointer<char>(o[7], myMissingSize);
+  myMapLM = myMap->getPointer<short>(o[8], myMissingSize);
+
+  // An empty column at the end of the file can be past the mapping, that's ok
+  const bool goodValues = (myValueSize == 0) ||
+    (myMapX && myMapY && myMapZ && myMapN && myMapD);
+  const bool goodMissings = (myMissingSize == 0) ||
+    (myMapXM && myMapYM && myMapZM && myMapLM);
+
+  if (!goodValues || !goodMissings) {
+    fLogSevere("Raw file {} is truncated.", myFilePath);
+    myMap = nullptr;
+    return false;
+  }
+  return true;
+} // FusionBinaryTable::mapColumns
+
+void
+FusionBinaryTable::append(const FusionBinaryTable& other)
+{
+  myNums.insert(myNums.end(), other.myNums.begin(), other.myNums.end());
+  myDems.insert(myDems.end(), other.myDems.begin(), other.myDems.end());
+  myXs.insert(myXs.end(), other.myXs.begin(), other.myXs.end());
+  myYs.insert(myYs.end(), other.myYs.begin(), other.myYs.end());
+  myZs.insert(myZs.end(), other.myZs.begin(), other.myZs.end());
+  myValueSize += other.myValueSize;
+
+  myXMissings.insert(myXMissings.end(), other.myXMissings.begin(), other.myXMissings.end());
+  myYMissings.insert(myYMissings.end(), other.myYMissings.begin(), other.myYMissings.end());
+  myZMissings.insert(myZMissings.end(), other.myZMissings.begin(), other.myZMissings.end());
+  myLMissings.insert(myLMissings.end(), other.myLMissings.begin(), other.myLMissings.end());
+  myMissingSize += other.myMissingSize;
+}
+
 bool
 FusionBinaryTable::get(float& n, float& d, short& x, short& y, short& z)
 {
@@ -147,7 +280,54 @@ FusionBinaryTable::get(float& n, float& d, short& x, short& y, short& z)
   if (myDataPosition < 1) {
     return false;
   }
+  if (myVersionID >= 2) {
+    return getMapped(n, d, x, y, z);
+  }
+  return getRecord(n, d, x, y, z);
+}
+
+bool
+FusionBinaryTable::getMapped(float& n, float& d, short& x, short& y, short& z)
+{
+  // First time, map the file
+  if (myMap == nullptr) {
+    if ((myValueAt > 0) || (myMissingAt > 0) || !mapColumns()) {
+      return false;
+    }
+  }
+
+  if (myValueAt < myValueSize) {
+    x = myMapX[myValueAt];
+    y = myMapY[myValueAt];
+    z = myMapZ[myValueAt];
+    n = myMapN[myValueAt];
+    d = myMapD[myValueAt];
+    myValueAt++;
+    return true;
+  }
+
+  if (myMissingAt < myMissingSize) {
+    n = Constants::MissingData;
+    d = 1.0; // doesn't matter weighted average ignores missing
+    x = myMapXM[myMissingAt] + myRLECounter;
+    y = myMapYM[myMissingAt];
+    z = myMapZM[myMissingAt];
+    myRLECounter++;
+    if (myRLECounter >= (size_t) myMapLM[myMissingAt]) {
+      myRLECounter = 0;
+      myMissingAt++;
+    }
+    return true;
+  }
 
+  // Nothing left...release the mapping, but keep counters so we don't remap
+  myMap = nullptr;
+  return false;
+} // FusionBinaryTable::getMapped
+
+bool
+FusionBinaryTable::getRecord(float& n, float& d, short& x, short& y, short& z)
+{
   // First time, try to reopen the file...
   if (myFile == 0) {
     myFile = fopen(myFilePath.c_str(), "rb");
@@ -214,7 +394,7 @@ FusionBinaryTable::get(float& n, float& d, short& x, short& y, short& z)
   fclose(myFile);
   myFile = 0;
   return false;
-} // FusionBinaryTable::get
+} // FusionBinaryTable::getRecord
 
 bool
 FusionBinaryTable::writeBlock(FILE * fp)
@@ -229,7 +409,8 @@ FusionBinaryTable::writeBlock(FILE * fp)
     // subclass that handles general DataGrids could be useful?
 
     // Adding a version number for future use
-    BinaryIO::write_type<size_t>(myVersionID, fp);
+    const size_t version = ((myWriteVersion < 1) || (myWriteVersion > Version)) ? Version : myWriteVersion;
+    BinaryIO::write_type<size_t>(version, fp);
 
     std::string radarName, typeName, units;
     BinaryIO::write_type<char>(myMissingMode, fp);
@@ -265,43 +446,88 @@ FusionBinaryTable::writeBlock(FILE * fp)
     BinaryIO::write_type<size_t>(myValueSize, fp);
     BinaryIO::write_type<size_t>(myMissingSize, fp);
 
-    // The data fields.  Ok we wanna stream them back to save ram,
-    // so make the order streamable...
-    // which is probably slower.  We'll probably have to make blocks
-    // also this won't compress.  Kill me.
-    // FIXME: We'll probably have to block and byte-align and compress
-    for (size_t i = 0; i < myXs.size(); ++i) {
-      BinaryIO::write_type<short>(myXs[i], fp);
-      BinaryIO::write_type<short>(myYs[i], fp);
-      BinaryIO::write_type<char>(myZs[i], fp);
-      BinaryIO::write_type<float>(myNums[i], fp);
-      BinaryIO::write_type<float>(myDems[i], fp);
+    if (version >= 2) {
+      return writeColumns(fp);
     }
-    for (size_t i = 0; i < myXMissings.size(); ++i) {
-      BinaryIO::write_type<short>(myXMissings[i], fp);
-      BinaryIO::write_type<short>(myYMissings[i], fp);
-      BinaryIO::write_type<char>(myZMissings[i], fp);
-      BinaryIO::write_type<short>(myLMissings[i], fp);
-    }
-
-    /*
-     *  BinaryIO::write_vector("X", myXs, fp);
-     *  BinaryIO::write_vector("Y", myYs, fp);
-     *  BinaryIO::write_vector("Z", myZs, fp);
-     *  BinaryIO::write_vector("N", myNums, fp);
-     *  BinaryIO::write_vector("D", myDems, fp);
-     *
-     *  BinaryIO::write_vector("Xm", myXMissings, fp);
-     *  BinaryIO::write_vector("Ym", myYMissings, fp);
-     *  BinaryIO::write_vector("Zm", myZMissings, fp);
-     *  BinaryIO::write_vector("Lm", myLMissings, fp);
-     */
-
+    writeRecords(fp);
     return true;
   }
   return false;
 } // FusionBinaryTable::writeBlock
 
+void
+FusionBinaryTable::writeRecords(FILE * fp)
+{
+  // The data fields.  Ok we wanna stream them back to save ram,
+  // so make the order streamable...
+  // which is probably slower.  Version 2 columns replace this.
+  for (size_t i = 0; i < myXs.size(); ++i) {
+    BinaryIO::write_type<short>(myXs[i], fp);
+    BinaryIO::write_type<short>(myYs[i], fp);
+    BinaryIO::write_type<char>(myZs[i], fp);
+    BinaryIO::write_type<float>(myNums[i], fp);
+    BinaryIO::write_type<float>(myDems[i], fp);
+  }
+  for (size_t i = 0; i < myXMissings.size(); ++i) {
+    BinaryIO::write_type<short>(myXMissings[i], fp);
+    BinaryIO::write_type<short>(myYMissings[i], fp);
+    BinaryIO::write_type<char>(myZMissings[i], fp);
+    BinaryIO::write_type<short>(myLMissings[i], fp);
+  }
+}
+
+bool
+FusionBinaryTable::writeColumns(FILE * fp)
+{
+  if ((myYs.size() != myValueSize) || (myZs.size() != myValueSize) ||
+    (myNums.size() != myValueSize) || (myDems.size() != myValueSize) ||
+    (myYMissings.size() != myMissingSize) || (myZMissings.size() != myMissingSize) ||
+    (myLMissings.size() != myMissingSize))
+  {
+    fLogSevere("Column sizes of fusion table don't match, can't write.");
+    return false;
+  }
+
+  // Index of aligned column offsets, computed from where we are in the file
+  const long start = ftell(fp);
+
+  if (start < 0) {
+    fLogSevere("Can't write columns to an unseekable file.");
+    return false;
+  }
+  const uint32_t count = NumColumns;
+  const size_t bytes[NumColumns] = {
+    myValueSize * sizeof(short),   myValueSize * sizeof(short),   myValueSize * sizeof(char),
+    myValueSize * sizeof(float),   myValueSize * sizeof(float),
+    myMissingSize * sizeof(short), myMissingSize * sizeof(short), myMissingSize * sizeof(char),
+    myMissingSize * sizeof(short)
+  };
+  uint64_t at = start + sizeof(count) + (NumColumns * sizeof(uint64_t));
+
+  myColumnOffsets.resize(NumColumns);
+  for (size_t i = 0; i < NumColumns; ++i) {
+    at = alignColumn(at);
+    myColumnOffsets[i] = at;
+    at += bytes[i];
+  }
+
+  BinaryIO::write_type<uint32_t>(count, fp);
+  fwrite(myColumnOffsets.data(), sizeof(uint64_t), NumColumns, fp);
+
+  // One write call per column
+  const auto& o = myColumnOffsets;
+
+  return (writeColumn(myXs, o[0], fp) &&
+         writeColumn(myYs, o[1], fp) &&
+         writeColumn(myZs, o[2], fp) &&
+         writeColumn(myNums, o[3], fp) &&
+         writeColumn(myDems, o[4], fp) &&
+         writeColumn(myXMissings, o[5], fp) &&
+         writeColumn(myYMissings, o[6], fp) &&
+         writeColumn(myZMissings, o[7], fp) &&
+         writeColumn(myLMissings, o[8], fp));
+} // FusionBinaryTable::writeColumns
+
 bool
 FusionBinaryTable::dumpToText(std::ostream& o)
 {
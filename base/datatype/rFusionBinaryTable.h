@@ -1,11 +1,17 @@
 #pragma once
 
 #include <rBinaryTable.h>
+#include <rMemoryMappedFile.h>
 #include <string>
 #include <vector>
 
 namespace rapio {
-/** Binary table for fusion (netcdf is averaging 0.5 to 1.8 sec per read) */
+/** Binary table for fusion (netcdf is averaging 0.5 to 1.8 sec per read)
+ *
+ * Version 1 interleaves every x,y,z,n,d record on disk, which means a read call
+ * per field.  Version 2 stores each array as its own contiguous column with an
+ * index of column offsets, so a full read is one read per column and streaming
+ * reads come directly out of a memory mapping of the file. */
 class FusionBinaryTable : public BinaryTable
 {
 public:
@@ -14,7 +20,9 @@ public:
   FusionBinaryTable()
     : myVersionID(Version), myMissingMode(0), myValueSize(0), myMissingSize(0), myDataPosition(0), myFile(0),
     myValueAt(0), myMissingAt(0), myRLECounter(0),
-    myXBlock(0), myYBlock(0), myZBlock(0), myLengthBlock(0)
+    myXBlock(0), myYBlock(0), myZBlock(0), myLengthBlock(0),
+    myMapX(nullptr), myMapY(nullptr), myMapZ(nullptr), myMapN(nullptr), myMapD(nullptr),
+    myMapXM(nullptr), myMapYM(nullptr), myMapZM(nullptr), myMapLM(nullptr)
   {
     // Lookup for read/write factories
     myDataType = "FusionBinaryTable";
@@ -29,6 +37,10 @@ public:
    * is for reading massive datasets.  The default is false  */
   static bool myStreamRead;
 
+  /** Version we write.  Defaults to the current version, but can be set to 1
+   * for readers that haven't been updated yet. */
+  static size_t myWriteVersion;
+
   /** Non-stream add ability (possibly could stream as well but need API changes) */
   inline void
   add(float& n, float& d, short& x, short& y, short& z)
@@ -52,6 +64,11 @@ public:
     myMissingSize++;
   }
 
+  /** Append the stored values and missings of another table to the end of ours.
+   * Used to join tables filled in parallel back into a single one in order. */
+  void
+  append(const FusionBinaryTable& other);
+
   /** Stream read ability */
   bool
   get(float& n, float& d, short& x, short& y, short& z);
@@ -106,8 +123,40 @@ public:
   }
 
 protected:
+
+  /** Read version 1 interleaved records into our arrays */
+  void
+  readRecords(FILE * fp);
+
+  /** Write version 1 interleaved records from our arrays */
+  void
+  writeRecords(FILE * fp);
+
+  /** Read version 2 column index, and the columns unless streaming */
+  bool
+  readColumns(FILE * fp);
+
+  /** Write version 2 column index and columns from our arrays */
+  bool
+  writeColumns(FILE * fp);
+
+  /** Map our file and point to the version 2 columns for streaming */
+  bool
+  mapColumns();
+
+  /** Stream read from version 1 file records */
+  bool
+  getRecord(float& n, float& d, short& x, short& y, short& z);
+
+  /** Stream read from version 2 mapped columns */
+  bool
+  getMapped(float& n, float& d, short& x, short& y, short& z);
+
   /** Current version of the Fusion Binary Table */
-  static constexpr size_t Version = 1;
+  static constexpr size_t Version = 2;
+
+  /** Number of columns in a version 2 file */
+  static constexpr size_t NumColumns = 9;
 
   char myMissingMode;   ///< Current way missing handled
   size_t myVersionID;   ///< Current version ID
@@ -127,6 +176,18 @@ protected:
   char myZBlock;       ///< Z current
   short myLengthBlock; ///< Length current
 
+  // Version 2 column state
+  std::vector<uint64_t> myColumnOffsets;    ///< File offset of each column
+  std::shared_ptr<MemoryMappedFile> myMap; ///< Mapping for streaming mode
+  const short * myMapX;                    ///< Mapped X column
+  const short * myMapY;                    ///< Mapped Y column
+  const char * myMapZ;                     ///< Mapped Z column
+  const float * myMapN;                    ///< Mapped numerator column
+  const float * myMapD;                    ///< Mapped denominator column
+  const short * myMapXM;                   ///< Mapped X missing column
+  const short * myMapYM;                   ///< Mapped Y missing column
+  const char * myMapZM;                    ///< Mapped Z missing column
+  const short * myMapLM;                   ///< Mapped length missing column
 
 public:
   // Data stored (ONLY if self contained. With fusion data is so large we don't
@@ -1,6 +1,8 @@
 #include "rLLHGridN2D.h"
 #include "rLLH.h"
 
+#include <typeinfo>
+
 using namespace rapio;
 using namespace std;
 
@@ -60,6 +62,16 @@ LLHGridN2D::Clone()
   return nsp;
 }
 
+std::shared_ptr<DataType>
+LLHGridN2D::cloneDataType()
+{
+  // A subclass we don't know would be sliced
+  if (typeid(*this) != typeid(LLHGridN2D)) {
+    return nullptr;
+  }
+  return Clone();
+}
+
 void
 LLHGridN2D::deep_copy(std::shared_ptr<LLHGridN2D> nsp)
 {
@@ -67,7 +79,7 @@ LLHGridN2D::deep_copy(std::shared_ptr<LLHGridN2D> nsp)
 
   // Clone our grids...
   for (auto g:myGrids) {
-    nsp->myGrids.push_back(g->Clone());
+    nsp->myGrids.push_back(g ? g->Clone() : nullptr); // Layers are lazy
   }
 }
 
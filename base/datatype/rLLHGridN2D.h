@@ -50,6 +50,10 @@ public:
   std::shared_ptr<LLHGridN2D>
   Clone();
 
+  /** Deep copy as a DataType, if we're exactly a LLHGridN2D */
+  virtual std::shared_ptr<DataType>
+  cloneDataType() override;
+
   /** Convenience to set the units of a given array name */
   virtual void
   setUnits(const std::string& units, const std::string& name = Constants::PrimaryDataName) override;
@@ -2,6 +2,8 @@
 #include "rLatLonGridProjection.h"
 #include "rArith.h"
 
+#include <typeinfo>
+
 using namespace rapio;
 using namespace std;
 
@@ -84,6 +86,16 @@ LatLonGrid::Clone()
   return nsp;
 }
 
+std::shared_ptr<DataType>
+LatLonGrid::cloneDataType()
+{
+  // A subclass we don't know would be sliced
+  if (typeid(*this) != typeid(LatLonGrid)) {
+    return nullptr;
+  }
+  return Clone();
+}
+
 void
 LatLonGrid::RemapInto(std::shared_ptr<LatLonGrid> out, std::shared_ptr<ArrayAlgorithm> pipeline)
 {
@@ -47,6 +47,10 @@ public:
   std::shared_ptr<LatLonGrid>
   Clone();
 
+  /** Deep copy as a DataType, if we're exactly a LatLonGrid */
+  virtual std::shared_ptr<DataType>
+  cloneDataType() override;
+
   /** Public API for users to remap a LatLonGrid into another
    * LatLonGrid of a different resolution using a sampling remapper. */
   void
@@ -1,6 +1,9 @@
 #include "rLatLonGridProjection.h"
 #include "rLatLonGrid.h"
 
+#include <vector>
+#include <algorithm>
+
 using namespace rapio;
 using namespace std;
 
@@ -102,6 +105,46 @@ LatLonGridProjection::getValuesAtLL(const double * lats, const double * lons, fl
   }
 } // LatLonGridProjection::getValuesAtLL
 
+void
+LatLonGridProjection::getValuesAtLLGrid(const double * lats, size_t rows, const double * lons, size_t cols,
+  float * out)
+{
+  const float * rawData = my2DLayer->data();
+  const double nwLat    = myLatNWDegs;
+  const double nwLon    = myLonNWDegs;
+  const double invLat   = myInvLatSpacing;
+  const double invLon   = myInvLonSpacing;
+  const double lonW     = myLonWidth;
+  const int maxLat      = static_cast<int>(myNumLats);
+  const int maxLon      = static_cast<int>(myNumLons);
+
+  // Source column for each tile column, -1 if outside the grid
+  std::vector<int> ys(cols);
+
+  for (size_t i = 0; i < cols; ++i) {
+    double deltaLon = lons[i] - nwLon;
+    if (deltaLon < 0.0) { deltaLon += 360.0; } else if (deltaLon > lonW) { deltaLon -= 360.0; }
+
+    const int y = static_cast<int>(deltaLon * invLon + 0.5);
+    ys[i] = ((y < 0) || (y >= maxLon)) ? -1 : y;
+  }
+
+  // Each tile row is a single source row, or nothing
+  for (size_t j = 0; j < rows; ++j) {
+    float * o   = out + (j * cols);
+    const int x = static_cast<int>((nwLat - lats[j]) * invLat + 0.5);
+
+    if ((x < 0) || (x >= maxLat)) {
+      std::fill(o, o + cols, Constants::DataUnavailable);
+      continue;
+    }
+    const float * row = rawData + (x * maxLon);
+    for (size_t i = 0; i < cols; ++i) {
+      o[i] = (ys[i] < 0) ? Constants::DataUnavailable : row[ys[i]];
+    }
+  }
+} // LatLonGridProjection::getValuesAtLLGrid
+
 bool
 LatLonGridProjection::LLCoverageCenterDegree(const float degreeOut, const size_t numRows, const size_t numCols,
   float& topDegs, float& leftDegs, float& deltaLatDegs, float& deltaLonDegs)
@@ -25,6 +25,11 @@ public:
   getValuesAtLL(const double * lats, const double * lons,
     float * out, size_t count) override;
 
+  /** Batch get values for a separable grid of Lat Lon */
+  virtual void
+  getValuesAtLLGrid(const double * lats, size_t rows, const double * lons, size_t cols,
+    float * out) override;
+
   /** Calculate Lat Lon coverage marching grid from spatial center */
   virtual bool
   LLCoverageCenterDegree(const float degreeOut, const size_t numRows, const size_t numCols,
@@ -1,6 +1,8 @@
 #include "rLatLonHeightGrid.h"
 #include "rProject.h"
 
+#include <typeinfo>
+
 using namespace rapio;
 using namespace std;
 
@@ -71,6 +73,16 @@ LatLonHeightGrid::Clone()
   return nsp;
 }
 
+std::shared_ptr<DataType>
+LatLonHeightGrid::cloneDataType()
+{
+  // A subclass we don't know would be sliced
+  if (typeid(*this) != typeid(LatLonHeightGrid)) {
+    return nullptr;
+  }
+  return Clone();
+}
+
 void
 LatLonHeightGrid::deep_copy(std::shared_ptr<LatLonHeightGrid> nsp)
 {
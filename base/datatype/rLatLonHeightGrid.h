@@ -52,6 +52,10 @@ public:
   std::shared_ptr<LatLonHeightGrid>
   Clone();
 
+  /** Deep copy as a DataType, if we're exactly a LatLonHeightGrid */
+  virtual std::shared_ptr<DataType>
+  cloneDataType() override;
+
   /** Generated default string for subtype from the data */
   virtual std::string
   getGeneratedSubtype() const override;
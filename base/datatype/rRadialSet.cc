@@ -8,6 +8,8 @@
 
 #include "rProcessTimer.h"
 
+#include <typeinfo>
+
 using namespace rapio;
 using namespace std;
 
@@ -51,6 +53,16 @@ RadialSet::Clone()
   return nsp;
 }
 
+std::shared_ptr<DataType>
+RadialSet::cloneDataType()
+{
+  // A subclass we don't know would be sliced
+  if (typeid(*this) != typeid(RadialSet)) {
+    return nullptr;
+  }
+  return Clone();
+}
+
 namespace {
 /* Compute slant range from ground range and elevation angle
  * This is what Lak did originally.  It assumes a flat earth
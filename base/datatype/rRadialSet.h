@@ -60,6 +60,10 @@ public:
   std::shared_ptr<RadialSet>
   Clone();
 
+  /** Deep copy as a DataType, if we're exactly a RadialSet */
+  virtual std::shared_ptr<DataType>
+  cloneDataType() override;
+
   /** Remap to another RadialSet resolution, optionally projecting
    * slant range to ground.  Useful for polar algorithms that need to
    * march in vertical polar with multiple elevation angles. */
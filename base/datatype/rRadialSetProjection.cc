@@ -2,6 +2,8 @@
 #include "rRadialSet.h"
 
 #include <iostream>
+#include <vector>
+#include <cmath>
 
 using namespace rapio;
 
@@ -120,6 +122,60 @@ RadialSetProjection::getValueAtLL(double latDegs, double lonDegs)
   return value;
 }
 
+void
+RadialSetProjection::getValuesAtLL(const double * lats, const double * lons, float * out, size_t count)
+{
+  AngleDegs azDegs;
+  float rangeMeters;
+  double value;
+  int radial, gate;
+
+  for (size_t i = 0; i < count; ++i) {
+    Project::LatLonToAzRange(myCenterLatDegs, myCenterLonDegs, lats[i], lons[i], azDegs, rangeMeters);
+    out[i] = getValueAtAzRange(azDegs, rangeMeters / 1000.0, value, radial, gate) ?
+      value : Constants::DataUnavailable;
+  }
+}
+
+void
+RadialSetProjection::getValuesAtLLGrid(const double * lats, size_t rows, const double * lons, size_t cols,
+  float * out)
+{
+  // Same math and precision as Project::LatLonToAzRange, so values match
+  // getValueAtLL exactly.
+  constexpr auto meterDeg = Constants::EarthRadiusM * DEG_TO_RAD;
+  const AngleDegs cLat    = myCenterLatDegs;
+  const AngleDegs cLon    = myCenterLonDegs;
+  double value;
+  int radial, gate;
+
+  // East/west meters before the latitude scale, per column
+  std::vector<double> dXs(cols);
+
+  for (size_t i = 0; i < cols; ++i) {
+    const AngleDegs tLon = lons[i];
+    dXs[i] = (tLon - cLon) * meterDeg;
+  }
+
+  for (size_t j = 0; j < rows; ++j) {
+    const AngleDegs tLat = lats[j];
+    const double Y       = (tLat > 0) ? (tLat - cLat) * meterDeg : (cLat - tLat) * meterDeg;
+    const double scale   = cos((cLat + tLat) / 2.0 * DEG_TO_RAD);
+    float * o = out + (j * cols);
+
+    for (size_t i = 0; i < cols; ++i) {
+      const double X          = dXs[i] * scale;
+      const float rangeMeters = sqrt(X * X + Y * Y);
+      AngleDegs azDegs        = atan2(X, Y) * RAD_TO_DEG;
+      if (azDegs < 0) {
+        azDegs = 360.0 + azDegs;
+      }
+      o[i] = getValueAtAzRange(azDegs, rangeMeters / 1000.0, value, radial, gate) ?
+        value : Constants::DataUnavailable;
+    }
+  }
+} // RadialSetProjection::getValuesAtLLGrid
+
 bool
 RadialSetProjection::LLCoverageCenterDegree(const float degreeOut, const size_t numRows, const size_t numCols,
   float& topDegs, float& leftDegs, float& deltaLatDegs, float& deltaLonDegs)
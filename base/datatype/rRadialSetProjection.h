@@ -178,6 +178,18 @@ public:
   virtual double
   getValueAtLL(double latDegs, double lonDegs) override;
 
+  /** Batch get values for Lat Lon */
+  virtual void
+  getValuesAtLL(const double * lats, const double * lons,
+    float * out, size_t count) override;
+
+  /** Batch get values for a separable grid of Lat Lon.  The latitude
+   * terms of the az/range math are done once per row and the longitude
+   * terms once per column. */
+  virtual void
+  getValuesAtLLGrid(const double * lats, size_t rows, const double * lons, size_t cols,
+    float * out) override;
+
   /** Calculate Lat Lon coverage marching grid from spatial center */
   virtual bool
   LLCoverageCenterDegree(const float degreeOut, const size_t numRows, const size_t numCols,
@@ -8,6 +8,9 @@
 #include "rOS.h"
 #include "rConfigRecord.h"
 
+#include <fcntl.h>
+#include <unistd.h>
+
 using namespace rapio;
 
 /** Default constant for a FAM polling index */
@@ -85,12 +88,44 @@ FMLIndex::initialRead(bool realtime, bool archive)
   } else if (myProtocol == FMLINDEX_POLL) {
     myProtocol = FileIndex::FileINDEX_POLL;
   }
-  return FileIndex::initialRead(realtime, archive);
+
+  // The archive scan happens inside the initial read, gather those
+  // records and queue them all at once
+  myBatching = archive;
+  const bool success = FileIndex::initialRead(realtime, archive);
+
+  myBatching = false;
+  if (!myBatch.empty()) {
+    fLogInfo("Read {} FML records from initial scan", myBatch.size());
+    Record::theRecordQueue->addRecords(std::move(myBatch));
+    myBatch.clear();
+  }
+  return success;
 } // FMLIndex::initialRead
 
 bool
 FMLIndex::fileToRecord(const std::string& filename, Record& rec)
 {
+  // FML files are tiny, so read into the stack and parse directly.
+  // Only fall back to the full XML reader if we can't handle it.
+  char buffer[8192];
+  ssize_t length = -1;
+  const int fd   = ::open(filename.c_str(), O_RDONLY);
+
+  if (fd >= 0) {
+    length = ::read(fd, buffer, sizeof(buffer));
+    ::close(fd);
+  }
+  if ((length > 0) && (length < (ssize_t) sizeof(buffer))) {
+    bool handled = false;
+    const bool ok = ConfigRecord::readFML(rec, buffer, buffer + length,
+        myIndexPath, getIndexLabel(), handled);
+    if (handled) {
+      return ok;
+    }
+    rec = Record();
+  }
+
   // For now, tell .fml to be parsed as xml builder
   auto doc = IODataType::read<PTreeData>(filename, "xml");
 
@@ -122,7 +157,11 @@ FMLIndex::handleFile(const std::string& filename)
     if (fileToRecord(filename, rec)) {
       // Add to the record queue.  Never process here directly.  The queue
       // will call our addRecord when it's time to do the work
-      Record::theRecordQueue->addRecord(rec);
+      if (myBatching) {
+        myBatch.push_back(std::move(rec));
+      } else {
+        Record::theRecordQueue->addRecord(std::move(rec));
+      }
     }
   }
 }
@@ -71,6 +71,12 @@ protected:
   /** The worker beast for turning a file into a record */
   bool
   fileToRecord(const std::string& filename, Record& rec);
+
+  /** Are we gathering records for one queue add? */
+  bool myBatching = false;
+
+  /** Records gathered during the initial archive scan */
+  std::vector<Record> myBatch;
 }
 ;
 }
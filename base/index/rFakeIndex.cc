@@ -85,7 +85,7 @@ FakeIndex::generateRecord(const Time& time)
 
   if (gen) {
     auto rec = gen->generateRecord(myParams, time);
-    Record::theRecordQueue->addRecord(rec);
+    Record::theRecordQueue->addRecord(std::move(rec));
   }
   return true;
 } // FakeIndex::readRemoteRecords
@@ -139,7 +139,7 @@ FileIndex::handleFile(const std::string& filename)
 
     // Add record for the file
     Record rec(params, aBuilder, time, "default", "file");
-    Record::theRecordQueue->addRecord(rec);
+    Record::theRecordQueue->addRecord(std::move(rec));
   }
 } // FileIndex::handleFile
 
@@ -15,6 +15,7 @@
 #include "rStreamIndex.h"
 #include "rFakeIndex.h"
 #include "rRedisIndex.h"
+#include "rJournalIndex.h"
 
 using namespace rapio;
 using namespace std;
@@ -38,6 +39,7 @@ IOIndex::introduceSelf()
   StreamIndex::introduceSelf(); // Stream index
   FakeIndex::introduceSelf();   // Fake index
   RedisIndex::introduceSelf();  // Redis index
+  JournalIndex::introduceSelf(); // Binary record journal
 }
 
 std::string
@@ -48,6 +50,7 @@ IOIndex::introduceHelp()
   help += "Indexes ingest data into the system, either with metadata notifications, or direct files.\n";
   help += "Default no protocol ending in .xml is an xml index.\n";
   help += "Default no protocol ending in .fam is an ifam index.\n";
+  help += "Default no protocol ending in .jrn is an ijrn index.\n";
   help += "Default url with 'source' or web macro is a web index.\n";
   help += "Indexes ingest data into the system.\n";
   help += ColorTerm::blue() + "The following types are registered:" + ColorTerm::reset() + "\n";
@@ -78,6 +81,7 @@ IOIndex::createIndex(
 
   WebIndex::canHandle(url, protocol, indexparams);
   FMLIndex::canHandle(url, protocol, indexparams);
+  JournalIndex::canHandle(url, protocol, indexparams);
   XMLIndex::canHandle(url, protocol, indexparams);
 
   // If STILL empty after indexes check/update protocol...
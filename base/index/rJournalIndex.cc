@@ -0,0 +1,107 @@
+#include "rJournalIndex.h"
+
+#include "rIOIndex.h"
+#include "rError.h"
+#include "rOS.h"
+#include "rRecordQueue.h"
+#include "rJournalWatcher.h"
+
+using namespace rapio;
+
+/** Default constant for a journal index */
+const std::string JournalIndex::JOURNALINDEX = "ijrn";
+
+JournalIndex::JournalIndex(const URL & url,
+  const TimeDuration                 & maximumHistory) :
+  IndexType(maximumHistory),
+  myURL(url)
+{ }
+
+JournalIndex::~JournalIndex()
+{ }
+
+std::string
+JournalIndex::getHelpString(const std::string& fkey)
+{
+  return "Follow a binary record journal directory written by the journal notifier.\n  Example: "
+         + JOURNALINDEX + "=/output/code_index.jrn";
+}
+
+bool
+JournalIndex::canHandle(const URL& url, std::string& protocol, std::string& indexparams)
+{
+  // We'll claim any missing protocol with a .jrn ending
+  if (protocol.empty()) {
+    std::string suffix = OS::getRootFileExtension(url.toString());
+    if (suffix == "jrn") {
+      protocol = JournalIndex::JOURNALINDEX;
+      return true;
+    }
+  }
+  return false;
+}
+
+void
+JournalIndex::introduceSelf()
+{
+  std::shared_ptr<IndexType> newOne = std::make_shared<JournalIndex>();
+
+  IOIndex::introduce(JOURNALINDEX, newOne);
+}
+
+std::shared_ptr<IndexType>
+JournalIndex::createIndexType(
+  const std::string  & protocol,
+  const std::string  & indexparams,
+  const TimeDuration & maximumHistory)
+{
+  return std::make_shared<JournalIndex>(URL(indexparams), maximumHistory);
+}
+
+size_t
+JournalIndex::readRecords()
+{
+  size_t total = 0;
+  std::vector<Record> records;
+
+  // Chunks so a huge backlog doesn't all sit in memory twice
+  while (myReader->read(records, 1000) > 0) {
+    total += records.size();
+    Record::theRecordQueue->addRecords(std::move(records));
+    records.clear();
+  }
+  return total;
+}
+
+bool
+JournalIndex::initialRead(bool realtime, bool archive)
+{
+  if (!myURL.isLocal()) {
+    fLogSevere("Can't do a journal index off a remote URL.");
+    return false;
+  }
+  const std::string dir = myURL.getPath();
+
+  myReader = std::make_shared<RecordJournalReader>(dir, IOIndex::getIndexPath(myURL), getIndexLabel());
+  myReader->open(archive);
+
+  if (archive) {
+    fLogInfo("Read {} records from journal {}", readRecords(), dir);
+  }
+
+  if (realtime) {
+    std::shared_ptr<WatcherType> watcher = IOWatcher::getIOWatcher(JournalWatcher::JOURNAL_WATCH);
+    return watcher->attach(dir, realtime, archive, this);
+  }
+  return true;
+}
+
+bool
+JournalIndex::handlePoll()
+{
+  // Cheap check of the mapped counter before touching files
+  if ((myReader != nullptr) && myReader->hasNew()) {
+    return (readRecords() > 0);
+  }
+  return false;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <rIndexType.h>
+#include <rRecordJournal.h>
+#include <rURL.h>
+
+namespace rapio {
+/**
+ * Index that follows a binary record journal directory written by the
+ * journal notifier, such as /output/code_index.jrn.  Records are read by
+ * offset as they are appended, with no file per record to watch.
+ *
+ * @author Robert Toomey
+ * @ingroup rapio_io
+ * @brief Index that follows a binary record journal
+ */
+class JournalIndex : public IndexType {
+public:
+
+  /** Default constant for a journal index */
+  static const std::string JOURNALINDEX;
+
+  /** Create a journal index */
+  JournalIndex(){ }
+
+  /** Create an individual journal index */
+  JournalIndex(const URL & url,
+    const TimeDuration   & maximumHistory);
+
+  /** Destroy a journal index */
+  virtual
+  ~JournalIndex();
+
+  /** Get help for us */
+  virtual std::string
+  getHelpString(const std::string& fkey) override;
+
+  /** Can we handle this protocol/path from -i?  Update allowed. */
+  static bool
+  canHandle(const URL& url, std::string& protocol, std::string& indexparams);
+
+  /** Introduce to list of indexes available */
+  static void
+  introduceSelf();
+
+  /** Create an individual journal index */
+  virtual std::shared_ptr<IndexType>
+  createIndexType(
+    const std::string  & protocol,
+    const std::string  & location,
+    const TimeDuration & maximumHistory) override;
+
+  /** Handle realtime vs. archive mode stuff */
+  virtual bool
+  initialRead(bool realtime, bool archive) override;
+
+  /** Read any new records on a poll */
+  virtual bool
+  handlePoll() override;
+
+protected:
+
+  /** Read available records into the queue */
+  size_t
+  readRecords();
+
+  /** Location of the journal directory */
+  URL myURL;
+
+  /** Reader following the journal */
+  std::shared_ptr<RecordJournalReader> myReader;
+};
+}
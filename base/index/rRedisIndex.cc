@@ -85,7 +85,7 @@ RedisIndex::handleNewEvent(WatchEvent * event)
       // We pass "" as indexPath because Redis records likely won't rely on
       // relative file paths from the index location.
       if (ConfigRecord::readXML(rec, item, "", getIndexLabel())) {
-        Record::theRecordQueue->addRecord(rec);
+        Record::theRecordQueue->addRecord(std::move(rec));
         //   fLogInfo("Redis FML Record Queued: {}", rec.getIDString());
         isFML = true;
       }
@@ -131,7 +131,7 @@ StreamIndex::handleNewEvent(WatchEvent * w)
                   auto tree = xml->getTree();
                   auto item = tree->getChild("item");
                   if (ConfigRecord::readXML(rec, item, "", getIndexLabel())) {
-                    Record::theRecordQueue->addRecord(rec);
+                    Record::theRecordQueue->addRecord(std::move(rec));
                   }
                 } else {
                   fLogSevere("Failed record XML from stream, can't parse.");
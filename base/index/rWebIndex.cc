@@ -203,7 +203,7 @@ WebIndex::readRemoteRecords()
           // Note priority queue time sorts all initial indexes
           Record rec;
           if (ConfigRecord::readXML(rec, r, indexPath, getIndexLabel())) {
-            Record::theRecordQueue->addRecord(rec);
+            Record::theRecordQueue->addRecord(std::move(rec));
           }
           count++;
         }
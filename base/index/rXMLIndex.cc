@@ -7,8 +7,10 @@
 #include "rIODataType.h"
 #include "rRecordQueue.h"
 #include "rConfigRecord.h"
+#include "rIOURL.h"
 
 #include <iostream>
+#include <cctype>
 
 using namespace rapio;
 
@@ -68,36 +70,225 @@ XMLIndex::createIndexType(
 bool
 XMLIndex::initialRead(bool realtime, bool archive)
 {
-  auto doc2 = IODataType::read<PTreeData>(myURL.toString());
-
-  if (doc2 != nullptr) {
-    const auto indexPath  = IOIndex::getIndexPath(myURL);
-    const auto indexLabel = getIndexLabel();
+  // Stream the index, so huge indexes start fast and use little memory.
+  // Allow -i "/archive/code_index.xml?offset=12345" to resume.
+  size_t offset = 0;
 
+  if (myURL.hasQuery("offset")) {
     try{
-      /* <codeindex>
-       * <item>
-       *   <time fractional="0.00000000"> 925767255 </time>
-       *   <params>
-       *   <selections>
-       * </item>
-       * </codeindex>
-       */
-      auto itemTree = doc2->getTree()->getChild("codeindex");
-      auto items    = itemTree.getChildren("item");
-      for (auto r: items) {
-        // Note priority queue time sorts all initial indexes
-        Record rec;
-        if (ConfigRecord::readXML(rec, r, indexPath, indexLabel)) {
-          Record::theRecordQueue->addRecord(rec);
-        }
-      }
+      offset = std::stoul(myURL.getQuery("offset"));
     }catch (const std::exception& e) {
-      fLogSevere("Error parsing codeindex XML");
-      return (false);
+      fLogSevere("Bad offset '{}' for XML index, starting at beginning", myURL.getQuery("offset"));
     }
-    return (true);
   }
 
-  return (false);
+  auto in = IOURL::openStream(myURL);
+
+  if (in == nullptr) {
+    return (false);
+  }
+  myStream = std::make_shared<XMLRecordStream>(in, IOIndex::getIndexPath(myURL),
+      getIndexLabel(), 1000, offset);
+
+  // Check the first item parses so a bad index fails now
+  if (!myStream->fill(*Record::theRecordQueue, 1)) {
+    // Might just be empty or filtered
+    return (!in->bad());
+  }
+  Record::theRecordQueue->addSource(myStream);
+  return (true);
 } // XMLIndex::initialRead
+
+XMLRecordStream::XMLRecordStream(std::shared_ptr<std::istream> in,
+  const std::string& indexPath, size_t indexLabel,
+  size_t lookAhead, size_t startOffset)
+  : myIn(in), myIndexPath(indexPath), myIndexLabel(indexLabel),
+  myLookAhead(std::max(size_t(1), lookAhead)), myBufferOffset(startOffset), myItemOffset(startOffset),
+  myEOF(false)
+{
+  if (startOffset > 0) {
+    // Seek if we can, otherwise read past it (compressed)
+    myIn->seekg(startOffset);
+    if (!*myIn) {
+      myIn->clear();
+      myIn->ignore(startOffset);
+    }
+    fLogInfo("Resuming XML index at byte {}", startOffset);
+  }
+}
+
+size_t
+XMLRecordStream::getResumeOffset() const
+{
+  size_t offset = myBufferOffset;
+
+  for (auto * m : { &myHeld, &myQueued }) {
+    for (auto& i:*m) {
+      offset = std::min(offset, i.second);
+    }
+  }
+  return offset;
+}
+
+void
+XMLRecordStream::handOff(RecordQueue& q, Record&& r)
+{
+  // Equal times might swap offsets, but the set of offsets is the same
+  auto at = myHeld.find(r.getTime());
+
+  if (at != myHeld.end()) {
+    myQueued.insert(*at);
+    myHeld.erase(at);
+  }
+  if (myLatest < r.getTime()) { myLatest = r.getTime(); }
+  q.addRecord(std::move(r));
+}
+
+bool
+XMLRecordStream::nextItem(size_t& begin, size_t& end)
+{
+  // Items are <item ...>...</item> or <item .../>, never nested
+  size_t searchFrom = 0;
+
+  for (;;) {
+    size_t b = myBuffer.find("<item", searchFrom);
+
+    // Skip tags like <items> that start the same
+    while (b != std::string::npos && b + 5 < myBuffer.size() &&
+      !isspace(static_cast<unsigned char>(myBuffer[b + 5])) &&
+      (myBuffer[b + 5] != '>') && (myBuffer[b + 5] != '/'))
+    {
+      b = myBuffer.find("<item", b + 5);
+    }
+    if (b != std::string::npos) {
+      const size_t close = myBuffer.find('>', b);
+      if (close != std::string::npos) {
+        if (myBuffer[close - 1] == '/') {
+          begin = b;
+          end   = close + 1;
+          return true;
+        }
+        const size_t e = myBuffer.find("</item>", close);
+        if (e != std::string::npos) {
+          begin = b;
+          end   = e + 7;
+          return true;
+        }
+      }
+      searchFrom = b;
+    } else {
+      // Keep a tail that could be the start of a split "<item"
+      searchFrom = (myBuffer.size() > 5) ? myBuffer.size() - 5 : 0;
+    }
+
+    if (myEOF) {
+      return false;
+    }
+
+    // Drop text we've scanned past, then read more
+    if (searchFrom > 0) {
+      myBuffer.erase(0, searchFrom);
+      myBufferOffset += searchFrom;
+      searchFrom      = 0;
+    }
+    char chunk[65536];
+    myIn->read(chunk, sizeof(chunk));
+    const auto got = myIn->gcount();
+    if (got > 0) {
+      myBuffer.append(chunk, got);
+    }
+    if (!*myIn) {
+      myEOF = true;
+    }
+  }
+} // XMLRecordStream::nextItem
+
+bool
+XMLRecordStream::readNext(Record& rec, bool& wanted)
+{
+  size_t b, e;
+
+  if (!nextItem(b, e)) {
+    return false;
+  }
+  myItemOffset = myBufferOffset + b;
+
+  // Plain legacy items parse directly, anything fancier uses the tree
+  const char * text = myBuffer.data();
+  bool handled      = false;
+
+  rec    = Record();
+  wanted = ConfigRecord::readFML(rec, text + b, text + e, myIndexPath, myIndexLabel, handled);
+  if (!handled) {
+    rec    = Record();
+    wanted = false;
+    std::vector<char> item(text + b, text + e);
+    auto doc = IODataType::readBuffer<PTreeData>(item, "xml");
+    if (doc != nullptr) {
+      try{
+        wanted = ConfigRecord::readXML(rec, doc->getTree()->getChild("item"), myIndexPath, myIndexLabel);
+      }catch (const std::exception& ex) {
+        fLogSevere("Error parsing codeindex XML item at byte {}", myBufferOffset + b);
+      }
+    }
+  }
+
+  // Done with this item text
+  myBuffer.erase(0, e);
+  myBufferOffset += e;
+  return true;
+} // XMLRecordStream::readNext
+
+bool
+XMLRecordStream::fill(RecordQueue& q, size_t count)
+{
+  size_t added = 0;
+  size_t read  = 0;
+  bool ended   = false;
+  Record rec;
+  bool wanted;
+
+  // The queue hands records out in time order, so ours older than its
+  // next record are processed.  Ties are kept, repeating is safe.
+  auto& waiting = q.getQueue();
+
+  if (waiting.empty()) {
+    myQueued.clear();
+  } else {
+    myQueued.erase(myQueued.begin(), myQueued.lower_bound(waiting.top().getTime()));
+  }
+
+  // Read at least count items so we always make progress, even if
+  // every item is filtered out
+  while (added < count || read < count) {
+    if (!readNext(rec, wanted)) {
+      ended = true;
+      break;
+    }
+    read++;
+    if (!wanted) { continue; }
+
+    // Note priority queue time sorts, we hold back a few to sort
+    myHeld.emplace(rec.getTime(), myItemOffset);
+    myHeap.push(std::move(rec));
+    if (myHeap.size() > myLookAhead) {
+      handOff(q, myHeap.take());
+      added++;
+    }
+  }
+
+  // At the end, the held back records go too
+  if (ended) {
+    while (!myHeap.empty()) {
+      handOff(q, myHeap.take());
+    }
+  }
+
+  const Time now = Time::ClockTime();
+
+  if ((now - myLastLog).seconds() >= 10) {
+    fLogInfo("XML index at byte {}, resume offset {}", myBufferOffset, getResumeOffset());
+    myLastLog = now;
+  }
+  return !ended;
+} // XMLRecordStream::fill
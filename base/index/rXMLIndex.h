@@ -1,8 +1,98 @@
 #pragma once
 
 #include <rIndexType.h>
+#include <rRecordQueue.h>
+
+#include <istream>
+#include <map>
 
 namespace rapio {
+/**
+ * Reads the items of a code index XML stream a chunk at a time, as the
+ * RecordQueue needs them.  A small heap of look ahead records puts
+ * slightly out of order items back in time order, so memory stays
+ * bounded no matter how large the index is.
+ *
+ * @author Robert Toomey
+ */
+class XMLRecordStream : public RecordSource {
+public:
+
+  /** Read records from a stream of code index XML */
+  XMLRecordStream(std::shared_ptr<std::istream> in,
+    const std::string& indexPath, size_t indexLabel,
+    size_t lookAhead = 1000, size_t startOffset = 0);
+
+  /** Add about count more records to the queue */
+  virtual bool
+  fill(RecordQueue& q, size_t count) override;
+
+  /** Time of the newest record added to the queue so far */
+  virtual Time
+  getLatestTime() override { return myLatest; }
+
+  /** Byte offset to resume from to not lose any record that hasn't
+   * been handed to the algorithm.  That's the oldest record held back
+   * for sorting or still waiting in the queue as of the last fill, so
+   * resuming there might repeat records, but won't lose any. */
+  size_t
+  getResumeOffset() const;
+
+  /** Read the next item into a record.  Returns false at end of stream. */
+  bool
+  readNext(Record& rec, bool& wanted);
+
+protected:
+
+  /** Find the next complete item in the buffer, reading more as needed */
+  bool
+  nextItem(size_t& begin, size_t& end);
+
+  /** Add a record from the heap to the queue */
+  void
+  handOff(RecordQueue& q, Record&& r);
+
+  /** The stream we read */
+  std::shared_ptr<std::istream> myIn;
+
+  /** Index path for the records */
+  std::string myIndexPath;
+
+  /** Index label for the records */
+  size_t myIndexLabel;
+
+  /** Max records held back for sorting */
+  size_t myLookAhead;
+
+  /** Text read but not parsed yet */
+  std::string myBuffer;
+
+  /** Stream offset of the start of myBuffer */
+  size_t myBufferOffset;
+
+  /** Start offset of the last item read */
+  size_t myItemOffset;
+
+  /** Times and start offsets of records held back for sorting */
+  std::multimap<Time, size_t> myHeld;
+
+  /** Times and start offsets of records added to the queue that might
+   * not be processed yet */
+  std::multimap<Time, size_t> myQueued;
+
+  /** Look ahead records for sorting */
+  RecordHeap myHeap;
+
+  /** Newest record time added to the queue */
+  Time myLatest;
+
+  /** Last time we logged progress */
+  Time myLastLog;
+
+  /** Have we hit the end of the stream? */
+  bool myEOF;
+};
+
 /**
  * The XMLIndex has a static file of index records,
  * used for an ordered archived dataset
@@ -55,5 +145,8 @@ protected:
 
   /** Location of the data file */
   URL myURL;
+
+  /** Streaming reader of the file */
+  std::shared_ptr<XMLRecordStream> myStream;
 };
 }
@@ -117,7 +117,7 @@ FMLRecordNotifier::getOutputFolder(std::map<std::string, std::string>& outputPar
   }
 
   // Append code_index.fam always for fam (We decided this is less confusing in operations)
-  outputDir = outputDir + "code_index.fam/"; // ...then put in subfolder of default output
+  outputDir = outputDir + myFolderName + "/"; // ...then put in subfolder of default output
 } // FMLRecordNotifier::getOutputFolder
 
 void
@@ -16,7 +16,7 @@ public:
   introduceSelf();
 
   /** Create uninitialized FML record notifier */
-  FMLRecordNotifier(){ }
+  FMLRecordNotifier(const std::string& folder = "code_index.fam") : myFolderName(folder){ }
 
   /** Destroy FML record notifier */
   virtual
@@ -45,6 +45,9 @@ public:
 
 protected:
 
+  /** Folder under the output directory we write to */
+  std::string myFolderName;
+
   /** Overridden output directory for the FML notification */
   std::string myOutputDir;
 
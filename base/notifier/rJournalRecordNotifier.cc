@@ -0,0 +1,56 @@
+#include "rJournalRecordNotifier.h"
+
+#include "rError.h"
+#include "rFactory.h"
+
+using namespace rapio;
+
+namespace rapio {
+/** Create a new instance of JournalRecordNotifier.
+ * @ingroup rapio_io
+ * @brief Create a new instance of JournalRecordNotifier
+ * */
+class JournalRecordNotifierCreator : public RecordNotifierCreator {
+public:
+  std::shared_ptr<RecordNotifierType>
+  create(const std::string& params) override
+  {
+    auto ptr = std::make_shared<JournalRecordNotifier>();
+
+    ptr->initialize(params);
+    return ptr;
+  }
+
+  /** Help for created objects */
+  virtual std::string
+  getHelpString(const std::string& fkey) override
+  {
+    return
+      "Append records to a binary journal directory, read with the ijrn index.  Avoids a file per record on busy systems.\n  Example: journal=/output to have ALL writers append to /output/code_index.jrn.\n  Example: journal= Append to {OutputDir}/code_index.jrn for each writer's path.";
+  }
+};
+}
+
+void
+JournalRecordNotifier::introduceSelf()
+{
+  std::shared_ptr<JournalRecordNotifierCreator> newOne = std::make_shared<JournalRecordNotifierCreator>();
+  Factory<RecordNotifierCreator>::introduce("journal", newOne);
+}
+
+void
+JournalRecordNotifier::writeRecord(std::map<std::string, std::string>& outputParams, const Record& rec)
+{
+  std::string outputDir, indexLocation;
+
+  getOutputFolder(outputParams, outputDir, indexLocation);
+
+  auto& w = myWriters[outputDir];
+
+  if (w == nullptr) {
+    w = std::make_shared<RecordJournalWriter>(outputDir);
+  }
+  if (!w->append(rec, indexLocation)) {
+    fLogSevere("Unable to notify record to journal {}", outputDir);
+  }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <rFMLRecordNotifier.h>
+#include <rRecordJournal.h>
+
+#include <map>
+#include <memory>
+
+namespace rapio {
+/**
+ * Notify records by appending them to a binary journal,
+ * {OutputDir}/code_index.jrn, instead of writing a .fml file per record.
+ * Uses the same output folder rules as the fml notifier.
+ *
+ * @author Robert Toomey
+ * @ingroup rapio_io
+ * @brief Notify records by appending to a binary journal
+ */
+class JournalRecordNotifier : public FMLRecordNotifier {
+public:
+
+  /** Introduce a record notifier that appends to a journal */
+  static void
+  introduceSelf();
+
+  /** Create uninitialized journal record notifier */
+  JournalRecordNotifier() : FMLRecordNotifier("code_index.jrn"){ }
+
+  /** Notify for a single record */
+  virtual void
+  writeRecord(std::map<std::string, std::string>& outputParams, const Record& rec) override;
+
+protected:
+
+  /** Open journal for each output directory */
+  std::map<std::string, std::shared_ptr<RecordJournalWriter> > myWriters;
+};
+}
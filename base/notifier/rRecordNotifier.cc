@@ -9,6 +9,7 @@
 #include "rFMLRecordNotifier.h"
 #include "rEXERecordNotifier.h"
 #include "rRedisRecordNotifier.h"
+#include "rJournalRecordNotifier.h"
 
 using namespace rapio;
 using namespace std;
@@ -19,6 +20,7 @@ RecordNotifier::introduceSelf()
   FMLRecordNotifier::introduceSelf();
   EXERecordNotifier::introduceSelf();
   RedisRecordNotifier::introduceSelf();
+  JournalRecordNotifier::introduceSelf();
 }
 
 std::string
@@ -31,6 +31,16 @@ PluginIngestor::declareOptions(RAPIOOptions& o)
     "/data/radar/KTLX/code_index.xml",
     "The input sources");
   o.addGroup(myName, "I/O");
+  o.optional("recordbatch",
+    "100",
+    "Max records processed per event loop pass.");
+  o.addGroup("recordbatch", "I/O");
+  o.setHidden("recordbatch");
+  o.optional("recordbudget",
+    "50",
+    "Max milliseconds of record processing per event loop pass.");
+  o.addGroup("recordbudget", "I/O");
+  o.setHidden("recordbudget");
 }
 
 void
@@ -38,6 +48,8 @@ PluginIngestor::addPostLoadedHelp(RAPIOOptions& o)
 {
   // The 'i' plugin relies on the Index::initialize called
   o.addAdvancedHelp(myName, IOIndex::introduceHelp());
+  o.addAdvancedHelp("recordbatch",
+    "Records are handed to the algorithm in batches.  After each batch, timers and web events get a turn, so a large backlog after an outage can't starve them.  A batch ends at this many records or when -recordbudget is used up.");
 }
 
 void
@@ -46,6 +58,9 @@ PluginIngestor::processOptions(RAPIOOptions& o)
   ConfigParamGroupi parami; // Thinking about deprecating these
 
   parami.readString(o.getString(myName));
+
+  myRecordBatch    = std::max(1, o.getInteger("recordbatch"));
+  myRecordBudgetMS = std::max(0, o.getInteger("recordbudget"));
 }
 
 void
@@ -61,6 +76,8 @@ PluginIngestor::execute(RAPIOProgram * callerin)
 
   std::shared_ptr<RecordQueue> q = std::make_shared<RecordQueue>(caller);
 
+  q->setBatchSize(myRecordBatch);
+  q->setLatencyBudgetMS(myRecordBudgetMS);
   Record::theRecordQueue = q;
   EventLoop::addEventHandler(q);
 
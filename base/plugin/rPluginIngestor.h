@@ -38,6 +38,12 @@ public:
 
 protected:
 
+  /** Max records processed per event loop wakeup */
+  size_t myRecordBatch = 100;
+
+  /** Max milliseconds of record processing per event loop wakeup */
+  size_t myRecordBudgetMS = 50;
+
   /** Indexes we are successfully attached to */
   std::vector<std::shared_ptr<IndexType> > myConnectedIndexes;
 };
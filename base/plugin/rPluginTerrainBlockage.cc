@@ -23,6 +23,10 @@ PluginTerrainBlockage::declareOptions(RAPIOOptions& o)
     "Terrain blockage algorithm. Params follow: lak,/DEMS.  Most take root folder of DEMS.");
   o.addSuboption(myName, "", "Don't apply any terrain algorithm.");
   TerrainBlockage::introduceSuboptions("terrain", o);
+
+  o.optional(myName + "cache", "", "Folder for terrain blockage cache files.");
+  o.addAdvancedHelp(myName + "cache",
+    "Terrain blockage only depends on the radar, DEM and the nominal geometry of a tilt, so it's the same every volume.  The most recently used tilts are kept in memory.  With a folder, each tilt is also written to a file and memory mapped back on later runs.  Files are keyed by the rounded tilt geometry and the DEM file's path, time and size, so a changed tilt or DEM file just makes a new file.");
 }
 
 void
@@ -35,6 +39,7 @@ void
 PluginTerrainBlockage::processOptions(RAPIOOptions& o)
 {
   myTerrainAlg = o.getString(myName);
+  myCacheDir   = o.getString(myName + "cache");
 }
 
 void
@@ -70,6 +75,7 @@ PluginTerrainBlockage::getNewTerrainBlockage(
       exit(1);
     } else {
       fLogInfo("Using Terrain Blockage: '{}'", myTerrainAlg);
+      myTerrainBlockage->setCacheDirectory(myCacheDir);
       return myTerrainBlockage;
     }
     return nullptr;
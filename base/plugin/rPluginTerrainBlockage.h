@@ -49,5 +49,8 @@ protected:
 
   /** The value of the command line argument */
   std::string myTerrainAlg;
+
+  /** Folder for terrain cache files, if any */
+  std::string myCacheDir;
 };
 }
@@ -59,3 +59,12 @@ PluginVolumeValueResolver::getVolumeValueResolver()
 {
   return myResolver;
 }
+
+std::shared_ptr<VolumeValueResolver>
+PluginVolumeValueResolver::createVolumeValueResolver()
+{
+  std::string key, params;
+
+  Strings::splitKeyParam(myResolverAlg, key, params);
+  return VolumeValueResolver::createVolumeValueResolver(key, params);
+}
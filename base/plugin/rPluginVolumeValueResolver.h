@@ -41,6 +41,11 @@ public:
   std::shared_ptr<VolumeValueResolver>
   getVolumeValueResolver();
 
+  /** Create a new independent resolver using the same name and params
+   * as ours.  Useful for giving each thread its own resolver. */
+  std::shared_ptr<VolumeValueResolver>
+  createVolumeValueResolver();
+
 protected:
   /** The value of the command line argument */
   std::string myResolverAlg;
@@ -296,6 +296,19 @@ public:
     os << myBits[at];
   }
 
+  /** Or the bits of another bitset of the same size into us.  Used to
+   * combine bitsets filled independently, such as by threads.
+   * @return false if sizes don't match */
+  bool
+  merge(const Bitset1& other)
+  {
+    if (other.myBits.size() != myBits.size()) {
+      return false;
+    }
+    myBits |= other.myBits;
+    return true;
+  }
+
   /** Write our bits to an ofstream */
   bool
   writeBits(std::ofstream& file) const
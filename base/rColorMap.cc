@@ -10,8 +10,22 @@
 #include "rIOXML.h"
 #include "rConfigColorMap.h"
 
+#include <algorithm>
+#include <cmath>
+
 using namespace rapio;
 
+void
+ColorMap::colorize(const float * values, uint32_t * colors, size_t count) const
+{
+  unsigned char r, g, b, a;
+
+  for (size_t i = 0; i < count; ++i) {
+    getColor(values[i], r, g, b, a);
+    colors[i] = packColor(r, g, b, a);
+  }
+}
+
 void
 ColorMap::setSpecialColorStrings(const std::string& missing, const std::string& unavailable)
 {
@@ -361,8 +375,111 @@ DefaultColorMap::addBin(bool linear, const std::string& label, double u, double
   myUpperBounds.push_back(u);
 
   myColorInfo.push_back(ColorBin(linear, label, l, u, r_, g_, b_, a_, r2_, g2_, b2_, a2_));
+
+  std::lock_guard<std::mutex> lock(myTableLock);
+  myTable.reset();
 }
 
+std::shared_ptr<const DefaultColorMap::ColorTable>
+DefaultColorMap::getTable() const
+{
+  std::lock_guard<std::mutex> lock(myTableLock);
+
+  if (myTable != nullptr) {
+    return myTable;
+  }
+
+  auto t = std::make_shared<ColorTable>();
+
+  t->low       = 0;
+  t->high      = 0;
+  t->scale     = 0;
+  t->below     = 0;
+  t->above     = 0;
+  t->haveBelow = false;
+  t->haveAbove = false;
+
+  // The color changes only at the finite upper bounds
+  std::vector<double> bounds;
+
+  for (auto& u:myUpperBounds) {
+    if (std::isfinite(u)) { bounds.push_back(u); }
+  }
+  std::sort(bounds.begin(), bounds.end());
+  if (bounds.empty() || myColorInfo.empty()) {
+    myTable = t;
+    return myTable;
+  }
+  t->low  = bounds.front();
+  t->high = bounds.back();
+  unsigned char r, g, b, a;
+
+  // Everything below the bounds is the first bin, at or above is one bin
+  const double justBelow = std::nextafter(t->low, -HUGE_VAL);
+  const size_t belowBin = std::upper_bound(myUpperBounds.begin(), myUpperBounds.end(), justBelow)
+    - myUpperBounds.begin();
+
+  if ((belowBin < myColorInfo.size()) && !myColorInfo[belowBin].myIsLinear) {
+    getDataColor(justBelow, r, g, b, a);
+    t->below     = packColor(r, g, b, a);
+    t->haveBelow = true;
+  }
+  const size_t aboveBin = std::upper_bound(myUpperBounds.begin(), myUpperBounds.end(), t->high)
+    - myUpperBounds.begin();
+
+  if ((aboveBin >= myColorInfo.size()) || !myColorInfo[aboveBin].myIsLinear) {
+    getDataColor(t->high, r, g, b, a);
+    t->above     = packColor(r, g, b, a);
+    t->haveAbove = true;
+  }
+
+  const double range = t->high - t->low;
+
+  if (range <= 0) {
+    myTable = t;
+    return myTable;
+  }
+
+  // Entry size is about one color step of the steepest linear bin
+  double step = range / 1024.0;
+
+  for (auto& z:myColorInfo) {
+    if (!std::isfinite(z.d) || (z.d <= 0)) { continue; }
+    if (z.myIsLinear) {
+      const int delta = std::max({ std::abs(z.r2 - z.r), std::abs(z.g2 - z.g),
+                                   std::abs(z.b2 - z.b), std::abs(z.a2 - z.a) });
+      if (delta > 0) { step = std::min(step, z.d / delta); }
+    } else {
+      step = std::min(step, z.d / 4.0);
+    }
+  }
+  const size_t n = std::max(size_t(1024), std::min(MAX_TABLE, size_t(std::ceil(range / step))));
+
+  t->scale = n / range;
+  t->colors.resize(n);
+  t->useTable.resize(n);
+
+  // Slop so rounding in the index can't cross a boundary
+  const double slop = 0.001 / t->scale;
+  auto boundAt      = bounds.begin();
+
+  for (size_t i = 0; i < n; ++i) {
+    const double start = t->low + i / t->scale;
+    const double end   = t->low + (i + 1) / t->scale;
+
+    while ((boundAt != bounds.end()) && (*boundAt < start - slop)) {
+      ++boundAt;
+    }
+    const bool split = (boundAt != bounds.end()) && (*boundAt <= end + slop);
+    t->useTable[i] = split ? 0 : 1;
+    getDataColor((start + end) / 2.0, r, g, b, a);
+    t->colors[i] = packColor(r, g, b, a);
+  }
+
+  myTable = t;
+  return myTable;
+} // DefaultColorMap::getTable
+
 void
 DefaultColorMap::getDataColor(double v, unsigned char& r, unsigned char& g, unsigned char& b, unsigned char& a) const
 {
@@ -429,3 +546,48 @@ DefaultColorMap::getColor(double v, unsigned char& r, unsigned char& g, unsigned
   }
   return getDataColor(v, r, g, b, a);
 }
+
+void
+DefaultColorMap::colorize(const float * values, uint32_t * colors, size_t count) const
+{
+  auto t = getTable();
+  unsigned char r, g, b, a;
+
+  myMissingColor.get(r, g, b, a);
+  const uint32_t missing = packColor(r, g, b, a);
+
+  myUnavailableColor.get(r, g, b, a);
+  const uint32_t unavailable = packColor(r, g, b, a);
+  const double n = t->colors.size();
+
+  for (size_t i = 0; i < count; ++i) {
+    const double v = values[i];
+
+    if (v == Constants::MissingData) {
+      colors[i] = missing;
+      continue;
+    }
+    if (v == Constants::DataUnavailable) {
+      colors[i] = unavailable;
+      continue;
+    }
+    const double x = (v - t->low) * t->scale;
+    if ((x >= 0) && (x < n)) {
+      const size_t k = size_t(x);
+      if (t->useTable[k]) {
+        colors[i] = t->colors[k];
+        continue;
+      }
+    } else if (t->haveBelow && (v < t->low)) {
+      colors[i] = t->below;
+      continue;
+    } else if (t->haveAbove && (v >= t->high)) {
+      colors[i] = t->above;
+      continue;
+    }
+
+    // Bin boundary, linear ends or nan
+    DefaultColorMap::getDataColor(v, r, g, b, a);
+    colors[i] = packColor(r, g, b, a);
+  }
+} // DefaultColorMap::colorize
@@ -6,6 +6,8 @@
 
 #include <memory>
 #include <map>
+#include <mutex>
+#include <cstdint>
 
 namespace rapio
 {
@@ -68,6 +70,30 @@ public:
   virtual void
   getColor(double v, unsigned char& r, unsigned char& g, unsigned char& b, unsigned char& a) const = 0;
 
+  /** Pack a color with red in the low byte, so in memory it's RGBA on
+   * little endian machines. */
+  static inline uint32_t
+  packColor(unsigned char r, unsigned char g, unsigned char b, unsigned char a)
+  {
+    return (uint32_t(r) | (uint32_t(g) << 8) | (uint32_t(b) << 16) | (uint32_t(a) << 24));
+  }
+
+  /** Unpack a color made by packColor */
+  static inline void
+  unpackColor(uint32_t c, unsigned char& r, unsigned char& g, unsigned char& b, unsigned char& a)
+  {
+    r = c & 0xFF;
+    g = (c >> 8) & 0xFF;
+    b = (c >> 16) & 0xFF;
+    a = (c >> 24) & 0xFF;
+  }
+
+  /** Colorize count values into packed colors, see packColor.  Renderers
+   * should call this with rows of data instead of getColor per value.
+   * The default calls getColor for each value. */
+  virtual void
+  colorize(const float * values, uint32_t * colors, size_t count) const;
+
   /** Set the missing color for colormap */
   void
   setMissingColor(unsigned char r, unsigned char g, unsigned char b, unsigned char a = 255)
@@ -141,8 +167,60 @@ public:
   virtual void
   getColor(double v, unsigned char& r, unsigned char& g, unsigned char& b, unsigned char& a) const override;
 
+  /** Colorize count values using the lookup table, which is built on
+   * the first call. */
+  virtual void
+  colorize(const float * values, uint32_t * colors, size_t count) const override;
+
+  /** Largest lookup table we build */
+  static constexpr size_t MAX_TABLE = 65536;
+
 protected:
 
+  /** Lookup table of colors over the bounds of the bins.  Entries that
+   * a bin boundary falls in aren't used, values there get the exact
+   * color from getDataColor.  Linear bins use the color at the middle
+   * of the entry, which is sized to about one color step. */
+  class ColorTable {
+public:
+    /** Value of the first entry */
+    double low;
+
+    /** Value at the end of the last entry */
+    double high;
+
+    /** Entries per data unit */
+    double scale;
+
+    /** Packed color of each entry */
+    std::vector<uint32_t> colors;
+
+    /** Can the entry be used, or is there a bin boundary in it? */
+    std::vector<unsigned char> useTable;
+
+    /** Color of all values below low */
+    uint32_t below;
+
+    /** Color of all values at or above high */
+    uint32_t above;
+
+    /** Is below one color? */
+    bool haveBelow;
+
+    /** Is above one color? */
+    bool haveAbove;
+  };
+
+  /** Get the lookup table, building it if needed */
+  std::shared_ptr<const ColorTable>
+  getTable() const;
+
+  /** Lock for building the table */
+  mutable std::mutex myTableLock;
+
+  /** The lookup table, reset when bins are added */
+  mutable std::shared_ptr<const ColorTable> myTable;
+
   /** Upper bound of each color bin */
   std::vector<double> myUpperBounds;
 
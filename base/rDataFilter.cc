@@ -61,6 +61,29 @@ applyBOOSTURL(const URL& infile, const URL& outfile, bi::filtering_streambuf<bi:
   return true;
 }
 
+/** A filtering stream that keeps its source alive */
+class FilteredIstream : public bi::filtering_istream {
+public:
+  /** Drop the chain before the source it reads goes away */
+  ~FilteredIstream(){ reset(); }
+
+  /** The stream we are filtering */
+  std::shared_ptr<std::istream> mySource;
+};
+
+/** Create a stream reading a source through a boost decompressor */
+template <typename T>
+std::shared_ptr<std::istream>
+applyBOOSTIstream(std::shared_ptr<std::istream> input, const T& filter)
+{
+  auto s = std::make_shared<FilteredIstream>();
+
+  s->mySource = input;
+  s->push(filter);
+  s->push(*input);
+  return s;
+}
+
 bool
 applyBOOSTOstream(std::vector<char>& input, std::vector<char>& output, bi::filtering_ostream& os)
 {
@@ -158,6 +181,12 @@ GZIPDataFilter::apply(std::vector<char>& input, std::vector<char>& output,
   return (applyBOOSTOstream(input, output, os));
 }
 
+std::shared_ptr<std::istream>
+GZIPDataFilter::applyStream(std::shared_ptr<std::istream> input)
+{
+  return applyBOOSTIstream(input, bi::gzip_decompressor());
+}
+
 bool
 GZIPDataFilter::applyURL(const URL& infile, const URL& outfile,
   std::map<std::string, std::string> &params)
@@ -203,6 +232,12 @@ BZIP2DataFilter::apply(std::vector<char>& input, std::vector<char>& output,
   return (applyBOOSTOstreamNew(input, output, os, startIndex, length));
 }
 
+std::shared_ptr<std::istream>
+BZIP2DataFilter::applyStream(std::shared_ptr<std::istream> input)
+{
+  return applyBOOSTIstream(input, bi::bzip2_decompressor());
+}
+
 bool
 BZIP2DataFilter::reverse(std::vector<char>& input, std::vector<char>& output,
   size_t startIndex, size_t length)
@@ -242,6 +277,12 @@ ZLIBDataFilter::apply(std::vector<char>& input, std::vector<char>& output,
   return (applyBOOSTOstream(input, output, os));
 }
 
+std::shared_ptr<std::istream>
+ZLIBDataFilter::applyStream(std::shared_ptr<std::istream> input)
+{
+  return applyBOOSTIstream(input, bi::zlib_decompressor());
+}
+
 bool
 ZLIBDataFilter::applyURL(const URL& infile, const URL& outfile,
   std::map<std::string, std::string> &params)
@@ -273,6 +314,12 @@ LZMADataFilter::apply(std::vector<char>& input, std::vector<char>& output,
   return (applyBOOSTOstream(input, output, os));
 }
 
+std::shared_ptr<std::istream>
+LZMADataFilter::applyStream(std::shared_ptr<std::istream> input)
+{
+  return applyBOOSTIstream(input, bi::lzma_decompressor());
+}
+
 bool
 LZMADataFilter::applyURL(const URL& infile, const URL& outfile,
   std::map<std::string, std::string> &params)
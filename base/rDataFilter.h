@@ -3,6 +3,7 @@
 #include <memory>
 #include <vector>
 #include <map>
+#include <istream>
 
 #define RAPIO_USE_SNAPPY 0
 
@@ -62,6 +63,15 @@ public:
     return false;
   }
 
+  /** Create a stream reading input through this filter, so a reader
+   * can decode a bit at a time without holding all of the input.
+   * The stream keeps input alive.  @return nullptr if we can't stream. */
+  virtual std::shared_ptr<std::istream>
+  applyStream(std::shared_ptr<std::istream> input)
+  {
+    return nullptr;
+  }
+
   /** Apply filter to a given URL, write to output location */
   virtual bool
   applyURL(const URL& infile, const URL& outfile,
@@ -91,6 +101,10 @@ public:
     size_t start_index = 0,
     size_t length      = 0) override;
 
+  /** Create a stream reading input through this filter */
+  virtual std::shared_ptr<std::istream>
+  applyStream(std::shared_ptr<std::istream> input) override;
+
   /** Apply filter to a given URL, write to output location */
   virtual bool
   applyURL(const URL& infile, const URL& outfile,
@@ -122,6 +136,10 @@ public:
     size_t start_index = 0,
     size_t length      = 0) override;
 
+  /** Create a stream reading input through this filter */
+  virtual std::shared_ptr<std::istream>
+  applyStream(std::shared_ptr<std::istream> input) override;
+
   /** Apply filter to a given URL, write to output location */
   virtual bool
   applyURL(const URL& infile, const URL& outfile,
@@ -147,6 +165,10 @@ public:
     size_t start_index = 0,
     size_t length      = 0) override;
 
+  /** Create a stream reading input through this filter */
+  virtual std::shared_ptr<std::istream>
+  applyStream(std::shared_ptr<std::istream> input) override;
+
   /** Apply filter to a given URL, write to output location */
   virtual bool
   applyURL(const URL& infile, const URL& outfile,
@@ -173,6 +195,10 @@ public:
     size_t start_index = 0,
     size_t length      = 0) override;
 
+  /** Create a stream reading input through this filter */
+  virtual std::shared_ptr<std::istream>
+  applyStream(std::shared_ptr<std::istream> input) override;
+
   /** Apply filter to a given URL, write to output location */
   virtual bool
   applyURL(const URL& infile, const URL& outfile,
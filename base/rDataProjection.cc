@@ -9,6 +9,8 @@
 #include "rProcessTimer.h"
 
 #include <iostream>
+#include <vector>
+#include <algorithm>
 
 using namespace rapio;
 using namespace std;
@@ -208,43 +210,93 @@ DataProjection::createResampledTile(std::shared_ptr<DataType> sourceData, std::m
   auto& destData = tileGrid->getFloat2DRef();
 
   // --------------------------------------------------------------
-  // 2. The Compositing Loop
-  // FIXME: Could make it actually mini-merge or something, or
-  // provide a visitor for doing different things
-  double atLat = top;
-
-  for (size_t y = 0; y < rows; ++y) {
+  // 2. Project the tile cells to Lat Lon.  Web mercator and lat lon
+  // marching are separable, so we only need a latitude per row and a
+  // longitude per column.  Anything else projects every cell at once.
+  const bool separable = isSeparable(proj);
+  const size_t cells   = rows * cols;
+  std::vector<double> lats, lons;
+
+  if (separable) {
+    lats.resize(rows);
+    lons.resize(cols);
+    double atLat = top;
+    for (size_t y = 0; y < rows; ++y) {
+      double queryLat = atLat, queryLon = left;
+      if (proj) {
+        proj->xyToLatLon(queryLon, atLat, queryLat, queryLon);
+      }
+      lats[y] = queryLat;
+      atLat  -= deltaLat;
+    }
     double atLon = left;
     for (size_t x = 0; x < cols; ++x) {
-      double queryLat = atLat, queryLon = atLon;
+      double queryLat = top, queryLon = atLon;
       if (proj) {
-        proj->xyToLatLon(atLon, atLat, queryLat, queryLon);
+        proj->xyToLatLon(atLon, queryLat, queryLat, queryLon);
       }
+      lons[x] = queryLon;
+      atLon  += deltaLon;
+    }
+  } else {
+    // In place, lons are x and lats are y going in
+    lats.resize(cells);
+    lons.resize(cells);
+    double atLat = top;
+    for (size_t y = 0; y < rows; ++y) {
+      double atLon = left;
+      for (size_t x = 0; x < cols; ++x) {
+        lats[y * cols + x] = atLat;
+        lons[y * cols + x] = atLon;
+        atLon += deltaLon;
+      }
+      atLat -= deltaLat;
+    }
+    if (!proj->bulkXyToLatLon(lons.data(), lats.data(), cells)) {
+      fLogSevere("Failed to project tile to Lat Lon.");
+      return nullptr;
+    }
+  }
 
-      // Top-down flattening: iterate backwards so the LAST added layer is ON TOP
-      float final_v = Constants::DataUnavailable;
+  // --------------------------------------------------------------
+  // 3. The Compositing Loop
+  // FIXME: Could make it actually mini-merge or something, or
+  // provide a visitor for doing different things
+  float * dest = destData.data();
+  std::vector<float> layer(cells);
 
-      for (auto it = projections.rbegin(); it != projections.rend(); ++it) {
-        float temp_v = (*it)->getValueAtLL(queryLat, queryLon);
+  std::fill(dest, dest + cells, Constants::DataUnavailable);
 
-        if (Constants::isGood(temp_v)) {
-          final_v = temp_v;
-          break; // Found our top-most valid pixel, stop digging!
-        }
+  // Top-down flattening: iterate backwards so the LAST added layer is ON TOP
+  for (auto it = projections.rbegin(); it != projections.rend(); ++it) {
+    if (separable) {
+      (*it)->getValuesAtLLGrid(lats.data(), rows, lons.data(), cols, layer.data());
+    } else {
+      (*it)->getValuesAtLL(lats.data(), lons.data(), layer.data(), cells);
+    }
 
+    size_t found = 0;
+    for (size_t i = 0; i < cells; ++i) {
+      if (Constants::isGood(dest[i])) {
+        found++; // Found our top-most valid pixel already
+        continue;
+      }
+      const float temp_v = layer[i];
+      if (Constants::isGood(temp_v)) {
+        dest[i] = temp_v;
+        found++;
+      } else if (dest[i] == Constants::DataUnavailable) {
         // If it's a sentinel (like MissingData), we temporarily hold onto it
         // if we don't have anything better yet, but we KEEP SEARCHING lower
         // layers in case they have a good pixel.
-        if (final_v == Constants::DataUnavailable) {
-          final_v = temp_v;
-        }
+        dest[i] = temp_v;
       }
+    }
 
-      destData[y][x] = final_v;
-
-      atLon += deltaLon;
+    // Every pixel good, lower layers can't show
+    if (found == cells) {
+      break;
     }
-    atLat -= deltaLat;
   }
   // --------------------------------------------------------------
 
@@ -252,6 +304,24 @@ DataProjection::createResampledTile(std::shared_ptr<DataType> sourceData, std::m
   return tileGrid;
 } // DataProjection::createResampledTile
 
+void
+DataProjection::getValuesAtLLGrid(const double * lats, size_t rows, const double * lons, size_t cols, float * out)
+{
+  std::vector<double> rowLats(cols);
+
+  for (size_t y = 0; y < rows; ++y) {
+    std::fill(rowLats.begin(), rowLats.end(), lats[y]);
+    getValuesAtLL(rowLats.data(), lons, out + (y * cols), cols);
+  }
+}
+
+bool
+DataProjection::isSeparable(std::shared_ptr<ProjLibProject> proj)
+{
+  // Our web mercator marching is, other projections we can't assume
+  return ((proj == nullptr) || (proj == theWebMercToLatLon));
+}
+
 bool
 DataProjection::getLLCoverage(const PTreeNode& fields, LLCoverage& c)
 {
@@ -82,6 +82,18 @@ public:
     }
   }
 
+  /** Fill a rows by cols grid where latitude only changes by row and
+   * longitude only by column, such as a web mercator tile.  Output is
+   * row major.  Default calls getValuesAtLL once per row. */
+  virtual void
+  getValuesAtLLGrid(const double * lats, size_t rows, const double * lons, size_t cols, float * out);
+
+  /** Is the projection from getBBOX separable, where x only changes
+   * longitude and y only changes latitude?  A nullptr projection is
+   * lat lon marching, which is. */
+  static bool
+  isSeparable(std::shared_ptr<ProjLibProject> proj);
+
   /** Calculate marching box for generating square images */
   static std::shared_ptr<ProjLibProject>
   getBBOX(std::map<std::string, std::string>& keys,
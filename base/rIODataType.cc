@@ -10,6 +10,8 @@
 #include "rIOPostProcessor.h"
 #include "rOS.h"
 
+#include <mutex>
+
 using namespace rapio;
 
 std::string
@@ -63,6 +65,26 @@ IODataType::getIOSpecializer(const std::string& name)
   return mySpecializers[name];
 }
 
+namespace {
+/** Shared by builders wrapping libraries that aren't thread safe */
+std::recursive_mutex theLibraryLock;
+}
+
+std::recursive_mutex&
+IODataType::getLibraryLock()
+{
+  return theLibraryLock;
+}
+
+std::unique_lock<std::recursive_mutex>
+IODataType::lockLibrary()
+{
+  if (isThreadSafe()) {
+    return std::unique_lock<std::recursive_mutex>();
+  }
+  return std::unique_lock<std::recursive_mutex>(getLibraryLock());
+}
+
 // -----------------------------------------------------------------------------------------
 // Reader stuff
 //
@@ -133,7 +155,11 @@ IODataType::readBufferImp(std::vector<char>& buffer, const std::string& factory)
 
   if (builder != nullptr) {
     // Create DataType and remember factory
-    std::shared_ptr<DataType> dt = builder->createDataTypeFromBuffer(buffer);
+    std::shared_ptr<DataType> dt;
+    {
+      auto lock = builder->lockLibrary();
+      dt = builder->createDataTypeFromBuffer(buffer);
+    }
     checkReadFactorySet(dt, f);
     return dt;
   } else {
@@ -150,7 +176,11 @@ IODataType::readDataType(const std::string& factoryparams, const std::string& fa
 
   if (builder != nullptr) {
     // Create DataType and remember factory
-    std::shared_ptr<DataType> dt = builder->createDataType(factoryparams);
+    std::shared_ptr<DataType> dt;
+    {
+      auto lock = builder->lockLibrary();
+      dt = builder->createDataType(factoryparams);
+    }
     checkReadFactorySet(dt, f);
     return dt;
   } else {
@@ -301,7 +331,13 @@ IODataType::writeout(std::shared_ptr<DataType> dt,
   outputParams["directfile"] = directFile ? "true" : "false"; // don't like this right now it's a suffix flag
 
   // Pass map to children.  Note: children can use the map to reply back to caller as well
-  bool success = encodeDataType(dt, outputParams);
+  // Background writers can get here at the same time as each other and
+  // as reads on the main thread
+  bool success = false;
+  {
+    auto lock = lockLibrary();
+    success = encodeDataType(dt, outputParams);
+  }
 
   // Generate a notification record on successful write of output file
   if (success) {
@@ -342,6 +378,7 @@ IODataType::writeBuffer(std::shared_ptr<DataType> dt,
   if (encoder == nullptr) { return 0; }
   // 2. Output file and generate records
   std::map<std::string, std::string> outputParams;
+  auto lock = encoder->lockLibrary();
 
   return (encoder->encodeDataTypeBuffer(dt, buffer, outputParams));
 }
@@ -5,6 +5,7 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <mutex>
 
 namespace rapio {
 class DataType;
@@ -220,6 +221,21 @@ protected:
     std::map<std::string, std::string>     & lookup
   ){ return false; }
 
+  /** Can we decode and encode on several threads at once?  Most builders
+   * wrap libraries such as netcdf or hdf5 that aren't thread safe, so
+   * by default reads and writes take turns. */
+  virtual bool
+  isThreadSafe(){ return false; }
+
+  /** Lock taken around decoding and encoding when not thread safe.
+   * Netcdf4 is built on hdf5, so by default all builders share one. */
+  virtual std::recursive_mutex&
+  getLibraryLock();
+
+  /** Lock our library for a read or write, unless we're thread safe */
+  std::unique_lock<std::recursive_mutex>
+  lockLibrary();
+
   /** Subclasses that can write to a character buffer can implement this.
    * Since not everything can write to a buffer, we default to nullptr */
   virtual size_t
@@ -4,16 +4,56 @@
 #include "rDataFilter.h"
 #include "rError.h"
 #include "rStrings.h"
+#include "rMemoryMappedFile.h"
 
 #include <fstream>
+#include <sstream>
 
 using namespace rapio;
 using namespace std;
 
+IOURLView::IOURLView(std::shared_ptr<MemoryMappedFile> m) : myMap(m)
+{
+  // Private copy on write mapping, so writes never reach the file
+  myData = const_cast<char *>(m->data());
+  mySize = m->size();
+}
+
+IOURLView::IOURLView(std::vector<char>&& buffer) : myBuffer(std::move(buffer))
+{
+  myData = myBuffer.data();
+  mySize = myBuffer.size();
+}
+
 int
 IOURL::read(const URL& url, std::vector<char>& buf)
 {
   // FIXME: Maybe a suffix 'loop' for processing nested formats
+  std::shared_ptr<DataFilter> f = Factory<DataFilter>::get(url.getSuffixLC(), "IOURL");
+
+  // Local compressed files uncompress straight from the file, so
+  // we never hold the compressed bytes in memory
+  if (url.isLocal() && (f != nullptr)) {
+    auto in = std::make_shared<std::ifstream>(url.getPath(), std::ios::binary);
+    if (!*in) {
+      fLogSevere("FAILED local file read {}", url.toString());
+      return (-1);
+    }
+    auto s = f->applyStream(in);
+    if (s != nullptr) {
+      std::vector<char> output;
+      char chunk[65536];
+      while (s->read(chunk, sizeof(chunk)) || (s->gcount() > 0)) {
+        output.insert(output.end(), chunk, chunk + s->gcount());
+      }
+      if (s->bad()) {
+        fLogSevere("FAILED to uncompress {}", url.toString());
+        return (-1);
+      }
+      buf = std::move(output);
+      return (buf.size());
+    }
+  }
 
   // Pull raw data into rawData buffer
   std::vector<char> rawData;
@@ -24,8 +64,6 @@ IOURL::read(const URL& url, std::vector<char>& buf)
 
   //  ------------------------------------------------------------
   // Choose a decompressor or directly move buffer
-  std::shared_ptr<DataFilter> f = Factory<DataFilter>::get(url.getSuffixLC(), "IOURL");
-
   if (f == nullptr) {
     buf = std::move(rawData);
   } else {
@@ -66,3 +104,63 @@ IOURL::readRaw(const URL& url, std::vector<char>& buf)
   }
   return (buf.size());
 } // IOURL::readRaw
+
+std::shared_ptr<IOURLView>
+IOURL::readView(const URL& url)
+{
+  // Local uncompressed, map it
+  if (url.isLocal() && (Factory<DataFilter>::get(url.getSuffixLC(), "IOURL") == nullptr)) {
+    auto m = MemoryMappedFile::Create(url.getPath(), true);
+    if (m != nullptr) {
+      m->adviseSequential();
+      return std::make_shared<IOURLView>(m);
+    }
+    // Empty files can't be mapped, fall through to a read
+  }
+
+  std::vector<char> buf;
+
+  if (read(url, buf) < 0) {
+    return nullptr;
+  }
+  return std::make_shared<IOURLView>(std::move(buf));
+}
+
+std::shared_ptr<std::istream>
+IOURL::openStream(const URL& url)
+{
+  std::shared_ptr<std::istream> in;
+
+  if (url.isLocal()) {
+    in = std::make_shared<std::ifstream>(url.getPath(), std::ios::binary);
+    if (!*in) {
+      fLogSevere("FAILED local file read {}", url.toString());
+      return nullptr;
+    }
+  } else {
+    std::vector<char> buf;
+    if (readRaw(url, buf) < 1) {
+      return nullptr;
+    }
+    in = std::make_shared<std::istringstream>(std::string(buf.begin(), buf.end()));
+  }
+
+  std::shared_ptr<DataFilter> f = Factory<DataFilter>::get(url.getSuffixLC(), "IOURL");
+
+  if (f == nullptr) {
+    return in;
+  }
+  auto s = f->applyStream(in);
+
+  if (s != nullptr) {
+    return s;
+  }
+
+  // Filter can't stream (snappy), so uncompress the whole thing
+  std::vector<char> buf;
+
+  if (read(url, buf) < 0) {
+    return nullptr;
+  }
+  return std::make_shared<std::istringstream>(std::string(buf.begin(), buf.end()));
+} // IOURL::openStream
@@ -5,8 +5,63 @@
 
 #include <string>
 #include <memory>
+#include <vector>
+#include <istream>
 
 namespace rapio {
+class MemoryMappedFile;
+
+/**
+ * A read only view of the bytes of a URL.  Local uncompressed files are
+ * memory mapped so nothing is copied, anything else is read into a
+ * buffer the view owns.  Hold the shared_ptr as long as data() is used.
+ *
+ * @ingroup rapio_data
+ * @brief Read only bytes of a URL.
+ */
+class IOURLView {
+public:
+
+  /** View of a mapped file */
+  IOURLView(std::shared_ptr<MemoryMappedFile> m);
+
+  /** View owning a read buffer */
+  IOURLView(std::vector<char>&& buffer);
+
+  /** Start of the bytes.  Writable for C libraries that want a void*,
+   * though nobody should write to it. */
+  char *
+  data() const { return myData; }
+
+  /** Number of bytes */
+  size_t
+  size() const { return mySize; }
+
+  /** Do we have no bytes? */
+  bool
+  empty() const { return (mySize == 0); }
+
+  /** Are we a file mapping vs a buffer copy? */
+  bool
+  isMapped() const { return (myMap != nullptr); }
+
+protected:
+
+  /** The mapping if mapped */
+  std::shared_ptr<MemoryMappedFile> myMap;
+
+  /** The buffer if read */
+  std::vector<char> myBuffer;
+
+  /** Start of bytes */
+  char * myData = nullptr;
+
+  /** Number of bytes */
+  size_t mySize = 0;
+
+  friend class IOURL;
+};
+
 /**
  * A framework to simplify URL reading.
  * @ingroup rapio_data
@@ -36,6 +91,25 @@ public:
   readRaw(const URL   & url,
     std::vector<char> & buffer);
 
+  /**
+   * Read `url' as a read only view.  Local uncompressed files are memory
+   * mapped with no copy, everything else goes through read().
+   *
+   * @return the view, or nullptr on error.
+   */
+  static std::shared_ptr<IOURLView>
+  readView(const URL& url);
+
+  /**
+   * Open `url' as a stream, uncompressing on the fly if the suffix has a
+   * streaming filter.  Readers that parse as they go can use this to
+   * avoid holding the whole file in memory.
+   *
+   * @return the stream, or nullptr on error.
+   */
+  static std::shared_ptr<std::istream>
+  openStream(const URL& url);
+
   /** Destroy a reader */
   virtual ~IOURL(){ }
 };
@@ -0,0 +1,94 @@
+#include "rMemoryMappedFile.h"
+#include "rError.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+
+using namespace rapio;
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+  close();
+}
+
+std::shared_ptr<MemoryMappedFile>
+MemoryMappedFile::Create(const std::string& filename, bool copyOnWrite)
+{
+  auto m = std::make_shared<MemoryMappedFile>();
+
+  if (!m->open(filename, copyOnWrite)) {
+    return nullptr;
+  }
+  return m;
+}
+
+bool
+MemoryMappedFile::open(const std::string& filename, bool copyOnWrite)
+{
+  close();
+
+  const int fd = ::open(filename.c_str(), O_RDONLY);
+
+  if (fd < 0) {
+    fLogDebug("Can't open {} for mapping: {}", filename, strerror(errno));
+    return false;
+  }
+
+  struct stat sb;
+
+  if ((fstat(fd, &sb) != 0) || (sb.st_size <= 0)) {
+    fLogDebug("Can't map empty or unreadable file {}", filename);
+    ::close(fd);
+    return false;
+  }
+
+  void * addr = copyOnWrite ?
+    mmap(nullptr, sb.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0) :
+    mmap(nullptr, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+  if (addr == MAP_FAILED) {
+    fLogSevere("Failed to map {}: {}", filename, strerror(errno));
+    ::close(fd);
+    return false;
+  }
+
+  myFD       = fd;
+  myData     = static_cast<const char *>(addr);
+  mySize     = sb.st_size;
+  myFilename = filename;
+  return true;
+} // MemoryMappedFile::open
+
+void
+MemoryMappedFile::close()
+{
+  if (myData != nullptr) {
+    munmap(const_cast<char *>(myData), mySize);
+    myData = nullptr;
+  }
+  if (myFD >= 0) {
+    ::close(myFD);
+    myFD = -1;
+  }
+  mySize = 0;
+  myFilename.clear();
+}
+
+void
+MemoryMappedFile::adviseSequential() const
+{
+  if (myData != nullptr) {
+    madvise(const_cast<char *>(myData), mySize, MADV_SEQUENTIAL);
+  }
+}
+
+void
+MemoryMappedFile::adviseRandom() const
+{
+  if (myData != nullptr) {
+    madvise(const_cast<char *>(myData), mySize, MADV_RANDOM);
+  }
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <rError.h>
+
+#include <string>
+#include <memory>
+
+namespace rapio {
+/** A read only memory mapped file.  The pages of the file are shared by
+ * every process mapping the same file, and the kernel only loads the parts
+ * actually touched.  The mapping is released on destruction, so hold a
+ * shared_ptr to this for as long as any pointers into data() are used.
+ *
+ * @code
+ * auto m = MemoryMappedFile::Create("/data/cache.bin");
+ * if (m) {
+ *   const float * f = m->getPointer<float>(headerSize);
+ * }
+ * @endcode
+ *
+ * @author Robert Toomey
+ * @ingroup rapio_utility
+ * @brief Read only memory mapped file.
+ */
+class MemoryMappedFile {
+public:
+
+  /** Create an unmapped file */
+  MemoryMappedFile() : myFD(-1), myData(nullptr), mySize(0){ }
+
+  /** Unmap on destruction */
+  ~MemoryMappedFile();
+
+  // Mappings can't be copied, share them with a shared_ptr
+  MemoryMappedFile(const MemoryMappedFile&) = delete;
+  MemoryMappedFile&
+  operator = (const MemoryMappedFile&) = delete;
+
+  /** Map a file read only, or return nullptr if it can't be mapped */
+  static std::shared_ptr<MemoryMappedFile>
+  Create(const std::string& filename, bool copyOnWrite = false);
+
+  /** Map a file read only.  Any current mapping is released first.
+   * With copyOnWrite the pages are private and writable, a page written
+   * to is copied and the file is never changed.  This is for libraries
+   * that want non-const memory but shouldn't write to it.
+   * @return false if the file couldn't be opened or mapped. */
+  bool
+  open(const std::string& filename, bool copyOnWrite = false);
+
+  /** Release the mapping */
+  void
+  close();
+
+  /** Are we mapped? */
+  bool
+  isOpen() const { return (myData != nullptr); }
+
+  /** Start of the mapped bytes */
+  const char *
+  data() const { return myData; }
+
+  /** Size of the mapped bytes */
+  size_t
+  size() const { return mySize; }
+
+  /** The file we mapped */
+  const std::string&
+  getFilename() const { return myFilename; }
+
+  /** Typed pointer at a byte offset, or nullptr if count values of T
+   * don't fit in the mapping from there. */
+  template <typename T>
+  const T *
+  getPointer(size_t offset, size_t count = 1) const
+  {
+    if ((myData == nullptr) || (offset > mySize) || (count * sizeof(T) > mySize - offset)) {
+      return nullptr;
+    }
+    return reinterpret_cast<const T *>(myData + offset);
+  }
+
+  /** Hint the kernel we'll read all of the mapping in order */
+  void
+  adviseSequential() const;
+
+  /** Hint the kernel we'll read randomly, so don't read ahead */
+  void
+  adviseRandom() const;
+
+protected:
+
+  /** File descriptor of the mapped file */
+  int myFD;
+
+  /** Start of the mapping */
+  const char * myData;
+
+  /** Size of the mapping */
+  size_t mySize;
+
+  /** The file we mapped */
+  std::string myFilename;
+};
+}
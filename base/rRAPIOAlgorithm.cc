@@ -54,6 +54,11 @@ RAPIOAlgorithm::initializeOptions(RAPIOOptions& o)
     "Simple executable to call post FML file writing using %filename%.");
   o.addGroup("postfml", "I/O");
   o.setHidden("postfml");
+  o.optional("writethreads",
+    "0",
+    "Number of background output writer threads, 0 writes in the calling thread.");
+  o.addGroup("writethreads", "I/O");
+  o.setHidden("writethreads");
 
   return RAPIOProgram::initializeOptions(o);
 }
@@ -69,6 +74,8 @@ RAPIOAlgorithm::addPostLoadedHelp(RAPIOOptions& o)
 
   o.addAdvancedHelp("postfml",
     "Allows you to run a command on a FML output file. The 'ldm' command maps to 'pqinsert -v -f EXP %filename%', but any command in path can be ran using available macros.  Example: 'file %filename%' or 'ldm' or 'aws cp %filename'.");
+  o.addAdvancedHelp("writethreads",
+    "Write output products in the background so processing isn't waiting on the disk.  Each product is always written by the same thread, so a product is written and notified in order, while different products write in parallel.  Each thread queues up to 4 writes, after that the algorithm waits.  Pending writes finish before exit.  Writers get their own copy of the DataType, and types that can't be copied are written in the calling thread.  Encoders that aren't thread safe, such as netcdf, still write one at a time.");
   // Now let subclasses declare more things.
   // We do it this way to keep the algorithms from having to call superclass first
   declareAdvancedHelp(o);
@@ -155,6 +162,11 @@ RAPIOAlgorithm::finalizeOptions(RAPIOOptions& o)
   myPostWrite = o.getString("postwrite");
   myPostFML   = o.getString("postfml");
 
+  const int writeThreads = o.getInteger("writethreads");
+  if (writeThreads > 0) {
+    myWritePool = std::make_shared<WriteOutputPool>(writeThreads, 4);
+  }
+
   return RAPIOProgram::finalizeOptions(o);
 }
 
@@ -175,8 +187,20 @@ RAPIOAlgorithm::execute()
     new ProcessTimer("Algorithm total runtime"));
 
   EventLoop::doEventLoop();
+
+  // Don't lose any output still in the background
+  drainOutputWrites();
 } // RAPIOAlgorithm::execute
 
+void
+RAPIOAlgorithm::drainOutputWrites()
+{
+  if (myWritePool) {
+    myWritePool->drain();
+    myWritePool->logStats();
+  }
+}
+
 void
 RAPIOAlgorithm::handleRecordEvent(const Record& rec)
 {
@@ -219,6 +243,7 @@ RAPIOAlgorithm::handleEndDatasetEvent()
     // FIXME: maybe just end event loop here, do a shutdown
     // Log::setSeverity(Log::Severity::INFO);
     fLogInfo("End of archive data set, {} of {} processed.", RecordQueue::poppedRecords, RecordQueue::pushedRecords);
+    drainOutputWrites();
     Log::flush();
     EventLoop::exit(0);
   } else {
@@ -318,45 +343,68 @@ RAPIOAlgorithm::writeOutputProduct(const std::string& key,
   outputParams["postfml"]      = myPostFML;
 
   if (isProductWanted(key)) {
-    // Original typeName, which may match key or not
-    const std::string typeName = outputData->getTypeName();
-
     // Resolve using the "-O key=resolved, if exists"
-    const std::string newProductName = resolveProductName(key, typeName);
+    const std::string newProductName = resolveProductName(key, outputData->getTypeName());
 
-    // Write DataType with given typename, or optionally filtered to new typename by -O
-    const bool changeProductName = (typeName != newProductName);
-    if (changeProductName) {
-      fLogInfo("Writing '{}' as product name '{}'", typeName, newProductName);
-      outputData->setTypeName(newProductName);
-    }
-
-    const auto& writers = ConfigParamGroupo::getWriteOutputInfo();
-    for (auto& w:writers) {
-      // Hardset writer to one only...this requires a writer=/path in -o to work
-      // For example 2D fusion forces hmrg binary by -o hmrg=/path and setting onewriter to hmrg
-      if (!outputParams["onewriter"].empty()) {
-        if (w.factory != outputParams["onewriter"]) {
-          continue;
-        }
-      }
+    // Background writers get their own copy, since callers keep changing
+    // and reusing their DataTypes.  Anything we can't copy is written now.
+    std::shared_ptr<DataType> copy = myWritePool ? outputData->cloneDataType() : nullptr;
 
-      // Can call write multiple times for each output wanted.
-      std::vector<Record> records;
-      const bool success = IODataType::write(outputData, w.outputinfo, records, w.factory, outputParams);
-
-      if (success) { // Only notify iff the file writes successfully
-        // Get back the output folder for notifications
-        // and notify each notifier for this writer.
-        for (auto& n:PluginNotifier::theNotifiers) { // if any, use
-          n->writeRecords(outputParams, records);
-        }
-      } // Not gonna error..writers should be complaining
+    if (copy != nullptr) {
+      myWritePool->enqueue(std::make_shared<WriteOutputThreadTask>(this, myWritePool.get(), key, copy,
+        outputParams, newProductName));
+    } else {
+      writeOutputProductNow(key, outputData, outputParams, newProductName);
     }
-
-    // Restore original typename, does matter since DataType might be reused.
-    outputData->setTypeName(typeName);
   } else {
     fLogInfo("Skipping write for -O unwanted product '{}'", key);
   }
 } // RAPIOAlgorithm::writeOutputProduct
+
+void
+RAPIOAlgorithm::writeOutputProductNow(const std::string& key,
+  std::shared_ptr<DataType>                            outputData,
+  std::map<std::string, std::string>                   & outputParams,
+  const std::string                                    & newProductName)
+{
+  // Original typeName, which may match key or not
+  const std::string typeName = outputData->getTypeName();
+
+  // Write DataType with given typename, or optionally filtered to new typename by -O
+  const bool changeProductName = (typeName != newProductName);
+
+  if (changeProductName) {
+    fLogInfo("Writing '{}' as product name '{}'", typeName, newProductName);
+    outputData->setTypeName(newProductName);
+  }
+
+  const auto& writers = ConfigParamGroupo::getWriteOutputInfo();
+
+  for (auto& w:writers) {
+    // Hardset writer to one only...this requires a writer=/path in -o to work
+    // For example 2D fusion forces hmrg binary by -o hmrg=/path and setting onewriter to hmrg
+    if (!outputParams["onewriter"].empty()) {
+      if (w.factory != outputParams["onewriter"]) {
+        continue;
+      }
+    }
+
+    // Can call write multiple times for each output wanted.
+    std::vector<Record> records;
+    const bool success = IODataType::write(outputData, w.outputinfo, records, w.factory, outputParams);
+
+    if (success) { // Only notify iff the file writes successfully
+      // Get back the output folder for notifications
+      // and notify each notifier for this writer.
+      // Notifiers aren't thread safe, so one at a time with background writers
+      static std::mutex notifyLock;
+      std::lock_guard<std::mutex> lock(notifyLock);
+      for (auto& n:PluginNotifier::theNotifiers) { // if any, use
+        n->writeRecords(outputParams, records);
+      }
+    } // Not gonna error..writers should be complaining
+  }
+
+  // Restore original typename, does matter since DataType might be reused.
+  outputData->setTypeName(typeName);
+} // RAPIOAlgorithm::writeOutputProductNow
@@ -3,6 +3,7 @@
 #include <rRAPIOProgram.h>
 #include <rRAPIOOptions.h>
 #include <rRAPIOData.h>
+#include <rThreadGroup.h>
 
 #include <string>
 #include <vector>
@@ -52,6 +53,12 @@ public:
   virtual void
   handleRecordEvent(const Record& rec);
 
+  /** Can queued records like this one be coalesced?  If true, when
+   * several records of the same product are waiting only the newest is
+   * processed.  For algorithms where new data makes older obsolete. */
+  virtual bool
+  isRecordCoalescable(const Record&){ return false; }
+
   /** Handle end of event index event (sent by archives) */
   virtual void
   handleEndDatasetEvent();
@@ -71,12 +78,25 @@ public:
   }
 
   /** Write data to given key.  Key must exist/match the keys from
-   * addOutputProduct */
+   * addOutputProduct.  With -writethreads a copy of outputData is
+   * written in the background, so the caller is free to reuse it. */
   virtual void
   writeOutputProduct(const std::string& key,
     std::shared_ptr<DataType>         outputData,
     std::map<std::string, std::string>& outputParams);
 
+  /** Write data now with a resolved product name to each writer, then
+   * notify.  Called by writeOutputProduct or a background writer. */
+  virtual void
+  writeOutputProductNow(const std::string& key,
+    std::shared_ptr<DataType>            outputData,
+    std::map<std::string, std::string>   & outputParams,
+    const std::string                    & productName);
+
+  /** Wait for any background writes to finish */
+  void
+  drainOutputWrites();
+
   /** Write data to given key.  Key must exist/match the keys from
    * addOutputProduct */
   virtual void
@@ -144,6 +164,9 @@ protected:
   /** Hold the postfml command, if any */
   std::string myPostFML;
 
+  /** Background writers if -writethreads is set */
+  std::shared_ptr<WriteOutputPool> myWritePool;
+
   /** History time for index storage */
   static TimeDuration myMaximumHistory;
 };
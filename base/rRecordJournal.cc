@@ -0,0 +1,518 @@
+#include "rRecordJournal.h"
+
+#include "rError.h"
+#include "rOS.h"
+#include "rConstants.h"
+#include "rRecordFilter.h"
+
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace rapio;
+
+const std::string RecordJournal::SEQUENCE_FILE  = "sequence";
+const std::string RecordJournal::SEGMENT_SUFFIX = ".jrn";
+
+namespace {
+/** Append a plain value */
+template <typename T>
+void
+put(std::vector<char>& out, const T& v)
+{
+  const char * p = reinterpret_cast<const char *>(&v);
+
+  out.insert(out.end(), p, p + sizeof(T));
+}
+
+/** Append a length prefixed string */
+void
+putString(std::vector<char>& out, const std::string& s)
+{
+  put<uint32_t>(out, s.size());
+  out.insert(out.end(), s.begin(), s.end());
+}
+
+/** Read a plain value */
+template <typename T>
+T
+get(const char * p)
+{
+  T v;
+
+  std::memcpy(&v, p, sizeof(T));
+  return v;
+}
+
+/** Read a length prefixed string, false if it runs past end */
+bool
+getString(const char *& p, const char * end, std::string& s)
+{
+  if (end - p < 4) { return false; }
+  const uint32_t l = get<uint32_t>(p);
+
+  p += 4;
+  if ((size_t) (end - p) < l) { return false; }
+  s.assign(p, l);
+  p += l;
+  return true;
+}
+}
+
+std::vector<uint64_t>
+RecordJournal::getSegments(const std::string& dir)
+{
+  std::vector<uint64_t> segments;
+  DIR * dirp = opendir(dir.c_str());
+
+  if (dirp == nullptr) {
+    return segments;
+  }
+  struct dirent * dp;
+
+  while ((dp = readdir(dirp)) != nullptr) {
+    const std::string name = dp->d_name;
+    if ((name.size() > SEGMENT_SUFFIX.size()) &&
+      (name.compare(name.size() - SEGMENT_SUFFIX.size(), SEGMENT_SUFFIX.size(), SEGMENT_SUFFIX) == 0))
+    {
+      char * stop;
+      const uint64_t n = strtoull(name.c_str(), &stop, 10);
+      if (stop == name.c_str() + name.size() - SEGMENT_SUFFIX.size()) {
+        segments.push_back(n);
+      }
+    }
+  }
+  closedir(dirp);
+  std::sort(segments.begin(), segments.end());
+  return segments;
+}
+
+std::string
+RecordJournal::getSegmentPath(const std::string& dir, uint64_t segment)
+{
+  char name[32];
+
+  snprintf(name, sizeof(name), "%08llu", (unsigned long long) segment);
+  return dir + "/" + name + SEGMENT_SUFFIX;
+}
+
+uint32_t
+RecordJournal::checksum(const char * data, size_t length)
+{
+  // FNV-1a, catches torn or stale bytes, not meant to be secure
+  uint32_t h = 2166136261u;
+
+  for (size_t i = 0; i < length; ++i) {
+    h ^= static_cast<unsigned char>(data[i]);
+    h *= 16777619u;
+  }
+  return h;
+}
+
+void
+RecordJournal::encode(const Record& rec, const std::string& indexPath, std::vector<char>& out)
+{
+  const size_t start = out.size();
+  const auto& params = rec.getParams();
+  const auto& keys   = rec.getKeys();
+  const auto& values = rec.getValues();
+  const Time& t      = rec.getTime();
+
+  // Header, payload length filled in after
+  put<uint32_t>(out, RECORD_MAGIC);
+  put<uint32_t>(out, 0);
+  put<int64_t>(out, t.getSecondsSinceEpoch());
+  put<double>(out, t.getFractional());
+  put<uint16_t>(out, params.size());
+  put<uint16_t>(out, keys.size());
+  put<uint32_t>(out, 0);
+
+  // Payload
+  putString(out, rec.getDataType());
+  putString(out, rec.getSubType());
+  for (auto& p:params) {
+    putString(out, (!indexPath.empty() && (p == indexPath)) ? Constants::IndexPathReplace : p);
+  }
+  for (size_t i = 0; i < keys.size(); ++i) {
+    putString(out, keys[i]);
+    putString(out, values[i]);
+  }
+
+  const uint32_t payload = out.size() - start - RECORD_HEADER;
+
+  std::memcpy(&out[start + 4], &payload, 4);
+  put<uint32_t>(out, checksum(&out[start], out.size() - start));
+} // RecordJournal::encode
+
+long
+RecordJournal::decode(const char * data, size_t length, const std::string& indexPath,
+  size_t indexLabel, Record& rec)
+{
+  if (length < RECORD_HEADER) {
+    return 0;
+  }
+  if (get<uint32_t>(data) != RECORD_MAGIC) {
+    return -1;
+  }
+  const uint32_t payload = get<uint32_t>(data + 4);
+  const size_t total     = RECORD_HEADER + payload + RECORD_TRAILER;
+
+  if (length < total) {
+    return 0;
+  }
+  if (get<uint32_t>(data + RECORD_HEADER + payload) != checksum(data, RECORD_HEADER + payload)) {
+    return -1;
+  }
+
+  const int64_t seconds    = get<int64_t>(data + 8);
+  const double fractional  = get<double>(data + 16);
+  const uint16_t numParams = get<uint16_t>(data + 24);
+  const uint16_t numKeys   = get<uint16_t>(data + 26);
+  const char * p   = data + RECORD_HEADER;
+  const char * end = p + payload;
+  std::string dataType, subType;
+  std::vector<std::string> params(numParams);
+
+  if (!getString(p, end, dataType) || !getString(p, end, subType)) {
+    return -1;
+  }
+  for (auto& s:params) {
+    if (!getString(p, end, s)) { return -1; }
+    if (s == Constants::IndexPathReplace) {
+      s = indexPath;
+    }
+  }
+  rec = Record();
+  std::string k, v;
+
+  for (size_t i = 0; i < numKeys; ++i) {
+    if (!getString(p, end, k) || !getString(p, end, v)) { return -1; }
+    rec.setValue(k, v);
+  }
+
+  rec.setIndexNumber(indexLabel);
+  rec.setTime(Time::SecondsSinceEpoch(seconds, fractional));
+  if (!params.empty()) {
+    std::vector<std::string> selections = { "", dataType, subType };
+    rec.setParams(params);
+    rec.setSelections(selections);
+  }
+  return total;
+} // RecordJournal::decode
+
+RecordJournalWriter::RecordJournalWriter(const std::string& dir, size_t maxBytes, size_t keep)
+  : myDir(dir), myMaxBytes(maxBytes), myKeep(std::max(size_t(1), keep)), mySegment(0), myFD(-1),
+  mySequence(nullptr)
+{ }
+
+RecordJournalWriter::~RecordJournalWriter()
+{
+  if (myFD >= 0) {
+    ::close(myFD);
+  }
+  if (mySequence != nullptr) {
+    munmap(mySequence, sizeof(uint64_t));
+  }
+}
+
+void
+RecordJournalWriter::openSequence()
+{
+  const std::string path = myDir + "/" + RecordJournal::SEQUENCE_FILE;
+  const int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+
+  if (fd < 0) {
+    return;
+  }
+
+  // A page, zero filled on creation.  Ftruncate only grows it.
+  struct stat sb;
+
+  if ((fstat(fd, &sb) == 0) && (sb.st_size < 4096)) {
+    if (ftruncate(fd, 4096) != 0) {
+      ::close(fd);
+      return;
+    }
+  }
+  void * addr = mmap(nullptr, sizeof(uint64_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+  ::close(fd);
+  if (addr != MAP_FAILED) {
+    mySequence = static_cast<uint64_t *>(addr);
+  }
+}
+
+bool
+RecordJournalWriter::openSegment()
+{
+  if (myFD < 0) {
+    if (!OS::mkdirp(myDir)) {
+      fLogSevere("Couldn't access/create journal directory: {}", myDir);
+      return false;
+    }
+    if (mySequence == nullptr) {
+      openSequence();
+    }
+    auto segments = RecordJournal::getSegments(myDir);
+    mySegment = segments.empty() ? 1 : segments.back();
+  }
+
+  for (;;) {
+    // Continue the current segment if it has room.  The shared lock is
+    // held until the append is written, so a reader draining the segment
+    // under an exclusive lock can't miss a write that saw room here
+    if (myFD >= 0) {
+      struct stat sb;
+      flock(myFD, LOCK_SH);
+      if ((fstat(myFD, &sb) == 0) && ((size_t) sb.st_size < myMaxBytes)) {
+        return true;
+      }
+      flock(myFD, LOCK_UN);
+      ::close(myFD);
+      myFD = -1;
+      mySegment++;
+    }
+
+    // Create it, or join it if another writer beat us
+    const std::string path = RecordJournal::getSegmentPath(myDir, mySegment);
+    int fd = ::open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_EXCL, 0644);
+
+    if (fd >= 0) {
+      char header[RecordJournal::SEGMENT_HEADER];
+      const uint64_t magic = RecordJournal::SEGMENT_MAGIC;
+      std::memcpy(header, &magic, 8);
+      std::memcpy(header + 8, &mySegment, 8);
+      if (::write(fd, header, sizeof(header)) != (ssize_t) sizeof(header)) {
+        fLogSevere("Failed to write journal segment {}", path);
+        ::close(fd);
+        return false;
+      }
+      myFD = fd;
+      purgeSegments();
+    } else if (errno == EEXIST) {
+      myFD = ::open(path.c_str(), O_WRONLY | O_APPEND);
+    }
+    if (myFD < 0) {
+      fLogSevere("Failed to open journal segment {}", path);
+      return false;
+    }
+  }
+} // RecordJournalWriter::openSegment
+
+void
+RecordJournalWriter::purgeSegments()
+{
+  for (auto s:RecordJournal::getSegments(myDir)) {
+    if (s + myKeep <= mySegment) {
+      OS::deleteFile(RecordJournal::getSegmentPath(myDir, s));
+    }
+  }
+}
+
+bool
+RecordJournalWriter::append(const Record& rec, const std::string& indexPath)
+{
+  if (!openSegment()) {
+    return false;
+  }
+  myBuffer.clear();
+  RecordJournal::encode(rec, indexPath, myBuffer);
+
+  // One append, so readers see the whole record or wait for it
+  const ssize_t wrote = ::write(myFD, myBuffer.data(), myBuffer.size());
+
+  flock(myFD, LOCK_UN);
+  if (wrote != (ssize_t) myBuffer.size()) {
+    fLogSevere("Failed to append record to journal {}", myDir);
+    ::close(myFD);
+    myFD = -1;
+    return false;
+  }
+  if (mySequence != nullptr) {
+    __atomic_fetch_add(mySequence, 1, __ATOMIC_RELEASE);
+  }
+  return true;
+}
+
+RecordJournalReader::RecordJournalReader(const std::string& dir, const std::string& indexPath,
+  size_t indexLabel)
+  : myDir(dir), myIndexPath(indexPath), myIndexLabel(indexLabel), mySegment(0), myFD(-1),
+  myOffset(0), myLastSequence(0), myBadOffset(0)
+{ }
+
+RecordJournalReader::~RecordJournalReader()
+{
+  if (myFD >= 0) {
+    ::close(myFD);
+  }
+}
+
+bool
+RecordJournalReader::openSegment(uint64_t segment, size_t offset)
+{
+  if (myFD >= 0) {
+    ::close(myFD);
+  }
+  mySegment = segment;
+  myOffset  = offset;
+  myFD      = ::open(RecordJournal::getSegmentPath(myDir, segment).c_str(), O_RDONLY);
+  return (myFD >= 0);
+}
+
+bool
+RecordJournalReader::open(bool fromStart)
+{
+  auto segments = RecordJournal::getSegments(myDir);
+
+  if (segments.empty()) {
+    // Nothing written yet, start with the first
+    mySegment = 1;
+    myOffset  = RecordJournal::SEGMENT_HEADER;
+  } else if (fromStart) {
+    openSegment(segments.front(), RecordJournal::SEGMENT_HEADER);
+  } else {
+    // Skip to the end of the newest, a record at a time
+    openSegment(segments.back(), RecordJournal::SEGMENT_HEADER);
+    std::vector<Record> skipped;
+    while (read(skipped, 1000) > 0) {
+      skipped.clear();
+    }
+  }
+
+  mySequence = MemoryMappedFile::Create(myDir + "/" + RecordJournal::SEQUENCE_FILE);
+  if (mySequence != nullptr) {
+    auto * s = mySequence->getPointer<uint64_t>(0);
+    myLastSequence = (s != nullptr) ? __atomic_load_n(s, __ATOMIC_ACQUIRE) : 0;
+  }
+  return true;
+}
+
+bool
+RecordJournalReader::hasNew() const
+{
+  if (mySequence == nullptr) {
+    return true;
+  }
+  auto * s = mySequence->getPointer<uint64_t>(0);
+
+  return (s == nullptr) || (__atomic_load_n(s, __ATOMIC_ACQUIRE) != myLastSequence);
+}
+
+bool
+RecordJournalReader::nextSegment(bool drain)
+{
+  // Only move on once a newer segment exists, which means the current
+  // one is full
+  auto segments = RecordJournal::getSegments(myDir);
+  auto it       = std::upper_bound(segments.begin(), segments.end(), mySegment);
+
+  if (it == segments.end()) {
+    return false;
+  }
+
+  // Other writers may still be appending to the full segment if they
+  // checked its size before it filled.  Wait them out, then stay if they
+  // left anything.  Any writer after this sees it full and rotates.
+  if (drain && (myFD >= 0)) {
+    struct stat sb;
+    flock(myFD, LOCK_EX);
+    const bool more = (fstat(myFD, &sb) == 0) && ((size_t) sb.st_size > myOffset);
+    flock(myFD, LOCK_UN);
+    if (more) {
+      return false;
+    }
+  }
+  openSegment(*it, RecordJournal::SEGMENT_HEADER);
+  return true;
+}
+
+size_t
+RecordJournalReader::read(std::vector<Record>& out, size_t max)
+{
+  // Late start of the sequence counter, writer made the journal after us
+  if (mySequence == nullptr) {
+    mySequence = MemoryMappedFile::Create(myDir + "/" + RecordJournal::SEQUENCE_FILE);
+  }
+  if (mySequence != nullptr) {
+    auto * s = mySequence->getPointer<uint64_t>(0);
+    if (s != nullptr) {
+      myLastSequence = __atomic_load_n(s, __ATOMIC_ACQUIRE);
+    }
+  }
+
+  if ((myFD < 0) && !openSegment(mySegment, myOffset)) {
+    // Purged out from under us or not created yet
+    auto segments = RecordJournal::getSegments(myDir);
+    if (segments.empty() || !openSegment(std::max(segments.front(), mySegment),
+      (segments.front() > mySegment) ? RecordJournal::SEGMENT_HEADER : myOffset))
+    {
+      return 0;
+    }
+  }
+
+  size_t count = 0;
+  size_t have  = 0; // Bytes in buffer from myOffset
+
+  while (count < max) {
+    // Fill more of the segment after what we have
+    if (myBuffer.size() < have + 65536) {
+      myBuffer.resize(have + 65536);
+    }
+    const ssize_t got = pread(myFD, &myBuffer[have], myBuffer.size() - have, myOffset + have);
+    if (got > 0) {
+      have += got;
+    }
+
+    size_t used = 0;
+    bool bad    = false;
+    while (count < max) {
+      Record rec;
+      const long n = RecordJournal::decode(&myBuffer[used], have - used, myIndexPath, myIndexLabel, rec);
+      if (n == 0) { break; }
+      if (n < 0) { bad = true; break; }
+      used += n;
+
+      // Records representing data are filtered. Messages aren't
+      if (!rec.isData() || (Record::theRecordFilter == nullptr) || Record::theRecordFilter->wanted(rec)) {
+        out.push_back(std::move(rec));
+      }
+      count++;
+    }
+    myOffset += used;
+    have     -= used;
+    if (used > 0) {
+      std::memmove(&myBuffer[0], &myBuffer[used], have);
+    }
+
+    if (bad) {
+      if (myBadOffset != myOffset) {
+        fLogSevere("Bad record in journal segment {} at {}, skipping rest of segment",
+          RecordJournal::getSegmentPath(myDir, mySegment), myOffset);
+        myBadOffset = myOffset;
+      }
+      if (!nextSegment(false)) {
+        // Stay at the bad spot, maybe a writer is mid write
+        return count;
+      }
+      have = 0;
+      continue;
+    }
+
+    // Nothing more in this segment right now
+    if ((got <= 0) && (used == 0)) {
+      if ((have == 0) && nextSegment(true)) {
+        continue;
+      }
+      // Pick up anything a late writer left on the next read
+      break;
+    }
+  }
+  return count;
+} // RecordJournalReader::read
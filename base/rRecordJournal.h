@@ -0,0 +1,214 @@
+#pragma once
+
+#include <rRecord.h>
+#include <rMemoryMappedFile.h>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+namespace rapio {
+/** Layout of the record journal files.
+ *
+ * A journal is a directory of numbered segment files, such as
+ * code_index.jrn/00000001.jrn, plus a small 'sequence' file.  Writers
+ * append records to the newest segment and start a new segment when it
+ * gets too big.  Each record is a fixed header, a block of length
+ * prefixed strings and a checksum, written with one append so a reader
+ * either sees a whole record or knows to wait.  After each record a
+ * writer bumps the counter in the memory mapped sequence file, so
+ * readers can check for new records without touching the file system.
+ *
+ * @author Robert Toomey
+ * @ingroup rapio_io
+ * @brief Binary append only journal of records
+ */
+class RecordJournal {
+public:
+
+  /** Magic at the start of each segment */
+  static constexpr uint64_t SEGMENT_MAGIC = 0x31304C4E524A5252ULL; // "RRJRNL01"
+
+  /** Magic at the start of each record */
+  static constexpr uint32_t RECORD_MAGIC = 0x4345524A; // "JREC"
+
+  /** Bytes in a segment header, magic then segment number */
+  static constexpr size_t SEGMENT_HEADER = 16;
+
+  /** Bytes in a record header */
+  static constexpr size_t RECORD_HEADER = 32;
+
+  /** Bytes of the checksum after each record */
+  static constexpr size_t RECORD_TRAILER = 4;
+
+  /** Name of the sequence counter file in a journal directory */
+  static const std::string SEQUENCE_FILE;
+
+  /** Suffix of segment files */
+  static const std::string SEGMENT_SUFFIX;
+
+  /** Segment numbers in a journal directory, oldest first */
+  static std::vector<uint64_t>
+  getSegments(const std::string& dir);
+
+  /** Full path of a segment */
+  static std::string
+  getSegmentPath(const std::string& dir, uint64_t segment);
+
+  /** Checksum of record bytes */
+  static uint32_t
+  checksum(const char * data, size_t length);
+
+  /** Append the bytes of a record to a buffer.  Params matching
+   * indexPath are stored as the index location macro, like FML. */
+  static void
+  encode(const Record& rec, const std::string& indexPath, std::vector<char>& out);
+
+  /** Decode the record at data, which has length bytes available.
+   * @return bytes used, 0 if the record isn't complete yet, or -1 if
+   * the bytes aren't a valid record. */
+  static long
+  decode(const char * data, size_t length, const std::string& indexPath,
+    size_t indexLabel, Record& rec);
+};
+
+/** Appends records to a journal directory.
+ * @ingroup rapio_io
+ * @brief Appends records to a journal directory
+ */
+class RecordJournalWriter {
+public:
+
+  /** Write to the journal in dir, rotating segments at maxBytes and
+   * keeping at most keep segments around. */
+  RecordJournalWriter(const std::string& dir,
+    size_t maxBytes = 64 * 1024 * 1024, size_t keep = 8);
+
+  /** Close files */
+  ~RecordJournalWriter();
+
+  /** Append a record.  @return false on a write error. */
+  bool
+  append(const Record& rec, const std::string& indexPath);
+
+  /** Current segment number */
+  uint64_t
+  getSegment() const { return mySegment; }
+
+protected:
+
+  /** Open the newest segment, or the next if the newest is full.  On
+   * success a shared lock is held on it until the append is written. */
+  bool
+  openSegment();
+
+  /** Map the sequence counter, creating it if needed */
+  void
+  openSequence();
+
+  /** Delete segments older than we keep */
+  void
+  purgeSegments();
+
+  /** Journal directory */
+  std::string myDir;
+
+  /** Size to start a new segment */
+  size_t myMaxBytes;
+
+  /** Segments to keep */
+  size_t myKeep;
+
+  /** Current segment */
+  uint64_t mySegment;
+
+  /** Descriptor of the current segment */
+  int myFD;
+
+  /** Mapped sequence counter, if any */
+  uint64_t * mySequence;
+
+  /** Reused encode buffer */
+  std::vector<char> myBuffer;
+};
+
+/** Follows a journal directory by offset, reading new records.
+ * @ingroup rapio_io
+ * @brief Follows a journal directory reading new records
+ */
+class RecordJournalReader {
+public:
+
+  /** Read the journal in dir */
+  RecordJournalReader(const std::string& dir, const std::string& indexPath,
+    size_t indexLabel);
+
+  /** Close files */
+  ~RecordJournalReader();
+
+  /** Start at the oldest record, or after the newest one */
+  bool
+  open(bool fromStart);
+
+  /** Has the sequence counter moved since we last read?  Always true
+   * when there's no counter to check. */
+  bool
+  hasNew() const;
+
+  /** Read up to max new complete records into out.
+   * @return the number read. */
+  size_t
+  read(std::vector<Record>& out, size_t max);
+
+  /** Current segment */
+  uint64_t
+  getSegment() const { return mySegment; }
+
+  /** Offset in the current segment */
+  size_t
+  getOffset() const { return myOffset; }
+
+protected:
+
+  /** Open a segment at an offset */
+  bool
+  openSegment(uint64_t segment, size_t offset);
+
+  /** Move past the end of a segment if a newer one exists.  With drain,
+   * first wait for writers still appending to the current segment and
+   * stay if they added to it. */
+  bool
+  nextSegment(bool drain);
+
+  /** Journal directory */
+  std::string myDir;
+
+  /** Index path for the records */
+  std::string myIndexPath;
+
+  /** Index label for the records */
+  size_t myIndexLabel;
+
+  /** Current segment */
+  uint64_t mySegment;
+
+  /** Descriptor of the current segment */
+  int myFD;
+
+  /** Offset of the next record in the segment */
+  size_t myOffset;
+
+  /** Sequence counter mapping */
+  std::shared_ptr<MemoryMappedFile> mySequence;
+
+  /** Sequence value when we last read */
+  uint64_t myLastSequence;
+
+  /** Read buffer */
+  std::vector<char> myBuffer;
+
+  /** Offset of the last bad record we logged */
+  size_t myBadOffset;
+};
+}
@@ -4,26 +4,106 @@
 #include <rError.h>
 
 #include <queue>
+#include <chrono>
 
 using namespace rapio;
 using namespace std;
 
 // In theory we could wrap
-long long RecordQueue::pushedRecords = 0;
-long long RecordQueue::poppedRecords = 0;
+long long RecordQueue::pushedRecords    = 0;
+long long RecordQueue::poppedRecords    = 0;
+long long RecordQueue::duplicateRecords = 0;
+long long RecordQueue::coalescedRecords = 0;
 
 RecordQueue::RecordQueue(
   RAPIOAlgorithm * alg
-) : EventHandler("RecordQueue") // Run me as fast as you can
+) : EventHandler("RecordQueue"), // Run me as fast as you can
+  myBatchSize(100), myLatencyBudgetMS(50)
 {
   myAlg = alg; // Only for archive stop...hummm
 }
 
+std::string
+RecordQueue::getDuplicateKey(const Record& r)
+{
+  std::string key = r.getTimeString();
+
+  key += '|';
+  key += r.getBuilder();
+  key += '|';
+  key += r.getSourceName();
+  key += '|';
+  key += std::to_string(r.getIndexNumber());
+  for (auto& p:r.getParams()) {
+    key += '|';
+    key += p;
+  }
+  key += '|';
+  key += r.getDataType();
+  key += '|';
+  key += r.getSubType();
+  return key;
+}
+
+std::string
+RecordQueue::getCoalesceKey(const Record& r)
+{
+  return std::to_string(r.getIndexNumber()) + '|' + r.getSourceName() + '|'
+         + r.getDataType() + '|' + r.getSubType();
+}
+
 void
-RecordQueue::addRecord(Record& record)
+RecordQueue::push(Record&& record)
 {
-  myQueue.push(record);
+  // Only data records are checked, messages can repeat
+  if (record.isData() && !record.isMessage()) {
+    if (!myQueued.insert(getDuplicateKey(record)).second) {
+      duplicateRecords++;
+      return;
+    }
+    if ((myAlg != nullptr) && myAlg->isRecordCoalescable(record)) {
+      auto& newest = myNewest[getCoalesceKey(record)];
+      if (newest < record.getTime()) {
+        newest = record.getTime();
+      }
+    }
+  }
+  myQueue.push(std::move(record));
   pushedRecords++;
+}
+
+bool
+RecordQueue::pop(Record& record)
+{
+  record = myQueue.take();
+  poppedRecords++;
+
+  if (record.isData() && !record.isMessage()) {
+    myQueued.erase(getDuplicateKey(record));
+    if (!myNewest.empty()) {
+      auto i = myNewest.find(getCoalesceKey(record));
+      if (i != myNewest.end()) {
+        if (record.getTime() < i->second) {
+          coalescedRecords++;
+          return false;
+        }
+        myNewest.erase(i);
+      }
+    }
+  }
+  return true;
+}
+
+void
+RecordQueue::addRecord(const Record& record)
+{
+  addRecord(Record(record));
+}
+
+void
+RecordQueue::addRecord(Record&& record)
+{
+  push(std::move(record));
   // Record pushed, notify ready for action
   setReady();
 }
@@ -31,34 +111,93 @@ RecordQueue::addRecord(Record& record)
 void
 RecordQueue::addRecords(std::vector<Record>& records)
 {
+  addRecords(std::vector<Record>(records));
+}
+
+void
+RecordQueue::addRecords(std::vector<Record>&& records)
+{
+  myQueue.reserve(myQueue.size() + records.size());
   for (auto&r:records) {
     // This should auto sort records..
-    myQueue.push(r); // copy or move?  We should switch to pointers I think...
-    pushedRecords++;
+    push(std::move(r));
   }
+  records.clear();
   // Have more available to process
   if (!myQueue.empty()) {
     setReady();
   }
 }
 
+void
+RecordQueue::addSource(std::shared_ptr<RecordSource> source)
+{
+  mySources.push_back(source);
+  setReady();
+}
+
+void
+RecordQueue::pullSources()
+{
+  bool pulled = true;
+
+  while (pulled && !mySources.empty()) {
+    pulled = false;
+    for (auto& s:mySources) {
+      // Behind if the next record isn't older than its newest
+      if (myQueue.empty() || !(myQueue.top().getTime() < s->getLatestTime())) {
+        if (!s->fill(*this, myBatchSize)) {
+          s = nullptr;
+        }
+        pulled = true;
+      }
+    }
+    mySources.erase(std::remove(mySources.begin(), mySources.end(), nullptr), mySources.end());
+  }
+}
+
 void
 RecordQueue::action()
 {
-  // Process one record if there...
-  if (!myQueue.empty()) {
-    fLogInfo("Record queue size is {}", myQueue.size());
-    Record r = myQueue.top();
-    myQueue.pop();
-    poppedRecords++;
+  // Process a batch of records if there...
+  const auto start  = std::chrono::steady_clock::now();
+  const auto budget = std::chrono::milliseconds(myLatencyBudgetMS);
+  size_t count      = 0;
+  Record r;
+
+  while (count < myBatchSize) {
+    pullSources();
+    if (myQueue.empty()) {
+      break;
+    }
+    if (!pop(r)) {
+      continue; // Obsolete, a newer one is waiting
+    }
     myAlg->handleRecordEvent(r);
+    count++;
+    if (std::chrono::steady_clock::now() - start >= budget) {
+      break;
+    }
+  }
+
+  // Sources might still have records even if the queue is empty
+  pullSources();
+
+  // Log backlog at most every few seconds, not every record
+  if (!myQueue.empty()) {
+    const Time now = Time::ClockTime();
+    if ((now - myLastLog).seconds() >= 5) {
+      fLogInfo("Record queue size is {} (duplicates {}, coalesced {})",
+        myQueue.size(), duplicateRecords, coalescedRecords);
+      myLastLog = now;
+    }
   }
 
   // If queue empty (possibly post processing one, fire end event)
   if (myQueue.empty()) {
     myAlg->handleEndDatasetEvent();
   } else {
-    // ...otherwise we want to fire again
+    // ...otherwise we want to fire again, after anything else waiting
     setReady();
   }
-}
+} // RecordQueue::action
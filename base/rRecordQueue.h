@@ -7,6 +7,9 @@
 #include <vector>
 #include <algorithm>
 #include <queue>
+#include <string>
+#include <unordered_set>
+#include <unordered_map>
 
 namespace rapio {
 /** Sort records for queue.  Usually this is in decreasing time order */
@@ -20,7 +23,62 @@ public:
   }
 };
 
+/** Priority queue of records that can move the top record out, where
+ * std::priority_queue only gives a const reference to copy. */
+class RecordHeap : public std::priority_queue<Record, std::vector<Record>, RecordQueueSort>
+{
+public:
+
+  /** Remove and return the top record */
+  Record
+  take()
+  {
+    std::pop_heap(c.begin(), c.end(), comp);
+    Record r = std::move(c.back());
+
+    c.pop_back();
+    return r;
+  }
+
+  /** Reserve room for n records */
+  void
+  reserve(size_t n){ c.reserve(n); }
+};
+
+class RecordQueue;
+
+/** A source of records that adds them to the queue on demand, instead of
+ * all at once.  Used by indexes too large to hold in memory.  The queue
+ * asks a source for more whenever the next record to process isn't older
+ * than the newest record the source has given, so records from all
+ * sources still come out in time order.
+ */
+class RecordSource {
+public:
+
+  /** Destroy a record source */
+  virtual ~RecordSource(){ }
+
+  /** Add about count more records to the queue.
+   * @return false once the source has no more records. */
+  virtual bool
+  fill(RecordQueue& q, size_t count) = 0;
+
+  /** Time of the newest record added to the queue so far */
+  virtual Time
+  getLatestTime() = 0;
+};
+
 /** Record queue holds Records that will be sent to be processed when able.
+ *
+ * Records are handed to the algorithm in batches, up to a batch size or
+ * a time budget per wakeup, whichever comes first.  Between batches the
+ * event loop gets to run timers and web events, so a big backlog after
+ * an outage doesn't starve them.  A record already waiting in the queue
+ * is dropped if added again.  If the algorithm says records of a product
+ * can be coalesced, only the newest waiting record of that product is
+ * processed and older ones are skipped.
+ *
  * @author Robert Toomey
  */
 class RecordQueue : public EventHandler
@@ -32,17 +90,38 @@ public:
 
   /** Add given record to queue */
   void
-  addRecord(Record& record);
+  addRecord(const Record& record);
+
+  /** Add given record to queue, moving it */
+  void
+  addRecord(Record&& record);
 
   /** Add given records to queue */
   void
   addRecords(std::vector<Record>& records);
 
+  /** Add given records to queue, moving them */
+  void
+  addRecords(std::vector<Record>&& records);
+
+  /** Add a source to pull records from as needed */
+  void
+  addSource(std::shared_ptr<RecordSource> source);
+
   /** Size of our queue */
   size_t
   size(){ return myQueue.size(); }
 
-  /** Fired action.  Usually process a record from queue */
+  /** Set the max records processed per wakeup */
+  void
+  setBatchSize(size_t s){ myBatchSize = std::max(size_t(1), s); }
+
+  /** Set the time budget in milliseconds per wakeup.  A batch stops after
+   * the record that goes over, so at least one record is processed. */
+  void
+  setLatencyBudgetMS(size_t ms){ myLatencyBudgetMS = ms; }
+
+  /** Fired action.  Process a batch of records from queue */
   virtual void
   action() override;
 
@@ -52,16 +131,61 @@ public:
   /** Simple counter of popped records */
   static long long poppedRecords;
 
+  /** Counter of records dropped as already queued */
+  static long long duplicateRecords;
+
+  /** Counter of records skipped for a newer one of the same product */
+  static long long coalescedRecords;
+
   /** Low level access the queue if needed */
-  std::priority_queue<Record, std::vector<Record>, RecordQueueSort>&
+  RecordHeap&
   getQueue(){ return myQueue; }
 
 protected:
 
+  /** Pull from sources that are behind the next record */
+  void
+  pullSources();
+
+  /** Push a record unless already queued */
+  void
+  push(Record&& record);
+
+  /** Remove the next record to process from the queue, false if the
+   * record is obsolete and should be skipped */
+  bool
+  pop(Record& record);
+
+  /** Key identical records share */
+  static std::string
+  getDuplicateKey(const Record& r);
+
+  /** Key records of the same product share */
+  static std::string
+  getCoalesceKey(const Record& r);
+
   /** The algorithm we send records to */
   RAPIOAlgorithm * myAlg;
 
   /** Records.  Stored in time order by record operator < */
-  std::priority_queue<Record, std::vector<Record>, RecordQueueSort> myQueue;
+  RecordHeap myQueue;
+
+  /** Keys of the data records waiting in the queue */
+  std::unordered_set<std::string> myQueued;
+
+  /** Newest waiting time for each coalesced product */
+  std::unordered_map<std::string, Time> myNewest;
+
+  /** Sources still having records */
+  std::vector<std::shared_ptr<RecordSource> > mySources;
+
+  /** Max records per wakeup */
+  size_t myBatchSize;
+
+  /** Max milliseconds per wakeup */
+  size_t myLatencyBudgetMS;
+
+  /** Last time we logged the backlog */
+  Time myLastLog;
 };
 }
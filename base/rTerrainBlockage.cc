@@ -2,12 +2,17 @@
 #include "rRadialSet.h"
 #include "rColorTerm.h"
 #include "rStrings.h"
+#include "rOS.h"
+#include "rThreadGroup.h"
+#include "rMemoryMappedFile.h"
 
 // Default terrain blockages
 #include "rTerrainBlockageLak.h"
 #include "rTerrainBlockage2me.h"
 
 #include <algorithm>
+#include <cstring>
+#include <fstream>
 
 using namespace rapio;
 
@@ -71,6 +76,10 @@ TerrainBlockage::createTerrainBlockage(
   } else {
     // Pass onto the factory method
     f = f->create(params, radarLocation, radarRangeKMs, radarName, minTerrainKMs, minAngleDegs);
+    if (f != nullptr) {
+      f->myCacheTag  = key + "," + params;
+      f->myRadarName = radarName;
+    }
   }
   return f;
 }
@@ -166,58 +175,355 @@ getHeightAboveTerrainKM(const AngleDegs elevDegs,
   return (outHeightKMs);
 } // TerrainBlockage::getHeightAboveTerrainKM
 
+namespace {
+/** Blockage cache file magic, bump the version on any layout change */
+const char BLOCKAGE_MAGIC[8]    = { 'R', 'A', 'P', 'I', 'O', 'T', 'B', 'K' };
+const uint32_t BLOCKAGE_VERSION = 2;
+
+/** Most tilt geometries we keep in memory, a few VCPs worth */
+const size_t MAX_CACHED_TILTS = 64;
+
+/** Header of a blockage cache file */
+struct BlockageHeader {
+  char     magic[8];
+  uint32_t version;
+  uint32_t unused;
+  uint64_t key;
+  uint64_t radials;
+  uint64_t gates;
+};
+
+/** FNV-1a over some bytes, used to key tilt geometry */
+void
+hashBytes(uint64_t& h, const void * data, size_t length)
+{
+  const unsigned char * c = static_cast<const unsigned char *>(data);
+
+  for (size_t i = 0; i < length; ++i) {
+    h ^= c[i];
+    h *= 1099511628211ULL;
+  }
+}
+
+/** Hash a double */
+void
+hashDouble(uint64_t& h, double v)
+{
+  hashBytes(h, &v, sizeof(v));
+}
+
+/** Round to a step, so jitter lands on the same value */
+double
+roundTo(double v, double step)
+{
+  return std::round(v / step) * step;
+}
+}
+
+void
+TerrainBlockage::setDEMSource(const std::string& file)
+{
+  Time modified;
+
+  if (OS::getFileModificationTime(file, modified)) {
+    myDEMTag = file + "," + std::to_string(modified.getSecondsSinceEpoch()) + "," +
+      std::to_string(OS::getFileSize(file));
+  } else {
+    myDEMTag = file;
+  }
+}
+
+TerrainBlockage::TiltGeometry
+TerrainBlockage::getTiltGeometry(RadialSet& rs)
+{
+  TiltGeometry geo;
+  const size_t radials = rs.getNumRadials();
+
+  geo.elevDegs         = roundTo(rs.getElevationDegs(), 0.1);
+  geo.stationHeightKMs = roundTo(rs.getLocation().getHeightKM(), 0.001);
+  geo.firstGateKMs     = roundTo(rs.getDistanceToFirstGateM() / 1000.0, 0.001);
+  geo.gateWidthKMs     = 0.001;
+  geo.beamWidthDegs    = 1;
+  geo.azResDegs        = (radials > 0) ? 360.0 / radials : 1;
+
+  if (radials > 0) {
+    // Use the middle values, odd radials shouldn't change the geometry
+    auto middle = [](std::vector<float> v){
+        std::nth_element(v.begin(), v.begin() + v.size() / 2, v.end());
+        return v[v.size() / 2];
+      };
+    auto& gwMs      = rs.getGateWidthVector()->ref();
+    auto& beamwidth = rs.getBeamWidthVector()->ref();
+    geo.gateWidthKMs  = std::max(0.001, roundTo(middle(std::vector<float>(&gwMs[0], &gwMs[0] + radials)) / 1000.0,
+        0.001));
+    geo.beamWidthDegs = roundTo(middle(std::vector<float>(&beamwidth[0], &beamwidth[0] + radials)), 0.01);
+    auto spacing = rs.getAzimuthSpacingVector();
+    if (spacing != nullptr) {
+      auto& azSpaceDegs = spacing->ref();
+      geo.azResDegs = middle(std::vector<float>(&azSpaceDegs[0], &azSpaceDegs[0] + radials));
+    }
+  }
+
+  // Whole bins around the circle, so 0.5 and 1 degree tilts are exact
+  geo.bins      = std::max(1L, std::lround(360.0 / std::max(geo.azResDegs, AngleDegs(0.01))));
+  geo.azResDegs = 360.0 / geo.bins;
+  return geo;
+} // TerrainBlockage::getTiltGeometry
+
+uint64_t
+TerrainBlockage::getTiltKey(const TiltGeometry& geo)
+{
+  uint64_t h = 14695981039346656037ULL;
+
+  // Who we are
+  hashBytes(h, myCacheTag.data(), myCacheTag.size());
+  hashBytes(h, myDEMTag.data(), myDEMTag.size());
+  hashDouble(h, myRadarLocation.getLatitudeDeg());
+  hashDouble(h, myRadarLocation.getLongitudeDeg());
+  hashDouble(h, myRadarLocation.getHeightKM());
+  hashDouble(h, myMinTerrainKMs);
+  hashDouble(h, myMinAngleDegs);
+  hashDouble(h, myMaxRangeKMs);
+
+  // The nominal tilt geometry
+  hashDouble(h, geo.elevDegs);
+  hashDouble(h, geo.stationHeightKMs);
+  hashDouble(h, geo.firstGateKMs);
+  hashDouble(h, geo.gateWidthKMs);
+  hashDouble(h, geo.beamWidthDegs);
+  const uint64_t bins = geo.bins;
+
+  hashBytes(h, &bins, sizeof(bins));
+  return h;
+} // TerrainBlockage::getTiltKey
+
+void
+TerrainBlockage::calculateGates(const TiltGeometry& geo, TiltBlockage& t, size_t end)
+{
+  const size_t start = t.gates;
+
+  if (end <= start) { return; }
+
+  // Grow the arrays, keeping the gates we already have
+  const size_t radials = t.radials;
+
+  if (start > 0) {
+    std::vector<float> cbb(radials * end), pbb(radials * end);
+    std::vector<char> hit(radials * end);
+    for (size_t r = 0; r < radials; ++r) {
+      std::copy(&t.cbb[r * start], &t.cbb[r * start] + start, &cbb[r * end]);
+      std::copy(&t.pbb[r * start], &t.pbb[r * start] + start, &pbb[r * end]);
+      std::copy(&t.hit[r * start], &t.hit[r * start] + start, &hit[r * end]);
+    }
+    t.cbb.swap(cbb);
+    t.pbb.swap(pbb);
+    t.hit.swap(hit);
+  } else {
+    t.cbb.assign(radials * end, 0);
+    t.pbb.assign(radials * end, 0);
+    t.hit.assign(radials * end, 0);
+  }
+  t.gates = end;
+
+  const AngleDegs elevDegs         = geo.elevDegs;
+  const LengthKMs stationHeightKMs = geo.stationHeightKMs;
+  const LengthKMs startKMs         = geo.firstGateKMs;
+  const LengthKMs gwKMs            = geo.gateWidthKMs;
+  const AngleDegs beamWidthDegs    = geo.beamWidthDegs;
+
+  // Anything not thread safe is set up first
+  initialize();
+
+  // Bins are independent, gates along a bin are cumulative
+  ThreadGroup::getShared()->parallelFor(0, radials, 8, [&](size_t rstart, size_t rend){
+    for (size_t r = rstart; r < rend; ++r) {
+      const AngleDegs centerAzDegs = (r + .5) * geo.azResDegs;
+      float * cbbRow = &t.cbb[r * end];
+      float * pbbRow = &t.pbb[r * end];
+      char * hitRow  = &t.hit[r * end];
+
+      // Terrain Blockage alg should increase cbb values, so pick up where we left off
+      float cbb = (start > 0) ? cbbRow[start - 1] : 0;
+      bool hitBottom;
+
+      for (size_t g = start; g < end; ++g) {
+        const LengthKMs rangeKMs       = startKMs + g * gwKMs;
+        const LengthKMs centerRangeKMs = rangeKMs + (.5 * gwKMs);
+
+        pbbRow[g] = 0;
+        hitBottom = false;
+        calculatePercentBlocked(stationHeightKMs, beamWidthDegs,
+          elevDegs, centerAzDegs, centerRangeKMs,
+          cbb, pbbRow[g], hitBottom);
+
+        hitRow[g] = hitBottom ? 1 : 0;
+        cbbRow[g] = cbb;
+      }
+    }
+  });
+} // TerrainBlockage::calculateGates
+
+std::string
+TerrainBlockage::getCacheFilename(uint64_t key)
+{
+  char hex[17];
+
+  snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(key));
+  return myCacheDir + "/" + myRadarName + "_" + hex + ".tbk";
+}
+
+std::shared_ptr<TerrainBlockage::TiltBlockage>
+TerrainBlockage::readCacheFile(uint64_t key, size_t radials)
+{
+  const std::string filename = getCacheFilename(key);
+  auto map = MemoryMappedFile::Create(filename);
+
+  if (map == nullptr) {
+    return nullptr;
+  }
+  const BlockageHeader * h = map->getPointer<BlockageHeader>(0);
+
+  if ((h == nullptr) || (std::memcmp(h->magic, BLOCKAGE_MAGIC, sizeof(h->magic)) != 0) ||
+    (h->version != BLOCKAGE_VERSION) || (h->key != key) || (h->radials != radials))
+  {
+    fLogInfo("Terrain cache {} is stale or a different version, ignoring.", filename);
+    return nullptr;
+  }
+  const size_t cells = h->radials * h->gates;
+
+  if (map->size() != sizeof(BlockageHeader) + cells * (2 * sizeof(float) + sizeof(char))) {
+    fLogInfo("Terrain cache {} is truncated, ignoring.", filename);
+    return nullptr;
+  }
+  map->adviseSequential();
+
+  auto t = std::make_shared<TiltBlockage>();
+
+  t->radials = h->radials;
+  t->gates   = h->gates;
+  size_t at      = sizeof(BlockageHeader);
+  const float * cbb = map->getPointer<float>(at, cells);
+
+  at += cells * sizeof(float);
+  const float * pbb = map->getPointer<float>(at, cells);
+
+  at += cells * sizeof(float);
+  const char * hit = map->getPointer<char>(at, cells);
+
+  t->cbb.assign(cbb, cbb + cells);
+  t->pbb.assign(pbb, pbb + cells);
+  t->hit.assign(hit, hit + cells);
+  fLogInfo("Mapped terrain cache {} ({} radials, {} gates)", filename, t->radials, t->gates);
+  return t;
+} // TerrainBlockage::readCacheFile
+
+bool
+TerrainBlockage::writeCacheFile(uint64_t key, const TiltBlockage& t)
+{
+  if (!OS::ensureDirectory(myCacheDir)) {
+    fLogSevere("Can't create terrain cache folder {}", myCacheDir);
+    return false;
+  }
+  const std::string filefinal = getCacheFilename(key);
+  const std::string filename  = OS::getUniqueTemporaryFile("terrain");
+  std::ofstream outFile(filename, std::ios::binary);
+
+  if (!outFile.is_open()) {
+    fLogSevere("Can't write terrain tmp file: {}", filename);
+    return false;
+  }
+
+  BlockageHeader h;
+
+  std::memset(&h, 0, sizeof(h));
+  std::memcpy(h.magic, BLOCKAGE_MAGIC, sizeof(h.magic));
+  h.version = BLOCKAGE_VERSION;
+  h.key     = key;
+  h.radials = t.radials;
+  h.gates   = t.gates;
+  outFile.write(reinterpret_cast<const char *>(&h), sizeof(h));
+  outFile.write(reinterpret_cast<const char *>(t.cbb.data()), t.cbb.size() * sizeof(float));
+  outFile.write(reinterpret_cast<const char *>(t.pbb.data()), t.pbb.size() * sizeof(float));
+  outFile.write(t.hit.data(), t.hit.size());
+
+  if (!outFile) {
+    fLogSevere("Couldn't write to tmp terrain file {} for {}", filename, filefinal);
+    outFile.close();
+    OS::deleteFile(filename);
+    return false;
+  }
+  outFile.close();
+
+  // Move into place so readers never map a partial file
+  if (!OS::moveFile(filename, filefinal, true)) {
+    fLogInfo("Couldn't move tmp {} to {}", filename, filefinal);
+    OS::deleteFile(filename);
+    return false;
+  }
+  fLogInfo("Wrote terrain cache to {}", filefinal);
+  return true;
+} // TerrainBlockage::writeCacheFile
+
 void
 TerrainBlockage::calculateTerrainPerGate(std::shared_ptr<RadialSet> rptr)
 {
   // FIXME: check radar name?
-  // FIXME: We could make a general RadialSet center gate marcher which could be useful.
   RadialSet& rs = *rptr;
 
-  // We should always have beamwidth array
-  auto& beamwidth = rs.getBeamWidthVector()->ref();
-
-  const AngleDegs elevDegs         = rs.getElevationDegs();
-  const LengthKMs stationHeightKMs = rs.getLocation().getHeightKM();
-
   // Create output arrays on the RadialSet.
   rs.initTerrain();
   auto& terrainCBBPercent = rs.getTerrainCBBPercentRef();
   auto& terrainPBBPercent = rs.getTerrainPBBPercentRef();
   auto& terrainBottomHit  = rs.getTerrainBeamBottomHitRef();
 
-  // First gate distance
-  LengthKMs startKMs = rs.getDistanceToFirstGateM() / 1000.0;
-  auto& gwMs         = rs.getGateWidthVector()->ref(); // We 'could' check nulls here
-  auto& azDegs       = rs.getAzimuthVector()->ref();
-  auto& azSpaceDegs  = rs.getAzimuthSpacingVector()->ref();
-
-  // March over RadialSet
   const size_t numRadials = rs.getNumRadials();
   const size_t numGates   = rs.getNumGates();
+  const TiltGeometry geo  = getTiltGeometry(rs);
+  const uint64_t key      = getTiltKey(geo);
 
-  bool hitBottom;
+  // Blockage only depends on the tilt geometry, which repeats every volume
+  std::lock_guard<std::mutex> lock(myCacheLock);
+  auto& t = myTilts[key];
 
-  for (int r = 0; r < numRadials; ++r) {
-    const AngleDegs azDeg           = azDegs[r];
-    const AngleDegs centerAzDegs    = azDeg + (.5 * azSpaceDegs[r]);
-    const LengthKMs gwKMs           = gwMs[r] / 1000.0; // Constant per radial
-    const AngleDegs myBeamWidthDegs = beamwidth[r];
-    LengthKMs rangeKMs = startKMs;
-
-    float cbb = 0; // Terrain Blockage alg should increase cbb values
-    for (int g = 0; g < numGates; ++g) {
-      LengthKMs centerRangeKMs = rangeKMs + (.5 * gwKMs);
-
-      terrainPBBPercent[r][g] = 0;
-      hitBottom = false;
-      calculatePercentBlocked(stationHeightKMs, myBeamWidthDegs,
-        elevDegs, centerAzDegs, centerRangeKMs,
-        cbb, terrainPBBPercent[r][g], hitBottom);
-
-      terrainBottomHit[r][g]  = hitBottom ? 1 : 0;
-      terrainCBBPercent[r][g] = cbb;
+  if ((t == nullptr) && !myCacheDir.empty()) {
+    t = readCacheFile(key, geo.bins);
+  }
+  if (t == nullptr) {
+    t = std::make_shared<TiltBlockage>();
+    t->radials = geo.bins;
+  }
+  if (t->gates < numGates) {
+    // Only the gates we haven't seen for this geometry
+    calculateGates(geo, *t, numGates);
+    if (!myCacheDir.empty()) {
+      writeCacheFile(key, *t);
+    }
+  }
+  t->lastUsed = ++myTiltUses;
+  auto tilt = t;
+
+  // Drop the least recently used geometry past our bound, never this one
+  if (myTilts.size() > MAX_CACHED_TILTS) {
+    auto oldest = myTilts.begin();
+    for (auto i = myTilts.begin(); i != myTilts.end(); ++i) {
+      if (i->second->lastUsed < oldest->second->lastUsed) {
+        oldest = i;
+      }
+    }
+    myTilts.erase(oldest);
+  }
 
-      rangeKMs += gwKMs;
+  // Each radial takes the blockage of its azimuth bin
+  auto& azDegs = rs.getAzimuthVector()->ref();
+  auto spacing = rs.getAzimuthSpacingVector();
+
+  for (size_t r = 0; r < numRadials; ++r) {
+    const AngleDegs spaceDegs = (spacing != nullptr) ? spacing->ref()[r] : geo.azResDegs;
+    const size_t row = geo.getBin(azDegs[r] + (.5 * spaceDegs)) * tilt->gates;
+    for (size_t g = 0; g < numGates; ++g) {
+      terrainCBBPercent[r][g] = tilt->cbb[row + g];
+      terrainPBBPercent[r][g] = tilt->pbb[row + g];
+      terrainBottomHit[r][g]  = tilt->hit[row + g];
     }
   }
 } // TerrainBlockage::calculateTerrainPerGate
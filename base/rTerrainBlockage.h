@@ -5,6 +5,8 @@
 #include "rRAPIOOptions.h"
 #include "rRadialSet.h"
 
+#include <mutex>
+
 namespace rapio
 {
 /** A DEM Lookup giving back zero height */
@@ -167,11 +169,31 @@ public:
   // --------------------------------------------------
 
   /** Calculate terrain blockage percentage for a given RadialSet for each gate, and
-   * add a 2D array to the RadialSet called TerrainPercent to store this value */
+   * add a 2D array to the RadialSet called TerrainPercent to store this value.
+   * Results are cached per tilt geometry, so only the first tilt of a kind,
+   * or gates past what we've done before, are calculated. */
   void
   calculateTerrainPerGate(std::shared_ptr<RadialSet> r);
 
-  /** Calculate percentage blocked information for a point */
+  /** Set a folder to keep blockage cache files in between runs */
+  void
+  setCacheDirectory(const std::string& dir){ myCacheDir = dir; }
+
+  /** Number of tilt geometries kept in memory */
+  size_t
+  getCachedTiltCount()
+  {
+    std::lock_guard<std::mutex> lock(myCacheLock);
+    return myTilts.size();
+  }
+
+  /** Called once before calculating gates in parallel.  Set up anything
+   * calculatePercentBlocked needs that isn't thread safe. */
+  virtual void
+  initialize(){ }
+
+  /** Calculate percentage blocked information for a point.  This is called
+   * from multiple threads at once for different radials. */
   virtual void
   calculatePercentBlocked(
     // Constants in 3D space information
@@ -187,6 +209,113 @@ public:
 
 protected:
 
+  /** Nominal geometry of a tilt.  Values are rounded so the same tilt
+   * of every volume maps to one cache entry, even with jitter */
+  class TiltGeometry {
+public:
+    /** Elevation, to a tenth of a degree */
+    AngleDegs elevDegs;
+
+    /** Station height, to a meter */
+    LengthKMs stationHeightKMs;
+
+    /** Distance to the first gate, to a meter */
+    LengthKMs firstGateKMs;
+
+    /** Gate width, to a meter */
+    LengthKMs gateWidthKMs;
+
+    /** Beam width, to a hundredth of a degree */
+    AngleDegs beamWidthDegs;
+
+    /** Azimuth bin size, dividing the circle evenly */
+    AngleDegs azResDegs;
+
+    /** Number of azimuth bins in the circle */
+    size_t bins;
+
+    /** Azimuth bin a radial center falls in */
+    size_t
+    getBin(AngleDegs centerAzDegs) const
+    {
+      const long b = std::lround(std::floor(centerAzDegs / azResDegs)) % long(bins);
+
+      return (b < 0) ? b + bins : b;
+    }
+  };
+
+  /** Blockage for every gate of each azimuth bin of a tilt */
+  class TiltBlockage {
+public:
+    /** Number of azimuth bins */
+    size_t radials = 0;
+
+    /** Number of gates calculated per radial */
+    size_t gates = 0;
+
+    /** Cumulative beam blockage */
+    std::vector<float> cbb;
+
+    /** Partial beam blockage */
+    std::vector<float> pbb;
+
+    /** Bottom beam hit */
+    std::vector<char> hit;
+
+    /** Use stamp, so we can drop the least recently used */
+    size_t lastUsed = 0;
+  };
+
+  /** Nominal geometry of a RadialSet */
+  TiltGeometry
+  getTiltGeometry(RadialSet& rs);
+
+  /** Key of everything the blockage of a tilt depends on, except the
+   * number of gates */
+  uint64_t
+  getTiltKey(const TiltGeometry& geo);
+
+  /** Calculate gates from start up to end for each azimuth bin of a tilt */
+  void
+  calculateGates(const TiltGeometry& geo, TiltBlockage& t, size_t end);
+
+  /** Note the DEM file we read, so a changed DEM makes a new cache key */
+  void
+  setDEMSource(const std::string& file);
+
+  /** Cache file for a tilt key */
+  std::string
+  getCacheFilename(uint64_t key);
+
+  /** Read a tilt cache file.  @return nullptr if missing or stale */
+  std::shared_ptr<TiltBlockage>
+  readCacheFile(uint64_t key, size_t radials);
+
+  /** Write a tilt cache file */
+  bool
+  writeCacheFile(uint64_t key, const TiltBlockage& t);
+
+  /** Algorithm and params we were created with, part of the cache key */
+  std::string myCacheTag;
+
+  /** Radar we were created for */
+  std::string myRadarName;
+
+  /** DEM file, time and size, part of the cache key */
+  std::string myDEMTag;
+
+  /** Folder for cache files, if any */
+  std::string myCacheDir;
+
+  /** Lock for the tilt cache */
+  std::mutex myCacheLock;
+
+  /** Blockage per tilt geometry, bounded with least recently used dropped */
+  std::map<uint64_t, std::shared_ptr<TiltBlockage> > myTilts;
+
+  /** Counter for tilt use stamps */
+  size_t myTiltUses = 0;
+
   /** Store terrain LatLonGrid for radar.  The data is height in meters */
   std::shared_ptr<LatLonGrid> myDEM;
 
@@ -20,8 +20,11 @@ TerrainBlockage2me::create(const std::string& params,
   std::string file = myTerrainPath + radarName + ".nc";
   std::shared_ptr<LatLonGrid> aDEM = IODataType::read<LatLonGrid>(file);
 
-  return std::make_shared<TerrainBlockage2me>(TerrainBlockage2me(aDEM, radarLocation, radarRangeKMs, radarName,
-           minTerrainKMs, minAngleDegs));
+  auto t = std::make_shared<TerrainBlockage2me>(aDEM, radarLocation, radarRangeKMs, radarName,
+      minTerrainKMs, minAngleDegs);
+
+  t->setDEMSource(file);
+  return t;
 }
 
 TerrainBlockage2me::TerrainBlockage2me(std::shared_ptr<LatLonGrid> aDEM,
@@ -31,8 +31,11 @@ TerrainBlockageLak::create(const std::string & params,
   std::string file = myTerrainPath + radarName + ".nc";
   std::shared_ptr<LatLonGrid> aDEM = IODataType::read<LatLonGrid>(file);
 
-  return std::make_shared<TerrainBlockageLak>(TerrainBlockageLak(aDEM, radarLocation, radarRangeKMs, radarName,
-           minTerrainKMs, minAngleDegs));
+  auto t = std::make_shared<TerrainBlockageLak>(aDEM, radarLocation, radarRangeKMs, radarName,
+      minTerrainKMs, minAngleDegs);
+
+  t->setDEMSource(file);
+  return t;
 }
 
 TerrainBlockageLak::TerrainBlockageLak(std::shared_ptr<LatLonGrid> aDEM,
@@ -90,8 +90,8 @@ public:
 
   /** Lak's method requires creating a virtual radialset overlay for
    * integrating the blockage within sub 'pencils' of the azimuth coverage area */
-  void
-  initialize();
+  virtual void
+  initialize() override;
 
   /** Help function, subclasses return help information. */
   virtual std::string
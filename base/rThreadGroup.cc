@@ -1,93 +1,409 @@
 #include "rThreadGroup.h"
 
 #include "rError.h"
+#include "rRAPIOAlgorithm.h"
+
+#include <functional>
+#include <algorithm>
+#include <exception>
 
 using namespace rapio;
 
-WriteOutputThreadTask::WriteOutputThreadTask(const std::string& key, std::shared_ptr<DataType> outputData,
-  std::map<std::string, std::string>& outputParams) : myKey(key), myOutputParams(outputParams)
-{
-  // FIXME: Will need the key, params, DataType
-  // outputData
-}
+WriteOutputThreadTask::WriteOutputThreadTask(
+  RAPIOAlgorithm                           * alg,
+  WriteOutputPool                          * pool,
+  const std::string                        & key,
+  std::shared_ptr<DataType>                outputData,
+  const std::map<std::string, std::string> & outputParams,
+  const std::string                        & productName)
+  : myAlg(alg), myPool(pool), myKey(key), myOutputData(outputData), myOutputParams(outputParams),
+  myProductName(productName), myQueuedAt(std::chrono::steady_clock::now())
+{ }
 
 void
 WriteOutputThreadTask::execute()
 {
-  // Will need the app pointer.
-  //  app->writeOutputProduct(myProductKey, myDataType, myExtraParams);
+  const auto started = std::chrono::steady_clock::now();
+
+  try{
+    myAlg->writeOutputProductNow(myKey, myOutputData, myOutputParams, myProductName);
+  }catch (const std::exception& e) {
+    fLogSevere("Background write of '{}' failed: {}", myKey, e.what());
+  }
+  const auto finished = std::chrono::steady_clock::now();
+
+  // Release the DataType before signaling, the caller might be waiting on memory
+  myOutputData = nullptr;
+  if (myPool != nullptr) {
+    myPool->taskDone(
+      std::chrono::duration<double, std::milli>(started - myQueuedAt).count(),
+      std::chrono::duration<double, std::milli>(finished - started).count());
+  }
   markDone();
+}
+
+std::mutex ThreadGroup::theSharedLock;
+std::shared_ptr<ThreadGroup> ThreadGroup::theShared;
+size_t ThreadGroup::theSharedThreadCount = 0;
+
+namespace {
+/** The group and worker index of the current thread, if a worker */
+thread_local ThreadGroup * theCurrentGroup = nullptr;
+thread_local size_t theCurrentWorker       = 0;
+
+/** The shared state of one parallelFor call */
+class ParallelForJob {
+public:
+  ParallelForJob(size_t begin, size_t end, size_t grain,
+    const std::function<void(size_t, size_t)>& func)
+    : myBegin(begin), myEnd(end), myGrain(grain), myChunks((end - begin + grain - 1) / grain),
+    myNext(0), myDone(0), myFunc(func)
+  { }
+
+  /** Grab and run ranges until none are left */
+  void
+  run()
+  {
+    size_t at;
+
+    while ((at = myNext++) < myChunks) {
+      const size_t start = myBegin + (at * myGrain);
+      const size_t end   = std::min(start + myGrain, myEnd);
+      try{
+        myFunc(start, end);
+      }catch (...) {
+        std::lock_guard<std::mutex> lock(myLock);
+        if (!myError) {
+          myError = std::current_exception();
+        }
+      }
+      if (++myDone == myChunks) {
+        std::lock_guard<std::mutex> lock(myLock);
+        myCondition.notify_all();
+      }
+    }
+  }
+
+  /** Wait for every range to finish */
+  void
+  wait()
+  {
+    std::unique_lock<std::mutex> lock(myLock);
+
+    myCondition.wait(lock, [this] {
+      return myDone == myChunks;
+    });
+    if (myError) {
+      std::rethrow_exception(myError);
+    }
+  }
+
+  size_t myBegin;
+  size_t myEnd;
+  size_t myGrain;
+  size_t myChunks;
+  std::atomic<size_t> myNext;
+  std::atomic<size_t> myDone;
+  std::function<void(size_t, size_t)> myFunc;
+  std::exception_ptr myError;
+  std::mutex myLock;
+  std::condition_variable myCondition;
+};
+
+/** Helper task running ranges of a parallelFor */
+class ParallelForTask : public ThreadTask {
+public:
+  ParallelForTask(std::shared_ptr<ParallelForJob> job) : myJob(job){ }
+
+  virtual void
+  execute() override
+  {
+    myJob->run();
+    markDone();
+  }
+
+protected:
+  std::shared_ptr<ParallelForJob> myJob;
 };
+}
 
 ThreadGroup::ThreadGroup(size_t maxWorkers, size_t maxQueueSize)
-  : myMaxWorkers(maxWorkers), myMaxQueueSize(maxQueueSize), myStop(false)
+  : myMaxWorkers(maxWorkers), myMaxQueueSize(maxQueueSize), myQueued(0), myNextQueue(0), myStop(false)
 {
+  if (myMaxWorkers < 1) {
+    myMaxWorkers = 1;
+  }
+  for (size_t i = 0; i < myMaxWorkers; ++i) {
+    myQueues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+  }
+
   // Start worker threads.  FIXME: I guess this could fail, so maybe a seperate method?
   for (size_t i = 0; i < myMaxWorkers; ++i) {
-    myWorkers.create_thread(std::bind(&ThreadGroup::workerThread, this));
+    myWorkers.create_thread(std::bind(&ThreadGroup::workerThread, this, i));
   }
 }
 
 bool
 ThreadGroup::enqueueThreadTask(std::shared_ptr<ThreadTask> task)
 {
+  // Claim a slot, give it back if full
+  if (myQueued++ >= myMaxQueueSize) {
+    --myQueued;
+    return false;
+  }
+
+  // Our own workers push onto their deque, others round robin
+  const size_t at = (theCurrentGroup == this) ? theCurrentWorker : (myNextQueue++ % myMaxWorkers);
   {
-    std::unique_lock<std::mutex> lock(myTaskQueueMutex);
-    if (myTaskQueue.size() >= myMaxQueueSize) {
-      // Handle queue full situation, maybe wait or drop the item
-      // fLogInfo("---Queue is full. Not adding task.");
-      return false;
-    }
-    myTaskQueue.push(task);
-    // static std::atomic<size_t> counter(0);
-    // fLogInfo("---Data enqueued. Queue size: {} ID#: {}", myTaskQueue.size(), ++counter);
-    // if (counter >= 2000){ counter = 0; }
+    std::lock_guard<std::mutex> lock(myQueues[at]->myLock);
+    myQueues[at]->myTasks.push_back(task);
   }
+
+  // Sync with a worker checking before it sleeps, so the notify isn't lost
+  { std::lock_guard<std::mutex> lock(myTaskQueueMutex); }
+
   /** Tell one of our workers to pop the queue */
   myCondition.notify_one();
   return true;
 }
 
+void
+ThreadGroup::waitEnqueueThreadTask(std::shared_ptr<ThreadTask> task)
+{
+  while (!enqueueThreadTask(task)) {
+    std::unique_lock<std::mutex> lock(myTaskQueueMutex);
+    mySpaceCondition.wait_for(lock, std::chrono::milliseconds(10));
+  }
+}
+
+bool
+ThreadGroup::popTask(size_t index, std::shared_ptr<ThreadTask>& task)
+{
+  // Our own work in order...
+  {
+    auto& q = *myQueues[index];
+    std::lock_guard<std::mutex> lock(q.myLock);
+    if (!q.myTasks.empty()) {
+      task = q.myTasks.front();
+      q.myTasks.pop_front();
+      --myQueued;
+      return true;
+    }
+  }
+
+  // ...then steal the newest work of the others
+  for (size_t i = 1; i < myMaxWorkers; ++i) {
+    auto& q = *myQueues[(index + i) % myMaxWorkers];
+    std::lock_guard<std::mutex> lock(q.myLock);
+    if (!q.myTasks.empty()) {
+      task = q.myTasks.back();
+      q.myTasks.pop_back();
+      --myQueued;
+      return true;
+    }
+  }
+  return false;
+}
+
 /** Main worker thread responsible for popping tasks from queue and executing */
 void
-ThreadGroup::workerThread()
+ThreadGroup::workerThread(size_t index)
 {
+  theCurrentGroup  = this;
+  theCurrentWorker = index;
+
   while (true) {
-    // This should only be calling once on start and once after a job pretty much
     std::shared_ptr<ThreadTask> task;
 
-    {
+    if (!popTask(index, task)) {
       std::unique_lock<std::mutex> lock(myTaskQueueMutex);
 
       myCondition.wait(lock, [this] {
-        return myStop || !myTaskQueue.empty();
+        return myStop || (myQueued > 0);
       });
-      if (myStop && myTaskQueue.empty()) {
+      if (myStop && (myQueued == 0)) {
         return;
       }
-      task = myTaskQueue.front();
-      myTaskQueue.pop();
-      // fLogInfo("---Data dequeued. Queue size: {}", myTaskQueue.size());
+      continue;
     }
+    mySpaceCondition.notify_one();
 
     task->execute();
+  }
+}
 
-    // static std::atomic<size_t> counter(0);
-    // fLogInfo("---Data processed.{}", ++counter);
+void
+ThreadGroup::parallelFor(size_t begin, size_t end, size_t grain,
+  const std::function<void(size_t, size_t)>& func)
+{
+  if (end <= begin) {
+    return;
   }
+  if (grain < 1) {
+    grain = 1;
+  }
+  auto job = std::make_shared<ParallelForJob>(begin, end, grain, func);
+
+  // Wake up helpers.  If we're full the caller just does more of the work
+  const size_t helpers = std::min(job->myChunks - 1, myMaxWorkers);
+
+  for (size_t i = 0; i < helpers; ++i) {
+    if (!enqueueThreadTask(std::make_shared<ParallelForTask>(job))) {
+      break;
+    }
+  }
+
+  // We work too, which also keeps a call from a worker from deadlocking
+  job->run();
+  job->wait();
+}
+
+size_t
+ThreadGroup::getDefaultThreadCount()
+{
+  const size_t cores = std::thread::hardware_concurrency();
+
+  return (cores > 0) ? cores : 4;
+}
+
+std::shared_ptr<ThreadGroup>
+ThreadGroup::getShared()
+{
+  std::lock_guard<std::mutex> lock(theSharedLock);
+
+  if (theShared == nullptr) {
+    const size_t threads = (theSharedThreadCount > 0) ? theSharedThreadCount : getDefaultThreadCount();
+    fLogInfo("Creating shared thread group with {} thread(s).", threads);
+    theShared = std::make_shared<ThreadGroup>(threads, 4096);
+  }
+  return theShared;
+}
+
+void
+ThreadGroup::setSharedThreadCount(size_t threads)
+{
+  std::lock_guard<std::mutex> lock(theSharedLock);
+
+  if (theShared && (theShared->getNumWorkers() != ((threads > 0) ? threads : getDefaultThreadCount()))) {
+    // Anyone holding the old group keeps it until they let go
+    theShared = nullptr;
+  }
+  theSharedThreadCount = threads;
 }
 
 ThreadGroup::~ThreadGroup()
 {
   {
-    // Lock the mutex to safely modify shared data
-    std::unique_lock<std::mutex> lock(myStopMutex);
-    // Set the stop flag to true to signal threads to stop
+    // Set under the queue lock the workers wait with, otherwise a worker
+    // between checking myStop and waiting could miss the notify forever.
+    std::unique_lock<std::mutex> lock(myTaskQueueMutex);
     myStop = true;
-  } // End of inner scope: mutex is automatically unlocked when leaving this scope
+  }
   fLogInfo("Shutting down a thread group {}", (void *) (this));
   // Notify all threads that they should wake up
   myCondition.notify_all();
   // Join all worker threads to wait for them to finish
   myWorkers.join_all();
 }
+
+WriteOutputPool::WriteOutputPool(size_t writers, size_t queueSize)
+  : myPending(0), myCompleted(0), myMaxPending(0), myQueuedTotalMS(0), myQueuedMaxMS(0),
+  myWriteTotalMS(0), myWriteMaxMS(0), myLastFullLog()
+{
+  if (writers < 1) { writers = 1; }
+  if (queueSize < 1) { queueSize = 1; }
+  for (size_t i = 0; i < writers; ++i) {
+    myWriters.push_back(std::make_shared<ThreadGroup>(1, queueSize));
+  }
+  fLogInfo("Writing output with {} background writer(s), {} queued write(s) each.", writers, queueSize);
+}
+
+WriteOutputPool::~WriteOutputPool()
+{
+  drain();
+  myWriters.clear();
+}
+
+void
+WriteOutputPool::enqueue(std::shared_ptr<WriteOutputThreadTask> task)
+{
+  // Same key, same writer, so a product is written in order
+  const size_t at = std::hash<std::string>()(task->getKey()) % myWriters.size();
+
+  {
+    std::unique_lock<std::mutex> lock(myStatsMutex);
+    const size_t pending = ++myPending;
+    if (pending > myMaxPending) {
+      myMaxPending = pending;
+    }
+  }
+
+  if (myWriters[at]->enqueueThreadTask(task)) {
+    return;
+  }
+
+  // Back pressure.  Wait for our writer to free a slot, letting the
+  // log know now and then since output is falling behind.
+  const auto now = std::chrono::steady_clock::now();
+  bool logFull   = false;
+
+  {
+    std::unique_lock<std::mutex> lock(myStatsMutex);
+    if ((myLastFullLog == std::chrono::steady_clock::time_point()) ||
+      (now - myLastFullLog > std::chrono::seconds(FULL_LOG_SECONDS)))
+    {
+      myLastFullLog = now;
+      logFull       = true;
+    }
+  }
+  if (logFull) {
+    fLogInfo("Background writer for '{}' is full, waiting on it.", task->getKey());
+    logStats();
+  }
+  myWriters[at]->waitEnqueueThreadTask(task);
+}
+
+void
+WriteOutputPool::taskDone(double queuedMS, double writeMS)
+{
+  size_t done;
+  {
+    std::unique_lock<std::mutex> lock(myStatsMutex);
+    myQueuedTotalMS += queuedMS;
+    myWriteTotalMS  += writeMS;
+    if (queuedMS > myQueuedMaxMS) { myQueuedMaxMS = queuedMS; }
+    if (writeMS > myWriteMaxMS) { myWriteMaxMS = writeMS; }
+    done = ++myCompleted;
+    --myPending;
+  }
+  myDoneCondition.notify_all();
+
+  // Real time algorithms never drain, so log as we go
+  if (done % STATS_EVERY == 0) {
+    logStats();
+  }
+}
+
+void
+WriteOutputPool::drain()
+{
+  std::unique_lock<std::mutex> lock(myStatsMutex);
+
+  if (myPending > 0) {
+    fLogInfo("Waiting on {} background write(s) to finish...", (size_t) (myPending));
+  }
+  myDoneCondition.wait(lock, [this] {
+    return myPending == 0;
+  });
+}
+
+void
+WriteOutputPool::logStats()
+{
+  std::unique_lock<std::mutex> lock(myStatsMutex);
+  const size_t done = myCompleted;
+  const double d    = (done > 0) ? done : 1;
+
+  fLogInfo("Background writes: {} done, {} pending, {} max pending. Queue wait avg {:.2f} max {:.2f} ms, write avg {:.2f} max {:.2f} ms.",
+    done, (size_t) (myPending), myMaxPending, myQueuedTotalMS / d, myQueuedMaxMS, myWriteTotalMS / d, myWriteMaxMS);
+}
@@ -11,10 +11,14 @@ BOOST_WRAP_POP
 #include <thread>
 #include <mutex>
 #include <condition_variable>
-#include <queue>
+#include <deque>
+#include <functional>
 #include <memory>
 #include <atomic>
 #include <future>
+#include <chrono>
+#include <vector>
+#include <map>
 
 namespace rapio {
 /** What we do with a worker thread?  Subclass to do more
@@ -63,34 +67,70 @@ protected:
   std::future<void> myFuture;
 };
 
-/** Write the standard output thread task.
- * Oh boy.  Can of worms I gotta go back and thread check the entire call tree here.
- * This is an experiment, I expect sync issues until I harden the code. */
+class RAPIOAlgorithm;
+class WriteOutputPool;
+
+/** Write a DataType in the background for a RAPIOAlgorithm.
+ * The task owns a copy of the output params and a shared_ptr to the
+ * DataType, so the caller must not modify the DataType after handing it
+ * off.  Notifiers are called by the task after the file is written, so a
+ * notification never goes out for a file not yet in place.
+ * @see WriteOutputPool */
 class WriteOutputThreadTask : public ThreadTask {
 public:
   /** Create a write output thread task. */
-  WriteOutputThreadTask(const std::string& key,
-    std::shared_ptr<DataType>            outputData,
-    std::map<std::string, std::string>   & outputParams);
+  WriteOutputThreadTask(
+    RAPIOAlgorithm                           * alg,
+    WriteOutputPool                          * pool,
+    const std::string                        & key,
+    std::shared_ptr<DataType>                outputData,
+    const std::map<std::string, std::string> & outputParams,
+    const std::string                        & productName);
 
-  /** Do our job.  Override to do your stuff. */
+  /** Write the DataType, notify and mark done */
   virtual void
-  execute();
+  execute() override;
+
+  /** The product key used to write the DataType */
+  const std::string&
+  getKey() const { return myKey; }
 
 protected:
 
+  /** The algorithm doing the writing */
+  RAPIOAlgorithm * myAlg;
+
+  /** The pool we report our latency to */
+  WriteOutputPool * myPool;
+
   /** The product key used to write the DataType */
   std::string myKey;
 
+  /** The DataType we are writing */
+  std::shared_ptr<DataType> myOutputData;
+
   /** The map of extra output params for the DataType */
   std::map<std::string, std::string> myOutputParams;
+
+  /** The resolved product name from -O */
+  std::string myProductName;
+
+  /** When we were queued, for latency */
+  std::chrono::steady_clock::time_point myQueuedAt;
 };
 
 /**
  * A utility for running thread pool of queued tasks
- * Note currently keeping each subclass group unique,
- * though possibly you could share a global thread pool
- * with generic task ability.
+ *
+ * Each worker has its own deque of tasks.  A worker runs its own tasks
+ * first in order and when it runs out steals from the back of the other
+ * workers, so uneven tasks don't leave cores idle.  Tasks enqueued from a
+ * worker go onto its own deque.  A group with one worker runs its tasks in
+ * the order given.
+ *
+ * Groups can be unique for a job or you can use the process wide
+ * shared group from getShared, which avoids the cost of creating threads
+ * for each piece of work.
  *
  * Using boost::thread_group, but maybe use tbb later.
  *
@@ -107,6 +147,36 @@ public:
   bool
   enqueueThreadTask(std::shared_ptr<ThreadTask> task);
 
+  /** Add a ThreadTask to the task queue, waiting while the queue is full */
+  void
+  waitEnqueueThreadTask(std::shared_ptr<ThreadTask> task);
+
+  /** Call func(start, end) over [begin, end) split into grain sized ranges.
+   * Workers grab the next range as they finish, so fast and slow ranges
+   * balance out.  The calling thread works too and this returns when
+   * every range is done.  Safe to call from within a task of this group.
+   * An exception from func is rethrown here. */
+  void
+  parallelFor(size_t begin, size_t end, size_t grain,
+    const std::function<void(size_t, size_t)>& func);
+
+  /** Number of worker threads */
+  size_t
+  getNumWorkers() const { return myMaxWorkers; }
+
+  /** Process wide shared thread group, created on first use */
+  static std::shared_ptr<ThreadGroup>
+  getShared();
+
+  /** Set the worker count of the shared group, 0 for number of cores.
+   * Call this during setup, before anything holds the shared group. */
+  static void
+  setSharedThreadCount(size_t threads);
+
+  /** Number of cores, or a guess if we can't tell */
+  static size_t
+  getDefaultThreadCount();
+
   /** On destruction, clean up threads */
   virtual
   ~ThreadGroup();
@@ -115,32 +185,146 @@ private:
 
   /** Main worker thread responsible for popping tasks from queue and executing */
   void
-  workerThread();
+  workerThread(size_t index);
+
+  /** Pop our own front, or steal the back of another worker */
+  bool
+  popTask(size_t index, std::shared_ptr<ThreadTask>& task);
 
 protected:
 
+  /** A worker's own task deque */
+  class WorkerQueue {
+public:
+    /** Lock for the deque */
+    std::mutex myLock;
+
+    /** Tasks of this worker */
+    std::deque<std::shared_ptr<ThreadTask> > myTasks;
+  };
+
   /** Maximum number of helper thread tasks we create */
   size_t myMaxWorkers;
 
   /** Maximum number of tasks we can buffer */
   size_t myMaxQueueSize;
 
-  /** Queue of tasks needing to be done */
-  std::queue<std::shared_ptr<ThreadTask> > myTaskQueue;
+  /** Deque of tasks per worker */
+  std::vector<std::unique_ptr<WorkerQueue> > myQueues;
 
-  /** Stop all threads when finalizing/exiting */
-  bool myStop;
+  /** Tasks queued in all the deques */
+  std::atomic<size_t> myQueued;
+
+  /** Round robin for tasks from outside the group */
+  std::atomic<size_t> myNextQueue;
 
-  /** Lock for myStop */
-  std::mutex myStopMutex;
+  /** Stop all threads when finalizing/exiting, locked by myTaskQueueMutex */
+  bool myStop;
 
-  /** Lock for myTaskQueue */
+  /** Lock for sleeping workers and myStop */
   std::mutex myTaskQueueMutex;
 
   /** Thread notification condition */
   std::condition_variable myCondition;
 
+  /** Notify waiting enqueuers a slot freed */
+  std::condition_variable mySpaceCondition;
+
   /** Boost thread group */
   boost::thread_group myWorkers;
+
+  /** Lock for the shared group */
+  static std::mutex theSharedLock;
+
+  /** The shared group */
+  static std::shared_ptr<ThreadGroup> theShared;
+
+  /** Worker count wanted for the shared group */
+  static size_t theSharedThreadCount;
+};
+
+/** A pool of background writers for RAPIOAlgorithm::writeOutputProduct.
+ * Each product key hashes to a single worker, so writes of one product
+ * stay in the order they were given while different products write in
+ * parallel.  Each worker queue is bounded, when full the caller waits,
+ * which keeps a slow disk from growing memory without limit.
+ *
+ * @author Robert Toomey
+ * @ingroup rapio_utility
+ * @brief Sharded bounded background writer threads.
+ */
+class WriteOutputPool {
+public:
+
+  /** Log stats every this many finished writes */
+  static constexpr size_t STATS_EVERY = 100;
+
+  /** Log a full writer at most this often, in seconds */
+  static constexpr size_t FULL_LOG_SECONDS = 60;
+
+  /** Create a pool of writers, each able to queue queueSize writes */
+  WriteOutputPool(size_t writers, size_t queueSize);
+
+  /** Drain any pending writes and stop the writers */
+  ~WriteOutputPool();
+
+  /** Queue a write, waiting while the worker for its key is full */
+  void
+  enqueue(std::shared_ptr<WriteOutputThreadTask> task);
+
+  /** Block until every queued write has finished */
+  void
+  drain();
+
+  /** Called by a task when it finishes its write */
+  void
+  taskDone(double queuedMS, double writeMS);
+
+  /** Number of writes queued or in progress */
+  size_t
+  getPending() const { return myPending; }
+
+  /** Number of writes finished */
+  size_t
+  getCompleted() const { return myCompleted; }
+
+  /** Log queue depth and latency stats */
+  void
+  logStats();
+
+protected:
+
+  /** Single thread groups, one per writer to keep product order */
+  std::vector<std::shared_ptr<ThreadGroup> > myWriters;
+
+  /** Writes queued or in progress */
+  std::atomic<size_t> myPending;
+
+  /** Writes finished */
+  std::atomic<size_t> myCompleted;
+
+  /** Largest number of writes pending at once */
+  size_t myMaxPending;
+
+  /** Total ms spent waiting in the queue */
+  double myQueuedTotalMS;
+
+  /** Largest ms spent waiting in the queue */
+  double myQueuedMaxMS;
+
+  /** Total ms spent writing */
+  double myWriteTotalMS;
+
+  /** Largest ms spent writing */
+  double myWriteMaxMS;
+
+  /** When we last logged waiting on a full writer */
+  std::chrono::steady_clock::time_point myLastFullLog;
+
+  /** Lock for stats and drain */
+  std::mutex myStatsMutex;
+
+  /** Signal when a write finishes */
+  std::condition_variable myDoneCondition;
 };
 }
@@ -46,6 +46,17 @@ public:
   virtual void
   add(VolumeValue * vvp, short x, short y, short z, size_t partIndex){ };
 
+  /** Can we merge another IO of our type into us?  Stage one uses this to
+   * resolve height layers in parallel, each layer into its own IO. */
+  virtual bool
+  canMerge(){ return false; }
+
+  /** Merge/append the added values of another IO (created by the same resolver
+   * and initialized the same way) into us.  Called in layer order so the
+   * result matches adding everything to a single IO. */
+  virtual void
+  merge(VolumeValueIO& other){ };
+
   /** Send/write stage2 data.  Give an algorithm pointer so we call do alg things if needed. */
   virtual void
   send(RAPIOAlgorithm * alg, Time aTime, const std::string& asName)
@@ -51,10 +51,10 @@ public:
   }
 
   /** Get the response message */
-  std::string
+  const std::string&
   getMessage()
   {
-    return message;
+    return myBuffer ? *myBuffer : message;
   }
 
   /** Get the header map */
@@ -99,7 +99,7 @@ public:
   bool
   isFile()
   {
-    return (message == "file");
+    return (!myBuffer && (message == "file"));
   }
 
   /** Set the response message */
@@ -107,6 +107,18 @@ public:
   setMessage(const std::string& m, const std::string& type = "text/plain")
   {
     message = m;
+    myBuffer.reset();
+    myHeaders.clear();
+    myHeaders["Content-Type"] = type;
+  }
+
+  /** Set the response message to a shared buffer, such as a cached tile.
+   * Large payloads aren't copied.  Don't change the buffer after. */
+  void
+  setMessage(std::shared_ptr<const std::string> m, const std::string& type)
+  {
+    message.clear();
+    myBuffer = m;
     myHeaders.clear();
     myHeaders["Content-Type"] = type;
   }
@@ -174,6 +186,9 @@ protected:
   /** Message response for web server */
   std::string message;
 
+  /** Shared message response, used instead of message if set */
+  std::shared_ptr<const std::string> myBuffer;
+
   /** File path, if any */
   std::string file;
 
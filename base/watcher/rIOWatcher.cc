@@ -9,6 +9,7 @@
 #include "rDirWatcher.h"
 #include "rEXEWatcher.h"
 #include "rRedisWatcher.h"
+#include "rJournalWatcher.h"
 
 #include <string>
 #include <memory>
@@ -33,6 +34,7 @@ IOWatcher::introduceSelf()
   DirWatcher::introduceSelf();
   EXEWatcher::introduceSelf();
   RedisWatcher::introduceSelf();
+  JournalWatcher::introduceSelf();
 }
 
 std::shared_ptr<WatcherType>
@@ -0,0 +1,67 @@
+#include "rJournalWatcher.h"
+
+#include "rError.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/inotify.h>
+
+using namespace rapio;
+
+/** Default constant for a journal watcher */
+const std::string JournalWatcher::JOURNAL_WATCH = "journal";
+
+bool
+JournalWatcher::attach(const std::string & dirname,
+  bool                                   realtime,
+  bool                                   archive,
+  IOListener *                           l)
+{
+  // The listener reads the journal itself on each poll
+  myWatches.push_back(std::make_shared<WatchInfo>(l));
+
+  if (myNotifyFD < 0) {
+    myNotifyFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (myNotifyFD < 0) {
+      fLogSevere("inotify_init failed with error: {}, polling journals only", strerror(errno));
+      return true;
+    }
+    myNotify = std::make_unique<boost::asio::posix::stream_descriptor>(EventLoop::io_context(), myNotifyFD);
+    waitForChange();
+  }
+
+  // Appends to a segment and new segments.  The sequence counter is
+  // written through a mapping, which inotify doesn't see.
+  if (inotify_add_watch(myNotifyFD, dirname.c_str(), IN_MODIFY | IN_CREATE | IN_MOVED_TO) < 0) {
+    fLogInfo("Can't watch journal {} ({}), polling it instead", dirname, strerror(errno));
+  }
+  return true;
+}
+
+void
+JournalWatcher::waitForChange()
+{
+  auto self = std::static_pointer_cast<JournalWatcher>(shared_from_this());
+
+  myNotify->async_wait(boost::asio::posix::stream_descriptor::wait_read,
+    [self](const boost::system::error_code& ec) {
+      if (ec) {
+        return;
+      }
+      // Drain the events, we only care that something changed
+      char buffer[4096];
+      while (::read(self->myNotifyFD, buffer, sizeof(buffer)) > 0) { }
+
+      self->setReady();
+      self->waitForChange();
+    });
+}
+
+void
+JournalWatcher::introduceSelf()
+{
+  std::shared_ptr<JournalWatcher> io = std::make_shared<JournalWatcher>();
+
+  IOWatcher::introduce(JOURNAL_WATCH, io);
+}
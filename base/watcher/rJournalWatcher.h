@@ -0,0 +1,51 @@
+#pragma once
+
+#include <rIOWatcher.h>
+#include <rEventLoop.h>
+#include <rEventTimer.h>
+
+#include <memory>
+
+namespace rapio {
+/** Wakes journal indexes when their journal is appended to.  Writers
+ * append with write(), so inotify reports a modify in the journal
+ * directory and we run right away instead of waiting on the next pulse.
+ * We still pulse often as a fallback, such as for a journal directory
+ * that doesn't exist yet.  Indexes check their sequence counter before
+ * reading, which is a read of mapped memory and costs next to nothing.
+ *
+ * @author Robert Toomey
+ */
+class JournalWatcher : public WatcherType {
+public:
+
+  /** Default constant for a journal watcher */
+  static const std::string JOURNAL_WATCH;
+
+  /** Create a journal watcher */
+  JournalWatcher() : WatcherType(100, 1, "Journal index event handler"), myNotifyFD(-1){ }
+
+  /** Introduce this to the global factory */
+  static void
+  introduceSelf();
+
+  /** Attach a pulse for a given listener to us */
+  virtual bool
+  attach(const std::string& dirname, bool realtime, bool archive, IOListener *) override;
+
+  /** Destroy us */
+  virtual ~JournalWatcher(){ }
+
+protected:
+
+  /** Wait on the inotify descriptor, running our action on any change */
+  void
+  waitForChange();
+
+  /** Inotify descriptor, owned by myNotify once created */
+  int myNotifyFD;
+
+  /** Async wait on the inotify descriptor in the main loop */
+  std::unique_ptr<boost::asio::posix::stream_descriptor> myNotify;
+};
+}
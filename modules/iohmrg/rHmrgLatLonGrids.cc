@@ -154,9 +154,6 @@ HmrgLatLonGrids::readLatLonGrids(StreamBuffer& g, const int year)
     radars.push_back(r);
   }
 
-  // Common code here with Radial
-  std::vector<short int> rawBuffer;
-
   #if 0
   for (size_t i = 0; i < numRadars; i++) {
     fLogDebug("   Got radar '{}'", radars[i]);
@@ -185,15 +182,7 @@ HmrgLatLonGrids::readLatLonGrids(StreamBuffer& g, const int year)
   const int dataMissing     = dataMissingValue * dataScale;
   const int dataUnavailable = -9990; // FIXME: table lookup * dataScale;
 
-  // Read in the data from file
-  int count = num_x * num_y * num_z;
-
-  rawBuffer.resize(count);
-  g.readVector(&rawBuffer[0], count * sizeof(short int)); // FIXME: vector doesn't check endian right?
-
   // Handle single layer
-  size_t at = 0;
-
   if (num_z == 1) {
     fLogInfo("HMRG reader: --Single layer LatLonGrid--");
 
@@ -217,13 +206,9 @@ HmrgLatLonGrids::readLatLonGrids(StreamBuffer& g, const int year)
     auto& data = array->ref();
 
     // NOTE: flipped order from RadialSet array if you try to merge the code
-    for (size_t j = 0; j < num_y; ++j) {
-      const size_t jflip = num_y - j - 1;
-      for (size_t i = 0; i < num_x; ++i) { // row order for the data, so read in order
-        data[jflip][i] =
-          IOHmrg::fromHmrgValue(rawBuffer[at++], dataUnavailable, dataMissing, dataScale);
-      }
-    }
+    // Rows go straight into their flipped spot in the grid storage
+    IOHmrg::readHmrgRows(g, data.data(), num_x, num_y, true,
+      dataUnavailable, dataMissing, dataScale);
     // fLogInfo("    Found {} missing values", countm);
     return latLonGridSP;
 
@@ -253,19 +238,13 @@ HmrgLatLonGrids::readLatLonGrids(StreamBuffer& g, const int year)
       grid.setLayerValue(i, heightMeters[i]);
     }
 
-    // This gonna be slower than W2 because the data ordering is different
-    // so we can't just directly push into memory.
+    // Each layer is contiguous rows, flipped north to south
     auto array = grid.getFloat3D(Constants::PrimaryDataName);
     auto& data = array->ref();
+    const size_t layer = (size_t) num_x * num_y;
     for (size_t z = 0; z < num_z; ++z) {
-      for (size_t j = 0; j < num_y; ++j) {
-        const size_t jflip = num_y - j - 1;
-        for (size_t i = 0; i < num_x; ++i) { // row order for the data, so read in order
-          data[z][jflip][i] = IOHmrg::fromHmrgValue(rawBuffer[at++], dataUnavailable,
-              dataMissing,
-              dataScale);
-        }
-      }
+      IOHmrg::readHmrgRows(g, data.data() + z * layer, num_x, num_y, true,
+        dataUnavailable, dataMissing, dataScale);
     }
     fLogInfo(">>Finished reading full LatLonHeightGrid");
 
@@ -409,49 +388,26 @@ HmrgLatLonGrids::writeLatLonGrids(StreamBuffer& g, std::shared_ptr<LatLonArea> l
   g.writeString(radar, 4);
 
   // Write in the data from LatLonGrid
-  // For now convert which eats some ram for big stuff.  I think we could
-  // add the mrms binary ability to our LatLonGrid data structure to compress ram/disk
-  int count = num_x * num_y * num_z;
+  const size_t count = (size_t) num_x * num_y * num_z;
 
   if (count == 0) {
     return true; // didn't write anything
   }
 
-  // FIXME: Make configurable. Alpha: Add write block ability due to having to write pretty
-  // large grids, and this avoids doubling RAM usage. Well have to test this more
-  std::vector<short int> rawBuffer;
-  const size_t maxItems = 524288; // Max items to write at once, here about 1 MB per 500K items
-
-  if (count > maxItems) {
-    count = maxItems; // trim buffer
-  }
-  rawBuffer.resize(count); // Up to maxItems *size(short int)
-
-  size_t at = 0;
-
-  // Various classes we support writing. FIXME: Should probably use specializer API and
-  // break up this code that way instead.
-
+  // Write in blocks of rows, which avoids doubling RAM usage for big grids
   const int dataMissing = dataMissingValue * dataScale; // prescaled for speed
   const int dataUnavailable = dataNCValue * dataScale;  // prescaled for speed
+  const size_t layer = (size_t) num_x * num_y;
 
+  // Various classes we support writing. FIXME: Should probably use specializer API and
+  // break up this code that way instead.
   if (auto llgptr = std::dynamic_pointer_cast<LatLonGrid>(llgp)) {
     fLogInfo("HMRG writer: --LatLonGrid--");
     auto& data = llg.getFloat2DRef(Constants::PrimaryDataName);
 
     // NOTE: flipped order from RadialSet array if you try to merge the code
-    for (size_t j = num_y - 1; j != SIZE_MAX; --j) {
-      for (size_t i = 0; i < num_x; ++i) { // row order for the data, so read in order
-        rawBuffer[at] = IOHmrg::toHmrgValue(data[j][i], dataUnavailable, dataMissing, dataScale);
-        if (++at >= count) {
-          g.writeVector(rawBuffer.data(), count * sizeof(short int));
-          at = 0;
-        }
-      }
-    }
-    if (at != 0) { // final left over
-      g.writeVector(rawBuffer.data(), at * sizeof(short int));
-    }
+    IOHmrg::writeHmrgRows(g, data.data(), num_x, num_y, true,
+      dataUnavailable, dataMissing, dataScale);
     success = true;
   } else if (auto llnptr = std::dynamic_pointer_cast<LLHGridN2D>(llgp)) {
     fLogInfo("HMRG writer: --Multi layer N 2D layers (LLHGridN2D)--");
@@ -461,19 +417,8 @@ HmrgLatLonGrids::writeLatLonGrids(StreamBuffer& g, std::shared_ptr<LatLonArea> l
       // Each 3D is a 2N layer here
       auto llg = lln.get(z);
       auto& data = llg->getFloat2DRef();
-
-      for (size_t j = num_y - 1; j != SIZE_MAX; --j) {
-        for (size_t i = 0; i < num_x; ++i) { // row order for the data, so read in order
-          rawBuffer[at] = IOHmrg::toHmrgValue(data[j][i], dataUnavailable, dataMissing, dataScale);
-          if (++at >= count) {
-            g.writeVector(rawBuffer.data(), count * sizeof(short int));
-            at = 0;
-          }
-        }
-      }
-    }
-    if (at != 0) { // final left over
-      g.writeVector(rawBuffer.data(), at * sizeof(short int));
+      IOHmrg::writeHmrgRows(g, data.data(), num_x, num_y, true,
+        dataUnavailable, dataMissing, dataScale);
     }
     success = true;
   } else if (auto llhgptr = std::dynamic_pointer_cast<LatLonHeightGrid>(llgp)) {
@@ -483,20 +428,8 @@ HmrgLatLonGrids::writeLatLonGrids(StreamBuffer& g, std::shared_ptr<LatLonArea> l
     auto& data = llg.getFloat3DRef(Constants::PrimaryDataName);
 
     for (size_t z = 0; z < num_z; ++z) {
-      // NOTE: flipped order from RadialSet array if you try to merge the code
-      // Same code as 2D though the data array type is different.  Could use a template method or macro
-      for (size_t j = num_y - 1; j != SIZE_MAX; --j) {
-        for (size_t i = 0; i < num_x; ++i) { // row order for the data, so read in order
-          rawBuffer[at] = IOHmrg::toHmrgValue(data[z][j][i], dataUnavailable, dataMissing, dataScale);
-          if (++at >= count) {
-            g.writeVector(rawBuffer.data(), count * sizeof(short int));
-            at = 0;
-          }
-        }
-      }
-    }
-    if (at != 0) { // final left over
-      g.writeVector(rawBuffer.data(), at * sizeof(short int));
+      IOHmrg::writeHmrgRows(g, data.data() + z * layer, num_x, num_y, true,
+        dataUnavailable, dataMissing, dataScale);
     }
     success = true;
   } else {
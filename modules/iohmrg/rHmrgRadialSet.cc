@@ -127,17 +127,6 @@ HmrgRadialSet::readRadialSet(StreamBuffer& g, const std::string& radarName)
   fLogDebug("   Data scale and missing value: {} and {}", dataScale, dataMissingValue);
   #endif // if 0
 
-  // Read the data right?  Buffer the short ints we'll have to unscale them into the netcdf
-  // We'll handle endian swapping in the convert loop.  So these shorts 'could' be flipped if
-  // we're on a big endian machine
-  // Order is radial major, all gates for a single radial/ray first.  That's great since
-  // that's our RAPIO/W2 order.
-  const int count = num_radials * num_gates;
-  std::vector<short int> rawBuffer;
-
-  rawBuffer.resize(count);
-  g.readVector(&rawBuffer[0], count * sizeof(short int));
-
   auto radialSetSP = RadialSet::Create(name, units, center, dataTime, elevAngleDegs, distanceToFirstGateMeters,
       gateSpacingMeters, num_radials, num_gates);
   RadialSet& radialSet = *radialSetSP;
@@ -161,35 +150,25 @@ HmrgRadialSet::readRadialSet(StreamBuffer& g, const std::string& radarName)
   auto array = radialSet.getFloat2D(Constants::PrimaryDataName);
   auto& data = array->ref();
 
-  // size_t countm = 0;
-  size_t rawBufferIndex = 0;
-
   // Think using the missing scaled up will help prevent float drift here
   // and avoid some divisions in loop
   const int dataMissing     = dataMissingValue * dataScale;
   const int dataUnavailable = -9990; // FIXME: table lookup * dataScale;
 
   for (size_t i = 0; i < num_radials; ++i) {
-    float start_az = i; // Each degree
-
     // We could add each time but that might accumulate drift error
     // Adding would be faster.  Does it matter?
     azimuths[i]   = std::fmod(firstAzimuthDegs + (i * azimuthResDegs), 360);
     beamwidths[i] = 1; // Correct?
     // gatewidths[i] = gateSpacingMeters;
-    for (size_t j = 0; j < num_gates; ++j) {
-      auto old = rawBuffer[rawBufferIndex];
-      data[i][j] = IOHmrg::fromHmrgValue(rawBuffer[rawBufferIndex++], dataUnavailable, dataMissing,
-          dataScale);
-      #if 0
-      if (i == 0) {
-        if (j < 20) {
-          std::cout << old << " --> " << data[i][j] << "\n";
-        }
-      }
-      #endif
-    }
   }
+
+  // Read the data.  Order is radial major, all gates for a single radial/ray
+  // first.  That's great since that's our RAPIO/W2 order, so we convert
+  // blocks of radials straight into the array.  Endian swapping is handled
+  // in the convert loop.
+  IOHmrg::readHmrgRows(g, data.data(), num_gates, num_radials, false,
+    dataUnavailable, dataMissing, dataScale);
   // fLogInfo("    Found {} missing values", countm);
 
   return radialSetSP;
@@ -358,19 +337,9 @@ HmrgRadialSet::writeRadialSet(StreamBuffer& g, std::shared_ptr<RadialSet> radial
     g.writeInt(0);
   }
 
-  const int count = num_radials * num_gates;
-  std::vector<short int> rawBuffer;
-
-  rawBuffer.resize(count);
-
-  size_t at = 0;
-
-  for (size_t i = 0; i < num_radials; ++i) {
-    for (size_t j = 0; j < num_gates; ++j) {
-      rawBuffer[at++] = IOHmrg::toHmrgValue(data[i][j], dataUnavailable, dataMissing, dataScale);
-    }
-  }
-  g.writeVector(rawBuffer.data(), count * sizeof(short int));
+  // Radial major, same as our storage, in blocks of radials
+  IOHmrg::writeHmrgRows(g, data.data(), num_gates, num_radials, false,
+    dataUnavailable, dataMissing, dataScale);
 
   return true;
 } // HmrgRadialSet::writeRadialSet
@@ -231,6 +231,48 @@ IOHmrg::encodeDataType(std::shared_ptr<DataType> dt,
   return successful;
 } // IOHmrg::encodeDataType
 
+void
+IOHmrg::readHmrgRows(StreamBuffer& g, float * out, size_t rowSize, size_t rows, bool flip,
+  const int dataUnavailable, const int dataMissing, const float dataScale)
+{
+  if ((rowSize == 0) || (rows == 0)) {
+    return;
+  }
+  const size_t blockRows = std::max(size_t(1), BLOCK_VALUES / rowSize);
+  std::vector<short int> buffer(std::min(rows, blockRows) * rowSize);
+
+  for (size_t at = 0; at < rows; at += blockRows) {
+    const size_t n = std::min(blockRows, rows - at);
+    g.readVector(buffer.data(), n * rowSize * sizeof(short int));
+    for (size_t r = 0; r < n; ++r) {
+      const size_t row = flip ? (rows - 1 - (at + r)) : (at + r);
+      fromHmrgValues(&buffer[r * rowSize], out + row * rowSize, rowSize,
+        dataUnavailable, dataMissing, dataScale);
+    }
+  }
+}
+
+void
+IOHmrg::writeHmrgRows(StreamBuffer& g, const float * in, size_t rowSize, size_t rows, bool flip,
+  const int dataUnavailable, const int dataMissing, const float dataScale)
+{
+  if ((rowSize == 0) || (rows == 0)) {
+    return;
+  }
+  const size_t blockRows = std::max(size_t(1), BLOCK_VALUES / rowSize);
+  std::vector<short int> buffer(std::min(rows, blockRows) * rowSize);
+
+  for (size_t at = 0; at < rows; at += blockRows) {
+    const size_t n = std::min(blockRows, rows - at);
+    for (size_t r = 0; r < n; ++r) {
+      const size_t row = flip ? (rows - 1 - (at + r)) : (at + r);
+      toHmrgValues(in + row * rowSize, &buffer[r * rowSize], rowSize,
+        dataUnavailable, dataMissing, dataScale);
+    }
+    g.writeVector(buffer.data(), n * rowSize * sizeof(short int));
+  }
+}
+
 StreamBuffer *
 IOHmrg::keyToStreamBuffer(std::map<std::string, std::string>& keys)
 {
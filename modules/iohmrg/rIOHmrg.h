@@ -54,6 +54,16 @@ public:
     return out;
   }
 
+  /** Scale a value to a short, clamping to the short range.  Converting
+   * an out of range float to a short is undefined. */
+  static inline short int
+  scaleHmrgValue(const float v, const float dataScale)
+  {
+    const float s = v * dataScale;
+
+    return (s >= 32767.0f) ? 32767 : ((s > -32768.0f) ? (short int) s : -32768);
+  }
+
   /** Convert float to scaled compressed int. */
   static inline short int
   toHmrgValue(float v, const int dataUnavailable, const int dataMissing,
@@ -70,12 +80,68 @@ public:
     } else if (v == w2missing) {
       out = dataMissing;
     } else {
-      out = v * dataScale;
+      out = scaleHmrgValue(v, dataScale);
       ON_BIG_ENDIAN(OS::byteswap(out));
     }
     return out;
   }
 
+  /** Convert a run of scaled compressed ints to floats.  A plain loop over
+   * arrays with no calls so the compiler can vectorize it. */
+  static inline void
+  fromHmrgValues(const short int * in, float * out, size_t count,
+    const int dataUnavailable, const int dataMissing, const float dataScale)
+  {
+    const float unavailable = Constants::DataUnavailable;
+    const float missing     = Constants::MissingData;
+
+    for (size_t i = 0; i < count; ++i) {
+      short int v = in[i];
+      ON_BIG_ENDIAN(OS::byteswap(v));
+      const float f = (float) v / dataScale;
+      out[i] = (v == dataUnavailable) ? unavailable : ((v == dataMissing) ? missing : f);
+    }
+  }
+
+  /** Convert a run of floats to scaled compressed ints. */
+  static inline void
+  toHmrgValues(const float * in, short int * out, size_t count,
+    const int dataUnavailable, const int dataMissing, const float dataScale)
+  {
+    const SentinelDouble w2missing     = Constants::MissingData;
+    const SentinelDouble w2unavailable = Constants::DataUnavailable;
+
+    for (size_t i = 0; i < count; ++i) {
+      const float v = in[i];
+      short int s;
+      if (v == w2unavailable) {
+        s = dataUnavailable;
+      } else if (v == w2missing) {
+        s = dataMissing;
+      } else {
+        s = scaleHmrgValue(v, dataScale);
+        ON_BIG_ENDIAN(OS::byteswap(s));
+      }
+      out[i] = s;
+    }
+  }
+
+  /** Values per block when reading or writing data, about 1 MB */
+  static constexpr size_t BLOCK_VALUES = 524288;
+
+  /** Read rows of scaled compressed ints into contiguous float rows.
+   * Reads blocks of rows at once.  With flip the first row read is the
+   * last row of out, as in HMRG grids stored south to north. */
+  static void
+  readHmrgRows(StreamBuffer& g, float * out, size_t rowSize, size_t rows, bool flip,
+    const int dataUnavailable, const int dataMissing, const float dataScale);
+
+  /** Write contiguous float rows as scaled compressed ints, in blocks of
+   * rows.  With flip the last row of in is written first. */
+  static void
+  writeHmrgRows(StreamBuffer& g, const float * in, size_t rowSize, size_t rows, bool flip,
+    const int dataUnavailable, const int dataMissing, const float dataScale);
+
   /** What we consider a valid year in the MRMS binary file,
    * used for validation of datatype */
   static bool
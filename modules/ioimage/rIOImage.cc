@@ -121,10 +121,13 @@ buildMagickImage(Magick::Image& i, std::shared_ptr<DataGrid> grid, std::map<std:
     }
     auto& data = floatArray->ref();
     unsigned char r, g, b, a;
+    std::vector<uint32_t> colors(cols);
 
     for (size_t y = 0; y < rows; y++) {
+      // Rows are contiguous, colorize a row at a time
+      aColorMap->colorize(&data[y][0], colors.data(), cols);
       for (size_t x = 0; x < cols; x++) {
-        aColorMap->getColor(data[y][x], r, g, b, a);
+        ColorMap::unpackColor(colors[x], r, g, b, a);
         Magick::ColorRGB cc(r / 255.0, g / 255.0, b / 255.0);
         cc.alpha(1.0 - (a / 255.0));
         *pixel++ = cc;
@@ -20,6 +20,8 @@
 
 #include <cstdio>
 #include <cassert>
+#include <atomic>
+#include <fstream>
 
 using namespace rapio;
 using namespace std;
@@ -39,7 +41,6 @@ createRAPIOIO(void)
 
 float IONetcdf::MISSING_DATA = Constants::MissingData;
 float IONetcdf::RANGE_FOLDED = Constants::RangeFolded;
-int IONetcdf::GZ_LEVEL       = 6;
 
 std::string
 IONetcdf::getHelpString(const std::string& key)
@@ -73,12 +74,12 @@ IONetcdf::createDataType(const std::string& params)
   fLogInfo("Netcdf reader: {}", url.toString());
   std::shared_ptr<DataType> datatype = nullptr;
 
-  // Note, in RAPIO we can read a netcdf file remotely too
-  std::vector<char> buf;
+  // Note, in RAPIO we can read a netcdf file remotely too.  Local
+  // uncompressed files are memory mapped, so netcdf reads only the
+  // pages it needs.  The view must live until nc_close.
+  auto buf = IOURL::readView(url);
 
-  IOURL::read(url, buf);
-
-  if (!buf.empty()) {
+  if ((buf != nullptr) && !buf->empty()) {
     // Open netcdf directly from buffer memory
     int retval, ncid;
     // nc_open_mem looks like it actually tries to read URLS directly
@@ -89,7 +90,7 @@ IONetcdf::createDataType(const std::string& params)
     static size_t counter  = 1;
     const std::string name = "netcdf-" + std::to_string(OS::getProcessID()) + std::to_string(counter) + ".nc";
     if (counter++ > 1000000000) { counter = 1; }
-    retval = nc_open_mem(name.c_str(), NC_NOWRITE, buf.size(), &buf[0], &ncid);
+    retval = nc_open_mem(name.c_str(), NC_NOWRITE, buf->size(), buf->data(), &ncid);
 
     if (retval == NC_NOERR) {
       // This is delegation, if successful we lose our netcdf-ness and become
@@ -127,10 +128,127 @@ IONetcdf::createDataType(const std::string& params)
   return (datatype);
 } // IONetcdf::readNetcdfDataType
 
+namespace {
+/** Is a key turned off?  Missing keys use the default */
 bool
-IONetcdf::encodeDataType(std::shared_ptr<DataType> dt,
-  std::map<std::string, std::string>               & keys
-)
+keyOn(std::map<std::string, std::string>& keys, const std::string& key, bool defaultOn)
+{
+  auto it = keys.find(key);
+
+  if ((it == keys.end()) || it->second.empty()) {
+    return defaultOn;
+  }
+  const std::string& v = it->second;
+
+  return !((v == "off") || (v == "false") || (v == "0") || (v == "no"));
+}
+}
+
+NetcdfWriteSettings
+NetcdfWriteSettings::fromKeys(std::map<std::string, std::string>& keys)
+{
+  NetcdfWriteSettings s;
+
+  try{
+    s.deflateLevel = std::stoi(keys["deflate_level"]);
+  }catch (const std::exception& e) {
+    s.deflateLevel = 6;
+  }
+  s.deflateLevel = std::max(0, std::min(9, s.deflateLevel));
+  s.shuffle      = keyOn(keys, "shuffle", true);
+  s.chunking     = keyOn(keys, "chunking", true);
+  try{
+    s.quantize = std::max(0, std::stoi(keys["quantize"]));
+  }catch (const std::exception& e) {
+    s.quantize = 0;
+  }
+  return s;
+}
+
+std::vector<size_t>
+NetcdfWriteSettings::getChunkSizes(int ncid, nc_type xtype, int ndims, const int dimids[])
+{
+  std::vector<size_t> chunks(ndims, 1);
+  size_t typeSize = 4;
+
+  nc_inq_type(ncid, xtype, nullptr, &typeSize);
+
+  for (int i = 0; i < ndims; ++i) {
+    size_t len = 0;
+    nc_inq_dimlen(ncid, dimids[i], &len);
+    // Unlimited dimensions start at zero
+    chunks[i] = std::max(size_t(1), len);
+  }
+
+  // One chunk per 2D slice, for example a height level of a 3D grid, so
+  // reading or writing a level only touches its own chunks.
+  for (int i = 0; i < ndims - 2; ++i) {
+    chunks[i] = 1;
+  }
+
+  // Split the slowest varying dimension until we're small enough
+  size_t bytes = typeSize;
+
+  for (auto c:chunks) {
+    bytes *= c;
+  }
+  int at = 0;
+
+  while ((bytes > CHUNK_BYTES) && (at < ndims)) {
+    if (chunks[at] > 1) {
+      const size_t half = (chunks[at] + 1) / 2;
+      bytes     = bytes / chunks[at] * half;
+      chunks[at] = half;
+    } else {
+      at++;
+    }
+  }
+  return chunks;
+} // NetcdfWriteSettings::getChunkSizes
+
+void
+NetcdfWriteSettings::apply(int ncid, int varid, nc_type xtype, int ndims, const int dimids[]) const
+{
+  // Filters and chunks are netcdf4/HDF5 only
+  int format = 0;
+
+  nc_inq_format(ncid, &format);
+  if ((format != NC_FORMAT_NETCDF4) && (format != NC_FORMAT_NETCDF4_CLASSIC)) {
+    return;
+  }
+
+  // Scalars can't be chunked or filtered
+  if (ndims < 1) {
+    return;
+  }
+
+  if (chunking) {
+    auto chunks = getChunkSizes(ncid, xtype, ndims, dimids);
+    nc_def_var_chunking(ncid, varid, NC_CHUNKED, &chunks[0]);
+  }
+
+  if ((quantize > 0) && ((xtype == NC_FLOAT) || (xtype == NC_DOUBLE))) {
+    #ifdef NC_QUANTIZE_GRANULARBR
+    nc_def_var_quantize(ncid, varid, NC_QUANTIZE_GRANULARBR, quantize);
+    #else
+    static bool warned = false;
+    if (!warned) {
+      fLogSevere("Netcdf library doesn't support quantize, writing full precision.");
+      warned = true;
+    }
+    #endif
+  }
+
+  // deflate_level 0 no compression and 9 (max compression), shuffle
+  // only helps when deflating.
+  if (deflateLevel > 0) {
+    nc_def_var_deflate(ncid, varid, shuffle ? NC_SHUFFLE : 0, 1, deflateLevel);
+  }
+} // NetcdfWriteSettings::apply
+
+bool
+IONetcdf::writeNetcdf(std::shared_ptr<DataType> dt,
+  std::map<std::string, std::string>          & keys, int ncid)
 {
   // ----------------------------------------------------------
   // Get specializer for the data type
@@ -152,6 +270,72 @@ IONetcdf::encodeDataType(std::shared_ptr<DataType> dt,
     return false;
   }
 
+  bool successful = false;
+
+  try {
+    keys["NETCDF_NCID"] = to_string(ncid);
+    keys["MakeSparse"]  = "on";
+    dt->preWrite(keys);
+    successful = fmt->write(dt, keys);
+    dt->postWrite(keys);
+  } catch (...) {
+    successful = false;
+    fLogSevere("Failed to write netcdf file for DataType");
+  }
+  return successful;
+} // IONetcdf::writeNetcdf
+
+size_t
+IONetcdf::encodeDataTypeBuffer(std::shared_ptr<DataType> dt, std::vector<char>& buffer,
+  std::map<std::string, std::string>     & keys
+)
+{
+  int ncflags;
+
+  try{
+    ncflags = std::stoi(keys["ncflags"]);
+  }catch (const std::exception& e) {
+    ncflags = NC_NETCDF4;
+  }
+
+  // Netcdf grows the memory as needed, start with a guess
+  static std::atomic<size_t> counter(1);
+  const std::string name    = "netcdf-out-" + std::to_string(counter++) + ".nc";
+  const size_t initialsize = 1024 * 1024;
+  int ncid = -1;
+
+  if (nc_create_mem(name.c_str(), ncflags, initialsize, &ncid) != NC_NOERR) {
+    fLogSevere("Netcdf in memory create error");
+    return 0;
+  }
+
+  const bool successful = writeNetcdf(dt, keys, ncid);
+
+  // Closing hands us the memory, which we own after
+  NC_memio finalmem;
+
+  finalmem.memory = nullptr;
+  finalmem.size   = 0;
+  const int retval = nc_close_memio(ncid, &finalmem);
+
+  if (successful && (retval == NC_NOERR) && (finalmem.memory != nullptr)) {
+    const char * m = static_cast<const char *>(finalmem.memory);
+    buffer.assign(m, m + finalmem.size);
+  } else {
+    if (retval != NC_NOERR) {
+      fLogSevere("Netcdf in memory close error: {}", nc_strerror(retval));
+    }
+    buffer.clear();
+  }
+  free(finalmem.memory);
+  return buffer.size();
+} // IONetcdf::encodeDataTypeBuffer
+
+bool
+IONetcdf::encodeDataType(std::shared_ptr<DataType> dt,
+  std::map<std::string, std::string>               & keys
+)
+{
   // ----------------------------------------------------------
   // Get the filename we should write to
   std::string filename;
@@ -173,46 +357,41 @@ IONetcdf::encodeDataType(std::shared_ptr<DataType> dt,
   }catch (const std::exception& e) {
     ncflags = NC_NETCDF4;
   }
-  try{
-    IONetcdf::GZ_LEVEL = std::stoi(keys["deflate_level"]);
-  }catch (const std::exception& e) {
-    IONetcdf::GZ_LEVEL = 6;
-  }
+  const NetcdfWriteSettings settings = NetcdfWriteSettings::fromKeys(keys);
+
+  if (keyOn(keys, "ncmemory", false)) {
+    // Encode in memory, then a single write of the file.  Keeps the
+    // many small HDF5 writes off the disk.
+    std::vector<char> buffer;
+    if (encodeDataTypeBuffer(dt, buffer, keys) > 0) {
+      std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+      out.write(buffer.data(), buffer.size());
+      successful = out.good();
+      if (!successful) {
+        fLogSevere("Couldn't write netcdf file: {}", filename);
+      }
+    }
+  } else {
+    // Open netcdf file
+    int ncid = -1;
+    try {
+      NETCDF(nc_create(filename.c_str(), ncflags, &ncid));
+    } catch (const NetcdfException& ex) {
+      nc_close(ncid);
+      fLogSevere("Netcdf create error: {} {}", filename, ex.getNetcdfStr());
+      return false;
+    }
 
-  // Open netcdf file
-  int ncid = -1;
+    if (ncid == -1) {
+      fLogSevere("Invalid netcdf ncid, can't write");
+      return false;
+    }
 
-  // NC_memio finalmem;
-  // size_t initialsize = 65000;
-  try {
-    // NETCDF(nc_create_mem("testing", NC_NETCDF4, initialsize, &ncid));
-    NETCDF(nc_create(filename.c_str(), ncflags, &ncid));
-  } catch (const NetcdfException& ex) {
-    // nc_close_memio(ncid, &finalmem);
+    // Write netcdf to a disk file here
+    successful = writeNetcdf(dt, keys, ncid);
     nc_close(ncid);
-    fLogSevere("Netcdf create error: {} {}", filename, ex.getNetcdfStr());
-    return false;
-  }
-
-  if (ncid == -1) {
-    fLogSevere("Invalid netcdf ncid, can't write");
-    return false;
-  }
-
-  // Write netcdf to a disk file here
-  try {
-    keys["NETCDF_NCID"] = to_string(ncid);
-    keys["MakeSparse"]  = "on";
-    dt->preWrite(keys);
-    successful = fmt->write(dt, keys);
-    dt->postWrite(keys);
-  } catch (...) {
-    successful = false;
-    fLogSevere("Failed to write netcdf file for DataType");
   }
 
-  nc_close(ncid);
-
   // ----------------------------------------------------------
   // Post processing such as extra compression, ldm, etc.
   if (successful) {
@@ -222,7 +401,11 @@ IONetcdf::encodeDataType(std::shared_ptr<DataType> dt,
   // Standard output
   if (successful) {
     std::stringstream s;
-    s << " (cmode:" << ncflags << " deflate_level: " << IONetcdf::GZ_LEVEL << ")";
+    s << " (cmode:" << ncflags << " deflate_level: " << settings.deflateLevel;
+    if (settings.quantize > 0) {
+      s << " quantize: " << settings.quantize;
+    }
+    s << ")";
     showFileInfo("Netcdf writer: ", keys, s.str());
   }
 
@@ -232,13 +415,14 @@ IONetcdf::encodeDataType(std::shared_ptr<DataType> dt,
 /** Add multiple dimension variable and assign a units to it */
 int
 IONetcdf::addVar(
-  int          ncid,
-  const char * name,
-  const char * units,
-  nc_type      xtype,
-  int          ndims,
-  const int    dimids[],
-  int *        varid)
+  int                       ncid,
+  const char *              name,
+  const char *              units,
+  nc_type                   xtype,
+  int                       ndims,
+  const int                 dimids[],
+  int *                     varid,
+  const NetcdfWriteSettings & settings)
 {
   int retval;
 
@@ -262,19 +446,7 @@ IONetcdf::addVar(
 
     // Compress variable...
     if (retval == NC_NOERR) {
-      //  retval = compressVar(ncid, *varid);
-      const int shuffle = NC_CONTIGUOUS;
-      const int deflate = 1;                        // if non-zero, turn on the
-                                                    // deflate-level
-      const int deflate_level = IONetcdf::GZ_LEVEL; // Set the compression level
-      // Compression for variable
-      //   NETCDF(nc_def_var_chunking(ncid, datavar, 0, 0)); Probably will never
-      // need this
-      // shuffle == control the HDF5 shuffle filter
-      // default == turn on deflate for variable
-      // deflate_level 0 no compression and 9 (max compression)
-      // Don't care if fails..maybe warn or something...
-      nc_def_var_deflate(ncid, *varid, shuffle, deflate, deflate_level);
+      settings.apply(ncid, *varid, xtype, ndims, dimids);
     }
   }
   return (retval);
@@ -684,7 +856,8 @@ IONetcdf::netcdfToDataArrayType(const nc_type& xtype, DataArrayType& theType)
 // Maybe part of a NetcdfDataGrid class?
 std::vector<int>
 IONetcdf::declareGridVars(
-  DataGrid& grid, const std::string& typeName, const std::vector<int>& ncdims, int ncid)
+  DataGrid& grid, const std::string& typeName, const std::vector<int>& ncdims, int ncid,
+  const NetcdfWriteSettings& settings)
 {
   auto list = grid.getArrays();
 
@@ -730,7 +903,7 @@ IONetcdf::declareGridVars(
 
     // Add the variable
     int var = -1;
-    NETCDF(addVar(ncid, theName.c_str(), theUnits.c_str(), xtype, s, dims, &var));
+    NETCDF(addVar(ncid, theName.c_str(), theUnits.c_str(), xtype, s, dims, &var, settings));
 
     datavars.push_back(var);
   }
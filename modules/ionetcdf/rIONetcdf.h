@@ -57,6 +57,61 @@ private:
   std::string command;
 };
 
+/** Compression and layout settings for one netcdf write.  These come
+ * from the output keys of each write, so threads writing different
+ * products with different settings don't step on each other.
+ *
+ * Keys:
+ * deflate_level: 0 no compression to 9 max compression
+ * shuffle: on/off the HDF5 byte shuffle filter before deflate
+ * chunking: on/off chunk shapes from the array dimensions
+ * quantize: Significant digits to keep of float data, 0 for all.  Zeroes
+ *   the rest of the bits so deflate works better.  Needs netcdf 4.9.
+ *
+ * These only apply to netcdf4 files, classic files ignore them.
+ *
+ * @author Robert Toomey
+ */
+class NetcdfWriteSettings {
+public:
+
+  /** Default settings */
+  NetcdfWriteSettings() : deflateLevel(6), shuffle(true), chunking(true),
+    quantize(0){ }
+
+  /** Settings from output keys, anything missing is the default */
+  static NetcdfWriteSettings
+  fromKeys(std::map<std::string, std::string>& keys);
+
+  /** Chunk sizes for a variable with given netcdf dimensions.  Grids
+   * with 3 or more dimensions get one chunk per 2D slice, such as one
+   * per height level, and chunks are split down until they are around
+   * CHUNK_BYTES in size. */
+  static std::vector<size_t>
+  getChunkSizes(int ncid, nc_type xtype, int ndims, const int dimids[]);
+
+  /** Apply our settings to a newly defined variable.
+   * Failing to apply settings isn't an error, the variable is still
+   * written just not as compressed. */
+  void
+  apply(int ncid, int varid, nc_type xtype, int ndims, const int dimids[]) const;
+
+  /** Deflate level 0 to 9 */
+  int deflateLevel;
+
+  /** Shuffle filter before deflate */
+  bool shuffle;
+
+  /** Chunk by dimensions */
+  bool chunking;
+
+  /** Significant digits for float quantize, 0 for off */
+  int quantize;
+
+  /** Target size of a chunk in bytes */
+  static constexpr size_t CHUNK_BYTES = 4 * 1024 * 1024;
+};
+
 /**
  * The base class of all Netcdf formatters.
  *
@@ -91,6 +146,13 @@ public:
     std::map<std::string, std::string>     & params
   ) override;
 
+  /** Encode this data type to a netcdf file in memory.  The buffer can
+   * be written by async writers or sent without touching disk. */
+  virtual size_t
+  encodeDataTypeBuffer(std::shared_ptr<DataType> dt, std::vector<char>& buffer,
+    std::map<std::string, std::string>     & params
+  ) override;
+
   // --------------------------------------------------------
   // ADD utilities
   //
@@ -103,7 +165,8 @@ public:
     nc_type      xtype,
     int          ndims,
     const int    dimids[],
-    int *        varid);
+    int *        varid,
+    const NetcdfWriteSettings& settings = NetcdfWriteSettings());
 
   /** Add a single variable with given units */
   static int
@@ -272,7 +335,8 @@ public:
   static
   std::vector<int>
   declareGridVars(DataGrid& grid, const std::string& typeName,
-    const std::vector<int>& ncdims, int ncid);
+    const std::vector<int>& ncdims, int ncid,
+    const NetcdfWriteSettings& settings = NetcdfWriteSettings());
 
   /** Convenience for gathering dimension information.
    * FIXME: Make object for dimension information? */
@@ -296,7 +360,11 @@ public:
                     ncDataIdentifier,
                     ncNumGlobals };
 
-  static int GZ_LEVEL;
+protected:
+
+  /** Write a datatype to an open ncid with the matching specializer */
+  bool
+  writeNetcdf(std::shared_ptr<DataType> dt, std::map<std::string, std::string>& keys, int ncid);
 };
 }
 
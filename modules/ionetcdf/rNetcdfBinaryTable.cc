@@ -72,6 +72,7 @@ NetcdfBinaryTable::write(std::shared_ptr<DataType> dt,
     const int ncid          = std::stoi(keys["NETCDF_NCID"]);
     const float missing     = IONetcdf::MISSING_DATA; // Could be keys
     const float rangeFolded = IONetcdf::RANGE_FOLDED;
+    const NetcdfWriteSettings settings = NetcdfWriteSettings::fromKeys(keys);
 
     // Generically write a binary table's stuff to netcdf.  This uses an API
     // within the binary table to avoid coupling and to allow dynamic expansion
@@ -122,23 +123,11 @@ NetcdfBinaryTable::write(std::shared_ptr<DataType> dt,
             fLogSevere("Netcdf encoder, binary table unknown data type '{}'", type);
           }
 
-          // Create and push back the new nc var
-          // int shuffle = NC_SHUFFLE; needs chunk size array in var_chunking..
-          const int shuffle       = NC_CONTIGUOUS;
-          const int deflate       = 1;
-          const int deflate_level = IONetcdf::GZ_LEVEL;
-
           // New var.  Use '1' here because we create a vector variable
           NETCDF(nc_def_var(ncid, name.c_str(), aNcType, 1, &dims[i], &varid));
 
-          // Compression for variable
-          NETCDF(nc_def_var_chunking(ncid, varid, 0, 0));
-
-          // shuffle == control the HDF5 shuffle filter
-          // default == turn on deflate for variable
-          // deflate_level 0 no compression and 9 (max compression)
-          NETCDF(nc_def_var_deflate(ncid, varid, shuffle, deflate,
-            deflate_level));
+          // Chunking and compression for variable
+          settings.apply(ncid, varid, aNcType, 1, &dims[i]);
 
           vars.push_back(varid);
         }
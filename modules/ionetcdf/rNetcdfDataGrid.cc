@@ -192,7 +192,8 @@ NetcdfDataGrid::write(std::shared_ptr<DataType> dt,
     // VARIABLES
     //
     auto typeName = dataGrid->getTypeName(); // FIXME: can't routine get it?
-    std::vector<int> datavars = IONetcdf::declareGridVars(*dataGrid, typeName, dimvars, ncid);
+    std::vector<int> datavars = IONetcdf::declareGridVars(*dataGrid, typeName, dimvars, ncid,
+      NetcdfWriteSettings::fromKeys(keys));
 
     // ------------------------------------------------------------
     // GLOBAL ATTRIBUTES
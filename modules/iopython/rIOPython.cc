@@ -1,4 +1,5 @@
 #include "rIOPython.h"
+#include "rPythonWorker.h"
 
 #include "rFactory.h"
 #include "rIOURL.h"
@@ -239,17 +240,13 @@ IOPython::encodeDataType(std::shared_ptr<DataType> dt,
   // Try a first time hunt for python
   // This code could also be in OS maybe.  Given a list of relative
   // or absolute paths, find a working exe
-  static bool huntedPython  = false;
-  static std::string python = "/usr/bin/pythonfail";
-
-  if (!huntedPython) {
-    huntedPython = true;
-    std::vector<std::string> pythonnames = { "python", "python2", "python3" };
-    const auto search = OS::findValidExe(pythonnames);
-    if (!search.empty()) {
-      python = search;
-    }
-  }
+  // Static init so writer threads hunt only once
+  static const std::string huntedPython = [](){
+      std::vector<std::string> pythonnames = { "python", "python2", "python3" };
+      const auto search = OS::findValidExe(pythonnames);
+      return search.empty() ? std::string("/usr/bin/pythonfail") : search;
+    }();
+  std::string python = huntedPython;
 
   auto p = keys["bin"]; // force override the python with setting.  Check for it?
 
@@ -264,7 +261,23 @@ IOPython::encodeDataType(std::shared_ptr<DataType> dt,
   if (dataGrid != nullptr) {
     std::string pythonCommand = python + " " + pythonScript;
     fLogInfo("RUN PYTHON: {} BASEURL: {}", pythonCommand, filename);
-    auto output = runDataProcess(pythonCommand, filename, dataGrid);
+    std::vector<std::string> output;
+
+    // Use a running worker unless turned off.  Only fall back to starting
+    // python for this product if the script didn't run, a worker dying
+    // part way fails the product so we never run the script twice.
+    bool fallback = true;
+    if (keys["worker"] != "false") {
+      const int workers = std::max(1, atoi(keys["workers"].c_str()));
+      auto pool         = PythonWorkerPool::getPool(python, pythonScript, workers);
+      fallback = (pool->run(filename, dataGrid, output) == PythonWorker::Result::UNAVAILABLE);
+    }
+    if (fallback) {
+      // The one shot path reuses shared memory names, so one at a time
+      static std::mutex processLock;
+      std::lock_guard<std::mutex> lock(processLock);
+      output = runDataProcess(pythonCommand, filename, dataGrid);
+    }
 
     // Hunt python output for RAPIO tags
     bool haveFileBack    = false;
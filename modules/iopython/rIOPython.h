@@ -49,6 +49,10 @@ public:
     std::map<std::string, std::string>     & keys
   ) override;
 
+  /** Python runs in its own processes, so writers can run side by side */
+  virtual bool
+  isThreadSafe() override { return true; }
+
   virtual
   ~IOPython();
 };
@@ -0,0 +1,320 @@
+#include "rPythonWorker.h"
+
+#include "rIODataType.h"
+#include "rError.h"
+#include "rStrings.h"
+#include "rOS.h"
+
+#include <csignal>
+#include <cstring>
+#include <chrono>
+#include <map>
+
+using namespace rapio;
+using namespace boost::interprocess;
+namespace bp = boost::process;
+
+namespace {
+/** Bytes used by an array of a DataGrid */
+size_t
+getArrayBytes(const std::vector<DataGridDimension>& dims, std::shared_ptr<DataArray> a)
+{
+  size_t total = 1;
+
+  for (auto& i:a->getDimIndexes()) {
+    total *= dims[i].size();
+  }
+  const auto type = a->getStorageType();
+
+  if (type == FLOAT) {
+    return total * sizeof(float);
+  } else if (type == INT) {
+    return total * sizeof(int);
+  }
+  return 0;
+}
+}
+
+PythonSegment::~PythonSegment()
+{
+  myRegion.reset();
+  if (myMemory) {
+    myMemory.reset();
+    shared_memory_object::remove(myName.c_str());
+  }
+}
+
+char *
+PythonSegment::reserve(size_t bytes)
+{
+  if (bytes <= mySize) {
+    return data();
+  }
+
+  // Grow with some room so a slowly growing workload doesn't remap each time
+  const size_t newSize = std::max(bytes, mySize + mySize / 2);
+
+  try {
+    myRegion.reset();
+    if (!myMemory) {
+      myMemory = std::make_unique<shared_memory_object>(open_or_create, myName.c_str(), read_write);
+    }
+    myMemory->truncate(newSize);
+    myRegion = std::make_unique<mapped_region>(*myMemory, read_write);
+    mySize   = newSize;
+  }catch (const std::exception& e) {
+    fLogSevere("Couldn't map {} bytes of shared memory {}: {}", newSize, myName, e.what());
+    myRegion.reset();
+    mySize = 0;
+    return nullptr;
+  }
+  return data();
+}
+
+PythonWorker::PythonWorker(const std::string& python, const std::string& script,
+  const std::string& prefix) : myPython(python), myScript(script), myPrefix(prefix),
+  myStarts(0), myJSON(prefix + "-JSON")
+{ }
+
+PythonWorker::~PythonWorker()
+{
+  stop();
+}
+
+bool
+PythonWorker::readUntil(const std::string& prefix, std::string& marker,
+  std::vector<std::string>& output)
+{
+  std::string line;
+
+  while (std::getline(*myOut, line)) {
+    if (Strings::beginsWith(line, prefix)) {
+      marker = line;
+      return true;
+    }
+    output.push_back(line);
+  }
+  return false;
+}
+
+bool
+PythonWorker::start()
+{
+  if (myChild && myChild->running()) {
+    return true;
+  }
+  if (myChild) {
+    fLogSevere("Python worker for {} died, restarting it.", myScript);
+    stop();
+  }
+
+  // Don't hammer a worker that can't start, say an old RAPIOPY
+  const Time now = Time::ClockTime();
+
+  if (now < myNextStart) {
+    return false;
+  }
+  myNextStart = now + TimeDuration::Seconds(30);
+
+  // A dead worker closes its stdin, so get an error instead of being killed
+  static std::once_flag ignorePipe;
+
+  std::call_once(ignorePipe, [](){
+    std::signal(SIGPIPE, SIG_IGN);
+  });
+
+  const std::string exe = OS::validateExe(myPython);
+
+  if (exe.empty()) {
+    fLogSevere("Python '{}' not found or not executable.", myPython);
+    return false;
+  }
+
+  std::vector<std::string> lines;
+  std::string marker;
+
+  try {
+    myIn    = std::make_unique<bp::opstream>();
+    myOut   = std::make_unique<bp::ipstream>();
+    myChild = std::make_unique<bp::child>(exe,
+        bp::args({ "-u", "-m", "RAPIOPY.worker", myScript }),
+        bp::std_in < *myIn, bp::std_out > *myOut);
+  }catch (const std::exception& e) {
+    fLogSevere("Couldn't start python worker for {}: {}", myScript, e.what());
+    stop();
+    return false;
+  }
+
+  if (!readUntil("RAPIO_WORKER_READY", marker, lines)) {
+    fLogSevere("Python worker for {} didn't start, is RAPIOPY up to date?", myScript);
+    for (auto& l:lines) {
+      fLogSevere("PYTHON: {}", l);
+    }
+    stop();
+    return false;
+  }
+  myNextStart = Time();
+  myStarts++;
+  fLogInfo("Started python worker {} for {} (start {})", myPrefix, myScript, myStarts);
+  return true;
+} // PythonWorker::start
+
+void
+PythonWorker::stop()
+{
+  if (myIn) {
+    // Closing stdin tells the worker to exit
+    myIn->pipe().close();
+  }
+  if (myChild) {
+    std::error_code ec;
+    if (myChild->running(ec) && !myChild->wait_for(std::chrono::seconds(2), ec)) {
+      myChild->terminate(ec);
+    }
+    myChild->wait(ec);
+  }
+  myChild.reset();
+  myIn.reset();
+  myOut.reset();
+}
+
+PythonWorker::Result
+PythonWorker::run(const std::string& filename, std::shared_ptr<DataGrid> datagrid,
+  std::vector<std::string>& output)
+{
+  if (!start()) {
+    return Result::UNAVAILABLE;
+  }
+
+  // ----------------------------------------------------
+  // JSON metadata, pointing python at our array segments
+  std::shared_ptr<PTreeData> theJson = datagrid->createMetadata(myPrefix);
+  PTreeNode fileinfo;
+
+  fileinfo.put("filebase", filename);
+  theJson->getTree()->addNode("RAPIOOutput", fileinfo);
+
+  std::vector<char> buf;
+  std::map<std::string, std::string> keys;
+  size_t aLength = IODataType::writeBuffer(theJson, buf, keys, "json");
+
+  if (aLength < 2) { // Buffer always ends with 0
+    fLogSevere("DataGrid didn't generate JSON so aborting python call.");
+    return Result::UNAVAILABLE;
+  }
+  aLength -= 1;
+  char * at = myJSON.reserve(aLength);
+
+  if (at == nullptr) {
+    return Result::UNAVAILABLE;
+  }
+  std::memcpy(at, &buf[0], aLength);
+
+  // ----------------------------------------------------
+  // Arrays into the mapped segments.  This is our only copy, the
+  // segments stay mapped between calls.
+  auto theDims = datagrid->getDims();
+  auto list    = datagrid->getArrays();
+  std::vector<size_t> sizes;
+
+  for (size_t i = 0; i < list.size(); ++i) {
+    if (i >= myArrays.size()) {
+      myArrays.push_back(std::make_unique<PythonSegment>(
+          myPrefix + "-array" + std::to_string(i + 1)));
+    }
+    const size_t bytes = getArrayBytes(theDims, list[i]);
+    char * a = myArrays[i]->reserve(std::max(bytes, size_t(1)));
+    if (a == nullptr) {
+      return Result::UNAVAILABLE;
+    }
+    std::memcpy(a, list[i]->getRawDataPointer(), bytes);
+    sizes.push_back(bytes);
+  }
+
+  // ----------------------------------------------------
+  // Ask the worker to run.  If it died while idle it never got the job,
+  // so restart it and ask again once.
+  *myIn << "RUN " << myJSON.getName() << " " << aLength << std::endl;
+  if (!myIn->good()) {
+    stop();
+    if (!start()) {
+      return Result::UNAVAILABLE;
+    }
+    *myIn << "RUN " << myJSON.getName() << " " << aLength << std::endl;
+    if (!myIn->good()) {
+      fLogSevere("Python worker for {} won't take {}", myScript, filename);
+      stop();
+      return Result::UNAVAILABLE;
+    }
+  }
+
+  // Once it has the job the script may have done things, so a death now
+  // fails this product rather than running the script again.
+  std::string marker;
+
+  if (!readUntil("RAPIO_WORKER_DONE", marker, output)) {
+    fLogSevere("Python worker for {} died running {}", myScript, filename);
+    stop();
+    return Result::DIED;
+  }
+  if (marker != "RAPIO_WORKER_DONE 0") {
+    fLogSevere("Python script {} failed on {}", myScript, filename);
+  }
+
+  // Copy back anything the script changed in place
+  for (size_t i = 0; i < list.size(); ++i) {
+    std::memcpy(list[i]->getRawDataPointer(), myArrays[i]->data(), sizes[i]);
+  }
+  return Result::RAN;
+} // PythonWorker::run
+
+PythonWorkerPool::PythonWorkerPool(const std::string& python, const std::string& script,
+  size_t size)
+{
+  const std::string pid = std::to_string(OS::getProcessID());
+  static size_t counter = 0;
+
+  for (size_t i = 0; i < std::max(size, size_t(1)); ++i) {
+    const std::string prefix = pid + "-w" + std::to_string(++counter);
+    myWorkers.push_back(std::make_shared<PythonWorker>(python, script, prefix));
+    myIdle.push_back(myWorkers.back().get());
+  }
+}
+
+std::shared_ptr<PythonWorkerPool>
+PythonWorkerPool::getPool(const std::string& python, const std::string& script, size_t size)
+{
+  static std::mutex poolLock;
+  static std::map<std::string, std::shared_ptr<PythonWorkerPool> > pools;
+
+  std::lock_guard<std::mutex> lock(poolLock);
+  auto& pool = pools[python + " " + script];
+
+  if (pool == nullptr) {
+    pool = std::make_shared<PythonWorkerPool>(python, script, size);
+  }
+  return pool;
+}
+
+PythonWorker::Result
+PythonWorkerPool::run(const std::string& filename, std::shared_ptr<DataGrid> datagrid,
+  std::vector<std::string>& output)
+{
+  PythonWorker * w = nullptr;
+  {
+    std::unique_lock<std::mutex> lock(myLock);
+    myReturned.wait(lock, [this]{
+      return !myIdle.empty();
+    });
+    w = myIdle.back();
+    myIdle.pop_back();
+  }
+
+  const auto result = w->run(filename, datagrid, output);
+  {
+    std::lock_guard<std::mutex> lock(myLock);
+    myIdle.push_back(w);
+  }
+  myReturned.notify_one();
+  return result;
+}
@@ -0,0 +1,188 @@
+#pragma once
+
+#include "rDataGrid.h"
+#include "rTime.h"
+
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/process.hpp>
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace rapio {
+/** A shared memory segment kept mapped between python calls.  It only
+ * grows, so after the first few products we stop creating, truncating
+ * and mapping memory.
+ *
+ * @author Robert Toomey
+ */
+class PythonSegment {
+public:
+
+  /** Create a segment with a shared memory name */
+  PythonSegment(const std::string& name) : myName(name), mySize(0){ }
+
+  /** Remove the shared memory */
+  ~PythonSegment();
+
+  /** Make sure we have at least bytes mapped, growing if needed.
+   * @return start of the mapping, or nullptr on failure */
+  char *
+  reserve(size_t bytes);
+
+  /** Start of the mapping */
+  char *
+  data(){ return myRegion ? static_cast<char *>(myRegion->get_address()) : nullptr; }
+
+  /** Shared memory name */
+  const std::string&
+  getName() const { return myName; }
+
+protected:
+
+  /** Shared memory name */
+  std::string myName;
+
+  /** Current mapped size */
+  size_t mySize;
+
+  /** The shared memory */
+  std::unique_ptr<boost::interprocess::shared_memory_object> myMemory;
+
+  /** Mapping of the shared memory */
+  std::unique_ptr<boost::interprocess::mapped_region> myRegion;
+};
+
+/** A long running python process that runs a script over and over.
+ *
+ * The worker runs 'python -u -m RAPIOPY.worker script', which compiles
+ * the script once and keeps the interpreter, numpy and anything the
+ * script imported loaded.  We talk over its stdin/stdout pipes:
+ *
+ * - Worker prints 'RAPIO_WORKER_READY' once started.
+ * - We send 'RUN jsonSegment jsonLength' per product.
+ * - Worker prints the output lines of the script, then
+ *   'RAPIO_WORKER_DONE status'.
+ *
+ * If the pipe closes on us the process is reaped and a new one
+ * started on the next call.  A worker that can't start waits a bit
+ * before trying again.
+ *
+ * @author Robert Toomey
+ */
+class PythonWorker {
+public:
+
+  /** How a run went */
+  enum class Result {
+    /** The script ran, check its output for success */
+    RAN,
+
+    /** The worker couldn't start or take the job, nothing ran */
+    UNAVAILABLE,
+
+    /** The worker died while running the script */
+    DIED
+  };
+
+  /** Create a worker for a script, using prefix for shared memory names */
+  PythonWorker(const std::string& python, const std::string& script,
+    const std::string& prefix);
+
+  /** Stop the python process */
+  ~PythonWorker();
+
+  /** Run the script on a DataGrid, filling in the output lines.
+   * Only UNAVAILABLE means the script didn't run. */
+  Result
+  run(const std::string& filename, std::shared_ptr<DataGrid> datagrid,
+    std::vector<std::string>& output);
+
+protected:
+
+  /** Start the python process if not running */
+  bool
+  start();
+
+  /** Close pipes and reap the python process */
+  void
+  stop();
+
+  /** Read lines until a marker line, which is returned in marker.
+   * @return false if the pipe closed first */
+  bool
+  readUntil(const std::string& prefix, std::string& marker,
+    std::vector<std::string>& output);
+
+  /** Python executable */
+  std::string myPython;
+
+  /** Script the worker runs */
+  std::string myScript;
+
+  /** Prefix of our shared memory names */
+  std::string myPrefix;
+
+  /** Number of times we've started the process */
+  size_t myStarts;
+
+  /** After a failed start, don't try again until this time */
+  Time myNextStart;
+
+  /** The python process */
+  std::unique_ptr<boost::process::child> myChild;
+
+  /** Pipe to the stdin of the process */
+  std::unique_ptr<boost::process::opstream> myIn;
+
+  /** Pipe from the stdout of the process */
+  std::unique_ptr<boost::process::ipstream> myOut;
+
+  /** JSON segment */
+  PythonSegment myJSON;
+
+  /** Array segments, in DataGrid array order */
+  std::vector<std::unique_ptr<PythonSegment> > myArrays;
+};
+
+/** A pool of python workers running the same script.  Writer threads
+ * check out an idle worker, so products run side by side up to the
+ * size of the pool.
+ *
+ * @author Robert Toomey
+ */
+class PythonWorkerPool {
+public:
+
+  /** Create a pool of size workers */
+  PythonWorkerPool(const std::string& python, const std::string& script,
+    size_t size);
+
+  /** Get the pool for a python and script, created on first use */
+  static std::shared_ptr<PythonWorkerPool>
+  getPool(const std::string& python, const std::string& script, size_t size);
+
+  /** Run the script on an idle worker, waiting for one if needed */
+  PythonWorker::Result
+  run(const std::string& filename, std::shared_ptr<DataGrid> datagrid,
+    std::vector<std::string>& output);
+
+protected:
+
+  /** Lock for the idle list */
+  std::mutex myLock;
+
+  /** Signaled when a worker is returned */
+  std::condition_variable myReturned;
+
+  /** All workers */
+  std::vector<std::shared_ptr<PythonWorker> > myWorkers;
+
+  /** Idle workers */
+  std::vector<PythonWorker *> myIdle;
+};
+}
@@ -51,7 +51,17 @@ Array2DCallback::handleSetDataArray(float * data, int nlats, int nlons, unsigned
 void
 Array3DCallback::handleSetDataArray(float * data, int nlats, int nlons, unsigned int * index)
 {
-  if (myLayerNumber == 0) {
+  // In a single pass, fields come in file order, so find our layer
+  if (!myLayerLookup.empty()) {
+    auto l = myLayerLookup.find(std::to_string(myMessageNumber) + "." + std::to_string(myFieldNumber));
+    if (l == myLayerLookup.end()) {
+      std::cerr << "\nError: (Unexpected field " << myMessageNumber << "." << myFieldNumber << ")\n";
+      return;
+    }
+    myLayerNumber = l->second;
+  }
+
+  if (myTemp3DArray == nullptr) {
     // Found first match.  Create the array.
     myTemp3DArray = Arrays::CreateFloat3D(nlats, nlons, myLayers.size());
     myNLats       = nlats;
@@ -93,8 +103,30 @@ Array3DCallback::executeLayer(size_t layer)
   myDKey  = myLayers[layer];
 
   myLayerNumber = layer;
+  if (layer == 0) { myTemp3DArray = nullptr; }
 
   execute(false);
   myDKey  = "";
   myMatch = holdMatch;
 }
+
+void
+Array3DCallback::executeLayers(const std::string& match)
+{
+  myLayerLookup.clear();
+  for (size_t i = 0; i < myLayers.size(); ++i) {
+    // A key without a field part is field 1
+    const auto& k = myLayers[i];
+    myLayerLookup[(k.find('.') == std::string::npos) ? k + ".1" : k] = i;
+  }
+
+  std::string holdMatch = myMatch; // Original key
+
+  myMatch       = match;
+  myDKey        = "";
+  myTemp3DArray = nullptr;
+
+  execute(false);
+  myMatch = holdMatch;
+  myLayerLookup.clear();
+}
@@ -7,6 +7,7 @@
 #include "rLatLonGrid.h" // temp
 
 #include <iostream>
+#include <map>
 
 namespace rapio {
 /**
@@ -75,10 +76,16 @@ public:
   /** Called with raw data, unprojected */
   virtual void
   handleSetDataArray(float * data, int nlats, int nlons, unsigned int * index) override;
+
   /** Execute us for a given layer */
   virtual void
   executeLayer(size_t layer);
 
+  /** Execute us once for all layers, matching them in a single wgrib2 pass.
+   * The match should select exactly the "message.field" keys of our layers */
+  virtual void
+  executeLayers(const std::string& match);
+
   /** Pull the current 3D array, taking ownership */
   static std::shared_ptr<Array<float, 3> >
   pull3DArray()
@@ -97,6 +104,9 @@ protected:
   /** Current layer number during execute */
   size_t myLayerNumber;
 
+  /** Layer number for each "message.field" key during executeLayers */
+  std::map<std::string, size_t> myLayerLookup;
+
   /** Temp storage of returned 3D Array */
   static std::shared_ptr<Array<float, 3> > myTemp3DArray;
 
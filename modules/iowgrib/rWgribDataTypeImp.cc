@@ -12,6 +12,7 @@
 
 // Cache includes
 #include "rStrings.h"
+#include "rOS.h"
 
 using namespace rapio;
 
@@ -86,19 +87,44 @@ GribCatalogCache::processLine(const std::string& line, GribCatalogCache::Field&
   return true;
 } // GribCatalogCache::processLine
 
-void
-GribCatalogCache::readCatalog()
+bool
+GribCatalogCache::readIDXLines(std::vector<std::string>& lines)
 {
-  // Already loaded, skip out
-  if (myLoaded) { return; }
+  // Only for local files with a sidecar .idx, which is the same
+  // format as the wgrib2 inventory
+  if (!myURL.isLocal()) { return false; }
+  const std::string path = myURL.getPath();
+  const std::string idx  = path + ".idx";
 
-  std::shared_ptr<CatalogCallback> action = std::make_shared<CatalogCallback>(myURL, "", "");
-  auto v = action->execute(false);
-  auto c = action->getMatchCount();
+  if (!OS::isRegularFile(idx)) { return false; }
+
+  // An idx older than the grib2 file is stale, use wgrib2 instead
+  Time gribTime, idxTime;
 
+  if (!OS::getFileModificationTime(path, gribTime) ||
+    !OS::getFileModificationTime(idx, idxTime) || (idxTime < gribTime))
+  {
+    fLogInfo("Ignoring stale or unreadable index {}", idx);
+    return false;
+  }
+
+  std::ifstream in(idx);
+  std::string line;
+
+  while (std::getline(in, line)) {
+    if (!line.empty()) {
+      lines.push_back(line);
+    }
+  }
+  fLogInfo("Read {} catalog lines from {}", lines.size(), idx);
+  return !lines.empty();
+} // GribCatalogCache::readIDXLines
+
+bool
+GribCatalogCache::parseCatalog(const std::vector<std::string>& v)
+{
   bool success = true;
   Field buffer;
-  size_t count = 0;
   size_t offset;
 
   int atMessage = 1; // Parser found message
@@ -123,12 +149,44 @@ GribCatalogCache::readCatalog()
       myMessages[myMessages.size() - 1].addField(buffer);
     } else {
       fLogSevere("Mismatched message number {}, expected {}", atMessage, myMessages.size());
-      break; // what to do?
+      return false; // what to do?
+    }
+  }
+  return success;
+} // GribCatalogCache::parseCatalog
+
+void
+GribCatalogCache::readCatalog()
+{
+  // Already loaded, skip out
+  if (myLoaded) { return; }
+
+  // Use the .idx if we have one, it saves a wgrib2 pass over
+  // every message in the file
+  std::vector<std::string> v;
+
+  if (readIDXLines(v)) {
+    if (parseCatalog(v)) {
+      myLoaded = true;
+      return;
     }
-    count++;
+    fLogSevere("Couldn't parse {}.idx, using the wgrib2 catalog", myURL.getPath());
+    myMessages.clear();
   }
 
+  std::shared_ptr<CatalogCallback> action = std::make_shared<CatalogCallback>(myURL, "", "");
+
+  v = action->execute(false);
+  auto c = action->getMatchCount();
+
+  bool success = parseCatalog(v);
+
   // Our parser should match the wgrib2 count
+  size_t count = 0;
+
+  for (auto& m:myMessages) {
+    count += m.myFields.size();
+  }
   if (c != count) {
     fLogSevere("Mismatch wgrib2 count vs c {}, {}", count, c);
     success = false;
@@ -185,6 +243,24 @@ GribCatalogCache::match(const std::string& product,
   return count;
 } // GribCatalogCache::match
 
+std::string
+GribCatalogCache::getLayerMatch(const std::vector<std::string>& keys)
+{
+  // Inventory lines start "12:" for single fields or "12.5:" for multiple
+  std::string match = "^(";
+
+  for (size_t i = 0; i < keys.size(); ++i) {
+    std::vector<std::string> mf;
+    Strings::split(keys[i], '.', &mf);
+    const std::string field = (mf.size() > 1) ? mf[1] : "1";
+    const size_t message    = std::stoull(mf[0]);
+    match += (i > 0) ? "|" : "";
+    match += (getFieldCount(message) > 1) ? mf[0] + "\\." + field : mf[0];
+  }
+  match += "):";
+  return match;
+}
+
 std::vector<std::string>
 GribCatalogCache::match3D(const std::string& product,
   const std::vector<std::string>           & zLevels)
@@ -325,9 +401,9 @@ WgribDataTypeImp::getFloat3D(const std::string& key, std::vector<std::string> zL
   std::shared_ptr<Array3DCallback> action =
     std::make_shared<Array3DCallback>(myURL, key, keys);
 
-  for (size_t i = 0; i < zLevels.size(); ++i) {
-    action->executeLayer(i);
-  }
+  // wgrib2 isn't thread safe, so rather than a -d call per layer, which
+  // rereads the file up to each message, match all the layers in one pass.
+  action->executeLayers(myCatalog.getLayerMatch(keys));
 
   return Array3DCallback::pull3DArray();
 } // WgribDataTypeImp::getFloat3D
@@ -104,6 +104,19 @@ public:
     return (myMessages[messageNumber - 1].myFields.size());
   }
 
+  /** Regex matching all "message.field" keys in one wgrib2 pass, such
+   * as "^(12|14\\.2):".  A key without a field part is field 1. */
+  std::string
+  getLayerMatch(const std::vector<std::string>& keys);
+
+  /** Read the lines of a local sidecar .idx file, if there is a current one */
+  bool
+  readIDXLines(std::vector<std::string>& lines);
+
+  /** Parse catalog lines into messages, return false on any bad line */
+  bool
+  parseCatalog(const std::vector<std::string>& lines);
+
   /** Release catalog information */
   void
   releaseCatalog()
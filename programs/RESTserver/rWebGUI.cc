@@ -19,6 +19,9 @@
 #include <sys/stat.h>
 
 #include <fstream>
+#include <functional>
+#include <future>
+#include <list>
 
 using namespace rapio;
 
@@ -54,6 +57,9 @@ RAPIOWebGUI::declareOptions(RAPIOOptions& o)
   myRoot = OS::getProcessPath() + "/web";
 
   o.optional("root", myRoot, "Web root.  Defaults to binary location+'web'.");
+
+  o.optional("tilecache", "256", "Megabytes of RAM for cached tiles.");
+  o.optional("tilecacheproduct", "64", "Megabytes of RAM for cached tiles of any one product.");
 }
 
 /** RAPIOAlgorithms process options on start up */
@@ -86,6 +92,12 @@ RAPIOWebGUI::processOptions(RAPIOOptions& o)
     cache = "CACHE";
   }
   myOverride["tilecachefolder"] = cache;
+
+  const int total      = o.getInteger("tilecache");
+  const int perProduct = o.getInteger("tilecacheproduct");
+
+  myTileCacheMB        = (total > 0) ? total : 0;
+  myTileCacheProductMB = (perProduct > 0) ? perProduct : 0;
 }
 
 void
@@ -177,22 +189,129 @@ getCachedVectorLayer(std::shared_ptr<DataType> targetData, const std::string& re
   return std::dynamic_pointer_cast<VectorDataType>(targetData);
 }
 
-// A tiny struct to hold our binary image and its MIME type
+// A tiny struct to hold our binary image and its MIME type.  The bytes are
+// shared and never changed once made, so a cache hit doesn't copy them.
 struct TilePayload {
-  std::vector<char> data;
-  std::string       mimeType;
+  std::shared_ptr<const std::string> data;
+  std::string                        mimeType;
+  size_t                             status = 200; // 204 for an empty tile
+
+  /** Rough memory used by this payload */
+  size_t
+  bytes() const
+  {
+    return (data ? data->size() : 0) + mimeType.size() + 128;
+  }
 };
 
-// Thread-Safe L1 RAM Cache
+// Thread-Safe L1 RAM Cache.  Limited by total bytes and bytes per product,
+// so one busy product can't push every other product out.  Requests for a
+// tile already being made wait for it instead of making it again.
 class TileLRUCache {
 private:
-  size_t capacity;
+  /** A cached tile */
+  struct Entry {
+    TilePayload                      payload;
+    std::string                      product;
+    std::list<std::string>::iterator lru;        // Position in lruList
+    std::list<std::string>::iterator productLRU; // Position in productLRU[product]
+  };
+
+  size_t maxBytes;
+  size_t maxProductBytes;
+  size_t totalBytes;
   std::mutex cacheMutex;
   std::list<std::string> lruList; // Tracks the least recently used keys
-  std::unordered_map<std::string, std::pair<TilePayload, std::list<std::string>::iterator> > cacheMap;
+  std::unordered_map<std::string, std::list<std::string> > productLRU;
+  std::unordered_map<std::string, size_t> productBytes;
+  std::unordered_map<std::string, Entry> cacheMap;
+  std::unordered_map<std::string, std::shared_future<TilePayload> > inFlight;
+
+  /** Move key to the front of both LRU lists */
+  void
+  touch(Entry& e)
+  {
+    lruList.splice(lruList.begin(), lruList, e.lru);
+    auto& plist = productLRU[e.product];
+
+    plist.splice(plist.begin(), plist, e.productLRU);
+  }
+
+  /** Remove a key, cacheMutex held */
+  void
+  erase(const std::string& key)
+  {
+    auto it = cacheMap.find(key);
+
+    if (it == cacheMap.end()) { return; }
+    Entry& e = it->second;
+    const size_t b = e.payload.bytes();
+
+    totalBytes -= b;
+    productBytes[e.product] -= b;
+    lruList.erase(e.lru);
+    auto& plist = productLRU[e.product];
+
+    plist.erase(e.productLRU);
+    if (plist.empty()) {
+      productLRU.erase(e.product);
+      productBytes.erase(e.product);
+    }
+    cacheMap.erase(it);
+  }
+
+  /** Add or replace a key, cacheMutex held */
+  void
+  putLocked(const std::string& key, const std::string& product, const TilePayload& payload)
+  {
+    const size_t b = payload.bytes();
+
+    erase(key);
+
+    // Too big to ever fit, just don't cache it
+    if ((b > maxBytes) || (b > maxProductBytes)) { return; }
+
+    // Evict the product's oldest tiles first, then the oldest overall
+    auto& plist = productLRU[product];
+
+    while (!plist.empty() && (productBytes[product] + b > maxProductBytes)) {
+      erase(std::string(plist.back())); // erase invalidates the reference
+    }
+    while (!lruList.empty() && (totalBytes + b > maxBytes)) {
+      erase(std::string(lruList.back()));
+    }
+
+    lruList.push_front(key);
+    auto& plist2 = productLRU[product]; // erase may have dropped the list
+
+    plist2.push_front(key);
+    cacheMap[key]          = { payload, product, lruList.begin(), plist2.begin() };
+    totalBytes            += b;
+    productBytes[product] += b;
+  }
 
 public:
-  TileLRUCache(size_t cap) : capacity(cap){ }
+  TileLRUCache(size_t bytes, size_t bytesPerProduct)
+    : maxBytes(bytes), maxProductBytes(bytesPerProduct), totalBytes(0){ }
+
+  /** Change the byte budgets.  Takes effect as tiles are added */
+  void
+  setBudgets(size_t bytes, size_t bytesPerProduct)
+  {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+
+    maxBytes        = bytes;
+    maxProductBytes = bytesPerProduct;
+  }
+
+  /** Current bytes held */
+  size_t
+  getBytes()
+  {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+
+    return totalBytes;
+  }
 
   bool
   get(const std::string& key, TilePayload& outPayload)
@@ -203,38 +322,79 @@ public:
     if (it == cacheMap.end()) { return false; }
 
     // Cache Hit: Move this key to the front of the list (Most Recently Used)
-    lruList.splice(lruList.begin(), lruList, it->second.second);
-    outPayload = it->second.first;
+    touch(it->second);
+    outPayload = it->second.payload;
     return true;
   }
 
   void
-  put(const std::string& key, const TilePayload& payload)
+  put(const std::string& key, const std::string& product, const TilePayload& payload)
   {
     std::lock_guard<std::mutex> lock(cacheMutex);
-    auto it = cacheMap.find(key);
 
-    if (it != cacheMap.end()) {
-      // Update existing entry and move to front
-      lruList.splice(lruList.begin(), lruList, it->second.second);
-      it->second.first = payload;
-      return;
+    putLocked(key, product, payload);
+  }
+
+  /** Get a tile, or make it with create.  Only one caller makes a key at a
+   * time, others asking meanwhile wait and share its result. */
+  TilePayload
+  getOrCreate(const std::string& key, const std::string& product,
+    const std::function<TilePayload()>& create)
+  {
+    std::promise<TilePayload> promise;
+    std::shared_future<TilePayload> waitOn;
+
+    {
+      std::lock_guard<std::mutex> lock(cacheMutex);
+      auto it = cacheMap.find(key);
+
+      if (it != cacheMap.end()) {
+        touch(it->second);
+        return it->second.payload;
+      }
+
+      auto f = inFlight.find(key);
+      if (f != inFlight.end()) {
+        waitOn = f->second;
+      } else {
+        inFlight[key] = promise.get_future().share();
+      }
     }
 
-    // Add new entry. If we hit the cap, evict the oldest tile!
-    if (cacheMap.size() >= capacity) {
-      std::string oldest = lruList.back();
-      lruList.pop_back();
-      cacheMap.erase(oldest);
+    // Someone else is making it
+    if (waitOn.valid()) {
+      return waitOn.get();
     }
 
-    lruList.push_front(key);
-    cacheMap[key] = { payload, lruList.begin() };
-  }
+    TilePayload payload;
+
+    try{
+      payload = create();
+    }catch (...) {
+      {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        inFlight.erase(key);
+      }
+      promise.set_exception(std::current_exception());
+      throw;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(cacheMutex);
+      inFlight.erase(key);
+
+      // Cache tiles and empty tiles, not errors
+      if ((payload.status == 200) || (payload.status == 204)) {
+        putLocked(key, product, payload);
+      }
+    }
+    promise.set_value(payload);
+    return payload;
+  } // getOrCreate
 };
 
-// Instantiate the global RAM cache (1000 tiles is roughly 20-50MB of RAM)
-TileLRUCache g_tileCache(1000);
+// Instantiate the global RAM cache, budgets set by -tilecache options
+TileLRUCache g_tileCache(256 * 1024 * 1024, 64 * 1024 * 1024);
 }
 
 // ---------------------------------------
@@ -580,31 +740,17 @@ RAPIOWebGUI::handleSVG(WebMessage& w, std::vector<std::string>& pieces, std::map
   }
 }
 
-void
-RAPIOWebGUI::serveTile(WebMessage& w, std::shared_ptr<DataType> targetData, std::string& pathout, std::map<std::string,
-  std::string>& settings)
+namespace {
+/** Read a tile from disk cache or make it.  Empty tiles are returned as
+ * status 204 with no data. */
+TilePayload
+createTile(std::shared_ptr<DataType> targetData, const std::string& pathout,
+  const std::string& mimeType, std::map<std::string, std::string>& settings)
 {
   TilePayload payload;
   std::string suffix = settings["suffix"];
 
-  // Resolve MIME type
-  std::string mimeType = "image/" + suffix;
-
-  if ((suffix == "jpg") || (suffix == "jpeg")) { mimeType = "image/jpeg"; } else if (suffix == "mrmstile") {
-    mimeType = "application/octet-stream";
-  } else if ((suffix == "pbf") || (suffix == "mvt") ) {
-    mimeType = "application/vnd.mapbox-vector-tile";
-  } else if ((suffix == "geojson") || (suffix == "json") ) { mimeType = "application/geo+json"; }
-  fLogInfo("----->MIME TYPE IS {}", mimeType);
-
-  // ==========================================
-  // TIER 1: Check RAM Cache (L1)
-  // ==========================================
-  if (g_tileCache.get(pathout, payload)) {
-    w.setMessage(std::string(payload.data.begin(), payload.data.end()), payload.mimeType);
-    w.setError(200);
-    return;
-  }
+  payload.mimeType = mimeType;
 
   // ==========================================
   // TIER 2: Check Disk Cache (L2)
@@ -612,19 +758,16 @@ RAPIOWebGUI::serveTile(WebMessage& w, std::shared_ptr<DataType> targetData, std:
   if (OS::isRegularFile(pathout)) {
     std::ifstream file(pathout, std::ios::binary);
     if (file) {
-      payload.data.assign((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-      payload.mimeType = mimeType;
-      g_tileCache.put(pathout, payload);
-      w.setMessage(std::string(payload.data.begin(), payload.data.end()), payload.mimeType);
-      w.setError(200);
-      return;
+      payload.data = std::make_shared<const std::string>(
+        (std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+      return payload;
     }
   }
 
   // ==========================================
   // TIER 3: Cache Miss (Generate the Tile)
   // ==========================================
-  std::vector<char> tileBuffer;
+  payload.status = 204; // No Content (empty tile) unless we make one
 
   // -- VECTOR TILE GENERATION --
   if ((suffix == "pbf") || (suffix == "mvt") || (suffix == "geojson") || (suffix == "json")) {
@@ -633,8 +776,7 @@ RAPIOWebGUI::serveTile(WebMessage& w, std::shared_ptr<DataType> targetData, std:
 
     // If we asked for vector data but have raster data, return gracefully
     if (!vectorData) {
-      w.setError(204);
-      return;
+      return payload;
     }
 
     double minLon = 0, minLat = 0, maxLon = 0, maxLat = 0;
@@ -665,10 +807,9 @@ RAPIOWebGUI::serveTile(WebMessage& w, std::shared_ptr<DataType> targetData, std:
       vectorData->getTileGeoJSON(minLon, minLat, maxLon, maxLat);
 
     if (vData.empty() || (vData == "{}") ) {
-      w.setError(204); // No Content (empty tile)
-      return;
+      return payload;
     }
-    tileBuffer.assign(vData.begin(), vData.end());
+    payload.data = std::make_shared<const std::string>(std::move(vData));
   }
   // -- RASTER TILE GENERATION --
   else {
@@ -676,39 +817,62 @@ RAPIOWebGUI::serveTile(WebMessage& w, std::shared_ptr<DataType> targetData, std:
 
     // If we asked for raster data but have vector data (or out of bounds), return gracefully
     if (!tileGrid) {
-      w.setError(204);
-      return;
+      return payload;
     }
 
+    std::vector<char> tileBuffer;
     settings["index"] = "true";
     size_t bytes = IODataType::writeBuffer(tileGrid, tileBuffer, settings, "image");
     if (bytes == 0) {
-      w.setError(204);
-      return;
+      return payload;
     }
+    payload.data = std::make_shared<const std::string>(tileBuffer.begin(), tileBuffer.end());
   }
+  payload.status = 200;
 
-  // ==========================================
-  // Finalize payload, serve to browser, and cache it
-  // ==========================================
-  payload.data     = std::move(tileBuffer);
-  payload.mimeType = mimeType;
-
-  w.setMessage(std::string(payload.data.begin(), payload.data.end()), payload.mimeType);
-  w.setError(200);
-
-  g_tileCache.put(pathout, payload);
-
+  // Keep it on disk for next time
   try {
     size_t lastSlash = pathout.find_last_of('/');
     if (lastSlash != std::string::npos) {
       OS::mkdirp(pathout.substr(0, lastSlash));
     }
     std::ofstream outFile(pathout, std::ios::binary);
-    if (outFile) { outFile.write(payload.data.data(), payload.data.size()); }
+    if (outFile) { outFile.write(payload.data->data(), payload.data->size()); }
   } catch (const std::exception& e) {
     fLogSevere("WebGUI: Failed to write disk cache for {}: {}", pathout, e.what());
   }
+  return payload;
+} // createTile
+}
+
+void
+RAPIOWebGUI::serveTile(WebMessage& w, std::shared_ptr<DataType> targetData, const std::string& product,
+  std::string& pathout, std::map<std::string, std::string>& settings)
+{
+  std::string suffix = settings["suffix"];
+
+  // Resolve MIME type
+  std::string mimeType = "image/" + suffix;
+
+  if ((suffix == "jpg") || (suffix == "jpeg")) { mimeType = "image/jpeg"; } else if (suffix == "mrmstile") {
+    mimeType = "application/octet-stream";
+  } else if ((suffix == "pbf") || (suffix == "mvt") ) {
+    mimeType = "application/vnd.mapbox-vector-tile";
+  } else if ((suffix == "geojson") || (suffix == "json") ) { mimeType = "application/geo+json"; }
+  fLogInfo("----->MIME TYPE IS {}", mimeType);
+
+  // ==========================================
+  // TIER 1: Check RAM Cache (L1), else disk or generate once
+  // ==========================================
+  TilePayload payload = g_tileCache.getOrCreate(pathout, product, [&]() {
+    return createTile(targetData, pathout, mimeType, settings);
+  });
+
+  if (payload.status == 200) {
+    // Shares the cached bytes, no copy
+    w.setMessage(payload.data, payload.mimeType);
+  }
+  w.setError(payload.status);
 } // RAPIOWebGUI::serveTile
 
 void
@@ -756,7 +920,7 @@ RAPIOWebGUI::handlePathWMS(WebMessage& w, std::vector<std::string>& pieces, std:
   if (w.getMap().count("layer")) { settings["layer"] = w.getMap().at("layer"); }
 
   // 3. Serve with target data
-  serveTile(w, targetData, pathout, settings);
+  serveTile(w, targetData, datasetId, pathout, settings);
 } // RAPIOWebGUI::handlePathWMS
 
 void
@@ -793,7 +957,7 @@ RAPIOWebGUI::handlePathMVT(WebMessage& w, std::vector<std::string>& pieces, std:
   if (w.getMap().count("layer")) { settings["layer"] = w.getMap().at("layer"); }
 
   // Pass the targetData into serveTile
-  serveTile(w, targetData, pathout, settings);
+  serveTile(w, targetData, datasetId, pathout, settings);
 } // RAPIOWebGUI::handlePathMVT
 
 void
@@ -839,7 +1003,7 @@ RAPIOWebGUI::handlePathTMS(WebMessage& w, std::vector<std::string>& pieces, std:
   if (w.getMap().count("layer")) { settings["layer"] = w.getMap().at("layer"); }
 
   // 4. Pass the explicitly loaded dataset into the serving logic
-  serveTile(w, targetData, pathout, settings);
+  serveTile(w, targetData, datasetId, pathout, settings);
 } // RAPIOWebGUI::handlePathTMS
 
 void
@@ -878,7 +1042,7 @@ RAPIOWebGUI::handlePathGeoJSON(WebMessage& w, std::vector<std::string>& pieces,
   if (w.getMap().count("layer")) { settings["layer"] = w.getMap().at("layer"); }
 
   // 3. Serve with target data
-  serveTile(w, targetData, pathout, settings);
+  serveTile(w, targetData, datasetId, pathout, settings);
 } // RAPIOWebGUI::handlePathGeoJSON
 
 void
@@ -1128,6 +1292,10 @@ RAPIOWebGUI::execute()
     p->execute(this);
   }
 
+  const size_t MB = 1024 * 1024;
+
+  g_tileCache.setBudgets(myTileCacheMB * MB, myTileCacheProductMB * MB);
+
   // We don't use process new data since that's a callback...
   // Direct read will be synchronous.
   if (!myStartUpFile.empty()) {
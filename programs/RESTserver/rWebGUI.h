@@ -7,7 +7,7 @@ class RAPIOWebGUI : public RAPIOProgram {
 public:
 
   /** Create tile algorithm */
-  RAPIOWebGUI(){ };
+  RAPIOWebGUI() : myTileCacheMB(256), myTileCacheProductMB(64){ };
 
   /** Declare extra command line plugins */
   virtual void
@@ -43,10 +43,11 @@ protected:
   void
   handleOverrides(const std::map<std::string, std::string>& params, std::map<std::string, std::string>& settings);
 
-  /** Serve a web tile image from a cache */
+  /** Serve a web tile image from a cache.  Product is the dataset the
+   * tile is from, which has its own share of the cache */
   void
-  serveTile(WebMessage& w, std::shared_ptr<DataType> targetData, std::string& pathout, std::map<std::string,
-    std::string>& settings);
+  serveTile(WebMessage& w, std::shared_ptr<DataType> targetData, const std::string& product,
+    std::string& pathout, std::map<std::string, std::string>& settings);
 
   /** Process a "/UI" message */
   void
@@ -105,6 +106,12 @@ protected:
   /** Web requests are concurrent; protect the cache */
   std::mutex myCacheMutex;
 
+  /** Megabytes of RAM for cached tiles */
+  size_t myTileCacheMB;
+
+  /** Megabytes of RAM for cached tiles of one product */
+  size_t myTileCacheProductMB;
+
   /** Start up file name, if any */
   std::string myStartUpFile;
 
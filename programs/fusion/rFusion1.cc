@@ -113,6 +113,16 @@ RAPIOFusionOneAlg::declareOptions(RAPIOOptions& o)
   o.addAdvancedHelp("roster",
     "Using a roster folder means we write coverage files and get back masks from a running roster that tells us what to write, because we are part of a N nearest radar cluster.  This means if a mask is missing we don't write anything.  Without a roster, we always write all our data.");
 
+  // Range files are quantized, so this is the roster's range precision
+  o.optional("rangeres", "0.025", "Range resolution in kilometers of roster coverage files.");
+  o.addAdvancedHelp("rangeres",
+    "Ranges written to the roster coverage file are stored as 16 bit steps of this size.  Smaller steps break ties between radars more finely.  The step is increased if 16 bits can't reach our radar range.");
+
+  // Projection math is the same each run for a radar/grid, so it can be kept on disk
+  o.optional("projcache", "", "Location of projection cache folder.");
+  o.addAdvancedHelp("projcache",
+    "The azimuth/range/elevation projection from the radar to each grid cell is costly to generate at startup.  With a folder, we write the projection to a file on first run and memory map it on later runs.  The mapping is read only, so multiple moments of the same radar share the same physical memory.  The file is regenerated if the radar location, grid or file version changes.");
+
   // Default sync heartbeat to 30 seconds
   // Format is seconds then mins
   o.setDefaultValue("sync", "*/30 * * * * *");
@@ -123,6 +133,12 @@ RAPIOFusionOneAlg::declareOptions(RAPIOOptions& o)
   o.boolean("everytilt", "Output after every tilt received and ignore heartbeat/sync");
   o.addGroup("everytilt", "time");
 
+  // Height layers are independent, so we can resolve them at the same time
+  o.optional("layerthreads", "1",
+    "Number of threads for resolving height layers at the same time. 1 is serial, 0 is the number of cores.");
+  o.addAdvancedHelp("layerthreads",
+    "Each height layer is resolved independently with its own resolver, output grid and stage2 storage.  The layer results are joined in height order, so output is identical to the serial path.  Useful for radars with many heights where one core can't keep up with the volume scan.");
+
   // Output S2 by default and declare static product keys for what we write.
   o.setDefaultValue("O", "S2");
   declareProduct("S2", "Write Stage2 raw data files. (Normal operations)");
@@ -173,6 +189,10 @@ RAPIOFusionOneAlg::processOptions(RAPIOOptions& o)
     myRangeKMs = 1000;
   }
   fLogInfo("Radar range is {} Kilometers.", myRangeKMs);
+  myRangeResolutionKMs = o.getFloat("rangeres");
+  if (myRangeResolutionKMs <= 0) {
+    myRangeResolutionKMs = FusionCache::DEFAULT_RANGE_RESOLUTION_KMS;
+  }
 
   // Weight information
   myWeight = o.getFloat("weight");
@@ -199,6 +219,19 @@ RAPIOFusionOneAlg::processOptions(RAPIOOptions& o)
     FusionCache::setRosterDir(roster);
   }
   myEveryTilt = o.getBoolean("everytilt");
+  myProjectionCacheDir = o.getString("projcache");
+
+  // Layer threading
+  int threads = o.getInteger("layerthreads");
+
+  if (threads < 1) {
+    threads = std::thread::hardware_concurrency();
+  }
+  myLayerThreadCount = std::max(1, std::min(threads, (int) myFullGrid.getNumZ()));
+  if (myLayerThreadCount > 1) {
+    fLogInfo("Resolving height layers using {} threads.", myLayerThreadCount);
+    myLayerThreads = std::make_shared<ThreadGroup>(myLayerThreadCount, myFullGrid.getNumZ());
+  }
 } // RAPIOFusionOneAlg::processOptions
 
 void
@@ -224,6 +257,24 @@ RAPIOFusionOneAlg::createLLHtoAzRangeElevProjection(
 {
   // We cache a bunch of repeated trig functions that save us a lot of CPU time
   if (myLLProjections[0] == nullptr) {
+    // Try to map an existing projection file first
+    std::string directory, projpath;
+    if (!myProjectionCacheDir.empty()) {
+      std::string filename = FusionCache::getProjectionFilename(myProjectionCacheDir,
+          myRadarName, myFullGrid, directory);
+      projpath = directory + filename;
+      ProcessTimer maptime("Projection AzRangeElev cache mapping.");
+      if (FusionCache::readProjectionFile(projpath, cLat, cLon, cHeight, g,
+        mySinCosCache, myLLProjections))
+      {
+        for (size_t i = 0; i < myLLProjections.size(); i++) {
+          myLevelSames[i] = std::make_shared<LevelSameCache>(g.getNumX(), g.getNumY());
+        }
+        fLogInfo("{}", maptime);
+        return;
+      }
+    }
+
     ProcessTimer projtime("Projection AzRangeElev cache generation.");
     // fLogInfo("Projection AzRangeElev cache generation.");
     LengthKMs virtualRangeKMs;
@@ -279,6 +330,12 @@ RAPIOFusionOneAlg::createLLHtoAzRangeElevProjection(
       }
     }
     fLogInfo("{}", projtime);
+
+    // Save for the next run or other moments of this radar
+    if (!projpath.empty() && OS::ensureDirectory(directory)) {
+      FusionCache::writeProjectionFile(projpath, cLat, cLon, cHeight, g,
+        *mySinCosCache, myLLProjections);
+    }
   }
 } // RAPIOFusionOneAlg::createLLHtoAzRangeElevProjection
 
@@ -394,6 +451,24 @@ RAPIOFusionOneAlg::firstDataSetup(std::shared_ptr<RadialSet> r, const std::strin
 
     // 25 here is a magic number from w2merger for time variance squared.
     myResolver->setVarianceWeight(1.0 / (25.0 * (mySigmaWeight * mySigmaWeight)));
+
+    // Each layer gets its own resolver when threading, since resolvers can
+    // keep working state during calc
+    if (myLayerThreads != nullptr) {
+      const size_t numZ = myFullGrid.getNumZ();
+      for (size_t i = 0; i < numZ; ++i) {
+        auto r = vp->createVolumeValueResolver();
+        if (r == nullptr) {
+          fLogSevere("Couldn't create a resolver per layer, falling back to serial layers.");
+          myLayerResolvers.clear();
+          myLayerThreads = nullptr;
+          break;
+        }
+        r->setGlobalWeight(myWeight);
+        r->setVarianceWeight(1.0 / (25.0 * (mySigmaWeight * mySigmaWeight)));
+        myLayerResolvers.push_back(r);
+      }
+    }
   }
 
   // -------------------------------------------------------------
@@ -443,9 +518,8 @@ RAPIOFusionOneAlg::updateRangeFile()
     return;
   }
   // We either have to write/rewrite the range file, or at least touch it.
-  // For moment we're rewriting it.  Multi moment they may step on each other,
-  // so we'll either pull it out to another program or check time stamps or
-  // something.  Have to think about it and run operationally to determine best design.
+  // The write only touches the file when the coverage is the same, so
+  // multiple moments writing the same radar mostly don't hit the disk.
 
   // Wait a few tilts so we don't just write a blank coverage file
   static size_t startupcounter = 0;
@@ -468,7 +542,7 @@ RAPIOFusionOneAlg::updateRangeFile()
   // fLogInfo("Sizes: {}, {}", myRadarGrid.getNumX(), myRadarGrid.getNumY());
   OS::ensureDirectory(directory);
   FusionCache::writeRangeFile(fullpath, myRadarGrid,
-    myLLProjections, myRangeKMs);
+    myLLProjections, myRangeKMs, myRangeResolutionKMs);
 } // RAPIOFusionOneAlg::updateRangeFile
 
 void
@@ -629,16 +703,45 @@ RAPIOFusionOneAlg::processHeartbeat(const Time& n, const Time& p)
   }
 }
 
+void
+FusionLayerTask::execute()
+{
+  auto resolver = myAlg->getLayerResolver(myLayer);
+
+  if (myWantIO) {
+    myIO = myAlg->createLayerIO(myLayer);
+  }
+  myAttemptCount = myAlg->processHeightLayer(myLayer, myCC, *resolver, myIO);
+  markDone();
+}
+
+std::shared_ptr<VolumeValueResolver>
+RAPIOFusionOneAlg::getLayerResolver(size_t layer)
+{
+  return (layer < myLayerResolvers.size()) ? myLayerResolvers[layer] : myResolver;
+}
+
+std::shared_ptr<VolumeValueIO>
+RAPIOFusionOneAlg::createLayerIO(size_t layer)
+{
+  auto io = getLayerResolver(layer)->getVolumeValueIO();
+
+  if (io) {
+    io->initForSend(myRadarName, myTypeName, myWriteOutputUnits, myRadarCenter, myNoMissing, myPartitionInfo,
+      myRadarGrid);
+  }
+  return io;
+}
+
 size_t
 RAPIOFusionOneAlg::processHeightLayer(size_t layer,
   const VolumePointerCache                   & cc,
-  const Time                                 & rTime, // Time for writing a 2D debug layer
+  VolumeValueResolver                        & resolver,
   std::shared_ptr<VolumeValueIO>             stage2p)
 {
-  // Prepping for threading layers here.  Since each layer is independent
-  // in memory we 'should' be able to thread them with minimum locking.  This
-  // will give us more CPU scaling.
-  // FIXME: check reads/writes here thread safe and add any needed locking
+  // Each layer is independent in memory.  Everything shared here is only
+  // read, and writes go to the layer's own output grid, caches and stage2
+  // storage, so layers can be threaded without locking.
 
   // ------------------------------------------------------------------------------
   // Do we try to output Stage 2 files for fusion2?
@@ -653,7 +756,6 @@ RAPIOFusionOneAlg::processHeightLayer(size_t layer,
   const size_t numX = outg.getNumX();
 
   // Set the value object for resolver
-  auto& resolver = *myResolver;
   std::shared_ptr<VolumeValue> vvsp = resolver.getVolumeValue();
   auto& vv   = *vvsp;
   auto * vvp = vvsp.get();
@@ -844,29 +946,70 @@ RAPIOFusionOneAlg::processHeightLayer(size_t layer,
     }   // endY
   } // end else
 
+  // --------------------------------------------------------
+  // Log info on the layer calculations
+  //
+  const double percentAttempt = (double) (attemptCount) / (double) (totalLayer) * 100.0;
+
+  fLogDebug("KM: {} Mask: {} Range: {} Same: {} Resolved: {} ({}%) or {}.",
+    vv.getAtLocationHeightKMs(), maskSkipped, rangeSkipped, sameTiltSkip,
+    attemptCount, percentAttempt, totalLayer);
+
+  return attemptCount;
+} // RAPIOFusionOneAlg::processHeightLayer
+
+void
+RAPIOFusionOneAlg::writeHeightLayer(size_t layer, const Time& rTime)
+{
   // --------------------------------------------------------
   // Write debugging 2D LatLonGrid for layer (post entire layer processing)
+  // This is done outside the layer calculation since writing isn't thread safe
   //
-  if (writeLLG) {
+  if (isProductWanted("2D")) {
     static int writeCount = 0;
     if (++writeCount >= myThrottleCount) {
+      auto output = myLLGCache->get(layer);
       output->setTime(rTime);
       writeOutputCAPPI(output);
     }
     writeCount = 0;
   }
+}
 
-  // --------------------------------------------------------
-  // Log info on the layer calculations
-  //
-  const double percentAttempt = (double) (attemptCount) / (double) (totalLayer) * 100.0;
+size_t
+RAPIOFusionOneAlg::processLayersParallel(const VolumePointerCache& cc, const Time& rTime,
+  std::shared_ptr<VolumeValueIO> stage2IO)
+{
+  const size_t numZ = myRadarGrid.getNumZ();
+  std::vector<std::shared_ptr<FusionLayerTask> > tasks;
+
+  // Queue every layer.  The thread group queue is sized to hold all of them
+  for (size_t layer = 0; layer < numZ; ++layer) {
+    auto task = std::make_shared<FusionLayerTask>(this, layer, cc, rTime, stage2IO != nullptr);
+    tasks.push_back(task);
+    while (!myLayerThreads->enqueueThreadTask(task)) {
+      std::this_thread::yield();
+    }
+  }
 
-  fLogDebug("KM: {} Mask: {} Range: {} Same: {} Resolved: {} ({}%) or {}.",
-    vv.getAtLocationHeightKMs(), maskSkipped, rangeSkipped, sameTiltSkip,
-    attemptCount, percentAttempt, totalLayer);
+  // Join in height order as each layer finishes, so the stage2 output is
+  // in the same order as the serial path.  Each layer's storage is
+  // released as soon as it's merged.
+  size_t attemptCount = 0;
 
+  for (size_t layer = 0; layer < numZ; ++layer) {
+    auto& task = tasks[layer];
+    task->waitUntilDone();
+    attemptCount += task->getAttemptCount();
+    auto io = task->getIO();
+    if (stage2IO && io) {
+      stage2IO->merge(*io);
+    }
+    task->clearIO();
+    writeHeightLayer(layer, rTime);
+  }
   return attemptCount;
-} // RAPIOFusionOneAlg::processHeightLayer
+} // RAPIOFusionOneAlg::processLayersParallel
 
 void
 RAPIOFusionOneAlg::processVolume(const Time rTime)
@@ -910,9 +1053,20 @@ RAPIOFusionOneAlg::processVolume(const Time rTime)
 
   size_t attemptCount = 0;
 
-  // Handle all layers
-  for (size_t layer = 0; layer < heightsKM.size(); layer++) {
-    attemptCount += processHeightLayer(layer, cc, rTime, stage2IO);
+  // Layers in parallel, if the stage2 storage can be joined back together
+  // or we're not writing it.
+  const bool outputStage2 = (isProductWanted("S2") || isProductWanted("S2Netcdf"));
+  const bool parallel     = (myLayerThreads != nullptr) &&
+    (!outputStage2 || (stage2IO == nullptr) || stage2IO->canMerge());
+
+  if (parallel) {
+    attemptCount = processLayersParallel(cc, rTime, outputStage2 ? stage2IO : nullptr);
+  } else {
+    // Handle all layers
+    for (size_t layer = 0; layer < heightsKM.size(); layer++) {
+      attemptCount += processHeightLayer(layer, cc, *myResolver, stage2IO);
+      writeHeightLayer(layer, rTime);
+    }
   }
 
   const double percentAttempt = (double) (attemptCount) / (double) (totalLayer) * 100.0;
@@ -5,10 +5,66 @@
 #include "rVolumeValueResolver.h"
 #include "rLLHGridN2D.h"
 #include "rElevationVolume.h"
+#include "rThreadGroup.h"
 
 #include "rFusionCache.h"
 
 namespace rapio {
+class RAPIOFusionOneAlg;
+
+/** Thread task for resolving a single height layer.  Each layer has its own
+ * resolver, output grid and stage2 storage, so layers can run at the same time.
+ *
+ * @author Robert Toomey
+ */
+class FusionLayerTask : public ThreadTask {
+public:
+
+  /** Create a task for a layer */
+  FusionLayerTask(RAPIOFusionOneAlg * alg, size_t layer,
+    const VolumePointerCache& cc, const Time& rTime, bool wantIO)
+    : myAlg(alg), myLayer(layer), myCC(cc), myTime(rTime), myWantIO(wantIO), myAttemptCount(0){ }
+
+  /** Resolve our layer */
+  virtual void
+  execute() override;
+
+  /** Number of resolver calculations done for the layer */
+  size_t
+  getAttemptCount() const { return myAttemptCount; }
+
+  /** Stage2 storage for our layer, if any */
+  std::shared_ptr<VolumeValueIO>
+  getIO(){ return myIO; }
+
+  /** Release our stage2 storage once it has been merged */
+  void
+  clearIO(){ myIO = nullptr; }
+
+protected:
+
+  /** The algorithm we're resolving for */
+  RAPIOFusionOneAlg * myAlg;
+
+  /** The height layer we resolve */
+  size_t myLayer;
+
+  /** Shared elevation volume pointers, read only while layers run */
+  const VolumePointerCache& myCC;
+
+  /** Time of the volume */
+  Time myTime;
+
+  /** Do we create stage2 storage for our layer? */
+  bool myWantIO;
+
+  /** Resolver calculations done */
+  size_t myAttemptCount;
+
+  /** Stage2 storage for just this layer */
+  std::shared_ptr<VolumeValueIO> myIO;
+};
+
 /** Stage 1 algorithm.  This handles projection and resolving values
  *  for a single source for the final output grid.
  *
@@ -18,7 +74,7 @@ class RAPIOFusionOneAlg : public rapio::RAPIOAlgorithm {
 public:
 
   /** Create tile algorithm */
-  RAPIOFusionOneAlg() : myDirty(0){ };
+  RAPIOFusionOneAlg() : myLayerThreadCount(1), myDirty(0){ };
 
   /** Declare all algorithm command line plugins */
   virtual void
@@ -77,10 +133,29 @@ public:
   size_t
   processHeightLayer(size_t        layer,
     const VolumePointerCache       & cc,
-    const Time                     & rTime,
+    VolumeValueResolver            & resolver,
     std::shared_ptr<VolumeValueIO> stage2p
   );
 
+  /** Write the debug 2D output for a height layer, if wanted */
+  void
+  writeHeightLayer(size_t layer, const Time& rTime);
+
+  /** Get the resolver for a height layer.  In parallel mode each layer has
+   * its own resolver, otherwise all layers share one */
+  std::shared_ptr<VolumeValueResolver>
+  getLayerResolver(size_t layer);
+
+  /** Create and initialize stage2 storage for a single layer using the layer's resolver */
+  std::shared_ptr<VolumeValueIO>
+  createLayerIO(size_t layer);
+
+  /** Process all height layers in parallel using our layer thread group.
+   * @return the total resolver attempts */
+  size_t
+  processLayersParallel(const VolumePointerCache& cc, const Time& rTime,
+    std::shared_ptr<VolumeValueIO> stage2IO);
+
   /** Process a volume generating stage 2 output */
   void
   processVolume(const Time rTime);
@@ -124,6 +199,9 @@ protected:
   /** Cached sin/cos lookup.  Needs to be one 2D over radar coverage area */
   std::shared_ptr<SinCosLatLonCache> mySinCosCache;
 
+  /** Folder for persistent projection caches, empty for none */
+  std::string myProjectionCacheDir;
+
   /** Coordinates for the total merger grid */
   LLCoverageArea myFullGrid;
 
@@ -148,6 +226,9 @@ protected:
   /** Radar range */
   LengthKMs myRangeKMs;
 
+  /** Resolution of ranges in the roster coverage file */
+  LengthKMs myRangeResolutionKMs;
+
   /** Coordinates for the one radar we're watching */
   LLCoverageArea myRadarGrid;
 
@@ -166,6 +247,15 @@ protected:
   /** The resolver we are using to calculate values */
   std::shared_ptr<VolumeValueResolver> myResolver;
 
+  /** Resolvers per height layer when processing layers in parallel */
+  std::vector<std::shared_ptr<VolumeValueResolver> > myLayerResolvers;
+
+  /** Number of threads for processing height layers */
+  size_t myLayerThreadCount;
+
+  /** Thread group for processing height layers, if threading */
+  std::shared_ptr<ThreadGroup> myLayerThreads;
+
   /** The mask from roster covering current nearest neighbor.
    * Basically we don't need to calculate values currently covered by
    * other radars. */
@@ -5,6 +5,7 @@
 #include "rProcessTimer.h"
 #include "rRecordQueue.h"
 
+#include <cstring>
 #include <vector>
 
 using namespace rapio;
@@ -45,6 +46,20 @@ RAPIOFusionTwoAlg::declareOptions(RAPIOOptions& o)
   o.optional("p", "-1",
     "Sets a round-off precision to use. Use a value of 0.5 to round off to the nearest half. Negative value disables.");
 
+  // Height layers merge independently, so we can merge them at the same time
+  o.optional("mergethreads", "0",
+    "Number of threads for merging height layers at the same time. 1 is serial, 0 is the number of cores.");
+  o.addAdvancedHelp("mergethreads",
+    "Each height layer of the output is merged into its own grid, so layers are split between threads without any locking.  Output is identical to the serial merge.");
+
+  // Restarting shouldn't need a full history of new stage1 input
+  o.optional("snapshot", "", "Folder for warm start snapshots of the database.");
+  o.addAdvancedHelp("snapshot",
+    "With a folder, the observations from all sources are written in the background every snapshotmins minutes.  On startup the newest valid snapshot for our grid, partition and moment is restored, then aged by the normal time purge, so output is complete right away.");
+  o.optional("snapshotmins", "5", "Minutes between warm start snapshots.");
+  o.addGroup("snapshot", "time");
+  o.addGroup("snapshotmins", "time");
+
   // Output 2D by default and declare static product keys for what we write.
   o.setDefaultValue("O", "2D");
   declareProduct("2D", "Write N 2D layers merged values");
@@ -52,6 +67,11 @@ RAPIOFusionTwoAlg::declareOptions(RAPIOOptions& o)
   declareProduct("3D", "Write a 3D layer");
   declareProduct("3DMax", "Write a 3D max layer");
   declareProduct("S2", "Write Stage2 raw data files");
+
+  // Stage2 output is sparse, only sending what changed
+  o.optional("s2full", "5", "Heartbeats between full S2 output, only changes are written between.");
+  o.addAdvancedHelp("s2full",
+    "S2 output is merged values of our partition as stage2 data for stage3 or tile joining.  Readers keep cells they aren't sent until they expire, so between full writes only the layer rows that changed are sent.  Cells losing all coverage are sent as missing so readers drop the old value.  Full writes refresh everything before it expires downstream, so s2full heartbeats should be less than the reader history (-h).");
 }
 
 /** RAPIOAlgorithms process options on start up */
@@ -84,8 +104,48 @@ RAPIOFusionTwoAlg::processOptions(RAPIOOptions& o)
     fLogSevere("Failed to load and/or parse partition information!");
     exit(1);
   }
+
+  int threads = o.getInteger("mergethreads");
+
+  if (threads < 1) {
+    threads = std::thread::hardware_concurrency();
+  }
+  myMergeThreadCount = std::max(1, threads);
+
+  mySnapshotDir = o.getString("snapshot");
+  if (!mySnapshotDir.empty() && !Strings::endsWith(mySnapshotDir, "/")) {
+    mySnapshotDir += "/";
+  }
+  mySnapshotInterval = TimeDuration::Minutes(std::max(1, o.getInteger("snapshotmins")));
+  myS2FullCycles     = std::max(1, o.getInteger("s2full"));
 } // RAPIOFusionTwoAlg::processOptions
 
+std::string
+RAPIOFusionTwoAlg::getSnapshotFilename(std::string& directory) const
+{
+  // Unique per grid, partition and moment since those share a folder
+  directory = mySnapshotDir + "GRID_" + myFullGrid.getParseUniqueString() + "/";
+  return directory + "Fusion2_" + myTypeName + "_"
+         + std::to_string(myPartitionInfo.getSelectedPartitionNumber()) + ".snap";
+}
+
+void
+RAPIOFusionTwoAlg::writeSnapshot(const Time& at)
+{
+  if (mySnapshotDir.empty() || (myDatabase == nullptr) || (at - myLastSnapshot < mySnapshotInterval)) {
+    return;
+  }
+  std::string directory;
+  const std::string filename = getSnapshotFilename(directory);
+
+  OS::ensureDirectory(directory);
+  if (myDatabase->writeSnapshot(filename, at)) {
+    myLastSnapshot = at;
+  } else {
+    fLogInfo("Last snapshot still writing, skipping this one.");
+  }
+}
+
 void
 RAPIOFusionTwoAlg::createLLGCache(
   const std::string    & outputName,
@@ -147,7 +207,21 @@ RAPIOFusionTwoAlg::firstDataSetup(std::shared_ptr<Stage2Data> data)
   // Finally, create the point cloud database with N observations per point
   myDatabase = std::make_shared<FusionDatabase>(myFullGrid.getNumX(), myFullGrid.getNumY(), myFullGrid.getNumZ());
   fLogInfo("Created XYZ array of {}*{}*{} size", myFullGrid.getNumX(), myFullGrid.getNumY(), myFullGrid.getNumZ());
+  myDatabase->setThreadCount(myMergeThreadCount);
   // fLogInfo("DATABASE IS {}", (void*)(myDatabase.get()));
+
+  // Warm start from the last snapshot, expiring anything too old
+  if (!mySnapshotDir.empty()) {
+    Time at;
+    std::string directory;
+    const std::string filename = getSnapshotFilename(directory);
+    if (myDatabase->readSnapshot(filename, at)) {
+      myDatabase->timePurge(Time::CurrentTime(), myMaximumHistory);
+      myLastSnapshot = at;
+    } else {
+      fLogInfo("No valid snapshot at {}, starting empty.", filename);
+    }
+  }
 } // RAPIOFusionTwoAlg::firstDataSetup
 
 void
@@ -330,7 +404,7 @@ RAPIOFusionTwoAlg::mergeAndWriteOutput(const Time& n, const Time& p)
 
   // myDatabase->dumpXYZ(); // only valid after firstDataSetup (currently)
 
-  ProcessTimer timepurge("Full time purge. Can still be optimized.");
+  ProcessTimer timepurge("Time purge");
 
   // Time to expire data
   // We might not have gotten data in a while..slowly expire off
@@ -345,6 +419,9 @@ RAPIOFusionTwoAlg::mergeAndWriteOutput(const Time& n, const Time& p)
   myDatabase->timePurge(Time::CurrentTime(), myMaximumHistory);
   fLogInfo("{}", timepurge);
 
+  // Snapshot after the purge so we don't save what's expired
+  writeSnapshot(p);
+
   // ----------------
   // Alpha Merge data and write... (fun times)
   // Time, etc. needs to be added
@@ -362,14 +439,17 @@ RAPIOFusionTwoAlg::mergeAndWriteOutput(const Time& n, const Time& p)
   extraParams["compression"]  = "gz";  // Force compression
 
   // ---------------------------------------
-  // Output 2D and/or 3D cube
-  const bool wantMerge = (isProductWanted("2D") || isProductWanted("3D"));
+  // Output 2D and/or 3D cube, and stage2 from the same merge
+  const bool wantMerge = (isProductWanted("2D") || isProductWanted("3D") || isProductWanted("S2"));
 
   if (wantMerge) {
     const std::string typeMerged = "Fused2" + myTypeName;
     myDatabase->mergeTo(myLLGCache, cutoff, part.getStartX(), part.getStartY(), myPrecision);
     write2DLayers("2D", "Writing fused layer ", typeMerged, extraParams, outputTime);
     write3DLayer("3D", typeMerged, extraParams, outputTime);
+    if (isProductWanted("S2")) { // -O="S2"
+      writeStage2(outputTime, extraParams);
+    }
   }
 
   // ---------------------------------------
@@ -382,14 +462,65 @@ RAPIOFusionTwoAlg::mergeAndWriteOutput(const Time& n, const Time& p)
     write2DLayers("2DMax", "Writing max layer ", typeMaxed, extraParams, outputTime);
     write3DLayer("3DMax", typeMaxed, extraParams, outputTime);
   }
+} // RAPIOFusionTwoAlg::processHeartbeat
 
-  // ---------------------------------------
-  // Output stage2 again with group
-  // -O="S2=GROUP1" I'm thinking here..
-  if (isProductWanted("S2")) { // -O="S2"
-    fLogInfo("Can't write stage2 data yet...but we will soon...");
+void
+RAPIOFusionTwoAlg::writeStage2(const Time& outputTime, const std::map<std::string, std::string>& extraParams)
+{
+  ProcessTimer timer("Writing stage2");
+  auto& part        = myPartitionInfo.getSelectedPartition();
+  const size_t numZ = myLLGCache->getNumLayers();
+  const size_t numY = part.getNumY();
+  const size_t numX = part.getNumX();
+
+  if (myS2Delta == nullptr) {
+    myS2Delta = std::make_shared<Stage2Delta>(numX, numY, numZ, myS2FullCycles);
+  } else if (!myS2HistoryWarned) {
+    // Readers expire what we don't send after their history, so the gap
+    // between full writes has to be shorter or cells drop out downstream
+    const TimeDuration fullGap = (outputTime - myS2LastWrite) * myS2FullCycles;
+    if (fullGap >= myMaximumHistory) {
+      fLogSevere("Stage2 full writes every {} heartbeats ({}) are not within the history {}.", myS2FullCycles, fullGap,
+        myMaximumHistory);
+      fLogSevere("Readers with the same -h will expire unchanged cells, lower s2full or raise -h.");
+      myS2HistoryWarned = true;
+    }
   }
-} // RAPIOFusionTwoAlg::processHeartbeat
+  myS2LastWrite = outputTime;
+
+  // We're a source to stage3 named by our partition, with partition coordinates
+  auto table = std::make_shared<FusionBinaryTable>();
+  const std::string name = "Fusion2Partition" + std::to_string(myPartitionInfo.getSelectedPartitionNumber());
+
+  table->setString("Sourcename", name);
+  table->setString("Radarname", name);
+  table->setString("Typename", myTypeName);
+  table->setUnits(myWriteOutputUnits);
+  table->setLocation(LLH(part.getNWLat() - (numY * part.getLatSpacing() / 2.0),
+    part.getNWLon() + (numX * part.getLonSpacing() / 2.0), 0));
+  table->setLong("xBase", part.getStartX());
+  table->setLong("yBase", part.getStartY());
+
+  bool full;
+  const size_t changed = myS2Delta->add(*myLLGCache, *table, full);
+
+  fLogInfo("Stage2 {} write of {} of {} rows, {} values and {} missing runs.", full ? "full" : "delta",
+    changed, myS2Delta->getNumRows(), table->getValueSize(), table->getMissingSize());
+
+  // Readers keep what we don't send, so nothing changed is nothing to write
+  if ((table->getValueSize() > 0) || (table->getMissingSize() > 0)) {
+    std::map<std::string, std::string> params = extraParams;
+    params.erase("compression"); // Raw like stage1 writes it
+    if (myPartitionInfo.getPartitionType() == PartitionInfo::Type::tile) {
+      params["outputsubfolder"] = "partition" + std::to_string(myPartitionInfo.getSelectedPartitionNumber());
+    }
+    table->setSubType("S2");
+    table->setTime(outputTime);
+    table->setTypeName(myTypeName);
+    writeOutputProduct("S2", table, params);
+  }
+  fLogInfo("{}", timer);
+} // RAPIOFusionTwoAlg::writeStage2
 
 int
 main(int argc, char * argv[])
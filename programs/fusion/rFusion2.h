@@ -31,7 +31,7 @@ class RAPIOFusionTwoAlg : public rapio::RAPIOAlgorithm {
 public:
 
   /** Create tile algorithm */
-  RAPIOFusionTwoAlg() : myDirty(0){ };
+  RAPIOFusionTwoAlg() : myDirty(0), myMergeThreadCount(1), myS2FullCycles(5), myS2HistoryWarned(false){ };
 
   /** Declare all algorithm command line plugins */
   virtual void
@@ -113,5 +113,42 @@ protected:
 
   // Could group this all as a 'partition info class'
   PartitionInfo myPartitionInfo;
+
+  /** Number of threads for merging height layers */
+  size_t myMergeThreadCount;
+
+  /** Folder for warm start snapshots, empty for none */
+  std::string mySnapshotDir;
+
+  /** Time between snapshots */
+  TimeDuration mySnapshotInterval;
+
+  /** Time of the last snapshot we started */
+  Time myLastSnapshot;
+
+  /** Full path of our snapshot file and its directory */
+  std::string
+  getSnapshotFilename(std::string& directory) const;
+
+  /** Snapshot the database if it's time */
+  void
+  writeSnapshot(const Time& at);
+
+  /** Write the merged values of our partition as stage2 data, only
+   * rows changed since the last write unless it's time for a full one */
+  void
+  writeStage2(const Time& outputTime, const std::map<std::string, std::string>& extraParams);
+
+  /** Cycles between full stage2 writes */
+  size_t myS2FullCycles;
+
+  /** Sparse stage2 output of our partition */
+  std::shared_ptr<Stage2Delta> myS2Delta;
+
+  /** Time of the last stage2 write */
+  Time myS2LastWrite;
+
+  /** Have we warned full writes are too far apart for readers? */
+  bool myS2HistoryWarned;
 };
 }
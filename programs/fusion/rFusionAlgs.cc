@@ -12,16 +12,20 @@ RAPIOFusionAlgs::declareOptions(RAPIOOptions& o)
   o.setAuthors("Robert Toomey");
 
   // Optional: Let user define thread count, default to hardware concurrency
-  o.optional("threads", std::to_string(std::thread::hardware_concurrency()), "Number of spatial threads to use");
+  o.optional("threads", "0", "Number of spatial threads to use, 0 for number of cores");
 }
 
 void
 RAPIOFusionAlgs::processOptions(RAPIOOptions& o)
 {
   // 1. The controller's own options (like 'threads') are already parsed and ready!
-  size_t threads = o.getInteger("threads");
+  const int threads = o.getInteger("threads");
 
-  fLogInfo("FusionAlgs configuring with {} threads", threads);
+  myThreadCount = (threads > 0) ? threads : ThreadGroup::getDefaultThreadCount();
+  fLogInfo("FusionAlgs configuring with {} threads", myThreadCount);
+
+  // Threads are kept for the life of the algorithm, not created per record
+  ThreadGroup::setSharedThreadCount(myThreadCount);
 
   // 2. Check if an XML config was provided to the orchestrator
   // Note that this file gets read twice.  Once for main fusionAlg parameters,
@@ -113,30 +117,19 @@ RAPIOFusionAlgs::processNewData(rapio::RAPIOData& d)
       return;
     }
 
-    size_t totalRows  = llg->getNumLats();
-    size_t numThreads = std::thread::hardware_concurrency();
-    if (numThreads == 0) { numThreads = 4; }
-
-    // Safety check just in case we have fewer rows than threads
-    if (numThreads > totalRows) { numThreads = totalRows; }
-
-    size_t rowsPerThread = totalRows / numThreads;
-
-    ThreadGroup threadPool(numThreads, numThreads * 2);
-    std::vector<std::shared_ptr<GridChunkTask> > tasks;
+    // Split rows into small ranges that the threads grab as they finish.
+    // Columns over clear air finish quickly, storms don't, so static
+    // chunks per thread would leave threads idle.
+    auto pool = ThreadGroup::getShared();
+    const size_t totalRows = llg->getNumLats();
+    const size_t grain     = std::max<size_t>(1, totalRows / (pool->getNumWorkers() * 8));
 
-    for (size_t i = 0; i < numThreads; ++i) {
-      size_t startY = i * rowsPerThread;
-      size_t endY   = (i == numThreads - 1) ? totalRows : startY + rowsPerThread;
+    pool->parallelFor(0, totalRows, grain, [&](size_t startY, size_t endY){
+      LatLonHeightGridIterator iter(*llg, startY, endY);
 
-      auto task = std::make_shared<GridChunkTask>(llg, compositeCb, startY, endY);
-      tasks.push_back(task);
-      threadPool.enqueueThreadTask(task);
-    }
-
-    for (auto& task : tasks) {
-      task->waitUntilDone();
-    }
+      // We force ColumnsDown so VIL and MaxAGL can share the loop
+      iter.iterateDownColumns(*compositeCb);
+    });
 
     // Write out the products dynamically
     for (auto& alg : myLoadedAlgorithms) {
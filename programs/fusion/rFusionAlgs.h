@@ -53,37 +53,10 @@ private:
   std::vector<LatLonHeightGridCallback *> myCallbacks;
 };
 
-// 2. The Spatial Thread Task (Thread the Grid)
-class GridChunkTask : public ThreadTask {
-public:
-  GridChunkTask(std::shared_ptr<LatLonHeightGrid> grid,
-    std::shared_ptr<MultiHeightGridCallback> multiCb,
-    size_t startY, size_t endY)
-    : myGrid(grid), myMultiCb(multiCb), myStartY(startY), myEndY(endY){ }
-
-  virtual void
-  execute() override
-  {
-    // Note: You must update LatLonHeightGridIterator to accept startY/endY bounds!
-    LatLonHeightGridIterator iter(*myGrid, myStartY, myEndY);
-
-    // We force ColumnsDown so VIL and MaxAGL can share the loop
-    iter.iterateDownColumns(*myMultiCb);
-
-    markDone();
-  }
-
-private:
-  std::shared_ptr<LatLonHeightGrid> myGrid;
-  std::shared_ptr<MultiHeightGridCallback> myMultiCb;
-  size_t myStartY;
-  size_t myEndY;
-};
-
-// 3. The Orchestrator
+// 2. The Orchestrator
 class RAPIOFusionAlgs : public rapio::RAPIOAlgorithm {
 public:
-  RAPIOFusionAlgs(){ };
+  RAPIOFusionAlgs() : myThreadCount(0){ };
   virtual void
   declareOptions(rapio::RAPIOOptions& o) override;
   virtual void
@@ -98,6 +71,9 @@ public:
 
 protected:
 
+  /** Number of spatial threads from the threads option */
+  size_t myThreadCount;
+
   /** Algorithm module/programs loaded dynamically */
   std::vector<std::shared_ptr<VolumeAlgorithm> > myLoadedAlgorithms;
 };
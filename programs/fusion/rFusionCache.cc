@@ -3,90 +3,367 @@
 #include "rLLCoverageArea.h"
 
 #include <fstream>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <fcntl.h>
+#include <sys/stat.h>
 
 using namespace rapio;
 
 std::string FusionCache::theRosterDir = "/home/mrms";
 
+namespace {
+/** Projection file magic, bump the version on any layout change */
+const char PROJECTION_MAGIC[8]    = { 'R', 'A', 'P', 'I', 'O', 'P', 'R', 'J' };
+const uint32_t PROJECTION_VERSION = 1;
+
+/** Beam model used for the projection.  Only the 4/3 earth radius model
+ * in Project is used currently */
+const uint32_t PROJECTION_BEAM_43 = 1;
+
+/** Alignment of arrays in the projection file */
+const size_t PROJECTION_ALIGN = 64;
+
+/** Header of a projection file.  Everything the projection depends on is
+ * stored here so a stale file from a moved radar or changed grid is never used. */
+struct ProjectionHeader {
+  char     magic[8];
+  uint32_t version;
+  uint32_t beamModel;
+  double   lat;
+  double   lon;
+  double   heightKMs;
+  double   nwLat;
+  double   nwLon;
+  double   latSpacing;
+  double   lonSpacing;
+  uint64_t numX;
+  uint64_t numY;
+  uint64_t numZ;
+  uint64_t startX;
+  uint64_t startY;
+  uint64_t dataOffset;
+};
+
+/** Fill a header for a radar/grid */
+void
+fillProjectionHeader(ProjectionHeader& h,
+  AngleDegs cLat, AngleDegs cLon, LengthKMs cHeight, const LLCoverageArea& g)
+{
+  std::memset(&h, 0, sizeof(h));
+  std::memcpy(h.magic, PROJECTION_MAGIC, sizeof(h.magic));
+  h.version    = PROJECTION_VERSION;
+  h.beamModel  = PROJECTION_BEAM_43;
+  h.lat        = cLat;
+  h.lon        = cLon;
+  h.heightKMs  = cHeight;
+  h.nwLat      = g.getNWLat();
+  h.nwLon      = g.getNWLon();
+  h.latSpacing = g.getLatSpacing();
+  h.lonSpacing = g.getLonSpacing();
+  h.numX       = g.getNumX();
+  h.numY       = g.getNumY();
+  h.numZ       = g.getNumZ();
+  h.startX     = g.getStartX();
+  h.startY     = g.getStartY();
+
+  const size_t headerBytes = sizeof(h) + h.numZ * sizeof(double);
+
+  h.dataOffset = ((headerBytes + PROJECTION_ALIGN - 1) / PROJECTION_ALIGN) * PROJECTION_ALIGN;
+}
+
+/** Range file magic, bump the version on any layout change */
+const char RANGE_MAGIC[8]    = { 'R', 'A', 'P', 'I', 'O', 'R', 'N', 'G' };
+const uint32_t RANGE_VERSION = 2;
+
+/** Stored range step meaning the cell isn't covered */
+const uint16_t RANGE_UNCOVERED = 0xFFFF;
+
+/** Largest stored range step */
+const uint16_t RANGE_MAX_STEP = 0xFFFE;
+
+/** Header of a range file.  The payload is, per layer and per row of
+ * the covered box, a run count followed by runs of (offset, length,
+ * length steps) of covered cells.  Offsets are from the box start. */
+struct RangeHeader {
+  char     magic[8];
+  uint32_t version;
+  uint32_t reserved;
+  double   resolutionKMs;
+  uint64_t startX;
+  uint64_t startY;
+  uint64_t numX;
+  uint64_t numY;
+  uint64_t numZ;
+  uint64_t boxX;
+  uint64_t boxY;
+  uint64_t boxNumX;
+  uint64_t boxNumY;
+  uint64_t payloadBytes;
+  uint64_t checksum;
+};
+
+/** Fill the fixed part of a range header */
+void
+fillRangeHeader(RangeHeader& h, size_t startX, size_t startY,
+  size_t numX, size_t numY, size_t numZ, double resolutionKMs)
+{
+  std::memset(&h, 0, sizeof(h));
+  std::memcpy(h.magic, RANGE_MAGIC, sizeof(h.magic));
+  h.version       = RANGE_VERSION;
+  h.resolutionKMs = resolutionKMs;
+  h.startX        = startX;
+  h.startY        = startY;
+  h.numX          = numX;
+  h.numY          = numY;
+  h.numZ          = numZ;
+}
+
+/** Does a header look like one of ours? */
 bool
-FusionCache::writeRangeFile(const std::string& filefinal, LLCoverageArea& outg,
-  std::vector<std::shared_ptr<AzRanElevCache> >& myLLProjections,
-  LengthKMs maxRangeKMs)
+validRangeHeader(const RangeHeader& h)
 {
-  bool success = true;
+  return (std::memcmp(h.magic, RANGE_MAGIC, sizeof(h.magic)) == 0) &&
+         (h.version == RANGE_VERSION) && (h.resolutionKMs > 0) &&
+         (h.boxX + h.boxNumX <= h.numX) && (h.boxY + h.boxNumY <= h.numY);
+}
 
-  // Letting stage1 overwrite file each time for moment.  This 'could'
-  // possibly be good enough for a marker.  These files are tiny so should be
-  // ok....we'll see in practice.
-  std::string filename = OS::getUniqueTemporaryFile("fusion");
+/** Checksum of the header geometry and payload, FNV-1a 8 bytes at a time */
+uint64_t
+rangeChecksum(const RangeHeader& h, const std::vector<char>& payload)
+{
+  uint64_t sum = 14695981039346656037ULL;
+  auto mix     = [&sum](uint64_t w){
+      sum ^= w;
+      sum *= 1099511628211ULL;
+    };
+  uint64_t res;
+
+  std::memcpy(&res, &h.resolutionKMs, sizeof(res));
+  for (uint64_t v: { res, h.startX, h.startY, h.numX, h.numY, h.numZ,
+                     h.boxX, h.boxY, h.boxNumX, h.boxNumY, h.payloadBytes })
+  {
+    mix(v);
+  }
+  size_t i = 0;
 
-  std::ofstream outFile(filename, std::ios::binary);
+  for (; i + 8 <= payload.size(); i += 8) {
+    uint64_t w;
+    std::memcpy(&w, &payload[i], 8);
+    mix(w);
+  }
+  for (; i < payload.size(); ++i) {
+    mix(static_cast<unsigned char>(payload[i]));
+  }
+  return sum;
+}
 
-  if (!outFile.is_open()) {
-    fLogSevere("Can't write cache tmp file: {}", filename);
+/** Append a value to a byte buffer */
+template <typename T>
+void
+put(std::vector<char>& out, T v)
+{
+  const size_t at = out.size();
+
+  out.resize(at + sizeof(T));
+  std::memcpy(&out[at], &v, sizeof(T));
+}
+
+/** Read a value from a byte buffer, false if past the end */
+template <typename T>
+bool
+get(const std::vector<char>& in, size_t& at, T& v)
+{
+  if (at + sizeof(T) > in.size()) {
     return false;
   }
+  std::memcpy(&v, &in[at], sizeof(T));
+  at += sizeof(T);
+  return true;
+}
 
-  // FIXME: Could I create an iterator for this?
-  // The iterator should keep lat, lon, etc. inline
-  // My concern is ordering and ease of breaking here
-
-  // FIXME: general gzip binary file class, we could clean up and compress
+/** Quantize ranges, find the covered box and pack runs of covered cells.
+ * Fills in the box, payload size and checksum of the header. */
+void
+packRanges(RangeHeader& h, const std::vector<FusionRangeCache>& ranges,
+  LengthKMs maxRangeKMs, std::vector<char>& payload)
+{
+  const size_t numX = h.numX, numY = h.numY, numZ = h.numZ;
+  std::vector<uint16_t> steps(ranges.size(), RANGE_UNCOVERED);
+  size_t minX = numX, maxX = 0, minY = numY, maxY = 0;
+
+  for (size_t z = 0, i = 0; z < numZ; ++z) {
+    for (size_t y = 0; y < numY; ++y) {
+      for (size_t x = 0; x < numX; ++x, ++i) {
+        const LengthKMs r = ranges[i];
+        if (!(r <= maxRangeKMs) || (r < 0)) { continue; }
+        steps[i] = std::min<double>(std::round(r / h.resolutionKMs), RANGE_MAX_STEP);
+        minX     = std::min(minX, x);
+        maxX     = std::max(maxX, x);
+        minY     = std::min(minY, y);
+        maxY     = std::max(maxY, y);
+      }
+    }
+  }
 
-  // Header (write the grid out so roster doesn't have to bother recalculating it):
-  auto x  = outg.getNumX();
-  auto y  = outg.getNumY();
-  auto sx = outg.getStartX();
-  auto sy = outg.getStartY();
+  payload.clear();
+  if (minX <= maxX) {
+    h.boxX    = minX;
+    h.boxY    = minY;
+    h.boxNumX = maxX - minX + 1;
+    h.boxNumY = maxY - minY + 1;
+
+    for (size_t z = 0; z < numZ; ++z) {
+      for (size_t y = minY; y <= maxY; ++y) {
+        const uint16_t * row = &steps[(z * numY + y) * numX];
+        const size_t countAt = payload.size();
+        uint32_t runs        = 0;
+        put<uint32_t>(payload, 0);
+
+        size_t x = minX;
+        while (x <= maxX) {
+          if (row[x] == RANGE_UNCOVERED) { ++x; continue; }
+          size_t end = x;
+          while (end <= maxX && row[end] != RANGE_UNCOVERED) { ++end; }
+          put<uint32_t>(payload, x - minX);
+          put<uint32_t>(payload, end - x);
+          const size_t at = payload.size();
+          payload.resize(at + (end - x) * sizeof(uint16_t));
+          std::memcpy(&payload[at], row + x, (end - x) * sizeof(uint16_t));
+          ++runs;
+          x = end;
+        }
+        std::memcpy(&payload[countAt], &runs, sizeof(runs));
+      }
+    }
+  }
+  h.payloadBytes = payload.size();
+  h.checksum     = rangeChecksum(h, payload);
+} // packRanges
 
-  size_t count = 0;
+/** Unpack runs into the full radar box, uncovered cells are max float */
+bool
+unpackRanges(const RangeHeader& h, const std::vector<char>& payload,
+  std::vector<FusionRangeCache>& data)
+{
+  std::fill(data.begin(), data.end(), std::numeric_limits<FusionRangeCache>::max());
+  size_t at = 0;
+
+  for (size_t z = 0; z < h.numZ && h.boxNumX > 0; ++z) {
+    for (size_t y = h.boxY; y < h.boxY + h.boxNumY; ++y) {
+      FusionRangeCache * row = &data[(z * h.numY + y) * h.numX + h.boxX];
+      uint32_t runs;
+      if (!get(payload, at, runs)) { return false; }
+      for (uint32_t r = 0; r < runs; ++r) {
+        uint32_t offset, length;
+        if (!get(payload, at, offset) || !get(payload, at, length) ||
+          (offset + length > h.boxNumX) || (at + length * sizeof(uint16_t) > payload.size()))
+        {
+          return false;
+        }
+        for (uint32_t i = 0; i < length; ++i, at += sizeof(uint16_t)) {
+          uint16_t step;
+          std::memcpy(&step, &payload[at], sizeof(step));
+          row[offset + i] = step * h.resolutionKMs;
+        }
+      }
+    }
+  }
+  return (at == payload.size());
+} // unpackRanges
 
-  outFile.write(reinterpret_cast<char *>(&x), sizeof(x));
-  outFile.write(reinterpret_cast<char *>(&y), sizeof(y));
-  outFile.write(reinterpret_cast<char *>(&sx), sizeof(sx));
-  outFile.write(reinterpret_cast<char *>(&sy), sizeof(sy));
+/** Total file size for a header */
+size_t
+projectionFileSize(const ProjectionHeader& h)
+{
+  const size_t cells = h.numX * h.numY;
 
-  // F(Lat,Lat,Height) --> Virtual Az, Elev, Range projection add spacing/2 to get cell cellcenters
-  const AngleDegs startLat = outg.getNWLat() - (outg.getLatSpacing() / 2.0); // move south (lat decreasing)
-  const AngleDegs startLon = outg.getNWLon() + (outg.getLonSpacing() / 2.0); // move east (lon increasing)
-  auto heightsKM = outg.getHeightsKM();
+  return h.dataOffset + (cells * 2 * sizeof(double))
+         + (h.numZ * cells * (2 * sizeof(AngleDegs) + sizeof(LengthKMs)));
+}
+}
 
+bool
+FusionCache::writeRangeFile(const std::string& filefinal, LLCoverageArea& outg,
+  std::vector<std::shared_ptr<AzRanElevCache> >& myLLProjections,
+  LengthKMs maxRangeKMs, LengthKMs resolutionKMs)
+{
+  // Gather ranges for the radar box.  Note: The 'range' is 0 to numX always,
+  // however the index to global grid is x+out.startX;
+  const size_t numZ = outg.getHeightsKM().size();
+  const size_t cells = outg.getNumX() * outg.getNumY();
   std::vector<FusionRangeCache> buffer;
 
-  for (size_t layer = 0; layer < heightsKM.size(); layer++) {
+  buffer.reserve(cells * numZ);
+  for (size_t layer = 0; layer < numZ; layer++) {
     auto& llp = *myLLProjections[layer];
     llp.reset();
+    for (size_t i = 0; i < cells; ++i, llp.next()) {
+      LengthKMs aLengthKMs;
+      llp.getRangeKMsAt(aLengthKMs);
+      buffer.push_back(aLengthKMs);
+    }
+  }
 
-    AngleDegs atLat = startLat;
-    for (size_t y = 0; y < outg.getNumY(); y++, atLat -= outg.getLatSpacing()) { // a north to south
-      AngleDegs atLon = startLon;
-      // Note: The 'range' is 0 to numX always, however the index to global grid is x+out.startX;
-      for (size_t x = 0; x < outg.getNumX(); x++, atLon += outg.getLonSpacing(), llp.next()) { // a east to west row, changing lon per cell
-        LengthKMs aLengthKMs;
+  return writeRangeFile(filefinal, outg.getStartX(), outg.getStartY(),
+           outg.getNumX(), outg.getNumY(), buffer, maxRangeKMs, resolutionKMs);
+} // FusionCache::writeRangeFile
 
-        // Store as 2 bytes meters for space.  8 bytes is about 128 mb per file currently
-        llp.getRangeKMsAt(aLengthKMs);
+bool
+FusionCache::writeRangeFile(const std::string& filefinal,
+  size_t startX, size_t startY, size_t numX, size_t numY,
+  const std::vector<FusionRangeCache>& ranges,
+  LengthKMs maxRangeKMs, LengthKMs resolutionKMs)
+{
+  const size_t cells = numX * numY;
+  const size_t numZ  = (cells > 0) ? ranges.size() / cells : 0;
 
-        // FusionRangeCache storedMeters = std::round(aLengthKMs * 1000.0);
-        FusionRangeCache storedMeters = aLengthKMs;
+  if ((numZ == 0) || (ranges.size() != cells * numZ)) {
+    fLogSevere("Size mismatch? {}, {} doesn't divide {}", numX, numY, ranges.size());
+    return false;
+  }
 
-        buffer.push_back(storedMeters);
-      }
+  // 16 bits has to hold our max range
+  if (resolutionKMs * RANGE_MAX_STEP < maxRangeKMs) {
+    resolutionKMs = maxRangeKMs / RANGE_MAX_STEP;
+    fLogInfo("Range resolution too small for {} KMs, using {} KMs.", maxRangeKMs, resolutionKMs);
+  }
+
+  RangeHeader h;
+
+  fillRangeHeader(h, startX, startY, numX, numY, numZ, resolutionKMs);
+  std::vector<char> payload;
+
+  packRanges(h, ranges, maxRangeKMs, payload);
+
+  // Stage1 rewrites every tilt, but coverage rarely changes.  Leave the
+  // file alone and just refresh its time for the roster.
+  uint64_t oldChecksum;
+
+  if (readRangeChecksum(filefinal, oldChecksum) && (oldChecksum == h.checksum)) {
+    if (::utimensat(AT_FDCWD, filefinal.c_str(), nullptr, 0) == 0) {
+      fLogInfo("Range file {} unchanged, touched it.", filefinal);
+      return true;
     }
   }
 
-  // Write the array
-  count = buffer.size();
-  if (count != x * y * heightsKM.size()) {
-    fLogSevere("Size mismatch? {}, {}, {} != {}", x, y, heightsKM.size(), count);
+  std::string filename = OS::getUniqueTemporaryFile("fusion");
+  std::ofstream outFile(filename, std::ios::binary);
+
+  if (!outFile.is_open()) {
+    fLogSevere("Can't write cache tmp file: {}", filename);
+    return false;
   }
-  outFile.write(reinterpret_cast<char *>(&count), sizeof(count));
-  outFile.write(reinterpret_cast<char *>(buffer.data()), count * sizeof(FusionRangeCache));
+
+  outFile.write(reinterpret_cast<const char *>(&h), sizeof(h));
+  outFile.write(payload.data(), payload.size());
 
   // Extra check file wrote successfully
   if (!outFile) {
     fLogSevere("Couldn't write to tmp cache file {} for {}", filename, filefinal);
     outFile.close();
+    OS::deleteFile(filename);
     return false;
   }
 
@@ -95,12 +372,14 @@ FusionCache::writeRangeFile(const std::string& filefinal, LLCoverageArea& outg,
   // Finally move the tmp file to final location
   // Current multi-moment can clash on the move since both will write the same file,
   // so we'll try a couple times, then delete our tmp file to avoid filing the disk
+  bool success = true;
   size_t attemptNumber      = 1;
   const size_t MAX_ATTEMPTS = 2;
 
   while (true) {
     if (OS::moveFile(filename, filefinal, true)) {
-      fLogInfo("Wrote cache file to {} with {} points.", filefinal, count);
+      fLogInfo("Wrote cache file to {} with {} bytes for box {}x{}.", filefinal,
+        sizeof(h) + payload.size(), h.boxNumX, h.boxNumY);
       break;
     } else {
       if (attemptNumber > MAX_ATTEMPTS) {
@@ -116,27 +395,26 @@ FusionCache::writeRangeFile(const std::string& filefinal, LLCoverageArea& outg,
     attemptNumber++;
   }
 
-  #if 0
-  // FIXME: Could write a unit test, but so much is required to reflect real time
-  // operations, so I have a test here.
-  // Read every file after writing test.
-  fLogInfo("Reading back cache file to check...");
-  std::vector<FusionRangeCache> data2;
-  size_t sx2, sy2, x2, y2;
+  return success;
+} // FusionCache::writeRangeFile
 
-  readRangeFile(filefinal, sx2, sy2, x2, y2, data2);
-  bool bad = ((sx != sx2) || (sy != sy2) || (x != x2) || (y != y2) || (buffer.size() != data2.size()));
+bool
+FusionCache::readRangeChecksum(const std::string& filename, uint64_t& checksum)
+{
+  std::ifstream infile(filename, std::ios::binary);
 
-  if (bad) {
-    fLogSevere("Uh oh ...read back not correct: ({},{})({},{})({},{})({},{}){},{}", sx, sx2, sy, sy2, x, x2, y, y2,
-      buffer.size(), data2.size());
-  } else {
-    fLogInfo("...Seems ok?");
+  if (!infile) {
+    return false;
   }
-  #endif // if 0
+  RangeHeader h;
 
-  return success;
-} // AzRanElevCache::writeRangeFile
+  infile.read(reinterpret_cast<char *>(&h), sizeof(h));
+  if (!infile || !validRangeHeader(h)) {
+    return false;
+  }
+  checksum = h.checksum;
+  return true;
+}
 
 bool
 FusionCache::readRangeFile(const std::string& filename,
@@ -151,42 +429,167 @@ FusionCache::readRangeFile(const std::string& filename,
     return false;
   }
 
-  size_t count;
+  RangeHeader h;
 
-  infile.read(reinterpret_cast<char *>(&x), sizeof(x));
-  infile.read(reinterpret_cast<char *>(&y), sizeof(y));
-  infile.read(reinterpret_cast<char *>(&sx), sizeof(sx));
-  infile.read(reinterpret_cast<char *>(&sy), sizeof(sy));
+  infile.read(reinterpret_cast<char *>(&h), sizeof(h));
+  if (!infile || !validRangeHeader(h)) {
+    fLogSevere("Cache file {} isn't a version {} range file.", filename, RANGE_VERSION);
+    return false;
+  }
 
-  // Why is count needed?  Isn't it a multiple of x,y,z or something?
-  infile.read(reinterpret_cast<char *>(&count), sizeof(count));
+  std::vector<char> payload;
 
-  // We don't want to use a count that wasn't read correctly...
-  if (infile) {
-    try{
-      // Read the data from the file into the vector
-      data.resize(count);
-      infile.read(reinterpret_cast<char *>(data.data()), count * sizeof(FusionRangeCache));
-    }catch (std::bad_alloc& e) {
-      // Memory check as well.
-      fLogSevere("Failed to allocation space for {}", count);
-    }
+  try{
+    payload.resize(h.payloadBytes);
+    infile.read(payload.data(), payload.size());
+    data.resize(h.numX * h.numY * h.numZ);
+  }catch (std::bad_alloc& e) {
+    // Memory check as well.
+    fLogSevere("Failed to allocation space for {}", filename);
+    return false;
   }
 
-  if (!infile) {
+  if (!infile || (rangeChecksum(h, payload) != h.checksum) || !unpackRanges(h, payload, data)) {
     // handle error reading file
     fLogSevere("Couldn't read existing cache file {}", filename);
-    infile.close();
-    // Copy file to someplace (Debugging)
-    // static size_t count = 0;
-    // OS::moveFile(filename, "/home/mrms/BADCACHE/badcache_" + std::to_string(count++) + ".cache");
     return false;
   }
-  infile.close();
+  sx = h.startX;
+  sy = h.startY;
+  x  = h.numX;
+  y  = h.numY;
 
   return true;
 } // FusionCache::readRangeFile
 
+bool
+FusionCache::writeProjectionFile(const std::string& filefinal,
+  AngleDegs cLat, AngleDegs cLon, LengthKMs cHeight,
+  const LLCoverageArea& grid,
+  const SinCosLatLonCache& sinCos,
+  const std::vector<std::shared_ptr<AzRanElevCache> >& llProjections)
+{
+  ProjectionHeader h;
+
+  fillProjectionHeader(h, cLat, cLon, cHeight, grid);
+  const size_t cells = h.numX * h.numY;
+
+  if ((llProjections.size() != h.numZ) || (sinCos.size() != cells)) {
+    fLogSevere("Projection cache size doesn't match grid, not writing {}", filefinal);
+    return false;
+  }
+
+  std::string filename = OS::getUniqueTemporaryFile("fusion");
+  std::ofstream outFile(filename, std::ios::binary);
+
+  if (!outFile.is_open()) {
+    fLogSevere("Can't write projection tmp file: {}", filename);
+    return false;
+  }
+
+  // Header, then heights, then pad to aligned data
+  outFile.write(reinterpret_cast<const char *>(&h), sizeof(h));
+  std::vector<double> heightsKM = grid.getHeightsKM();
+
+  outFile.write(reinterpret_cast<const char *>(heightsKM.data()), heightsKM.size() * sizeof(double));
+  const size_t pad = h.dataOffset - (sizeof(h) + heightsKM.size() * sizeof(double));
+  const std::vector<char> zeros(pad, 0);
+
+  outFile.write(zeros.data(), pad);
+
+  // Sin/cos shared by all layers, then az/elev/range per layer
+  outFile.write(reinterpret_cast<const char *>(sinCos.sinGcdIRData()), cells * sizeof(double));
+  outFile.write(reinterpret_cast<const char *>(sinCos.cosGcdIRData()), cells * sizeof(double));
+  for (auto& l:llProjections) {
+    if ((l == nullptr) || (l->size() != cells)) {
+      fLogSevere("Missing projection layer, not writing {}", filefinal);
+      outFile.close();
+      OS::deleteFile(filename);
+      return false;
+    }
+    outFile.write(reinterpret_cast<const char *>(l->azimuthData()), cells * sizeof(AngleDegs));
+    outFile.write(reinterpret_cast<const char *>(l->elevationData()), cells * sizeof(AngleDegs));
+    outFile.write(reinterpret_cast<const char *>(l->rangeData()), cells * sizeof(LengthKMs));
+  }
+
+  if (!outFile) {
+    fLogSevere("Couldn't write to tmp projection file {} for {}", filename, filefinal);
+    outFile.close();
+    OS::deleteFile(filename);
+    return false;
+  }
+  outFile.close();
+
+  // Move into place so readers never map a partial file.  Multiple moments of
+  // a radar may race here, but they write identical content.
+  if (!OS::moveFile(filename, filefinal, true)) {
+    fLogInfo("Couldn't move tmp {} to {}", filename, filefinal);
+    OS::deleteFile(filename);
+    return false;
+  }
+  fLogInfo("Wrote projection cache to {} ({} layers of {} points)", filefinal, h.numZ, cells);
+  return true;
+} // FusionCache::writeProjectionFile
+
+bool
+FusionCache::readProjectionFile(const std::string& filename,
+  AngleDegs cLat, AngleDegs cLon, LengthKMs cHeight,
+  const LLCoverageArea& grid,
+  std::shared_ptr<SinCosLatLonCache>& sinCos,
+  std::vector<std::shared_ptr<AzRanElevCache> >& llProjections)
+{
+  auto map = MemoryMappedFile::Create(filename);
+
+  if (map == nullptr) {
+    fLogInfo("No projection cache file {} exists.", filename);
+    return false;
+  }
+
+  // Check the header matches what we would have written
+  ProjectionHeader want;
+
+  fillProjectionHeader(want, cLat, cLon, cHeight, grid);
+  const ProjectionHeader * have = map->getPointer<ProjectionHeader>(0);
+
+  if ((have == nullptr) || (std::memcmp(have, &want, sizeof(want)) != 0)) {
+    fLogInfo("Projection cache {} is stale or a different version, ignoring.", filename);
+    return false;
+  }
+
+  const size_t cells = want.numX * want.numY;
+  const double * heights = map->getPointer<double>(sizeof(want), want.numZ);
+  std::vector<double> heightsKM = grid.getHeightsKM();
+
+  if ((heights == nullptr) || (map->size() != projectionFileSize(want)) ||
+    !std::equal(heightsKM.begin(), heightsKM.end(), heights))
+  {
+    fLogInfo("Projection cache {} doesn't match our heights or is truncated, ignoring.", filename);
+    return false;
+  }
+
+  size_t at = want.dataOffset;
+  const double * sins = map->getPointer<double>(at, cells);
+
+  at += cells * sizeof(double);
+  const double * coss = map->getPointer<double>(at, cells);
+
+  at    += cells * sizeof(double);
+  sinCos = std::make_shared<SinCosLatLonCache>(want.numX, want.numY, sins, coss, map);
+
+  llProjections.resize(want.numZ);
+  for (size_t z = 0; z < want.numZ; ++z) {
+    const AngleDegs * az = map->getPointer<AngleDegs>(at, cells);
+    at += cells * sizeof(AngleDegs);
+    const AngleDegs * elev = map->getPointer<AngleDegs>(at, cells);
+    at += cells * sizeof(AngleDegs);
+    const LengthKMs * range = map->getPointer<LengthKMs>(at, cells);
+    at += cells * sizeof(LengthKMs);
+    llProjections[z] = std::make_shared<AzRanElevCache>(want.numX, want.numY, az, elev, range, map);
+  }
+  fLogInfo("Mapped projection cache {}", filename);
+  return true;
+} // FusionCache::readProjectionFile
+
 bool
 FusionCache::writeMaskFile(const std::string& name, const std::string& filefinal, const Bitset& mask)
 {
@@ -5,6 +5,7 @@
 #include "rVolumeValueResolver.h"
 #include "rLLHGridN2D.h"
 #include "rBitset.h"
+#include "rMemoryMappedFile.h"
 
 namespace rapio {
 /**  Use 8 bits for FusionKey, with a max value of 255.  This means our volume
@@ -19,23 +20,32 @@ typedef float FusionRangeCache;
 /** This cache stores sin and cos for a 2D grid.  The advantage here is that
  * calculating sin/cos is fairly slow.  We can reuse the math when doing things
  * like calculating range, etc. for converting from polar to grid.
+ * The values can either be owned by us or be a view into a memory mapped
+ * projection file, see FusionCache::readProjectionFile.
  */
 class SinCosLatLonCache
 {
 public:
   SinCosLatLonCache(size_t numX, size_t numY) :
-    myNumX(numX), myNumY(numY), mySinGcdIR(numX * numY), myCosGcdIR(numX * numY)
+    myNumX(numX), myNumY(numY), mySinGcdIR(numX * numY), myCosGcdIR(numX * numY),
+    mySinGcdIRPtr(mySinGcdIR.data()), myCosGcdIRPtr(myCosGcdIR.data())
+  { }
+
+  /** Create a read only view into memory we don't own, such as a mapped file */
+  SinCosLatLonCache(size_t numX, size_t numY, const double * sinGcdIR, const double * cosGcdIR,
+    std::shared_ptr<MemoryMappedFile> map) :
+    myNumX(numX), myNumY(numY), mySinGcdIRPtr(sinGcdIR), myCosGcdIRPtr(cosGcdIR), myMap(map)
   { }
 
   /** Access raw pointer of sin data for fast read thread-safe iteration */
   inline const double *
-  sinGcdIRData() const { return mySinGcdIR.data(); }
+  sinGcdIRData() const { return mySinGcdIRPtr; }
 
   /** Access raw pointer of cos data for fast read thread-safe iteration */
   inline const double *
-  cosGcdIRData() const { return myCosGcdIR.data(); }
+  cosGcdIRData() const { return myCosGcdIRPtr; }
 
-  /** Set at current position */
+  /** Set at current position.  Only for caches we own. */
   inline void
   set(size_t at, const double sinGcdIR, const double cosGcdIR)
   {
@@ -47,10 +57,14 @@ public:
   inline void
   get(size_t at, double& sinGcdIR, double& cosGcdIR)
   {
-    sinGcdIR = mySinGcdIR[at];
-    cosGcdIR = myCosGcdIR[at];
+    sinGcdIR = mySinGcdIRPtr[at];
+    cosGcdIR = myCosGcdIRPtr[at];
   }
 
+  /** Number of cells in the cache */
+  inline size_t
+  size() const { return myNumX * myNumY; }
+
 protected:
 
   /** The X size of our cache */
@@ -64,6 +78,15 @@ protected:
 
   /** Cached cos */
   std::vector<double> myCosGcdIR;
+
+  /** Read pointer to sin, ours or mapped */
+  const double * mySinGcdIRPtr;
+
+  /** Read pointer to cos, ours or mapped */
+  const double * myCosGcdIRPtr;
+
+  /** Mapped file we view into, if any */
+  std::shared_ptr<MemoryMappedFile> myMap;
 };
 
 /** This is the trick, the lightbulb combining Lak's big brain with my slightly smaller one.
@@ -88,9 +111,20 @@ public:
   AzRanElevCache(size_t numX, size_t numY) :
     myNumX(numX), myNumY(numY),
     myAzimuths(numX * numY), myVirtualElevations(numX * numY), myRanges(numX * numY),
+    myAzimuthsPtr(myAzimuths.data()), myVirtualElevationsPtr(myVirtualElevations.data()),
+    myRangesPtr(myRanges.data()),
     myAt(0)
   { }
 
+  /** Create a read only view into memory we don't own, such as a mapped file */
+  AzRanElevCache(size_t numX, size_t numY,
+    const AngleDegs * azimuths, const AngleDegs * elevations, const LengthKMs * ranges,
+    std::shared_ptr<MemoryMappedFile> map) :
+    myNumX(numX), myNumY(numY),
+    myAzimuthsPtr(azimuths), myVirtualElevationsPtr(elevations), myRangesPtr(ranges),
+    myMap(map), myAt(0)
+  { }
+
   /** Reset iterator functions */
   inline void
   reset()
@@ -105,7 +139,7 @@ public:
     myAt++;
   }
 
-  /** Store cache lookup at current position */
+  /** Store cache lookup at current position.  Only for caches we own. */
   inline void
   setAt(const AngleDegs inAzDegs, const AngleDegs inElevDegs, const LengthKMs inRanges)
   {
@@ -118,23 +152,39 @@ public:
   inline void
   getAzDegsAt(AngleDegs& outAzDegs)
   {
-    outAzDegs = myAzimuths[myAt];
+    outAzDegs = myAzimuthsPtr[myAt];
   }
 
   /** Get Elev degrees at current position */
   inline void
   getElevDegsAt(AngleDegs& outElevDegs)
   {
-    outElevDegs = myVirtualElevations[myAt];
+    outElevDegs = myVirtualElevationsPtr[myAt];
   }
 
   /** Get Range KMs at current position */
   inline void
   getRangeKMsAt(LengthKMs& outRanges)
   {
-    outRanges = myRanges[myAt];
+    outRanges = myRangesPtr[myAt];
   }
 
+  /** Access raw pointer of azimuth data */
+  inline const AngleDegs *
+  azimuthData() const { return myAzimuthsPtr; }
+
+  /** Access raw pointer of virtual elevation data */
+  inline const AngleDegs *
+  elevationData() const { return myVirtualElevationsPtr; }
+
+  /** Access raw pointer of range data */
+  inline const LengthKMs *
+  rangeData() const { return myRangesPtr; }
+
+  /** Number of cells in the cache */
+  inline size_t
+  size() const { return myNumX * myNumY; }
+
 protected:
 
   /** The X size of our cache */
@@ -153,6 +203,18 @@ protected:
   /** Cached range kilometers for each cell */
   std::vector<LengthKMs> myRanges;
 
+  /** Read pointer to azimuths, ours or mapped */
+  const AngleDegs * myAzimuthsPtr;
+
+  /** Read pointer to virtual elevations, ours or mapped */
+  const AngleDegs * myVirtualElevationsPtr;
+
+  /** Read pointer to ranges, ours or mapped */
+  const LengthKMs * myRangesPtr;
+
+  /** Mapped file we view into, if any */
+  std::shared_ptr<MemoryMappedFile> myMap;
+
   /** Current location for raw iteration */
   size_t myAt;
 };
@@ -293,6 +355,20 @@ public:
     return getFilename(name, "mask", ".mask", grid, directory);
   }
 
+  /** Get the projection cache filename for a radar.  Projection files
+   * live in their own folder since they can be large. */
+  static std::string
+  getProjectionFilename(const std::string& folder, const std::string& name,
+    const LLCoverageArea& fullGrid, std::string& directory)
+  {
+    directory = folder;
+    if (!Strings::endsWith(directory, "/")) {
+      directory += "/";
+    }
+    directory += "GRID_" + fullGrid.getParseUniqueString() + "/projection/";
+    return (name + ".proj");
+  }
+
   /** Set the base directory used for rostering */
   static void
   setRosterDir(const std::string& folder);
@@ -304,11 +380,24 @@ public:
   static bool
   writeRangeFile(const std::string& filename, LLCoverageArea& outg,
     std::vector<std::shared_ptr<AzRanElevCache> >& myLLProjections,
-    LengthKMs maxRangeKMs);
+    LengthKMs maxRangeKMs, LengthKMs resolutionKMs = DEFAULT_RANGE_RESOLUTION_KMS);
+
+  /** Write ranges of a radar subgrid to a binary file.
+   * Ranges are stored as 16 bit steps of resolutionKMs, and only the box
+   * of cells within maxRangeKMs is kept, as runs of covered cells per row.
+   * If the file already holds the same content it's only touched, so
+   * the roster still sees the source as active.
+   */
+  static bool
+  writeRangeFile(const std::string& filename,
+    size_t startX, size_t startY, size_t numX, size_t numY,
+    const std::vector<FusionRangeCache>& ranges,
+    LengthKMs maxRangeKMs, LengthKMs resolutionKMs = DEFAULT_RANGE_RESOLUTION_KMS);
 
   /** Read ranges from a binary file.
    * Range files are read by roster in order to do the nearest
-   * active neighbor calculation.
+   * active neighbor calculation.  Cells the source doesn't cover
+   * are the max float, so they're never nearest.
    */
   static bool
   readRangeFile(const std::string& filename,
@@ -316,6 +405,14 @@ public:
     size_t& numX, size_t& numY,
     std::vector<FusionRangeCache>& output);
 
+  /** Read just the content checksum of a range file.
+   * @return false if the file is missing or not a range file. */
+  static bool
+  readRangeChecksum(const std::string& filename, uint64_t& checksum);
+
+  /** Default quantization of stored ranges, 25 meters */
+  static constexpr LengthKMs DEFAULT_RANGE_RESOLUTION_KMS = 0.025;
+
   /** Write mask to a binary file.
    * Masks are 1 and 0 small files, written by roster after the
    * nearest active neighbor calculation.  There is one written
@@ -332,6 +429,30 @@ public:
   static bool
   readMaskFile(const std::string& filename, Bitset& mask);
 
+  /** Write the sin/cos and az/range/elev projection caches of a radar to a
+   * binary file.  The file has a versioned header of everything the
+   * projection depends on, followed by the raw arrays aligned so they can
+   * be used directly from a memory mapping.
+   */
+  static bool
+  writeProjectionFile(const std::string& filename,
+    AngleDegs cLat, AngleDegs cLon, LengthKMs cHeight,
+    const LLCoverageArea& grid,
+    const SinCosLatLonCache& sinCos,
+    const std::vector<std::shared_ptr<AzRanElevCache> >& llProjections);
+
+  /** Memory map a projection file written by writeProjectionFile.  The
+   * caches created are views into the mapping, so they are shared between
+   * processes using the same file.
+   * @return false if the file is missing or doesn't match the given radar/grid.
+   */
+  static bool
+  readProjectionFile(const std::string& filename,
+    AngleDegs cLat, AngleDegs cLon, LengthKMs cHeight,
+    const LLCoverageArea& grid,
+    std::shared_ptr<SinCosLatLonCache>& sinCos,
+    std::vector<std::shared_ptr<AzRanElevCache> >& llProjections);
+
   /** The base directory used for rostering */
   static std::string theRosterDir;
 };
@@ -1,9 +1,112 @@
 #include "rFusionDatabase.h"
 #include "rProcessTimer.h"
 #include "rArith.h"
+#include "rOS.h"
+
+#include <fstream>
+#include <cstring>
 
 using namespace rapio;
 
+namespace {
+/** Snapshot magic, bump the version on any layout change */
+const char SNAPSHOT_MAGIC[8]    = { 'R', 'A', 'P', 'I', 'O', 'S', '2', 'S' };
+const uint32_t SNAPSHOT_VERSION = 1;
+
+/** Header of a snapshot file.  Sources follow, then the checksum of
+ * everything after the header. */
+struct SnapshotHeader {
+  char     magic[8];
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t numX;
+  uint64_t numY;
+  uint64_t numZ;
+  int64_t  time;
+  uint64_t sources;
+};
+
+/** Writes values to a stream, keeping a FNV-1a checksum */
+class SnapshotOut {
+public:
+  SnapshotOut(std::ostream& o) : myOut(o), mySum(14695981039346656037ULL){ }
+
+  /** Write raw bytes */
+  void
+  write(const void * data, size_t bytes)
+  {
+    const unsigned char * c = static_cast<const unsigned char *>(data);
+
+    for (size_t i = 0; i < bytes; ++i) {
+      mySum ^= c[i];
+      mySum *= 1099511628211ULL;
+    }
+    myOut.write(static_cast<const char *>(data), bytes);
+  }
+
+  /** Write a single value */
+  template <typename T>
+  void
+  put(const T& v){ write(&v, sizeof(T)); }
+
+  /** Write a column of values, the size is written separately */
+  template <typename T>
+  void
+  putArray(const std::vector<T>& v){ write(v.data(), v.size() * sizeof(T)); }
+
+  std::ostream& myOut;
+  uint64_t mySum;
+};
+
+/** Reads values from a stream, keeping a FNV-1a checksum */
+class SnapshotIn {
+public:
+  SnapshotIn(std::istream& i) : myIn(i), mySum(14695981039346656037ULL){ }
+
+  /** Read raw bytes */
+  bool
+  read(void * data, size_t bytes)
+  {
+    myIn.read(static_cast<char *>(data), bytes);
+    if (!myIn) { return false; }
+    const unsigned char * c = static_cast<const unsigned char *>(data);
+
+    for (size_t i = 0; i < bytes; ++i) {
+      mySum ^= c[i];
+      mySum *= 1099511628211ULL;
+    }
+    return true;
+  }
+
+  /** Read a single value */
+  template <typename T>
+  bool
+  get(T& v){ return read(&v, sizeof(T)); }
+
+  /** Read a column of count values */
+  template <typename T>
+  bool
+  getArray(std::vector<T>& v, size_t count)
+  {
+    v.resize(count);
+    return read(v.data(), count * sizeof(T));
+  }
+
+  std::istream& myIn;
+  uint64_t mySum;
+};
+
+/** Largest count we'll believe in a snapshot, guards allocation on a bad file */
+const uint64_t SNAPSHOT_MAX_COUNT = 1ULL << 34;
+}
+
+FusionDatabase::~FusionDatabase()
+{
+  if (mySnapshotThread.joinable()) {
+    mySnapshotThread.join();
+  }
+}
+
 void
 FusionDatabase::ingestNewData(Stage2Data& data, time_t cutoff, size_t& missingcounter, size_t& points, size_t& total)
 {
@@ -29,10 +132,12 @@ FusionDatabase::ingestNewData(Stage2Data& data, time_t cutoff, size_t& missingco
   // Could store shorts and then do a move forward pass in output
   const time_t t = radar.myTime.getSecondsSinceEpoch();
 
-  // Get a brand new source list
+  // Get a brand new source list, with times relative to this ingest
   auto newSourcePtr = getNewSourceList("newone");
   auto& newSource   = *newSourcePtr;
 
+  newSource.setEpoch(t);
+
   // Read the source list, marking x,y,z found
   myHaves.clearAllBits();
 
@@ -74,212 +179,282 @@ FusionDatabase::ingestNewData(Stage2Data& data, time_t cutoff, size_t& missingco
   }
 } // FusionDatabase::ingestNewData
 
+void
+FusionMergeTask::execute()
+{
+  if (myMax) {
+    myDatabase->maxLayer(*myOutput, myZ, myCutoff, myOffsetX, myOffsetY, myPrecision);
+  } else {
+    myDatabase->mergeLayer(*myOutput, myZ, myCutoff, myOffsetX, myOffsetY, myPrecision);
+  }
+  markDone();
+}
+
+void
+FusionDatabase::setThreadCount(size_t threads)
+{
+  threads = std::min(threads, myNumZ);
+  if (threads > 1) {
+    fLogInfo("Merging height layers using {} threads.", threads);
+    myThreads = std::make_shared<ThreadGroup>(threads, myNumZ);
+  } else {
+    myThreads = nullptr;
+  }
+}
+
+void
+FusionDatabase::mergeLayers(std::shared_ptr<LLHGridN2D> cache, bool max, const time_t cutoff,
+  size_t offsetX, size_t offsetY, float precision)
+{
+  cache->fillPrimary(Constants::DataUnavailable);
+
+  const size_t gridZ = cache->getNumLayers();
+
+  // Serial, each layer in order
+  if (myThreads == nullptr) {
+    for (size_t z = 0; z < gridZ; z++) {
+      auto output = cache->get(z);
+      if (max) {
+        maxLayer(*output, z, cutoff, offsetX, offsetY, precision);
+      } else {
+        mergeLayer(*output, z, cutoff, offsetX, offsetY, precision);
+      }
+    }
+    return;
+  }
+
+  // Each layer writes only to its own grid, so there's nothing to lock.
+  // Layers are already created by fillPrimary above, so get() won't create.
+  std::vector<std::shared_ptr<FusionMergeTask> > tasks;
+
+  for (size_t z = 0; z < gridZ; z++) {
+    auto task = std::make_shared<FusionMergeTask>(this, max, cache->get(z), z, cutoff, offsetX, offsetY, precision);
+    tasks.push_back(task);
+    while (!myThreads->enqueueThreadTask(task)) {
+      std::this_thread::yield();
+    }
+  }
+  for (auto& t:tasks) {
+    t->waitUntilDone();
+  }
+} // FusionDatabase::mergeLayers
+
 void
 FusionDatabase::mergeTo(std::shared_ptr<LLHGridN2D> cache, const time_t cutoff, size_t offsetX, size_t offsetY,
   float precision)
 {
   ProcessTimer test("Merging XYZ tree");
 
-  cache->fillPrimary(Constants::DataUnavailable);
+  mergeLayers(cache, false, cutoff, offsetX, offsetY, precision);
+
+  fLogInfo("{}", test);
+}
+
+void
+FusionDatabase::maxTo(std::shared_ptr<LLHGridN2D> cache, const time_t cutoff, size_t offsetX, size_t offsetY,
+  float precision)
+{
+  ProcessTimer test("Maxing XYZ tree");
+
+  mergeLayers(cache, true, cutoff, offsetX, offsetY, precision);
+
+  fLogInfo("{}", test);
+}
 
-  // Use the coordinates of the cache in case it's a subgrid/tile
+void
+FusionDatabase::mergeLayer(LatLonGrid& output, size_t z, const time_t cutoff, size_t offsetX, size_t offsetY,
+  float precision)
+{
+  // Use the coordinates of the layer in case it's a subgrid/tile
   // and not a full grid
-  const size_t gridZ = cache->getNumLayers();
-  const size_t gridY = cache->getNumLats(); // dim 0
-  const size_t gridX = cache->getNumLons(); // dim 1
+  const size_t gridY = output.getNumLats(); // dim 0
+  const size_t gridX = output.getNumLons(); // dim 1
+
+  // Observations are checked against the full grid on ingest, so a
+  // tile covering the full grid doesn't need to clip each one
+  const bool clip = !((offsetX == 0) && (offsetY == 0) && (gridX >= myNumX) && (gridY >= myNumY));
 
   // -------------------------------------------------------------
   // Accumulation pass...add up all numerators and denominators
   // of a weighted average sum.  Parts of which were generated by
   // multiple rFusion1 algorithms.
 
-  // We'll still order by z, since we'll probably thread around it
-  for (size_t z = 0; z < gridZ; z++) {
-    std::shared_ptr<LatLonGrid> output = cache->get(z);
-
-    // Accumulate 2D weights
-    auto w = output->getFloat2D("weights");
-    w->fill(0);
-    auto& wa = output->getFloat2DRef("weights");
-
-    // Accumulate 2D masks (when storing per radar).
-    // auto m = output->getByte2D("masks");
-    // m->fill(0);
-    // auto& ma = output->getByte2DRef("masks");
-
-    // Accumulate 2D values (borrow final output to save RAM)
-    auto gridtestP = output->getFloat2D();
-    gridtestP->fill(0);
-    auto& gridtest = output->getFloat2DRef();
-
-    // Here's the genius, we don't care about x,y,z ordering...we accumulate
-    // the weights and values randomly...
-    for (auto it = myObservationManager.begin(); it != myObservationManager.end(); ++it) {
-      auto &r = *(it->second);
-
-      // Missing observations just set the mask flag (background)
-      // for (auto& m:r.myAMObs[z]) {
-      //  ma[m.y][m.x] = 1;
-      // }
-
-      // Value observations accumulate values and weights
-      for (auto& v:r.myAObs[z]) {
+  // Accumulate 2D weights
+  auto w = output.getFloat2D("weights");
+
+  w->fill(0);
+  auto& wa = output.getFloat2DRef("weights");
+
+  // Accumulate 2D values (borrow final output to save RAM)
+  auto gridtestP = output.getFloat2D();
+
+  gridtestP->fill(0);
+  auto& gridtest = output.getFloat2DRef();
+
+  // Here's the genius, we don't care about x,y,z ordering...we accumulate
+  // the weights and values randomly...
+  for (auto it = myObservationManager.begin(); it != myObservationManager.end(); ++it) {
+    auto &r = *(it->second);
+
+    // Value observations accumulate values and weights
+    auto& obs         = r.myAObs[z];
+    const size_t size = obs.size();
+    const short * xs  = obs.myX.data();
+    const short * ys  = obs.myY.data();
+    const float * vs  = obs.myV.data();
+    const float * ws  = obs.myW.data();
+
+    if (clip) {
+      for (size_t i = 0; i < size; ++i) {
         // Since we can be a tile/partition, shifts global to partition coordinates
         // atX and atY are local coordinates in the partition
         // So we clip global to the area we cover
-        const int atX = v.x - offsetX;
-        const int atY = v.y - offsetY;
+        const int atX = xs[i] - offsetX;
+        const int atY = ys[i] - offsetY;
         if ((atX < 0) || (atY < 0) || (atX >= gridX) || (atY >= gridY)) {
           continue;
         }
-        gridtest[atY][atX] += v.v;
-        wa[atY][atX]       += v.w;
+        gridtest[atY][atX] += vs[i];
+        wa[atY][atX]       += ws[i];
+      }
+    } else {
+      for (size_t i = 0; i < size; ++i) {
+        gridtest[ys[i]][xs[i]] += vs[i];
+        wa[ys[i]][xs[i]]       += ws[i];
       }
     }
   }
 
   // -------------------------------------------------------------
-  // Finialization pass, divide all values/weights and handle mask
-  for (size_t z = 0; z < gridZ; z++) {
-    std::shared_ptr<LatLonGrid> output = cache->get(z);
-    auto& wa = output->getFloat2DRef("weights");
-    // auto& ma       = output->getByte2DRef("masks");
-    auto& gridtest = output->getFloat2DRef();
+  // Finialization pass, divide all values/weights
+  for (size_t y = 0; y < gridY; y++) {
     for (size_t x = 0; x < gridX; x++) { // x currently LON for stage2 right..so xy swapped
-      for (size_t y = 0; y < gridY; y++) {
-        auto& v = gridtest[y][x];
-        auto& w = wa[y][x];
-
-        if (w == 0) { // If no values hit (weight should be 0 from the init)
-          // Use the missing flag array....
-          // if (ma[y][x] > 0) {
-          // FIXME: Feel like with some ordering could skip the indexing calculation
-          // Missing here is global and we're locally scanning the tile.
-          // I'm assuming tile is not bigger than the global CONUS here
-          const size_t globalX = offsetX + x;
-          const size_t globalY = offsetY + y;
-          if (myMissings[myHaves.getIndex3D(globalX, globalY, z)] >= cutoff) {
-            v = Constants::MissingData;
-          } else {
-            v = Constants::DataUnavailable;
-          }
-          continue;
-        }
+      auto& v = gridtest[y][x];
+      auto& w = wa[y][x];
 
-        // So we have weights, values....divide them to get total
-        v /= w;
-        if (precision > 0) {
-          v = Arith::roundOff(v, precision);
-        }
+      if (w == 0) { // If no values hit (weight should be 0 from the init)
+        v = Constants::DataUnavailable;
+        continue;
+      }
+
+      // So we have weights, values....divide them to get total
+      v /= w;
+      if (precision > 0) {
+        v = Arith::roundOff(v, precision);
       }
     }
   }
 
-  fLogInfo("{}", test);
-} // FusionDatabase::mergeTo
+  // Missing background where nothing hit
+  fillBackground(output, z, cutoff, offsetX, offsetY);
+} // FusionDatabase::mergeLayer
 
 void
-FusionDatabase::maxTo(std::shared_ptr<LLHGridN2D> cache, const time_t cutoff, size_t offsetX, size_t offsetY,
+FusionDatabase::maxLayer(LatLonGrid& output, size_t z, const time_t cutoff, size_t offsetX, size_t offsetY,
   float precision)
 {
-  // FIXME: Maybe combine common code or something with the mergeTo..though it might
+  // FIXME: Maybe combine common code or something with the mergeLayer..though it might
   // slow things doing that.
-  //
-  ProcessTimer test("Maxing XYZ tree");
-
-  cache->fillPrimary(Constants::DataUnavailable);
-
-  // Use the coordinates of the cache in case it's a subgrid/tile
-  // and not a full grid
-  const size_t gridZ = cache->getNumLayers();
-  const size_t gridY = cache->getNumLats(); // dim 0
-  const size_t gridX = cache->getNumLons(); // dim 1
+  const size_t gridY = output.getNumLats(); // dim 0
+  const size_t gridX = output.getNumLons(); // dim 1
 
   // -------------------------------------------------------------
   // Max pass, gather maximum values in each hit cell
 
-  // We'll still order by z, since we'll probably thread around it
-  for (size_t z = 0; z < gridZ; z++) {
-    std::shared_ptr<LatLonGrid> output = cache->get(z);
+  // Use weight as a 'hit' marker here
+  auto w = output.getFloat2D("weights");
 
-    // Use weight as a 'hit' marker here
-    auto w = output->getFloat2D("weights");
-    w->fill(0);
-    auto& wa = output->getFloat2DRef("weights");
+  w->fill(0);
+  auto& wa = output.getFloat2DRef("weights");
 
-    // Max values (borrow final output to save RAM)
-    auto gridtestP = output->getFloat2D();
-    gridtestP->fill(0);
-    auto& gridtest = output->getFloat2DRef();
+  // Max values (borrow final output to save RAM)
+  auto gridtestP = output.getFloat2D();
 
-    // Here's the genius, we don't care about x,y,z ordering...we accumulate
-    // the weights and values randomly...
-    for (auto it = myObservationManager.begin(); it != myObservationManager.end(); ++it) {
-      auto &r = *(it->second);
+  gridtestP->fill(0);
+  auto& gridtest = output.getFloat2DRef();
 
-      // Value observations accumulate values and weights
-      for (auto& v:r.myAObs[z]) {
-        // Since we can be a tile/partition, shifts global to partition coordinates
-        // atX and atY are local coordinates in the partition
-        // So we clip global to the area we cover
-        const int atX = v.x - offsetX;
-        const int atY = v.y - offsetY;
-        if ((atX < 0) || (atY < 0) || (atX >= gridX) || (atY >= gridY)) {
-          continue;
-        }
-        /// --------------------------------------------
-        // Max logic code
-        // Use weight as a 'hit' marker and just keep the max value
-        //
-        auto& hit     = wa[atY][atX];
-        auto& vref    = gridtest[atY][atX];
-        const auto rv = v.v / v.w; // Resolve value/weight to true value
-        if (hit > 0) {             // if already have a value, replace with max...
-          vref = (rv > vref) ? rv : vref;
-        } else { // ..otherwise use the first one (to avoid caring about background 0)
-          vref = rv;
-        }
-        if (precision > 0) {
-          vref = Arith::roundOff(vref, precision);
-        }
-        hit = 1;
-        /// --------------------------------------------
+  for (auto it = myObservationManager.begin(); it != myObservationManager.end(); ++it) {
+    auto &r = *(it->second);
+
+    auto& obs = r.myAObs[z];
+
+    for (size_t i = 0; i < obs.size(); ++i) {
+      // Since we can be a tile/partition, shifts global to partition coordinates
+      // atX and atY are local coordinates in the partition
+      // So we clip global to the area we cover
+      const int atX = obs.myX[i] - offsetX;
+      const int atY = obs.myY[i] - offsetY;
+      if ((atX < 0) || (atY < 0) || (atX >= gridX) || (atY >= gridY)) {
+        continue;
+      }
+      /// --------------------------------------------
+      // Max logic code
+      // Use weight as a 'hit' marker and just keep the max value
+      //
+      auto& hit     = wa[atY][atX];
+      auto& vref    = gridtest[atY][atX];
+      const auto rv = obs.myV[i] / obs.myW[i]; // Resolve value/weight to true value
+      if (hit > 0) {             // if already have a value, replace with max...
+        vref = (rv > vref) ? rv : vref;
+      } else { // ..otherwise use the first one (to avoid caring about background 0)
+        vref = rv;
+      }
+      if (precision > 0) {
+        vref = Arith::roundOff(vref, precision);
       }
+      hit = 1;
+      /// --------------------------------------------
     }
   }
 
   // -------------------------------------------------------------
-  // Finialization pass, handle mask
-  for (size_t z = 0; z < gridZ; z++) {
-    std::shared_ptr<LatLonGrid> output = cache->get(z);
-    auto& wa       = output->getFloat2DRef("weights");
-    auto& gridtest = output->getFloat2DRef();
+  // Finialization pass, no hit in the cell is unavailable...
+  for (size_t y = 0; y < gridY; y++) {
     for (size_t x = 0; x < gridX; x++) { // x currently LON for stage2 right..so xy swapped
-      for (size_t y = 0; y < gridY; y++) {
-        auto& hit = wa[y][x];
-
-        // if no hit in the cell...use the mask field
-        // FIXME: Generically maybe we prefill with mask values before the 'alg' we're doing.
-        // though this could be slightly slower for hit cells.
-        // prefill would allow use to share this code with mergeTo above
-        // and avoid the hit or weight checks
-        if (hit < 1) {
-          auto& vref = gridtest[y][x];
-          const size_t globalX = offsetX + x;
-          const size_t globalY = offsetY + y;
-          if (myMissings[myHaves.getIndex3D(globalX, globalY, z)] >= cutoff) {
-            vref = Constants::MissingData;
-          } else {
-            vref = Constants::DataUnavailable;
-          }
-          continue;
-        }
+      if (wa[y][x] < 1) {
+        gridtest[y][x] = Constants::DataUnavailable;
       }
     }
   }
 
-  fLogInfo("{}", test);
-} // FusionDatabase::mergeTo
+  // ...unless there's missing background
+  fillBackground(output, z, cutoff, offsetX, offsetY);
+} // FusionDatabase::maxLayer
+
+void
+FusionDatabase::fillBackground(LatLonGrid& output, size_t z, const time_t cutoff, size_t offsetX, size_t offsetY)
+{
+  const int gridY = output.getNumLats(); // dim 0
+  const int gridX = output.getNumLons(); // dim 1
+  auto& wa        = output.getFloat2DRef("weights");
+  auto& gridtest  = output.getFloat2DRef();
+
+  // Any time valid missing run from any source marks unhit cells as missing.
+  // Painting is order independent, so this matches a per cell latest time.
+  for (auto it = myObservationManager.begin(); it != myObservationManager.end(); ++it) {
+    auto &r = *(it->second);
+    auto& m = r.myAMObs[z];
+    const FusionTimeOffset c = r.toOffset(cutoff);
+
+    for (size_t i = 0; i < m.size(); ++i) {
+      if (m.myT[i] < c) {
+        continue;
+      }
+      // Clip the run to the tile
+      const int atY = m.myY[i] - (int) offsetY;
+      if ((atY < 0) || (atY >= gridY)) {
+        continue;
+      }
+      const int startX = std::max(0, m.myX[i] - (int) offsetX);
+      const int endX   = std::min(gridX, m.myX[i] + m.myL[i] - (int) offsetX);
+      for (int x = startX; x < endX; ++x) {
+        if (wa[atY][x] == 0) {
+          gridtest[atY][x] = Constants::MissingData;
+        }
+      }
+    }
+  }
+} // FusionDatabase::fillBackground
 
 void
 FusionDatabase::timePurge(Time atTime, TimeDuration d)
@@ -290,10 +465,245 @@ FusionDatabase::timePurge(Time atTime, TimeDuration d)
 
   // For each source, purge times...
   for (auto it = myObservationManager.begin(); it != myObservationManager.end(); ++it) {
-    it->second->timePurge(cutoff);
+    if (!it->second->hasExpired(cutoff)) {
+      continue;
+    }
+    // A snapshot being written still holds this list, so replace it with
+    // a copy of just what we keep
+    if (it->second.use_count() > 1) {
+      it->second = it->second->purgedCopy(cutoff);
+    } else {
+      it->second->timePurge(cutoff);
+    }
   }
 } // FusionDatabase::timePurge
 
+bool
+FusionDatabase::writeSnapshot(const std::string& filename, const Time& at)
+{
+  if (mySnapshotThread.joinable()) {
+    // Don't stall ingest waiting on a slow disk
+    if (mySnapshotBusy) {
+      return false;
+    }
+    mySnapshotThread.join();
+  }
+
+  // Hold the current lists.  Ingest replaces lists and a purge copies any
+  // we hold, so these don't change under the writer.  The latest time is
+  // updated in place, so we copy it now.
+  std::vector<std::shared_ptr<SourceList> > sources;
+  std::vector<Time> times;
+
+  for (auto it = myObservationManager.begin(); it != myObservationManager.end(); ++it) {
+    sources.push_back(it->second);
+    times.push_back(it->second->myTime);
+  }
+
+  mySnapshotGood   = false;
+  mySnapshotBusy   = true;
+  mySnapshotThread = std::thread([this, filename, at, sources, times](){
+      mySnapshotGood = writeSnapshotFile(filename, at, sources, times);
+      mySnapshotBusy = false;
+    });
+  return true;
+}
+
+bool
+FusionDatabase::waitForSnapshot()
+{
+  if (mySnapshotThread.joinable()) {
+    mySnapshotThread.join();
+  }
+  return mySnapshotGood;
+}
+
+bool
+FusionDatabase::writeSnapshotFile(const std::string& filename, const Time& at,
+  const std::vector<std::shared_ptr<SourceList> >& sources,
+  const std::vector<Time>& times)
+{
+  ProcessTimer timer("Writing snapshot");
+
+  // Temp next to the final file so the move is a rename
+  const std::string tmp = filename + ".tmp";
+  std::ofstream outFile(tmp, std::ios::binary);
+
+  if (!outFile.is_open()) {
+    fLogSevere("Can't write snapshot tmp file: {}", tmp);
+    return false;
+  }
+
+  SnapshotHeader h;
+
+  std::memset(&h, 0, sizeof(h));
+  std::memcpy(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic));
+  h.version = SNAPSHOT_VERSION;
+  h.numX    = myNumX;
+  h.numY    = myNumY;
+  h.numZ    = myNumZ;
+  h.time    = at.getSecondsSinceEpoch();
+  h.sources = sources.size();
+  outFile.write(reinterpret_cast<const char *>(&h), sizeof(h));
+
+  SnapshotOut out(outFile);
+  size_t values = 0, missings = 0;
+
+  for (size_t s = 0; s < sources.size(); ++s) {
+    const SourceList& r = *sources[s];
+    out.put<uint32_t>(r.myName.size());
+    out.write(r.myName.data(), r.myName.size());
+    out.put<uint16_t>(r.myID);
+    out.put<int64_t>(times[s].getSecondsSinceEpoch());
+    out.put<double>(times[s].getFractional());
+    out.put<int64_t>(r.myEpoch);
+    out.put<uint64_t>(r.myLevels);
+    for (size_t z = 0; z < r.myLevels; ++z) {
+      auto& v = r.myAObs[z];
+      out.put<uint64_t>(v.size());
+      out.putArray(v.myX);
+      out.putArray(v.myY);
+      out.putArray(v.myT);
+      out.putArray(v.myV);
+      out.putArray(v.myW);
+      auto& m = r.myAMObs[z];
+      out.put<uint64_t>(m.size());
+      out.putArray(m.myX);
+      out.putArray(m.myY);
+      out.putArray(m.myL);
+      out.putArray(m.myT);
+      values   += v.size();
+      missings += m.size();
+    }
+  }
+  const uint64_t sum = out.mySum;
+
+  outFile.write(reinterpret_cast<const char *>(&sum), sizeof(sum));
+
+  if (!outFile) {
+    fLogSevere("Couldn't write snapshot {}", tmp);
+    outFile.close();
+    OS::deleteFile(tmp);
+    return false;
+  }
+  outFile.close();
+
+  // Keep the last good one in case we crash between the moves
+  if (OS::isRegularFile(filename)) {
+    OS::moveFile(filename, filename + ".prev", true);
+  }
+  if (!OS::moveFile(tmp, filename, true)) {
+    fLogSevere("Couldn't move snapshot {} to {}", tmp, filename);
+    OS::deleteFile(tmp);
+    return false;
+  }
+  fLogInfo("Wrote snapshot {} with {} sources, {} v. {} m. {}", filename, sources.size(),
+    values, missings, timer);
+  return true;
+} // FusionDatabase::writeSnapshotFile
+
+bool
+FusionDatabase::readSnapshotFile(const std::string& filename, Time& at,
+  std::vector<std::shared_ptr<SourceList> >& sources)
+{
+  std::ifstream inFile(filename, std::ios::binary);
+
+  if (!inFile) {
+    return false;
+  }
+  SnapshotHeader h;
+
+  inFile.read(reinterpret_cast<char *>(&h), sizeof(h));
+  if (!inFile || (std::memcmp(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic)) != 0) ||
+    (h.version != SNAPSHOT_VERSION))
+  {
+    fLogSevere("Snapshot {} isn't a version {} snapshot.", filename, SNAPSHOT_VERSION);
+    return false;
+  }
+  if ((h.numX != myNumX) || (h.numY != myNumY) || (h.numZ != myNumZ)) {
+    fLogSevere("Snapshot {} is for a {}x{}x{} grid, not ours.", filename, h.numX, h.numY, h.numZ);
+    return false;
+  }
+
+  SnapshotIn in(inFile);
+
+  sources.clear();
+  try{
+    for (size_t s = 0; s < h.sources; ++s) {
+      uint32_t length;
+      uint16_t id;
+      int64_t time, epoch;
+      double fractional;
+      uint64_t levels;
+      if (!in.get(length) || (length > 1024)) { return false; }
+      std::string name(length, ' ');
+      if (!in.read(&name[0], length) || !in.get(id) || !in.get(time) || !in.get(fractional) ||
+        !in.get(epoch) ||
+        !in.get(levels) || (levels > 256))
+      {
+        return false;
+      }
+      auto r = std::make_shared<SourceList>(name, id, levels);
+      r->myTime  = Time::SecondsSinceEpoch(time, fractional);
+      r->myEpoch = epoch;
+      for (size_t z = 0; z < levels; ++z) {
+        uint64_t count;
+        auto& v = r->myAObs[z];
+        if (!in.get(count) || (count > SNAPSHOT_MAX_COUNT) ||
+          !in.getArray(v.myX, count) || !in.getArray(v.myY, count) || !in.getArray(v.myT, count) ||
+          !in.getArray(v.myV, count) || !in.getArray(v.myW, count))
+        {
+          return false;
+        }
+        auto& m = r->myAMObs[z];
+        if (!in.get(count) || (count > SNAPSHOT_MAX_COUNT) ||
+          !in.getArray(m.myX, count) || !in.getArray(m.myY, count) ||
+          !in.getArray(m.myL, count) || !in.getArray(m.myT, count))
+        {
+          return false;
+        }
+      }
+      r->scanTimes();
+      sources.push_back(r);
+    }
+  }catch (const std::bad_alloc& e) {
+    fLogSevere("Out of memory reading snapshot {}", filename);
+    return false;
+  }
+
+  // A crash mid write or a bad disk shows up here
+  const uint64_t expected = in.mySum;
+  uint64_t sum;
+
+  inFile.read(reinterpret_cast<char *>(&sum), sizeof(sum));
+  if (!inFile || (sum != expected)) {
+    fLogSevere("Snapshot {} failed its checksum.", filename);
+    return false;
+  }
+  at = Time::SecondsSinceEpoch(h.time);
+  return true;
+} // FusionDatabase::readSnapshotFile
+
+bool
+FusionDatabase::readSnapshot(const std::string& filename, Time& at)
+{
+  ProcessTimer timer("Reading snapshot");
+  std::vector<std::shared_ptr<SourceList> > sources;
+
+  for (auto& f: { filename, filename + ".prev" }) {
+    if (!readSnapshotFile(f, at, sources)) {
+      continue;
+    }
+    myObservationManager.clear();
+    for (auto& r:sources) {
+      myObservationManager.restore(r);
+    }
+    fLogInfo("Restored {} sources from snapshot {} taken at {}. {}", sources.size(), f, at, timer);
+    return true;
+  }
+  return false;
+}
+
 // SourceList&
 std::shared_ptr<SourceList>
 FusionDatabase::getSourceList(const std::string& name)
@@ -315,27 +725,17 @@ FusionDatabase::addObservation(SourceList& list, float v, float w, size_t x, siz
 void
 FusionDatabase::addMissing(SourceList& list, size_t x, size_t y, size_t z, time_t t, bool dataNoMissingSet)
 {
-  // -----------------------------------------
-  // add to the source missing list
-  //  list.addMissing(x, y, z, t);
-  //  FIXME: So we're not using per source missing anyway now, so
-  //  we could probably deprecate/delete anything with that.
-
-  size_t i = myHaves.getIndex3D(x, y, z);
-
   // If no missing set, then we only use missing to update the have array.  This means any old
   // data in that location won't be added back into the new data, expiring it basically.
-  // However, by not adding to myMissings, no missing background will show.
+  // However, by not adding to missing runs, no missing background will show.
   if (!dataNoMissingSet) {
-    // Add to global missing array mask
-    if (myMissings[i] < t) { // Always update to latest time from all
-      myMissings[i] = t;
-    }
+    // Missing comes in as expanded runs, so this joins them back together
+    list.addMissing(x, y, z, t);
   }
 
   // Mark that we have this point
-  // myHaves.set13D(x, y, z); // still 'expire' old valid values replaced by missing now (moving storm)
-  myHaves.set1(i); // still 'expire' old valid values replaced by missing now (moving storm)
+  // still 'expire' old valid values replaced by missing now (moving storm)
+  myHaves.set13D(x, y, z);
 }
 
 void
@@ -412,8 +812,8 @@ FusionDatabase::dumpSources()
     mcounter += numMObs;
 
     // Size is the actual capacity of vector
-    sizeCounter += (numObsCap * (sizeof(VObservation)));
-    sizeCounter += (numMObsCap * (sizeof(MObservation)));
+    sizeCounter += (numObsCap * VObservations::BYTES);
+    sizeCounter += (numMObsCap * MObservations::BYTES);
 
     // Different in stored vs allocated 'should' be minor but checking
     obsDelta += (numObsCap - numObs);
@@ -3,6 +3,11 @@
 #include "rLLCoverageArea.h"
 #include "rLLHGridN2D.h"
 #include "rStage2Data.h"
+#include "rThreadGroup.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
 
 // Gives 2^9-1 or 511 source/radar support
 #define SOURCE_KEY_BITS 9
@@ -22,87 +27,281 @@ namespace rapio {
  *
  */
 
-/** Ultimate observation stored. Size here is stupid important.
+/** Time of an observation as seconds relative to the epoch of its SourceList.
+ * Kept observations are always near the latest ingest, so 32 bits is plenty
+ * and saves 4 bytes per observation over a time_t. */
+typedef int32_t FusionTimeOffset;
+
+/** Value observations of a single height level.  Size here is stupid important.
  * Due to conus size, we need to minimize observation handling on incoming data
  * The storage here is required per x,y,z point, so the smaller the better.
  *
+ * Stored as a structure of arrays, so there's no padding per observation
+ * (16 bytes vs 24 for an object with a time_t) and the merge loops stream
+ * through tightly packed columns.
+ *
+ * Note: We trust FusionRoster completely on the ranges, so no range is stored.
+ * If a radar toggles we might briefly merge more radars than expected until the
+ * old data expires.  The benefit is faster merge and less IO sending stage2 data.
+ *
  * NOTE: Do not make these classes virtual unless you want to explode your RAM
  */
-class Observation {
+class VObservations {
 public:
-  /** Create an observation */
-  Observation(short xin, short yin, char zin, time_t tin) :
-    x(xin), y(yin), t(tin){ }
-
-  // All observations will have to forward reference the giant x,y,z tree
-  // that back-references them.
-  // Reference to XYZ Tree (to delete/modify/merge in XYZ by source)
-  // This is 5 bytes.  We 'could' use a size_t i into data, but that's 8 bytes
-  short x;
-  short y;
-  //  char z; Pulled out into multi vector messy but saves this memory
-
-  // FIXME: We could use a short (2 bytes) and use relative time from the source,
-  // but this will require updating the relative times.  Future RAM optimization
-  time_t t; // 8 bytes (we could do 2 with relative times)
-
-  // We store range as meters (2 bytes)  Need this for dynamic nearest comparison
-  // Assuming here that meter resolution is high enough
-
-  // Ok we're gonna trust FusionRoster completely on the ranges.  If we do any
-  // trimming of the list of values per point we'll use time I think.
-  //
-  // Example: Radars A,B,C. Radar A goes down. We still have 3 radars for the point..haven't expired yet.
-  // Roster turns on radar D. We now get radar D. Now we have 4 radars worth of data since A hasn't 'quite' expired yet.
-  // So we actuallly merge 4 values instead of the 3 we set we wanted. A does expire out though so things 'fix' themselves.
-  // It's a temp issue of having more data than expected if radars toggle status a lot.
-  // However the benefit of no range is allowing faster merge and less IO sending stage2 data.
-  // Note: if we get more values and we can store we can always pick the 'newest' 3 vs range in this case
-  // short r;
-};
 
-/** Observation storing a non-missing data value */
-class VObservation : public Observation {
-public:
-  VObservation(short xin, short yin, char zin, float vin, float win, time_t tin) :
-    v(vin), w(win), Observation(xin, yin, zin, tin){ }
+  /** Add an observation */
+  inline void
+  add(short x, short y, FusionTimeOffset t, float v, float w)
+  {
+    myX.push_back(x);
+    myY.push_back(y);
+    myT.push_back(t);
+    myV.push_back(v);
+    myW.push_back(w);
+  }
+
+  /** Copy observation i of another level, shifting its time by delta */
+  inline void
+  addFrom(const VObservations& o, size_t i, FusionTimeOffset delta)
+  {
+    add(o.myX[i], o.myY[i], o.myT[i] + delta, o.myV[i], o.myW[i]);
+  }
+
+  /** Copy observation from into slot to, used when compacting */
+  inline void
+  move(size_t to, size_t from)
+  {
+    myX[to] = myX[from];
+    myY[to] = myY[from];
+    myT[to] = myT[from];
+    myV[to] = myV[from];
+    myW[to] = myW[from];
+  }
+
+  /** Keep the first n observations */
+  inline void
+  resize(size_t n)
+  {
+    myX.resize(n);
+    myY.resize(n);
+    myT.resize(n);
+    myV.resize(n);
+    myW.resize(n);
+  }
+
+  /** Set to the first n observations of another level */
+  inline void
+  assignFirst(const VObservations& o, size_t n)
+  {
+    myX.assign(o.myX.begin(), o.myX.begin() + n);
+    myY.assign(o.myY.begin(), o.myY.begin() + n);
+    myT.assign(o.myT.begin(), o.myT.begin() + n);
+    myV.assign(o.myV.begin(), o.myV.begin() + n);
+    myW.assign(o.myW.begin(), o.myW.begin() + n);
+  }
+
+  /** Clear all observations */
+  inline void
+  clear()
+  {
+    myX.clear();
+    myY.clear();
+    myT.clear();
+    myV.clear();
+    myW.clear();
+  }
+
+  /** Number of observations */
+  inline size_t
+  size() const { return myX.size(); }
+
+  /** Number of observations allocated */
+  inline size_t
+  capacity() const { return myX.capacity(); }
+
+  /** Bytes per observation */
+  static constexpr size_t BYTES = 2 * sizeof(short) + sizeof(FusionTimeOffset) + 2 * sizeof(float);
 
-  // Data we store for merging.  Currently simple weight average
-  float v; // 4 bytes
-  float w; // 4 bytes
+  std::vector<short> myX;            ///< X location (LON)
+  std::vector<short> myY;            ///< Y location (LAT)
+  std::vector<FusionTimeOffset> myT; ///< Time relative to source epoch
+  std::vector<float> myV;            ///< Weighted value numerator
+  std::vector<float> myW;            ///< Weight denominator
 };
 
-/** Observation storing a missing data value */
-class MObservation : public Observation {
+/** Missing observations of a single height level.  Missing comes in large
+ * blocks, so we store runs along x vs a time per grid cell. */
+class MObservations {
 public:
-  MObservation(short xin, short yin, char zin, time_t tin) :
-    Observation(xin, yin, zin, tin){ }
+
+  /** Add a missing cell, extending the last run if it continues it */
+  inline void
+  add(short x, short y, FusionTimeOffset t)
+  {
+    if (!myX.empty()) {
+      const size_t last = myX.size() - 1;
+      if ((myY[last] == y) && (myT[last] == t) && (myX[last] + myL[last] == x) &&
+        (myL[last] < std::numeric_limits<short>::max()))
+      {
+        myL[last]++;
+        return;
+      }
+    }
+    addRun(x, y, 1, t);
+  }
+
+  /** Add a run of missing cells */
+  inline void
+  addRun(short x, short y, short l, FusionTimeOffset t)
+  {
+    myX.push_back(x);
+    myY.push_back(y);
+    myL.push_back(l);
+    myT.push_back(t);
+  }
+
+  /** Copy run i of another level, shifting its time by delta */
+  inline void
+  addFrom(const MObservations& o, size_t i, FusionTimeOffset delta)
+  {
+    addRun(o.myX[i], o.myY[i], o.myL[i], o.myT[i] + delta);
+  }
+
+  /** Copy run from into slot to, used when compacting */
+  inline void
+  move(size_t to, size_t from)
+  {
+    myX[to] = myX[from];
+    myY[to] = myY[from];
+    myL[to] = myL[from];
+    myT[to] = myT[from];
+  }
+
+  /** Keep the first n runs */
+  inline void
+  resize(size_t n)
+  {
+    myX.resize(n);
+    myY.resize(n);
+    myL.resize(n);
+    myT.resize(n);
+  }
+
+  /** Set to the first n runs of another level */
+  inline void
+  assignFirst(const MObservations& o, size_t n)
+  {
+    myX.assign(o.myX.begin(), o.myX.begin() + n);
+    myY.assign(o.myY.begin(), o.myY.begin() + n);
+    myL.assign(o.myL.begin(), o.myL.begin() + n);
+    myT.assign(o.myT.begin(), o.myT.begin() + n);
+  }
+
+  /** Clear all runs */
+  inline void
+  clear()
+  {
+    myX.clear();
+    myY.clear();
+    myL.clear();
+    myT.clear();
+  }
+
+  /** Number of runs */
+  inline size_t
+  size() const { return myX.size(); }
+
+  /** Number of runs allocated */
+  inline size_t
+  capacity() const { return myX.capacity(); }
+
+  /** Bytes per run */
+  static constexpr size_t BYTES = 3 * sizeof(short) + sizeof(FusionTimeOffset);
+
+  std::vector<short> myX;            ///< X start of run
+  std::vector<short> myY;            ///< Y of run
+  std::vector<short> myL;            ///< Length of run in X
+  std::vector<FusionTimeOffset> myT; ///< Time relative to source epoch
 };
 
 /** Store a Source Observation List.  Due to the size of output CONUS we group
- * observations by source to allow quickly updating incoming data. */
+ * observations by source to allow quickly updating incoming data.
+ *
+ * Each ingest adds its observations first, then the old ones still valid
+ * in their old order.  So each level is newest first, in buckets of one
+ * ingest time, and expired buckets are always at the end, where the purge
+ * can drop them by truncating.  A late out of order ingest breaks this, and
+ * the list falls back to compacting until it's replaced by the next ingest.
+ */
 class SourceList {
 public:
   /** STL unordered map */
   SourceList(){ }
 
   /** Create a source list with a number of levels. **/
-  SourceList(const std::string& n, short i, size_t levels = 35) : myName(n), myID(i), myTime(0), myLevels(levels),
-    myAObs(levels), myAMObs(levels)
+  SourceList(const std::string& n, short i, size_t levels = 35) : myName(n), myID(i), myTime(0), myEpoch(0),
+    myLevels(levels), myAObs(levels), myAMObs(levels), myOldest(std::numeric_limits<FusionTimeOffset>::max()),
+    mySorted(true)
   { }
 
+  /** Set the epoch all our observation times are relative to.  Only call while empty. */
+  inline void
+  setEpoch(time_t t)
+  {
+    myEpoch = t;
+  }
+
+  /** Track the oldest time, and if a time added to a level is newer
+   * than the last one, breaking the newest first order */
+  inline void
+  noteTime(const std::vector<FusionTimeOffset>& times, FusionTimeOffset t)
+  {
+    if (!times.empty() && (t > times.back())) {
+      mySorted = false;
+    }
+    if (t < myOldest) {
+      myOldest = t;
+    }
+  }
+
   /** Add observation to observation list */
   inline void
   addObservation(short x, short y, char z, float v, float w, time_t t)
   {
-    myAObs[z].push_back(VObservation(x, y, z, v, w, t));
+    const FusionTimeOffset o = t - myEpoch;
+
+    noteTime(myAObs[z].myT, o);
+    myAObs[z].add(x, y, o, v, w);
   }
 
   /** Add missing to missing list */
   inline void
   addMissing(short x, short y, char z, time_t t)
   {
-    myAMObs[z].push_back(MObservation(x, y, z, t));
+    const FusionTimeOffset o = t - myEpoch;
+
+    noteTime(myAMObs[z].myT, o);
+    myAMObs[z].add(x, y, o);
+  }
+
+  /** Recalculate the oldest time and order from scratch, for example
+   * after filling the levels directly */
+  inline void
+  scanTimes()
+  {
+    myOldest = std::numeric_limits<FusionTimeOffset>::max();
+    mySorted = true;
+    for (size_t z = 0; z < myLevels; ++z) {
+      for (auto * times : { &myAObs[z].myT, &myAMObs[z].myT }) {
+        for (size_t i = 0; i < times->size(); ++i) {
+          const FusionTimeOffset t = (*times)[i];
+          if ((i > 0) && (t > (*times)[i - 1])) {
+            mySorted = false;
+          }
+          myOldest = std::min(myOldest, t);
+        }
+      }
+    }
   }
 
   /** Clear observations */
@@ -113,66 +312,177 @@ public:
       myAObs[i].clear();
       myAMObs[i].clear();
     }
+    myOldest = std::numeric_limits<FusionTimeOffset>::max();
+    mySorted = true;
   }
 
-  /** General vector time purge. We delete by swapping to the end of
-   * vector and popping. */
+  /** Time purge of a level, returning the oldest time kept.  Newest first
+   * levels drop their expired buckets off the end, otherwise we compact
+   * keeping order. */
   template <typename T>
-  inline void
-  timePurgeV(std::vector<T>& v, time_t cutoff)
+  inline FusionTimeOffset
+  timePurgeV(T& v, FusionTimeOffset cutoff)
   {
-    size_t i = 0;
+    auto& t = v.myT;
+
+    if (mySorted) {
+      const size_t keep = std::partition_point(t.begin(), t.end(),
+          [cutoff](FusionTimeOffset a){
+        return a >= cutoff;
+      }) - t.begin();
+      v.resize(keep);
+      return t.empty() ? std::numeric_limits<FusionTimeOffset>::max() : t.back();
+    }
+
+    FusionTimeOffset oldest = std::numeric_limits<FusionTimeOffset>::max();
+    size_t at = 0;
 
-    while (i < v.size()) {
-      if (v[i].t < cutoff) { // Our epoch less than cutoff epoch
-        // Swap and pop item
-        v[i] = v.back();
-        v.pop_back();
-      } else {
-        ++i;
+    for (size_t i = 0; i < t.size(); ++i) {
+      if (t[i] >= cutoff) { // Our epoch not less than cutoff epoch
+        oldest = std::min(oldest, t[i]);
+        v.move(at++, i);
       }
     }
+    v.resize(at);
+    return oldest;
   }
 
-  /** Purge time cutoff */
+  /** Purge time cutoff.  Sources with nothing old enough are skipped. */
   inline void
   timePurge(time_t cutoff)
   {
+    const FusionTimeOffset c = toOffset(cutoff);
+
+    if (myOldest >= c) {
+      return;
+    }
+    myOldest = std::numeric_limits<FusionTimeOffset>::max();
     for (size_t z = 0; z < myLevels; ++z) {
-      timePurgeV(myAObs[z], cutoff);
-      timePurgeV(myAMObs[z], cutoff);
+      myOldest = std::min(myOldest, timePurgeV(myAObs[z], c));
+      myOldest = std::min(myOldest, timePurgeV(myAMObs[z], c));
     }
   }
 
-  /** Add points to a new source not marked in mask and still time valid */
+  /** Copy the part of a level a purge at cutoff keeps into out, returning
+   * the oldest time kept.  Newest first levels copy just the kept front. */
   template <typename T>
-  inline void
-  unionMergeV(Bitset1& mask, size_t z, std::vector<T>& new1, std::vector<T>& old1, time_t cutoff, size_t& timePurged,
-    size_t& restored)
-  {
-    for (auto& o: old1) {
-      if (!mask.get13D(o.x, o.y, z)) {
-        if (o.t < cutoff) { // We could wait until global time purge?
-          timePurged++;
-        } else {
-          new1.push_back(o);
-          // Do we need to update mask...think we don't have to
-          // mask.set13D(o.x, o.y, z);
-          restored++;
-        }
+  inline FusionTimeOffset
+  keptV(const T& v, T& out, FusionTimeOffset cutoff) const
+  {
+    auto& t = v.myT;
+
+    if (mySorted) {
+      const size_t keep = std::partition_point(t.begin(), t.end(),
+          [cutoff](FusionTimeOffset a){
+        return a >= cutoff;
+      }) - t.begin();
+      out.assignFirst(v, keep);
+      return (keep == 0) ? std::numeric_limits<FusionTimeOffset>::max() : t[keep - 1];
+    }
+
+    FusionTimeOffset oldest = std::numeric_limits<FusionTimeOffset>::max();
+
+    for (size_t i = 0; i < t.size(); ++i) {
+      if (t[i] >= cutoff) {
+        oldest = std::min(oldest, t[i]);
+        out.addFrom(v, i, 0);
       }
     }
+    return oldest;
+  }
+
+  /** A new list holding what a purge at cutoff would keep.  Used when
+   * the list is shared, so only the kept part is copied. */
+  inline std::shared_ptr<SourceList>
+  purgedCopy(time_t cutoff) const
+  {
+    const FusionTimeOffset c = toOffset(cutoff);
+    auto p = std::make_shared<SourceList>(myName, myID, myLevels);
+
+    p->myTime   = myTime;
+    p->myEpoch  = myEpoch;
+    p->mySorted = mySorted;
+    for (size_t z = 0; z < myLevels; ++z) {
+      p->myOldest = std::min(p->myOldest, keptV(myAObs[z], p->myAObs[z], c));
+      p->myOldest = std::min(p->myOldest, keptV(myAMObs[z], p->myAMObs[z], c));
+    }
+    return p;
+  }
+
+  /** Would a purge at cutoff remove anything? */
+  inline bool
+  hasExpired(time_t cutoff) const
+  {
+    return myOldest < toOffset(cutoff);
   }
 
   /** Add our points to a new source not marked in mask and still time valid. Marked
-   * is used to avoid duplicates and properly union the sets. */
+   * is used to avoid duplicates and properly union the sets.
+   * Missing runs are kept while time valid, since missing from any source marks
+   * the background until it expires, but only where the new source didn't
+   * report the cell again. */
   inline void
   unionMerge(SourceList& newSource, Bitset1& mask, time_t cutoff, size_t& timePurged, size_t& restored)
   {
+    const FusionTimeOffset c     = toOffset(cutoff);
+    const FusionTimeOffset delta = myEpoch - newSource.myEpoch;
+
     for (size_t z = 0; z < myLevels; ++z) {
-      unionMergeV(mask, z, newSource.myAObs[z], myAObs[z], cutoff, timePurged, restored);
-      unionMergeV(mask, z, newSource.myAMObs[z], myAMObs[z], cutoff, timePurged, restored);
+      auto& old1 = myAObs[z];
+      auto& new1 = newSource.myAObs[z];
+      for (size_t i = 0; i < old1.size(); ++i) {
+        if (!mask.get13D(old1.myX[i], old1.myY[i], z)) {
+          if (old1.myT[i] < c) { // We could wait until global time purge?
+            timePurged++;
+          } else {
+            newSource.noteTime(new1.myT, old1.myT[i] + delta);
+            new1.addFrom(old1, i, delta);
+            restored++;
+          }
+        }
+      }
+
+      // Old missing runs only keep the cells the new ingest didn't cover,
+      // so each cell holds just its latest missing run
+      auto& oldm = myAMObs[z];
+      auto& newm = newSource.myAMObs[z];
+      for (size_t i = 0; i < oldm.size(); ++i) {
+        if (oldm.myT[i] < c) {
+          continue;
+        }
+        const short y   = oldm.myY[i];
+        const short end = oldm.myX[i] + oldm.myL[i];
+        short x         = oldm.myX[i];
+        while (x < end) {
+          while ((x < end) && mask.get13D(x, y, z)) {
+            ++x;
+          }
+          const short start = x;
+          while ((x < end) && !mask.get13D(x, y, z)) {
+            ++x;
+          }
+          if (x > start) {
+            newSource.noteTime(newm.myT, oldm.myT[i] + delta);
+            newm.addRun(start, y, x - start, oldm.myT[i] + delta);
+          }
+        }
+      }
+    }
+  }
+
+  /** Convert an absolute time to our relative time, clamped to our range */
+  inline FusionTimeOffset
+  toOffset(time_t t) const
+  {
+    const time_t d = t - myEpoch;
+
+    if (d < std::numeric_limits<FusionTimeOffset>::min()) {
+      return std::numeric_limits<FusionTimeOffset>::min();
+    }
+    if (d > std::numeric_limits<FusionTimeOffset>::max()) {
+      return std::numeric_limits<FusionTimeOffset>::max();
     }
+    return d;
   }
 
   // FIXME: 'maybe' we inline get/set methods when things get stable
@@ -187,14 +497,23 @@ public:
   // Note: Typically the observations stored in us will contain times <= this one.
   Time myTime;
 
+  /** Epoch in seconds all our observation times are relative to */
+  time_t myEpoch;
+
   /** Number of levels we store */
   size_t myLevels;
 
-  /** Vector of value observations */
-  std::vector<std::vector<VObservation> > myAObs;
+  /** Value observations per level */
+  std::vector<VObservations> myAObs;
+
+  /** Missing observation runs per level */
+  std::vector<MObservations> myAMObs;
+
+  /** Oldest time of any observation */
+  FusionTimeOffset myOldest;
 
-  /** Vector of missing observations */
-  std::vector<std::vector<MObservation> > myAMObs;
+  /** Are all levels newest first? */
+  bool mySorted;
 };
 
 /** (AI) Handle a group of source observation lists that have unique ID keys
@@ -260,6 +579,27 @@ public:
     // }
   }
 
+  /** Add a source list restored from a snapshot, keeping its key */
+  void
+  restore(std::shared_ptr<SourceList> r)
+  {
+    const T key = r->myID;
+
+    myObservationMap[key] = r;
+    if (key >= myNextKey) {
+      myNextKey = key + 1;
+    }
+  }
+
+  /** Remove all source lists */
+  void
+  clear()
+  {
+    myObservationMap.clear();
+    myAvailableKeys.clear();
+    myNextKey = 0;
+  }
+
   /** Iterators for begin access, hiding implementation details */
   typename std::unordered_map<T, std::shared_ptr<SourceList> >::iterator
   begin()
@@ -286,6 +626,51 @@ protected:
   short myNextKey = 0;
 };
 
+class FusionDatabase;
+
+/** Merge or max a single height layer of the database into its output grid.
+ * Each layer is its own LatLonGrid, so layers can run at the same time
+ * without any locking. */
+class FusionMergeTask : public ThreadTask {
+public:
+
+  /** Create a task for a layer */
+  FusionMergeTask(FusionDatabase * db, bool max, std::shared_ptr<LatLonGrid> output, size_t z,
+    time_t cutoff, size_t offsetX, size_t offsetY, float precision)
+    : myDatabase(db), myMax(max), myOutput(output), myZ(z),
+    myCutoff(cutoff), myOffsetX(offsetX), myOffsetY(offsetY), myPrecision(precision){ }
+
+  /** Merge our layer */
+  virtual void
+  execute() override;
+
+protected:
+
+  /** The database we're merging from */
+  FusionDatabase * myDatabase;
+
+  /** Max vs weighted average merge */
+  bool myMax;
+
+  /** The layer grid we write to */
+  std::shared_ptr<LatLonGrid> myOutput;
+
+  /** The height layer */
+  size_t myZ;
+
+  /** Missing time cutoff */
+  time_t myCutoff;
+
+  /** X offset of the tile in the full grid */
+  size_t myOffsetX;
+
+  /** Y offset of the tile in the full grid */
+  size_t myOffsetY;
+
+  /** Round off precision */
+  float myPrecision;
+};
+
 /** FusionDatabase maintains the collection of sources which store various types
  * of observations.  It also maintains a X,Y,Z grid that backreferences various
  * observations */
@@ -293,13 +678,11 @@ class FusionDatabase {
 public:
   /** The Database is for a 3D cube */
   FusionDatabase(size_t x, size_t y, size_t z) : myNumX(x), myNumY(y), myNumZ(z), myXYZs({ x, y, z }), myHaves({ x, y,
-                                                                                                                 z }),
-    myMissings(x * y * z)
-  {
-    for (size_t i = 0; i < myMissings.size(); ++i) {
-      myMissings[i] = std::numeric_limits<time_t>::min();
-    }
-  };
+                                                                                                                 z })
+  { };
+
+  /** Finish any background snapshot */
+  ~FusionDatabase();
 
   /** Ingest new stage2 data */
   void
@@ -347,12 +730,45 @@ public:
   /** Max merge of given values */
   void
   maxTo(std::shared_ptr<LLHGridN2D> cache, const time_t cutoff, size_t offsetX, size_t offsetY, float promise);
+
+  /** Weighted distance merge of a single height layer */
+  void
+  mergeLayer(LatLonGrid& output, size_t z, const time_t cutoff, size_t offsetX, size_t offsetY, float precision);
+
+  /** Max merge of a single height layer */
+  void
+  maxLayer(LatLonGrid& output, size_t z, const time_t cutoff, size_t offsetX, size_t offsetY, float precision);
+
+  /** Set the number of threads used to merge height layers.  1 or less is serial. */
+  void
+  setThreadCount(size_t threads);
   // ----------------------------------------
 
   /** Attempt to purge times from database */
   void
   timePurge(Time atTime, TimeDuration interval);
 
+  // ----------------------------------------
+  // Warm start snapshots
+
+  /** Start writing a snapshot of all sources in the background.  Source
+   * lists are replaced, not changed, on ingest, so the writer just holds
+   * on to the current lists while we keep going.  The snapshot is moved
+   * into place when complete, keeping the last one as filename.prev.
+   * @return false if the last snapshot is still being written. */
+  bool
+  writeSnapshot(const std::string& filename, const Time& at);
+
+  /** Wait for a background snapshot.  @return true if it was written. */
+  bool
+  waitForSnapshot();
+
+  /** Replace our sources with the newest valid snapshot, filename or
+   * filename.prev, for our grid.
+   * @return false if neither is a valid snapshot. */
+  bool
+  readSnapshot(const std::string& filename, Time& at);
+
 protected:
 
   /** Size in X of entire database */
@@ -373,7 +789,37 @@ protected:
   /** My have marked array (bits) */
   Bitset1 myHaves;
 
-  /** My latest missing array mask */
-  std::vector<time_t> myMissings;
+  /** Mark unhit cells of a layer as missing or unavailable from the source
+   * missing runs.  Unhit cells are the ones with a hit/weight of zero. */
+  void
+  fillBackground(LatLonGrid& output, size_t z, const time_t cutoff, size_t offsetX, size_t offsetY);
+
+  /** Run merge or max over all layers, in parallel if we have threads */
+  void
+  mergeLayers(std::shared_ptr<LLHGridN2D> cache, bool max, const time_t cutoff, size_t offsetX, size_t offsetY,
+    float precision);
+
+  /** Threads for merging layers, if any */
+  std::shared_ptr<ThreadGroup> myThreads;
+
+  /** Write a snapshot of sources to a file */
+  bool
+  writeSnapshotFile(const std::string& filename, const Time& at,
+    const std::vector<std::shared_ptr<SourceList> >& sources,
+    const std::vector<Time>& times);
+
+  /** Read sources from a single snapshot file */
+  bool
+  readSnapshotFile(const std::string& filename, Time& at,
+    std::vector<std::shared_ptr<SourceList> >& sources);
+
+  /** Background snapshot writer, if any */
+  std::thread mySnapshotThread;
+
+  /** Is a snapshot being written? */
+  std::atomic<bool> mySnapshotBusy{ false };
+
+  /** Did the last snapshot write? */
+  std::atomic<bool> mySnapshotGood{ false };
 };
 }
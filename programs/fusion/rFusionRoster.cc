@@ -4,6 +4,11 @@
 #include "rConfigRadarInfo.h"
 #include "rDirWalker.h"
 #include "rProcessTimer.h"
+#include "rThreadGroup.h"
+
+#include <algorithm>
+#include <array>
+#include <sys/stat.h>
 
 using namespace rapio;
 
@@ -99,8 +104,14 @@ RAPIOFusionRosterAlg::firstTimeSetup()
   // New way, grouped separately (dynamic for possible memory locality issues)
   fLogInfo("Creating nearest array of size {}, each cell {} bytes.", NFULL,
     (sizeof(SourceIDKey) + sizeof(float)) * (NFULL * size));
-  myNearestSourceIDKeys = std::vector<SourceIDKey>(NFULL * size, 0);
-  myNearestRanges       = std::vector<float>(NFULL * size, std::numeric_limits<float>::max()); // The ranges per location
+  // Reuse the arrays from the last pass if the grid didn't change
+  if (myNearestRanges.size() == NFULL * size) {
+    std::fill(myNearestSourceIDKeys.begin(), myNearestSourceIDKeys.end(), 0);
+    std::fill(myNearestRanges.begin(), myNearestRanges.end(), std::numeric_limits<float>::max());
+  } else {
+    myNearestSourceIDKeys = std::vector<SourceIDKey>(NFULL * size, 0);
+    myNearestRanges       = std::vector<float>(NFULL * size, std::numeric_limits<float>::max()); // The ranges per location
+  }
   #endif
 
   fLogInfo("{}", createGrid);
@@ -145,41 +156,85 @@ RAPIOFusionRosterAlg::walkerCallback(const std::string& what, const std::string&
   const std::string& fullpath)
 {
   if (what == "INGEST") {
-    // Reading in .cache files
-    ingest(sourcename, fullpath);
+    // Gather current .cache files, read after the walk
+    if (!expiredCoverage(sourcename, fullpath)) {
+      myFound.push_back(std::make_pair(sourcename, fullpath));
+    }
   } else if (what == "DELETE") {
     // Deleting masks for old stuff we didn't have a cache file for
     deleteMask(sourcename, fullpath);
   }
 }
 
-void
-RAPIOFusionRosterAlg::ingest(const std::string& sourcename, const std::string& fullpath)
+bool
+RAPIOFusionRosterAlg::rangesChanged()
 {
-  // Don't handle expired files (not included in mask calculations)
-  if (expiredCoverage(sourcename, fullpath)) {
-    return; // ignore it
-  }
+  // Stat everything we found, only reading the checksum of files with a
+  // new time or size.  Stage1 touches a file when its coverage is the same.
+  const size_t count = myFound.size();
+  std::vector<RangeFileState> states(count);
+  std::vector<char> good(count, 0);
+
+  ThreadGroup::getShared()->parallelFor(0, count, 1, [&](size_t start, size_t end){
+    for (size_t i = start; i < end; ++i) {
+      auto& name = myFound[i].first;
+      auto& path = myFound[i].second;
+      struct stat info;
+      if (::stat(path.c_str(), &info) != 0) { continue; }
+      auto& st   = states[i];
+      st.seconds = info.st_mtim.tv_sec;
+      st.nanos   = info.st_mtim.tv_nsec;
+      st.size    = info.st_size;
+
+      auto old = myRangeStates.find(name);
+      if ((old != myRangeStates.end()) && (old->second.seconds == st.seconds) &&
+      (old->second.nanos == st.nanos) && (old->second.size == st.size))
+      {
+        st.hash = old->second.hash;
+        good[i] = 1;
+        continue;
+      }
 
-  ProcessTimer merge("Reading range/merging 1 took:");
+      // Touched, so see if the content actually changed
+      if (FusionCache::readRangeChecksum(path, st.hash)) {
+        good[i] = 1;
+      }
+    }
+  });
 
-  size_t startX, startY, numX, numY; // subgrid coordinates
+  // Changed if any source came, went or has new ranges
+  std::map<std::string, RangeFileState> current;
 
-  // We're reading to get the data and grid..which we need to generate the mask
-  std::vector<FusionRangeCache> out;
+  for (size_t i = 0; i < count; ++i) {
+    if (good[i]) { current[myFound[i].first] = states[i]; }
+  }
+  bool changed = !myHaveRoster || (current.size() != myRangeStates.size());
 
-  if (!FusionCache::readRangeFile(fullpath, startX, startY, numX, numY, out)) {
-    return;
+  for (auto& c:current) {
+    auto old = myRangeStates.find(c.first);
+    if ((old == myRangeStates.end()) || (old->second.hash != c.second.hash)) {
+      fLogInfo("Coverage for '{}' is new or changed.", c.first);
+      changed = true;
+    }
   }
+  myRangeStates.swap(current);
+  return changed;
+} // RAPIOFusionRosterAlg::rangesChanged
+
+bool
+RAPIOFusionRosterAlg::ingest(const std::string& sourcename, size_t startX, size_t startY,
+  size_t numX, size_t numY, std::vector<FusionRangeCache>& out)
+{
+  ProcessTimer merge("Merging 1 took:");
 
   // Make sure we have correct size..or skip
   const size_t numZ     = myFullGrid.getNumZ();
   const size_t expected = numX * numY * numZ;
 
   if (out.size() != expected) {
-    fLogSevere("Expected {} points but got {} for {}", expected, out.size(), fullpath);
+    fLogSevere("Expected {} points but got {} for {}", expected, out.size(), sourcename);
     fLogSevere("EXTRA: {}, {}, {}", numX, numY, numZ);
-    return;
+    return false;
   }
   // FIXME: check read errors?
 
@@ -235,6 +290,7 @@ RAPIOFusionRosterAlg::ingest(const std::string& sourcename, const std::string& f
     myWalkTimer->add(merge);
   }
   myWalkCount++;
+  return true;
 } // RAPIOFusionRosterAlg::ingest
 
 void
@@ -260,37 +316,76 @@ RAPIOFusionRosterAlg::deleteMask(const std::string& sourcename, const std::strin
   }
 }
 
-void
+bool
 RAPIOFusionRosterAlg::generateNearest()
 {
   myWalkTimer = new ProcessTimerSum();
   myWalkCount = 0;
   fLogInfo("Grid is {}", myFullGrid);
   //  int NFULL = myFullGrid.getNumX() * myFullGrid.getNumY() * myFullGrid.getNumZ();
+
+  // Walk the cache directory looking for current/good files
+  std::string directory = FusionCache::getRangeDirectory(myFullGrid);
+  myDirWalker walk("INGEST", this, ".cache");
+
+  myFound.clear();
+  walk.traverse(directory);
+
+  // Same sources with the same ranges give the same masks
+  if (!rangesChanged()) {
+    delete myWalkTimer;
+    return false;
+  }
+
   firstTimeSetup();
 
   // Clear out our stored radars
   mySourceInfos.clear();
   myNameToInfo.clear();
 
-  // Walk the cache directory looking for current/good files
-  std::string directory = FusionCache::getRangeDirectory(myFullGrid);
-  myDirWalker walk("INGEST", this, ".cache");
+  // Sorted so ids are stable between passes
+  std::sort(myFound.begin(), myFound.end());
 
-  walk.traverse(directory);
+  // Read a batch of files in parallel, then merge them in order.  Each
+  // merge is parallel by row, and only a batch of files is in RAM.
+  const size_t batch = std::max(size_t(1), ThreadGroup::getShared()->getNumWorkers());
+
+  for (size_t b = 0; b < myFound.size(); b += batch) {
+    const size_t e = std::min(myFound.size(), b + batch);
+    std::vector<std::vector<FusionRangeCache> > outs(e - b);
+    std::vector<std::array<size_t, 4> > grids(e - b);
+    std::vector<char> good(e - b, 0);
+
+    ThreadGroup::getShared()->parallelFor(b, e, 1, [&](size_t start, size_t end){
+      for (size_t i = start; i < end; ++i) {
+        auto& g = grids[i - b];
+        good[i - b] = FusionCache::readRangeFile(myFound[i].second, g[0], g[1], g[2], g[3], outs[i - b]);
+      }
+    });
+    for (size_t i = b; i < e; ++i) {
+      auto& g = grids[i - b];
+      if (!good[i - b] || !ingest(myFound[i].first, g[0], g[1], g[2], g[3], outs[i - b])) {
+        // Forget it so the next pass sees it as changed and tries again
+        myRangeStates.erase(myFound[i].first);
+      }
+      std::vector<FusionRangeCache>().swap(outs[i - b]);
+    }
+  }
 
   fLogInfo("Total walk/merge time {} ({}) sources active.", *myWalkTimer, myWalkCount);
   delete myWalkTimer;
+  myHaveRoster = true;
+  return true;
 } // RAPIOFusionRosterAlg::generateNearest
 
 void
 RAPIOFusionRosterAlg::nearestNeighbor(std::vector<FusionRangeCache>& out, size_t id, size_t startX, size_t startY,
   size_t numX, size_t numY)
 {
-  size_t counter    = 0;
   const size_t size = myNearestCount;
 
   #if USER_STATIC_NEAREST
+  size_t counter = 0;
 
   for (size_t z = 0; z < myFullGrid.getNumZ(); ++z) {
     for (size_t y = startY; y < startY + numY; ++y) {   // north to south
@@ -329,14 +424,19 @@ RAPIOFusionRosterAlg::nearestNeighbor(std::vector<FusionRangeCache>& out, size_t
   }
   #else // if USER_STATIC_NEAREST
 
-  // NEW WAY TESTING
-  for (size_t z = 0; z < myFullGrid.getNumZ(); ++z) {
-    for (size_t y = startY; y < startY + numY; ++y) {   // north to south
+  // Each row of the coverage is a tile, rows never share a cell
+  const size_t numZ = myFullGrid.getNumZ();
+
+  ThreadGroup::getShared()->parallelFor(0, numZ * numY, 16, [&](size_t rstart, size_t rend){
+    for (size_t row = rstart; row < rend; ++row) {
+      const size_t z = row / numY;
+      const size_t y = startY + (row % numY);
+      size_t offset = row * numX;
       for (size_t x = startX; x < startX + numX; ++x) { // east to west
         size_t at = myNearestIndex.getIndex3D(x, y, z);
 
         // Update the 'nearest' for this radar id, etc.
-        auto v = out[counter++];
+        auto v = out[offset++];
 
         // Find the correct position to insert v using linear search (small N)
         const size_t atr = at * size; // relative into group
@@ -364,7 +464,7 @@ RAPIOFusionRosterAlg::nearestNeighbor(std::vector<FusionRangeCache>& out, size_t
         }
       }
     }
-  }
+  });
   #endif // if USER_STATIC_NEAREST
 } // RAPIOFusionRosterAlg::nearestNeighbor
 
@@ -410,34 +510,35 @@ RAPIOFusionRosterAlg::generateMasks()
   }
   #else // if USE_STATIC_NEAREST
 
-  // Mask generation algorithm
+  // Mask generation algorithm.  Each source walks its own coverage box
+  // looking for itself in the nearest list, so masks are never shared.
   auto& k = myNearestSourceIDKeys;
-  auto& r = myNearestRanges;
-  for (size_t z = 0; z < myFullGrid.getNumZ(); ++z) {
-    for (size_t y = 0; y < myFullGrid.getNumY(); ++y) {
-      for (size_t x = 0; x < myFullGrid.getNumX(); ++x) {
-        size_t at = myNearestIndex.getIndex3D(x, y, z);
-
-        const size_t atr = at * size; // relative into group
-
-        for (size_t i = 0; i < size; ++i) {
-          // if we find a 0 id, then since we're insertion sorted by range,
-          // then this means all are 0 later...so continue
-          if (k[atr + i] == 0) {
-            continue;
+  const size_t numZ = myFullGrid.getNumZ();
+
+  // Zero is reserved as missing
+  ThreadGroup::getShared()->parallelFor(1, mySourceInfos.size(), 1, [&](size_t sstart, size_t send){
+    for (size_t s = sstart; s < send; ++s) {
+      SourceInfo& info = mySourceInfos[s];
+      Bitset& b        = info.mask; // refer to mask
+      for (size_t z = 0; z < numZ; ++z) {
+        for (size_t ly = 0; ly < info.numY; ++ly) {
+          for (size_t lx = 0; lx < info.numX; ++lx) {
+            const size_t at  = myNearestIndex.getIndex3D(info.startX + lx, info.startY + ly, z);
+            const size_t atr = at * size; // relative into group
+            for (size_t i = 0; i < size; ++i) {
+              // if we find a 0 id, then since we're insertion sorted by range,
+              // then this means all are 0 later
+              if (k[atr + i] == 0) { break; }
+              if (k[atr + i] == info.id) {
+                b.set1(b.getIndex3D(lx, ly, z)); // Set one bit
+                break;
+              }
+            }
           }
-          // If not zero, we need the sourceInfo for it.  This is why
-          // we store as ids in a vector it makes this lookup fast
-          SourceInfo * info = &mySourceInfos[k[atr + i]];
-          Bitset& b         = info->mask;         // refer to mask
-          const size_t lx   = x - (info->startX); // "shouldn't" underflow
-          const size_t ly   = y - (info->startY);
-          const size_t li   = b.getIndex3D(lx, ly, z);
-          info->mask.set1(li); // Set one bit
         }
       }
     }
-  }
+  });
   #endif // if USE_STATIC_NEAREST
   fLogInfo("{}", maskGen);
 } // RAPIOFusionRosterAlg::generateMasks
@@ -483,7 +584,11 @@ RAPIOFusionRosterAlg::writeMasks()
 void
 RAPIOFusionRosterAlg::performRoster()
 {
-  generateNearest(); // Read all stage1 info files, for example "KTLX.cache" and merge nearest values
+  // Read all stage1 info files, for example "KTLX.cache" and merge nearest values
+  if (!generateNearest()) {
+    fLogInfo("No coverage changes, current masks are still good.");
+    return;
+  }
 
   generateMasks(); // In RAM, create 1/0 bit array for each source
 
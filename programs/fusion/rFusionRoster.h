@@ -60,6 +60,22 @@ public:
   Bitset mask;
 };
 
+/** What we knew about a range file on the last roster pass */
+class RangeFileState {
+public:
+  /** Modification time seconds */
+  time_t seconds;
+
+  /** Modification time nanoseconds */
+  long nanos;
+
+  /** Size of the file */
+  off_t size;
+
+  /** Checksum of the grid and ranges from the file header */
+  uint64_t hash;
+};
+
 /**
  * A group idea to handle IO/CPU reduction.  Since we filter out
  * data by nearest 3-4 radars and other factors, we can create
@@ -73,9 +89,11 @@ public:
  * the ranges from source center and we don't want roster having
  * to do this math for 300 radars.
  *
- * This range/meta file is read in by scanning/walking the
- * directory.  The nearest neighbor algorithm then inserts each
- * of these into our 'big' data structure.  Finally, we create a 1/0
+ * Walking the directory gathers the current range/meta files.
+ * If any source came, went or has new ranges since the last pass,
+ * the files are read in parallel batches and the nearest neighbor
+ * algorithm inserts each of these, in sorted order, into our 'big'
+ * data structure.  Finally, we create a 1/0
  * bit mask for each source and write back. This mask is then
  * used by stage1 to turn on/off generated grid points for that
  * source.  The area of coverage for the range and bit masks is
@@ -114,22 +132,33 @@ public:
   void
   walkerCallback(const std::string& what, const std::string& sourcename, const std::string& fullpath);
 
-  /** Ingest single cache file */
-  void
-  ingest(const std::string& sourcename, const std::string& fullpath);
+  /** Check the range files found in a walk against the last pass.
+   * Files with a new modification time have their checksum read.
+   * @return true if the set of sources or any of their ranges changed */
+  bool
+  rangesChanged();
+
+  /** Ingest ranges read from a cache file.
+   * @return false if the ranges don't fit the grid */
+  bool
+  ingest(const std::string& sourcename, size_t startX, size_t startY,
+    size_t numX, size_t numY, std::vector<FusionRangeCache>& out);
 
   /** Delete an old mask file */
   void
   deleteMask(const std::string& sourcename, const std::string& fullpath);
 
   /** Do nearest neighbor algorithm ingest for a single source.
-  * This modifies the current nearest list with the new one. */
+  * This modifies the current nearest list with the new one.  Rows of
+  * the source's coverage are merged in parallel since they never share
+  * a cell. */
   void
   nearestNeighbor(std::vector<FusionRangeCache>& out, size_t id,
     size_t startX, size_t startY, size_t numX, size_t numY);
 
-  /** Generate nearest array for all sources. */
-  void
+  /** Generate nearest array for all sources.
+   * @return false if nothing changed since the last pass */
+  bool
   generateNearest();
 
   /** Do the entire roster process one time */
@@ -137,7 +166,8 @@ public:
   performRoster();
 
   /** Generate masks from nearest neighbor results into individual
-   * bit masks for each source */
+   * bit masks for each source.  Each source only looks at its own
+   * coverage, so sources are done in parallel. */
   void
   generateMasks();
 
@@ -193,6 +223,15 @@ protected:
 
   /** My static field (ignore expiration times) */
   bool myStatic;
+
+  /** Source name and path of current range files found in a walk */
+  std::vector<std::pair<std::string, std::string> > myFound;
+
+  /** Range file state by source name from the last pass */
+  std::map<std::string, RangeFileState> myRangeStates;
+
+  /** Have we done a full pass yet? */
+  bool myHaveRoster = false;
 };
 
 class myDirWalker : public DirWalker
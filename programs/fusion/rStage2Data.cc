@@ -2,6 +2,9 @@
 #include "rFusion1.h"
 #include "rBitset.h"
 #include "rColorTerm.h"
+#include "rLLHGridN2D.h"
+
+#include <cstring>
 
 using namespace rapio;
 
@@ -279,3 +282,68 @@ Stage2Data::receive(RAPIOData& rData)
   }
   return nullptr;
 } // Stage2Data::receive
+
+Stage2Delta::Stage2Delta(size_t numX, size_t numY, size_t numZ, size_t fullCycles) :
+  myNumX(numX), myNumY(numY), myNumZ(numZ), myFullCycles(std::max(fullCycles, size_t(1))), myCycle(0),
+  myRowHashes(numY * numZ, 0), mySent({ numX, numY, numZ })
+{ }
+
+size_t
+Stage2Delta::add(LLHGridN2D& grid, FusionBinaryTable& table, bool& full)
+{
+  full = ((myCycle++ % myFullCycles) == 0);
+  size_t changed = 0;
+
+  for (size_t z = 0; z < myNumZ; ++z) {
+    auto& g = grid.get(z)->getFloat2DRef();
+    for (size_t y = 0; y < myNumY; ++y) {
+      // Hash the row, skipping it if the same as last time
+      uint64_t h = 14695981039346656037ULL;
+      for (size_t x = 0; x < myNumX; ++x) {
+        uint32_t bits;
+        const float v = g[y][x];
+        std::memcpy(&bits, &v, sizeof(bits));
+        h ^= bits;
+        h *= 1099511628211ULL;
+      }
+      auto& last = myRowHashes[z * myNumY + y];
+      if (!full && (h == last)) {
+        continue;
+      }
+      last = h;
+      changed++;
+
+      // Values with a weight of 1, missing as runs.  Cells we sent before
+      // but have no coverage now go as missing, expiring them downstream.
+      size_t runX = 0, runL = 0;
+      for (size_t x = 0; x <= myNumX; ++x) {
+        bool isMissing = false;
+        if (x < myNumX) {
+          float v        = g[y][x];
+          const size_t i = mySent.getIndex3D(x, y, z);
+          if (v == Constants::MissingData) {
+            isMissing = true;
+            mySent.set1(i);
+          } else if (v == Constants::DataUnavailable) {
+            isMissing = mySent.get1(i);
+            mySent.set(i, 0);
+          } else {
+            float w  = 1;
+            short sx = x, sy = y, sz = z;
+            table.add(v, w, sx, sy, sz);
+            mySent.set1(i);
+          }
+        }
+        if (isMissing) {
+          if (runL == 0) { runX = x; }
+          runL++;
+        } else if (runL > 0) {
+          size_t ry = y, rz = z;
+          table.addMissing(runX, ry, rz, runL);
+          runL = 0;
+        }
+      }
+    }
+  }
+  return changed;
+} // Stage2Delta::add
@@ -13,6 +13,7 @@
 
 namespace rapio {
 class RAPIOFusionOneAlg;
+class LLHGridN2D;
 
 /** Store a single tile or area.  Depending on our partitioning mode, we may have one or N of these. */
 class Stage2Storage {
@@ -100,10 +101,30 @@ public:
     }
   }
 
+  /** Merge another storage of the same grid into us.  Values are appended
+   * after ours and missing bits are or'd in. */
+  void
+  merge(Stage2Storage& other)
+  {
+    if (!myMissingSet.merge(other.myMissingSet)) {
+      fLogSevere("Merging stage2 storage with a different grid size, missing values lost.");
+    }
+    myTable->append(*other.myTable);
+    myAddValueCounter   += other.myAddValueCounter;
+    myAddMissingCounter += other.myAddMissingCounter;
+  }
+
   /** Send/write our tile. */
   void
   send(RAPIOAlgorithm * alg, Time aTime, const std::string& asName);
 
+  /** Get the table we store values in */
+  std::shared_ptr<FusionBinaryTable>
+  getTable()
+  {
+    return myTable;
+  }
+
   /** Number of true non-missing values expected */
   size_t
   getValueCount()
@@ -303,6 +324,25 @@ public:
     myStorage[partIndex]->add(vvp, x, y, z);
   }
 
+  /** We can merge other Stage2Data partitions into ours */
+  virtual bool
+  canMerge() override { return true; }
+
+  /** Merge the partition storage of another Stage2Data into ours */
+  virtual void
+  merge(VolumeValueIO& other) override
+  {
+    auto * o = dynamic_cast<Stage2Data *>(&other);
+
+    if ((o == nullptr) || (o->myStorage.size() != myStorage.size())) {
+      fLogSevere("Can't merge stage2 data, partitions don't match.");
+      return;
+    }
+    for (size_t i = 0; i < myStorage.size(); ++i) {
+      myStorage[i]->merge(*(o->myStorage[i]));
+    }
+  }
+
   /** Send/write stage2 data.  Give an algorithm pointer so we call do alg things if needed. */
   virtual void
   send(RAPIOAlgorithm * alg, Time aTime, const std::string& asName) override;
@@ -426,4 +466,42 @@ protected:
   // For send need N storage
   std::vector<std::shared_ptr<Stage2Storage> > myStorage; ///< Storage for a tile or area
 };
+
+/** Builds the sparse stage2 output of a merged partition grid, as written
+ * by fusion stage two.  Readers keep cells they aren't sent until they
+ * expire, so between full writes only the layer rows that changed are
+ * added.  Cells we sent before that have lost all coverage go as missing,
+ * so readers drop the old value.
+ *
+ * @author Robert Toomey
+ */
+class Stage2Delta {
+public:
+
+  /** Create for a grid size, writing every row each fullCycles calls */
+  Stage2Delta(size_t numX, size_t numY, size_t numZ, size_t fullCycles);
+
+  /** Add the rows of each layer of the grid that changed since the last call
+   * to the table, or all of them if it's time for a full write.  Values
+   * are added with a weight of 1, missing as runs along x.
+   * @return Number of rows added */
+  size_t
+  add(LLHGridN2D& grid, FusionBinaryTable& table, bool& full);
+
+  /** Number of rows in all layers */
+  size_t
+  getNumRows() const
+  {
+    return myNumY * myNumZ;
+  }
+
+protected:
+  size_t myNumX;                     ///< Columns of each layer
+  size_t myNumY;                     ///< Rows of each layer
+  size_t myNumZ;                     ///< Number of layers
+  size_t myFullCycles;               ///< Calls between full writes
+  size_t myCycle;                    ///< Calls so far
+  std::vector<uint64_t> myRowHashes; ///< Hash of each layer row at the last call
+  Bitset1 mySent;                    ///< Cells we sent a value or missing for
+};
 }
@@ -97,6 +97,29 @@ public:
     }
   }
 
+  /** We can merge other velocity tables into ours */
+  virtual bool
+  canMerge() override { return true; }
+
+  /** Append the gathered values of another VelVolumeValueIO to ours */
+  virtual void
+  merge(VolumeValueIO& other) override
+  {
+    auto * o = dynamic_cast<VelVolumeValueIO *>(&other);
+
+    if (o == nullptr) {
+      fLogSevere("Can't merge velocity data from a different IO type.");
+      return;
+    }
+    myValues.insert(myValues.end(), o->myValues.begin(), o->myValues.end());
+    myUXs.insert(myUXs.end(), o->myUXs.begin(), o->myUXs.end());
+    myUYs.insert(myUYs.end(), o->myUYs.begin(), o->myUYs.end());
+    myUZs.insert(myUZs.end(), o->myUZs.begin(), o->myUZs.end());
+    myLatDegs.insert(myLatDegs.end(), o->myLatDegs.begin(), o->myLatDegs.end());
+    myLonDegs.insert(myLonDegs.end(), o->myLonDegs.begin(), o->myLonDegs.end());
+    myHeightMeters.insert(myHeightMeters.end(), o->myHeightMeters.begin(), o->myHeightMeters.end());
+  }
+
   /** Send/write stage2 data.  Give an algorithm pointer so we call do alg things if needed. */
   virtual void
   send(RAPIOAlgorithm * alg, Time aTime, const std::string& asName) override
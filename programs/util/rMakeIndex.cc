@@ -140,7 +140,7 @@ public:
       }
       if (selects.size() > 1) {
         Record rec(params, factory, aTime, selects[1], selects[2]);
-        Record::theRecordQueue->addRecord(rec);
+        Record::theRecordQueue->addRecord(std::move(rec));
       }
       // -------------------------------------------------------------------
     } else {
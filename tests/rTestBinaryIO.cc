@@ -2,6 +2,7 @@
 #include "rBOOSTTest.h"
 
 #include "rBinaryIO.h"
+#include "rMemoryMappedFile.h"
 
 #include <fstream>
 #include <string>
@@ -149,4 +150,41 @@ BOOST_AUTO_TEST_CASE(STREAMBUFFER_ALL_FUNCTIONS)
   std::remove(GZIP_PATH);
 }
 
+BOOST_AUTO_TEST_CASE(MEMORY_MAPPED_FILE)
+{
+  // Missing file doesn't map
+  BOOST_CHECK(MemoryMappedFile::Create("/tmp/no_such_mapped_file.dat") == nullptr);
+
+  {
+    std::ofstream out(FILE_PATH, std::ios::binary);
+    out.write(TEST_STRING.data(), 8);
+    out.write(reinterpret_cast<const char *>(TEST_VECTOR.data()), TEST_VECTOR_SIZE);
+  }
+
+  auto m = MemoryMappedFile::Create(FILE_PATH);
+
+  BOOST_REQUIRE(m != nullptr);
+  BOOST_CHECK(m->isOpen());
+  BOOST_CHECK_EQUAL(m->size(), 8 + TEST_VECTOR_SIZE);
+  BOOST_CHECK_EQUAL(std::string(m->data(), 5), "Hello");
+
+  // Typed access in bounds
+  const float * f = m->getPointer<float>(8, TEST_VECTOR.size());
+
+  BOOST_REQUIRE(f != nullptr);
+  for (size_t i = 0; i < TEST_VECTOR.size(); ++i) {
+    BOOST_CHECK_EQUAL(f[i], TEST_VECTOR[i]);
+  }
+
+  // Out of bounds gives nullptr
+  BOOST_CHECK(m->getPointer<float>(8, TEST_VECTOR.size() + 1) == nullptr);
+  BOOST_CHECK(m->getPointer<char>(m->size() + 1) == nullptr);
+
+  m->close();
+  BOOST_CHECK(!m->isOpen());
+  BOOST_CHECK(m->getPointer<char>(0) == nullptr);
+
+  std::remove(FILE_PATH);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
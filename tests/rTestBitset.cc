@@ -86,4 +86,28 @@ BOOST_AUTO_TEST_CASE(BITSET_CREATION)
   BOOST_CHECK_EQUAL(true, good);
 }
 
+/** Test merging Bitset1 filled separately, such as by threads */
+BOOST_AUTO_TEST_CASE(BITSET1_MERGE)
+{
+  const std::vector<size_t> dims = { 10, 5, 3 };
+  Bitset1 all(dims);
+  Bitset1 layer0(dims);
+  Bitset1 layer2(dims);
+
+  all.set13D(1, 1, 0);
+  all.set13D(9, 4, 2);
+  layer0.set13D(1, 1, 0);
+  layer2.set13D(9, 4, 2);
+
+  BOOST_CHECK_EQUAL(layer0.merge(layer2), true);
+  BOOST_CHECK_EQUAL(layer0.getAllOnBits(), all.getAllOnBits());
+  BOOST_CHECK_EQUAL(layer0.get13D(9, 4, 2), true);
+  BOOST_CHECK_EQUAL(layer0.get13D(1, 1, 0), true);
+
+  // Different sizes can't merge
+  Bitset1 other({ 2, 2, 2 });
+
+  BOOST_CHECK_EQUAL(layer0.merge(other), false);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -6,6 +6,7 @@
 #include "rIOXML.h"
 #include "rFactory.h"
 #include <fstream>
+#include <cmath>
 #include <map>
 
 using namespace rapio;
@@ -150,4 +151,60 @@ BOOST_AUTO_TEST_CASE(TEST_PARA_COLORMAP_PARSING)
   OS::deleteFile(tempParaFile);
 }
 
+// ============================================================================
+// TEST 4: Lookup table colorize matches getColor
+// ============================================================================
+BOOST_AUTO_TEST_CASE(TEST_COLORIZE_TABLE)
+{
+  auto colorMap = std::make_shared<DefaultColorMap>();
+
+  colorMap->addBin(false, "low", 0.0, -HUGE_VAL, 10, 10, 10, 255, 10, 10, 10, 255);
+  colorMap->addBin(true, "ramp", 10.0, 0.0, 0, 0, 0, 255, 255, 128, 0, 255);
+  colorMap->addBin(false, "mid", 10.5, 10.0, 0, 255, 0, 255, 0, 255, 0, 255);
+
+  // Past the last bin is the last bin's color
+  float top = 50.0f;
+  uint32_t c;
+
+  colorMap->colorize(&top, &c, 1);
+  BOOST_CHECK_EQUAL(c, ColorMap::packColor(0, 255, 0, 255));
+
+  // Adding a bin rebuilds the table
+  colorMap->addBin(false, "high", HUGE_VAL, 10.5, 0, 0, 255, 255, 0, 0, 255, 255);
+  colorMap->colorize(&top, &c, 1);
+  BOOST_CHECK_EQUAL(c, ColorMap::packColor(0, 0, 255, 255));
+  colorMap->setMissingColor(1, 2, 3, 4);
+  colorMap->setUnavailableColor(5, 6, 7, 8);
+
+  std::vector<float> values = { static_cast<float>(double(Constants::MissingData)),
+                                static_cast<float>(double(Constants::DataUnavailable)),
+                                0.0f, 10.0f, 10.5f, -HUGE_VALF, HUGE_VALF, std::nanf("") };
+
+  for (float v = -20.0f; v < 30.0f; v += 0.0137f) {
+    values.push_back(v);
+  }
+  std::vector<uint32_t> colors(values.size());
+
+  colorMap->colorize(values.data(), colors.data(), values.size());
+
+  size_t bad = 0;
+
+  for (size_t i = 0; i < values.size(); ++i) {
+    unsigned char r, g, b, a, r2, g2, b2, a2;
+    colorMap->getColor(values[i], r, g, b, a);
+    ColorMap::unpackColor(colors[i], r2, g2, b2, a2);
+
+    // Ramp is quantized to the table, everything else is exact
+    const int slop = ((values[i] > 0.0f) && (values[i] < 10.0f)) ? 1 : 0;
+    if ((std::abs(r - r2) > slop) || (std::abs(g - g2) > slop) ||
+      (std::abs(b - b2) > slop) || (std::abs(a - a2) > slop))
+    {
+      bad++;
+    }
+  }
+  BOOST_CHECK_EQUAL(bad, 0);
+  BOOST_CHECK_EQUAL(colors[0], ColorMap::packColor(1, 2, 3, 4));
+  BOOST_CHECK_EQUAL(colors[1], ColorMap::packColor(5, 6, 7, 8));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
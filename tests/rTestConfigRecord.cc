@@ -0,0 +1,93 @@
+// Add this at top for any BOOST test
+#include "rBOOSTTest.h"
+
+/** Test reading records from FML text. */
+#include "rConfigRecord.h"
+#include "rIOXML.h"
+#include "rFactory.h"
+
+#include <sstream>
+
+using namespace rapio;
+
+namespace {
+/** Read with the property tree, the way FMLIndex used to */
+bool
+readTree(const std::string& text, Record& rec)
+{
+  std::vector<char> buf(text.begin(), text.end());
+  auto doc = IODataType::readBuffer<PTreeData>(buf, "xml");
+
+  if (doc == nullptr) { return false; }
+  auto item = doc->getTree()->getChild("item");
+
+  return ConfigRecord::readXML(rec, item, "/index", 0);
+}
+
+/** Read with the direct FML reader */
+bool
+readFast(const std::string& text, Record& rec, bool& handled)
+{
+  return ConfigRecord::readFML(rec, text.data(), text.data() + text.size(), "/index", 0, handled);
+}
+}
+
+BOOST_AUTO_TEST_SUITE(CONFIGRECORD)
+
+BOOST_AUTO_TEST_CASE(CONFIGRECORD_FML)
+{
+  Factory<IODataType>::introduce("xml", std::make_shared<IOXML>());
+
+  // Round trip what the FML notifier writes
+  std::vector<std::string> params = { "netcdf", "/index", "Reflectivity/00.50/19990503-213435.netcdf.gz" };
+  Record out(params, "netcdf", Time::SecondsSinceEpoch(925767275, 0.25), "Reflectivity", "00.50");
+
+  out.setValue("Color", "Red and blue");
+  std::stringstream ss;
+
+  ss << "<item>\n";
+  ConfigRecord::constructXMLString(out, ss, "/index");
+  ss << "</item>\n";
+
+  Record a, b;
+  bool handled = false;
+
+  BOOST_REQUIRE(readTree(ss.str(), a));
+  BOOST_REQUIRE(readFast(ss.str(), b, handled));
+  BOOST_CHECK(handled);
+  BOOST_CHECK(a.getTime() == b.getTime());
+  BOOST_CHECK(b.getTime() == out.getTime());
+  BOOST_CHECK(a.getParams() == b.getParams());
+  BOOST_CHECK(b.getParams() == params);
+  BOOST_CHECK(a.getSelections() == b.getSelections());
+  BOOST_CHECK(a.getKeys() == b.getKeys());
+  BOOST_CHECK(a.getValues() == b.getValues());
+
+  // Old style event message
+  const std::string event =
+    "<item>\n <time fractional=\"0.358000\"> 1747425326 </time>\n"
+    " <params>Event 3530 </params>\n <selections>20250516-195526.358 NewVolume </selections>\n</item>\n";
+  Record e;
+
+  BOOST_REQUIRE(readFast(event, e, handled));
+  BOOST_CHECK(handled);
+  BOOST_CHECK(!e.isData());
+  BOOST_CHECK_EQUAL(e.getString("Count"), "3530");
+  BOOST_CHECK_EQUAL(e.getString("MessageText"), "NewVolume");
+
+  // Anything else is left for the XML reader
+  const std::vector<std::string> others = {
+    "<item t=\"925776886.46\" p=\"netcdf /a.netcdf\" s=\"19990504-001446.460 Reflectivity 05.25\" />",
+    "<item><time> 10 </time><params>netcdf /a&amp;b</params></item>",
+    "<item><!-- comment --><time> 10 </time><params>netcdf /a</params></item>",
+    "<item><time> 10 </time><params>netcdf /a</params></item><item>"
+  };
+
+  for (auto& o:others) {
+    Record r;
+    readFast(o, r, handled);
+    BOOST_CHECK(!handled);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END();
@@ -0,0 +1,169 @@
+// Add this at top for any BOOST test
+#include "rBOOSTTest.h"
+
+/** Test fusion binary table read/write versions */
+#include "rFusionBinaryTable.h"
+
+#include <cstdio>
+
+using namespace rapio;
+
+namespace {
+const char * FUSION_PATH = "/tmp/fusion_table_test.raw";
+
+/** Fill a table with some values and missing runs */
+void
+fillTable(FusionBinaryTable& t)
+{
+  t.setString("Radarname", "KTLX");
+  t.setString("Typename", "Reflectivity");
+  t.setUnits("dBZ");
+  for (short i = 0; i < 100; ++i) {
+    float n = i * 1.5;
+    float d = i + 0.25;
+    short x = i;
+    short y = 200 - i;
+    short z = i % 30;
+    t.add(n, d, x, y, z);
+  }
+  for (size_t i = 0; i < 10; ++i) {
+    size_t x = i * 3, y = i, z = i % 5, l = i + 1;
+    t.addMissing(x, y, z, l);
+  }
+}
+
+/** Write a table with a version and read it back */
+std::shared_ptr<FusionBinaryTable>
+roundTrip(size_t version, bool stream)
+{
+  FusionBinaryTable out;
+
+  fillTable(out);
+  FusionBinaryTable::myWriteVersion = version;
+  FILE * fp = fopen(FUSION_PATH, "wb");
+
+  BOOST_REQUIRE(fp != nullptr);
+  BOOST_CHECK(out.writeBlock(fp));
+  fclose(fp);
+
+  FusionBinaryTable::myStreamRead = stream;
+  auto in = std::make_shared<FusionBinaryTable>();
+
+  fp = fopen(FUSION_PATH, "rb");
+  BOOST_REQUIRE(fp != nullptr);
+  BOOST_CHECK(in->readBlock(FUSION_PATH, fp));
+  fclose(fp);
+  return in;
+}
+
+/** Check streamed values against what we wrote */
+void
+checkStream(FusionBinaryTable& in)
+{
+  FusionBinaryTable want;
+
+  fillTable(want);
+  float n, d;
+  short x, y, z;
+
+  for (size_t i = 0; i < want.myXs.size(); ++i) {
+    BOOST_REQUIRE(in.get(n, d, x, y, z));
+    BOOST_CHECK_EQUAL(n, want.myNums[i]);
+    BOOST_CHECK_EQUAL(d, want.myDems[i]);
+    BOOST_CHECK_EQUAL(x, want.myXs[i]);
+    BOOST_CHECK_EQUAL(y, want.myYs[i]);
+    BOOST_CHECK_EQUAL(z, want.myZs[i]);
+  }
+
+  // Missing runs expand along x
+  for (size_t i = 0; i < want.myXMissings.size(); ++i) {
+    for (short l = 0; l < want.myLMissings[i]; ++l) {
+      BOOST_REQUIRE(in.get(n, d, x, y, z));
+      BOOST_CHECK_EQUAL(n, Constants::MissingData);
+      BOOST_CHECK_EQUAL(x, want.myXMissings[i] + l);
+      BOOST_CHECK_EQUAL(y, want.myYMissings[i]);
+      BOOST_CHECK_EQUAL(z, want.myZMissings[i]);
+    }
+  }
+  BOOST_CHECK(!in.get(n, d, x, y, z));
+}
+}
+
+BOOST_AUTO_TEST_SUITE(FUSIONBINARYTABLE)
+
+BOOST_AUTO_TEST_CASE(FUSIONBINARYTABLE_VERSIONS)
+{
+  FusionBinaryTable want;
+
+  fillTable(want);
+
+  // Full reads of both versions match what we wrote
+  for (size_t version = 1; version <= 2; ++version) {
+    auto in = roundTrip(version, false);
+    BOOST_CHECK_EQUAL(in->getValueSize(), want.myXs.size());
+    BOOST_CHECK_EQUAL(in->getMissingSize(), want.myXMissings.size());
+    BOOST_CHECK(in->myXs == want.myXs);
+    BOOST_CHECK(in->myYs == want.myYs);
+    BOOST_CHECK(in->myZs == want.myZs);
+    BOOST_CHECK(in->myNums == want.myNums);
+    BOOST_CHECK(in->myDems == want.myDems);
+    BOOST_CHECK(in->myXMissings == want.myXMissings);
+    BOOST_CHECK(in->myYMissings == want.myYMissings);
+    BOOST_CHECK(in->myZMissings == want.myZMissings);
+    BOOST_CHECK(in->myLMissings == want.myLMissings);
+    std::string r;
+    in->getString("Radarname", r);
+    BOOST_CHECK_EQUAL(r, "KTLX");
+  }
+
+  // Streamed reads of both versions match
+  for (size_t version = 1; version <= 2; ++version) {
+    auto in = roundTrip(version, true);
+    checkStream(*in);
+  }
+
+  FusionBinaryTable::myStreamRead   = false;
+  FusionBinaryTable::myWriteVersion = 2;
+  std::remove(FUSION_PATH);
+}
+
+BOOST_AUTO_TEST_CASE(FUSIONBINARYTABLE_APPEND)
+{
+  // Two halves appended match one table filled with both
+  FusionBinaryTable a, b, want;
+
+  for (short i = 0; i < 20; ++i) {
+    float n = i * 2.5;
+    float d = 1 + i;
+    short x = i, y = i * 2, z = i % 4;
+    (i < 12 ? a : b).add(n, d, x, y, z);
+    want.add(n, d, x, y, z);
+  }
+  for (size_t i = 0; i < 6; ++i) {
+    size_t x = i, y = i + 1, z = i % 3, l = i + 2;
+    (i < 2 ? a : b).addMissing(x, y, z, l);
+    want.addMissing(x, y, z, l);
+  }
+
+  a.append(b);
+  BOOST_CHECK_EQUAL(a.getValueSize(), want.getValueSize());
+  BOOST_CHECK_EQUAL(a.getMissingSize(), want.getMissingSize());
+  BOOST_CHECK(a.myXs == want.myXs);
+  BOOST_CHECK(a.myYs == want.myYs);
+  BOOST_CHECK(a.myZs == want.myZs);
+  BOOST_CHECK(a.myNums == want.myNums);
+  BOOST_CHECK(a.myDems == want.myDems);
+  BOOST_CHECK(a.myXMissings == want.myXMissings);
+  BOOST_CHECK(a.myYMissings == want.myYMissings);
+  BOOST_CHECK(a.myZMissings == want.myZMissings);
+  BOOST_CHECK(a.myLMissings == want.myLMissings);
+
+  // Appending an empty table changes nothing
+  FusionBinaryTable empty;
+
+  a.append(empty);
+  BOOST_CHECK_EQUAL(a.getValueSize(), want.getValueSize());
+  BOOST_CHECK_EQUAL(a.getMissingSize(), want.getMissingSize());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,187 @@
+// Add this at top for any BOOST test
+#include "rBOOSTTest.h"
+
+/** Test fusion roster range file read/write */
+#include "../programs/fusion/rFusionCache.h"
+
+#include <cstdio>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace rapio;
+
+namespace {
+const char * RANGE_PATH = "/tmp/fusion_range_test.cache";
+const char * PROJ_PATH  = "/tmp/fusion_projection_test.proj";
+const size_t NUMX       = 50;
+const size_t NUMY       = 40;
+const size_t NUMZ       = 3;
+
+/** Ranges from a fake radar at the grid center, out past maxRange */
+std::vector<FusionRangeCache>
+createRanges(float bump)
+{
+  std::vector<FusionRangeCache> ranges;
+
+  for (size_t z = 0; z < NUMZ; ++z) {
+    for (size_t y = 0; y < NUMY; ++y) {
+      for (size_t x = 0; x < NUMX; ++x) {
+        const float dx = (float) x - 25.0f, dy = (float) y - 20.0f;
+        ranges.push_back(std::sqrt(dx * dx + dy * dy) * 1.13f + z * 0.3f + bump);
+      }
+    }
+  }
+  return ranges;
+}
+
+/** Size of a file on disk */
+off_t
+projectionSize(const char * path)
+{
+  struct stat info;
+
+  return (::stat(path, &info) == 0) ? info.st_size : 0;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(FUSIONCACHE)
+
+BOOST_AUTO_TEST_CASE(FUSIONCACHE_RANGEFILE)
+{
+  const LengthKMs maxRange = 15.0;
+  const LengthKMs res      = 0.025;
+  auto ranges = createRanges(0);
+
+  std::remove(RANGE_PATH);
+  BOOST_REQUIRE(FusionCache::writeRangeFile(RANGE_PATH, 7, 9, NUMX, NUMY, ranges, maxRange, res));
+
+  // Only the covered box is stored, much smaller than the raw floats
+  struct stat info;
+
+  BOOST_REQUIRE(::stat(RANGE_PATH, &info) == 0);
+  BOOST_CHECK(size_t(info.st_size) < ranges.size() * sizeof(FusionRangeCache) / 2);
+
+  // Covered cells are within a step, everything else never nearest
+  size_t sx, sy, nx, ny;
+  std::vector<FusionRangeCache> out;
+
+  BOOST_REQUIRE(FusionCache::readRangeFile(RANGE_PATH, sx, sy, nx, ny, out));
+  BOOST_CHECK_EQUAL(sx, 7);
+  BOOST_CHECK_EQUAL(sy, 9);
+  BOOST_CHECK_EQUAL(nx, NUMX);
+  BOOST_CHECK_EQUAL(ny, NUMY);
+  BOOST_REQUIRE_EQUAL(out.size(), ranges.size());
+  bool good = true;
+
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    if (ranges[i] <= maxRange) {
+      good &= (std::abs(out[i] - ranges[i]) <= res / 2 + 1e-4);
+    } else {
+      good &= (out[i] == std::numeric_limits<FusionRangeCache>::max());
+    }
+  }
+  BOOST_CHECK(good);
+
+  // Same content keeps the checksum, different content changes it
+  uint64_t first, second, third;
+
+  BOOST_REQUIRE(FusionCache::readRangeChecksum(RANGE_PATH, first));
+  BOOST_REQUIRE(FusionCache::writeRangeFile(RANGE_PATH, 7, 9, NUMX, NUMY, ranges, maxRange, res));
+  BOOST_REQUIRE(FusionCache::readRangeChecksum(RANGE_PATH, second));
+  BOOST_CHECK_EQUAL(first, second);
+
+  auto moved = createRanges(0.5);
+
+  BOOST_REQUIRE(FusionCache::writeRangeFile(RANGE_PATH, 7, 9, NUMX, NUMY, moved, maxRange, res));
+  BOOST_REQUIRE(FusionCache::readRangeChecksum(RANGE_PATH, third));
+  BOOST_CHECK(first != third);
+
+  // A corrupted payload is rejected
+  {
+    std::FILE * f = std::fopen(RANGE_PATH, "r+b");
+    BOOST_REQUIRE(f != nullptr);
+    std::fseek(f, -3, SEEK_END);
+    std::fputc(0x5A, f);
+    std::fclose(f);
+  }
+  BOOST_CHECK(!FusionCache::readRangeFile(RANGE_PATH, sx, sy, nx, ny, out));
+
+  std::remove(RANGE_PATH);
+}
+
+BOOST_AUTO_TEST_CASE(FUSIONCACHE_PROJECTIONFILE)
+{
+  LLCoverageArea grid;
+
+  BOOST_REQUIRE(grid.parse("nw(37, -100) se(36.5, -99.4) h(0.5,2,NMQWD) s(0.05, 0.05)"));
+  const size_t cells = grid.getNumX() * grid.getNumY();
+
+  BOOST_REQUIRE(cells > 0);
+  BOOST_REQUIRE(grid.getNumZ() > 1);
+
+  // Fake projection values, different per cell and layer
+  SinCosLatLonCache sinCos(grid.getNumX(), grid.getNumY());
+  std::vector<std::shared_ptr<AzRanElevCache> > layers;
+
+  for (size_t i = 0; i < cells; ++i) {
+    sinCos.set(i, std::sin(i * 0.01), std::cos(i * 0.01));
+  }
+  for (size_t z = 0; z < grid.getNumZ(); ++z) {
+    auto l = std::make_shared<AzRanElevCache>(grid.getNumX(), grid.getNumY());
+    for (size_t i = 0; i < cells; ++i) {
+      l->setAt(i % 360, z + i * 0.001, i * 0.5);
+      l->next();
+    }
+    layers.push_back(l);
+  }
+
+  const AngleDegs lat = 36.7, lon = -99.7;
+  const LengthKMs height = 0.4;
+
+  std::remove(PROJ_PATH);
+  BOOST_REQUIRE(FusionCache::writeProjectionFile(PROJ_PATH, lat, lon, height, grid, sinCos, layers));
+
+  // Mapped back values match what we wrote
+  std::shared_ptr<SinCosLatLonCache> sinCosOut;
+  std::vector<std::shared_ptr<AzRanElevCache> > layersOut;
+
+  BOOST_REQUIRE(FusionCache::readProjectionFile(PROJ_PATH, lat, lon, height, grid, sinCosOut, layersOut));
+  BOOST_REQUIRE(sinCosOut != nullptr);
+  BOOST_REQUIRE_EQUAL(sinCosOut->size(), cells);
+  BOOST_REQUIRE_EQUAL(layersOut.size(), layers.size());
+  BOOST_CHECK(std::equal(sinCos.sinGcdIRData(), sinCos.sinGcdIRData() + cells, sinCosOut->sinGcdIRData()));
+  BOOST_CHECK(std::equal(sinCos.cosGcdIRData(), sinCos.cosGcdIRData() + cells, sinCosOut->cosGcdIRData()));
+  bool good = true;
+
+  for (size_t z = 0; z < layers.size(); ++z) {
+    auto& a = layers[z];
+    auto& b = layersOut[z];
+    good &= std::equal(a->azimuthData(), a->azimuthData() + cells, b->azimuthData());
+    good &= std::equal(a->elevationData(), a->elevationData() + cells, b->elevationData());
+    good &= std::equal(a->rangeData(), a->rangeData() + cells, b->rangeData());
+  }
+  BOOST_CHECK(good);
+
+  // The data is aligned for direct use from the mapping
+  BOOST_CHECK_EQUAL(reinterpret_cast<uintptr_t>(sinCosOut->sinGcdIRData()) % alignof(double), 0);
+
+  // A different radar or grid doesn't use the file
+  BOOST_CHECK(!FusionCache::readProjectionFile(PROJ_PATH, lat + 0.01, lon, height, grid, sinCosOut, layersOut));
+  BOOST_CHECK(!FusionCache::readProjectionFile(PROJ_PATH, lat, lon, height + 0.1, grid, sinCosOut, layersOut));
+  LLCoverageArea other;
+
+  BOOST_REQUIRE(other.parse("nw(37, -100) se(36.5, -99.4) h(0.5,2,NMQWD) s(0.05, 0.06)"));
+  BOOST_CHECK(!FusionCache::readProjectionFile(PROJ_PATH, lat, lon, height, other, sinCosOut, layersOut));
+  LLCoverageArea fewer;
+
+  BOOST_REQUIRE(fewer.parse("nw(37, -100) se(36.5, -99.4) h(0.5,1.5,NMQWD) s(0.05, 0.05)"));
+  BOOST_CHECK(!FusionCache::readProjectionFile(PROJ_PATH, lat, lon, height, fewer, sinCosOut, layersOut));
+
+  // A truncated file is rejected
+  BOOST_REQUIRE(::truncate(PROJ_PATH, projectionSize(PROJ_PATH) - 8) == 0);
+  BOOST_CHECK(!FusionCache::readProjectionFile(PROJ_PATH, lat, lon, height, grid, sinCosOut, layersOut));
+
+  std::remove(PROJ_PATH);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
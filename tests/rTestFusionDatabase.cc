@@ -0,0 +1,303 @@
+// Add this at top for any BOOST test
+#include "rBOOSTTest.h"
+
+/** Test fusion stage2 database merging. */
+#include "../programs/fusion/rFusionDatabase.h"
+
+#include <cstdio>
+#include <fstream>
+
+using namespace rapio;
+
+namespace {
+const size_t NUMX = 40;
+const size_t NUMY = 30;
+const size_t NUMZ = 5;
+
+/** Create an output cache with a weight buffer per layer, like rFusion2 */
+std::shared_ptr<LLHGridN2D>
+createCache(size_t numX, size_t numY)
+{
+  auto cache = LLHGridN2D::Create("Test", "dBZ", Time(), LLH(40, -100, 0), 0.01, 0.01, numY, numX, NUMZ);
+
+  for (size_t z = 0; z < NUMZ; ++z) {
+    cache->get(z)->addFloat2D("weights", "Dimensionless", { 0, 1 });
+  }
+  return cache;
+}
+
+/** Fill a database with overlapping sources, some missing */
+void
+fillDatabase(FusionDatabase& db, time_t t)
+{
+  for (size_t s = 0; s < 3; ++s) {
+    auto list = db.getSourceList("Radar" + std::to_string(s));
+    for (size_t z = 0; z < NUMZ; ++z) {
+      for (size_t y = s; y < NUMY; y += 2) {
+        for (size_t x = 0; x < NUMX - s; x += 1 + s) {
+          const float v = (x * 0.37f) + (y * 1.3f) + z + s;
+          const float w = 0.1f + (s * 0.25f);
+          db.addObservation(*list, v * w, w, x, y, z, t);
+        }
+      }
+      db.addMissing(*list, NUMX - 1, NUMY - 1, z, t, false);
+    }
+  }
+}
+
+/** Check every layer of two caches are exactly the same */
+void
+checkSame(LLHGridN2D& a, LLHGridN2D& b)
+{
+  for (size_t z = 0; z < NUMZ; ++z) {
+    auto& ga = a.get(z)->getFloat2DRef();
+    auto& gb = b.get(z)->getFloat2DRef();
+    for (size_t y = 0; y < a.getNumLats(); ++y) {
+      for (size_t x = 0; x < a.getNumLons(); ++x) {
+        BOOST_REQUIRE_EQUAL(ga[y][x], gb[y][x]);
+      }
+    }
+  }
+}
+}
+
+BOOST_AUTO_TEST_SUITE(FUSIONDATABASE)
+
+BOOST_AUTO_TEST_CASE(FUSIONDATABASE_PARALLEL_MERGE)
+{
+  const time_t t = 1000;
+  FusionDatabase db(NUMX, NUMY, NUMZ);
+
+  fillDatabase(db, t);
+
+  // Full grid and a clipped tile, serial vs threaded
+  for (size_t tile = 0; tile < 2; ++tile) {
+    const size_t offX = tile ? 7 : 0;
+    const size_t offY = tile ? 5 : 0;
+    const size_t nx   = tile ? 20 : NUMX;
+    const size_t ny   = tile ? 15 : NUMY;
+
+    auto serialMerge = createCache(nx, ny);
+    auto serialMax   = createCache(nx, ny);
+    db.setThreadCount(1);
+    db.mergeTo(serialMerge, t, offX, offY, -1);
+    db.maxTo(serialMax, t, offX, offY, -1);
+
+    auto threadMerge = createCache(nx, ny);
+    auto threadMax   = createCache(nx, ny);
+    db.setThreadCount(3);
+    db.mergeTo(threadMerge, t, offX, offY, -1);
+    db.maxTo(threadMax, t, offX, offY, -1);
+
+    checkSame(*serialMerge, *threadMerge);
+    checkSame(*serialMax, *threadMax);
+  }
+
+  // Spot check a weighted average and the missing mask
+  auto cache = createCache(NUMX, NUMY);
+
+  db.mergeTo(cache, t, 0, 0, -1);
+  auto& g = cache->get(0)->getFloat2DRef();
+
+  BOOST_CHECK_CLOSE(g[0][0], 0.0f, 0.001);
+  BOOST_CHECK_EQUAL(g[NUMY - 1][NUMX - 1], Constants::MissingData);
+  BOOST_CHECK_EQUAL(g[1][1], Constants::DataUnavailable);
+}
+
+BOOST_AUTO_TEST_CASE(FUSIONDATABASE_COMPACT_STORAGE)
+{
+  SourceList s("KTLX", 0, NUMZ);
+
+  s.setEpoch(1000);
+
+  // Consecutive missing cells join into a single run
+  for (short x = 3; x < 8; ++x) {
+    s.addMissing(x, 2, 1, 1000);
+  }
+  BOOST_REQUIRE_EQUAL(s.myAMObs[1].size(), 1);
+  BOOST_CHECK_EQUAL(s.myAMObs[1].myL[0], 5);
+  s.addMissing(9, 2, 1, 1000); // gap
+  s.addMissing(10, 3, 1, 1000); // new row
+  BOOST_CHECK_EQUAL(s.myAMObs[1].size(), 3);
+
+  // Times are relative to the epoch
+  s.addObservation(4, 4, 0, 10.0, 1.0, 990);
+  s.addObservation(5, 4, 0, 20.0, 1.0, 1000);
+  BOOST_CHECK_EQUAL(s.myAObs[0].myT[0], -10);
+  BOOST_CHECK_EQUAL(s.myAObs[0].myT[1], 0);
+
+  // Union into a newer source shifts times to its epoch
+  SourceList n("KTLX", 0, NUMZ);
+
+  n.setEpoch(1100);
+  Bitset1 mask({ NUMX, NUMY, NUMZ });
+  size_t purged = 0, restored = 0;
+
+  mask.set13D(5, 4, 0); // new source replaced this one
+  s.unionMerge(n, mask, 995, purged, restored);
+  BOOST_CHECK_EQUAL(purged, 1);
+  BOOST_CHECK_EQUAL(restored, 0);
+  BOOST_CHECK_EQUAL(n.myAObs[0].size(), 0);
+  BOOST_REQUIRE_EQUAL(n.myAMObs[1].size(), 3);
+  BOOST_CHECK_EQUAL(n.myAMObs[1].myT[0], -100);
+
+  // Purge by absolute time
+  n.timePurge(1000);
+  BOOST_CHECK_EQUAL(n.myAMObs[1].size(), 3);
+  n.timePurge(1001);
+  BOOST_CHECK_EQUAL(n.myAMObs[1].size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(FUSIONDATABASE_MISSING_REPLACED)
+{
+  Bitset1 mask({ NUMX, NUMY, NUMZ });
+  auto current = std::make_shared<SourceList>("KTLX", 0, NUMZ);
+
+  // The same missing block every heartbeat only keeps the newest runs
+  for (time_t t = 1000; t <= 1300; t += 30) {
+    auto n = std::make_shared<SourceList>("KTLX", 0, NUMZ);
+    n->setEpoch(t);
+    mask.clearAllBits();
+    for (short y = 5; y < 10; ++y) {
+      for (short x = 2; x < 20; ++x) {
+        n->addMissing(x, y, 1, t);
+        mask.set13D(x, y, 1);
+      }
+    }
+    size_t purged = 0, restored = 0;
+    current->unionMerge(*n, mask, 0, purged, restored);
+    current = n;
+  }
+  BOOST_REQUIRE_EQUAL(current->myAMObs[1].size(), 5);
+  BOOST_CHECK_EQUAL(current->myAMObs[1].myT[0], 0);
+
+  // A partly covered old run keeps the uncovered pieces
+  auto n = std::make_shared<SourceList>("KTLX", 0, NUMZ);
+
+  n->setEpoch(1330);
+  mask.clearAllBits();
+  for (short x = 6; x < 10; ++x) {
+    n->addObservation(x, 5, 1, 1.0, 1.0, 1330);
+    mask.set13D(x, 5, 1);
+  }
+  size_t purged = 0, restored = 0;
+
+  current->unionMerge(*n, mask, 0, purged, restored);
+  auto& m = n->myAMObs[1];
+
+  BOOST_REQUIRE_EQUAL(m.size(), 6);
+  BOOST_CHECK_EQUAL(m.myX[0], 2);
+  BOOST_CHECK_EQUAL(m.myL[0], 4);
+  BOOST_CHECK_EQUAL(m.myX[1], 10);
+  BOOST_CHECK_EQUAL(m.myL[1], 10);
+  BOOST_CHECK_EQUAL(m.myT[0], -30);
+  BOOST_CHECK(n->mySorted);
+}
+
+BOOST_AUTO_TEST_CASE(FUSIONDATABASE_TIME_PURGE)
+{
+  FusionDatabase db(NUMX, NUMY, NUMZ);
+  Bitset1 mask({ NUMX, NUMY, NUMZ });
+
+  // Three ingests of the same source, each at a new time
+  std::shared_ptr<SourceList> current = db.getSourceList("KTLX");
+
+  for (time_t t = 1000; t <= 1020; t += 10) {
+    auto n = db.getNewSourceList("newone");
+    n->setEpoch(t);
+    n->addObservation(t / 10 % NUMX, 1, 0, 5.0, 1.0, t);
+    n->addMissing(t / 10 % NUMX, 2, 0, t);
+    size_t purged = 0, restored = 0;
+    mask.clearAllBits();
+    current->unionMerge(*n, mask, 0, purged, restored);
+    current = n;
+  }
+
+  // Newest first, so each ingest is a bucket at the end
+  BOOST_CHECK(current->mySorted);
+  BOOST_REQUIRE_EQUAL(current->myAObs[0].size(), 3);
+  BOOST_CHECK_EQUAL(current->myAObs[0].myT[0], 0);
+  BOOST_CHECK_EQUAL(current->myAObs[0].myT[2], -20);
+  BOOST_CHECK(!current->hasExpired(1000));
+  BOOST_CHECK(current->hasExpired(1001));
+
+  // A copy of what's kept for snapshots leaves the original alone
+  auto kept = current->purgedCopy(1005);
+
+  BOOST_CHECK_EQUAL(current->myAObs[0].size(), 3);
+  current->timePurge(1005);
+  BOOST_CHECK(kept->myAObs[0].myT == current->myAObs[0].myT);
+  BOOST_CHECK(kept->myAMObs[0].myT == current->myAMObs[0].myT);
+  BOOST_CHECK_EQUAL(kept->myOldest, current->myOldest);
+  BOOST_CHECK_EQUAL(current->myAObs[0].size(), 2);
+  BOOST_CHECK_EQUAL(current->myAMObs[0].size(), 2);
+  BOOST_CHECK_EQUAL(current->myAObs[0].myT[1], -10);
+  BOOST_CHECK(!current->hasExpired(1010));
+
+  // A late older observation breaks the order, purge still correct
+  current->addObservation(3, 3, 0, 1.0, 1.0, 1015);
+  current->addObservation(4, 3, 0, 1.0, 1.0, 1025);
+  BOOST_CHECK(!current->mySorted);
+  kept = current->purgedCopy(1016);
+  current->timePurge(1016);
+  BOOST_CHECK(kept->myAObs[0].myT == current->myAObs[0].myT);
+  BOOST_CHECK(kept->myAObs[0].myX == current->myAObs[0].myX);
+  BOOST_CHECK_EQUAL(kept->myOldest, current->myOldest);
+  BOOST_REQUIRE_EQUAL(current->myAObs[0].size(), 2);
+  BOOST_CHECK_EQUAL(current->myAObs[0].myT[0], 0);
+  BOOST_CHECK_EQUAL(current->myAObs[0].myT[1], 5);
+  BOOST_CHECK_EQUAL(current->myAMObs[0].size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(FUSIONDATABASE_SNAPSHOT)
+{
+  const time_t t = 1000;
+  const std::string path = "/tmp/fusion_snapshot_test.snap";
+  FusionDatabase db(NUMX, NUMY, NUMZ);
+
+  fillDatabase(db, t);
+  BOOST_REQUIRE(db.writeSnapshot(path, Time::SecondsSinceEpoch(t)));
+
+  // Purging while the writer holds the lists doesn't change what it writes
+  db.timePurge(Time::SecondsSinceEpoch(t + 10), TimeDuration::Seconds(1));
+  BOOST_REQUIRE(db.waitForSnapshot());
+
+  // Restored database merges the same as the original
+  FusionDatabase fresh(NUMX, NUMY, NUMZ);
+  FusionDatabase original(NUMX, NUMY, NUMZ);
+  Time at;
+
+  fillDatabase(original, t);
+  BOOST_REQUIRE(fresh.readSnapshot(path, at));
+  BOOST_CHECK_EQUAL(at.getSecondsSinceEpoch(), t);
+  auto a = createCache(NUMX, NUMY);
+  auto b = createCache(NUMX, NUMY);
+
+  original.mergeTo(a, t, 0, 0, -1);
+  fresh.mergeTo(b, t, 0, 0, -1);
+  checkSame(*a, *b);
+
+  // A second snapshot keeps the first as .prev, which is used if the
+  // newest is damaged
+  BOOST_REQUIRE(fresh.writeSnapshot(path, Time::SecondsSinceEpoch(t + 1)));
+  BOOST_REQUIRE(fresh.waitForSnapshot());
+  {
+    std::fstream f(path, std::ios::in | std::ios::out | std::ios::binary);
+    f.seekp(100);
+    f.put(0x5A);
+  }
+  FusionDatabase fallback(NUMX, NUMY, NUMZ);
+
+  BOOST_REQUIRE(fallback.readSnapshot(path, at));
+  BOOST_CHECK_EQUAL(at.getSecondsSinceEpoch(), t);
+
+  // Snapshots of another grid are ignored
+  FusionDatabase other(NUMX + 1, NUMY, NUMZ);
+
+  BOOST_CHECK(!other.readSnapshot(path, at));
+
+  std::remove(path.c_str());
+  std::remove((path + ".prev").c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -2,6 +2,13 @@
 #include "rBOOSTTest.h"
 
 #include "rPartitionInfo.h"
+#include "rLatLonGrid.h"
+#include "rRadialSet.h"
+#include "rDataProjection.h"
+#include "rTerrainBlockage2me.h"
+#include "rOS.h"
+
+#include <boost/filesystem.hpp>
 
 using namespace rapio;
 
@@ -91,4 +98,149 @@ doneLoop:
   BOOST_CHECK(inPartitionCheck == true);
 }
 
+namespace {
+/** Check the separable batch matches single lookups exactly */
+size_t
+countGridMismatches(DataProjection& p, const std::vector<double>& lats, const std::vector<double>& lons)
+{
+  std::vector<float> out(lats.size() * lons.size());
+
+  p.getValuesAtLLGrid(lats.data(), lats.size(), lons.data(), lons.size(), out.data());
+  size_t bad = 0;
+
+  for (size_t y = 0; y < lats.size(); ++y) {
+    for (size_t x = 0; x < lons.size(); ++x) {
+      const float single = p.getValueAtLL(lats[y], lons[x]);
+      if (single != out[y * lons.size() + x]) { bad++; }
+    }
+  }
+  return bad;
+}
+}
+
+BOOST_AUTO_TEST_CASE(GRID_PROJECTION_BATCH)
+{
+  // Tile over and past the edges of the data, uneven spacing like webmerc rows
+  std::vector<double> lats, lons;
+
+  for (size_t y = 0; y < 64; ++y) {
+    lats.push_back(41.3 - (y * 0.07) - (y * y * 0.0004));
+  }
+  for (size_t x = 0; x < 80; ++x) {
+    lons.push_back(-103.2 + (x * 0.09));
+  }
+
+  // LatLonGrid
+  auto llg = LatLonGrid::Create("Test", "dBZ", LLH(40, -101, 0), Time(), 0.05, 0.05, 60, 80);
+  auto& d  = llg->getFloat2DRef();
+
+  for (size_t y = 0; y < 60; ++y) {
+    for (size_t x = 0; x < 80; ++x) {
+      d[y][x] = ((x + y) % 7 == 0) ? Constants::MissingData : (x * 0.5f) + y;
+    }
+  }
+  BOOST_CHECK_EQUAL(countGridMismatches(*llg->getProjection(Constants::PrimaryDataName), lats, lons), 0);
+
+  // RadialSet
+  const size_t numRadials = 360, numGates = 200;
+  auto rs = RadialSet::Create("Test", "dBZ", LLH(38.5, -99.5, 0.4), Time(), 0.5, 2000, 1000, numRadials, numGates);
+  auto& az = rs->getFloat1DRef(RadialSet::Azimuth);
+  auto& bw = rs->getFloat1DRef(RadialSet::BeamWidth);
+  auto& r  = rs->getFloat2DRef();
+
+  for (size_t i = 0; i < numRadials; ++i) {
+    az[i] = i;
+    bw[i] = 1;
+    for (size_t g = 0; g < numGates; ++g) {
+      r[i][g] = (g % 11 == 0) ? Constants::MissingData : (i * 0.1f) + g;
+    }
+  }
+  BOOST_CHECK_EQUAL(countGridMismatches(*rs->getProjection(), lats, lons), 0);
+}
+
+BOOST_AUTO_TEST_CASE(TERRAIN_BLOCKAGE_CACHE)
+{
+  // A ridge about 50 KM north of the radar
+  auto dem = LatLonGrid::Create("DEM", "Meters", LLH(39.5, -100.5, 0), Time(), 0.01, 0.01, 200, 200);
+  auto& h  = dem->getFloat2DRef();
+
+  for (size_t y = 0; y < 200; ++y) {
+    for (size_t x = 0; x < 200; ++x) {
+      h[y][x] = ((y > 50) && (y < 60)) ? 3000 : 100;
+    }
+  }
+
+  const LLH radar(38.5, -99.5, 0.4);
+  auto makeTilt = [&](size_t numGates){
+      auto rs  = RadialSet::Create("Test", "dBZ", radar, Time(), 0.5, 2000, 1000, 360, numGates);
+      auto& az = rs->getFloat1DRef(RadialSet::Azimuth);
+      auto& bw = rs->getFloat1DRef(RadialSet::BeamWidth);
+      for (size_t i = 0; i < 360; ++i) {
+        az[i] = i;
+        bw[i] = 1;
+      }
+      return rs;
+    };
+  auto matches = [](std::shared_ptr<RadialSet> a, std::shared_ptr<RadialSet> b){
+      auto& ac   = a->getTerrainCBBPercentRef();
+      auto& bc   = b->getTerrainCBBPercentRef();
+      auto& ah   = a->getTerrainBeamBottomHitRef();
+      auto& bh   = b->getTerrainBeamBottomHitRef();
+      size_t bad = 0;
+      for (size_t r = 0; r < a->getNumRadials(); ++r) {
+        for (size_t g = 0; g < a->getNumGates(); ++g) {
+          if ((ac[r][g] != bc[r][g]) || (ah[r][g] != bh[r][g])) { bad++; }
+        }
+      }
+      return bad;
+    };
+
+  // Straight calculation
+  auto base = std::make_shared<TerrainBlockage2me>(dem, radar, 230, "KTST", 0, 0.1);
+  auto full = makeTilt(100);
+
+  base->calculateTerrainPerGate(full);
+  BOOST_CHECK_GT(full->getTerrainCBBPercentRef()[0][99], 0.5);
+  BOOST_CHECK_EQUAL(full->getTerrainCBBPercentRef()[180][99], 0);
+
+  // A jittered tilt of the same kind uses the same azimuth bins
+  auto jitter = RadialSet::Create("Test", "dBZ", radar, Time(), 0.52, 2000, 1000, 360, 100);
+  auto& jaz   = jitter->getFloat1DRef(RadialSet::Azimuth);
+  auto& jbw   = jitter->getFloat1DRef(RadialSet::BeamWidth);
+
+  for (size_t i = 0; i < 360; ++i) {
+    jaz[i] = i + ((i % 2) ? 0.1 : -0.1);
+    jbw[i] = 1;
+  }
+  base->calculateTerrainPerGate(jitter);
+  BOOST_CHECK_EQUAL(base->getCachedTiltCount(), 1);
+  BOOST_CHECK_EQUAL(matches(full, jitter), 0);
+
+  // Fewer gates first, then the rest incrementally
+  auto inc  = std::make_shared<TerrainBlockage2me>(dem, radar, 230, "KTST", 0, 0.1);
+  auto half = makeTilt(50);
+
+  inc->calculateTerrainPerGate(half);
+  auto again = makeTilt(100);
+
+  inc->calculateTerrainPerGate(again);
+  BOOST_CHECK_EQUAL(matches(full, again), 0);
+
+  // Written on the first run and mapped by the next
+  const std::string dir = OS::getUniqueTemporaryFile("terraintest");
+  auto writer = std::make_shared<TerrainBlockage2me>(dem, radar, 230, "KTST", 0, 0.1);
+
+  writer->setCacheDirectory(dir);
+  writer->calculateTerrainPerGate(makeTilt(100));
+  BOOST_CHECK(!boost::filesystem::is_empty(dir));
+
+  auto reader = std::make_shared<TerrainBlockage2me>(nullptr, radar, 230, "KTST", 0, 0.1);
+  auto mapped = makeTilt(100);
+
+  reader->setCacheDirectory(dir);
+  reader->calculateTerrainPerGate(mapped);
+  BOOST_CHECK_EQUAL(matches(full, mapped), 0);
+  boost::filesystem::remove_all(dir);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -0,0 +1,102 @@
+// Add this at top for any BOOST test
+#include "rBOOSTTest.h"
+
+/** Test HMRG block row encoding against the per cell path */
+#include "../modules/iohmrg/rIOHmrg.h"
+
+#include <cstring>
+
+using namespace rapio;
+
+namespace {
+const size_t ROW  = 7;
+const size_t ROWS = 5;
+const int UNAVAILABLE = -9999;
+const int MISSING     = -999;
+const float SCALE     = 10.0;
+
+/** Rows of values with sentinels and values out of the short range */
+std::vector<float>
+createRows()
+{
+  std::vector<float> values;
+
+  for (size_t i = 0; i < ROW * ROWS; ++i) {
+    values.push_back((i * 1.37f) - 20.0f);
+  }
+  values[3]  = Constants::MissingData;
+  values[9]  = Constants::DataUnavailable;
+  values[15] = 1e7;
+  values[16] = -1e7;
+  values[ROW * ROWS - 1] = Constants::MissingData;
+  return values;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(HMRG)
+
+BOOST_AUTO_TEST_CASE(HMRG_BLOCK_ROWS)
+{
+  auto values = createRows();
+
+  // Block writer matches the per cell writer, south row first
+  MemoryStreamBuffer out;
+
+  IOHmrg::writeHmrgRows(out, values.data(), ROW, ROWS, true, UNAVAILABLE, MISSING, SCALE);
+  auto& bytes = *out.getData();
+
+  BOOST_REQUIRE_EQUAL(bytes.size(), values.size() * sizeof(short int));
+  std::vector<short int> shorts(values.size());
+
+  std::memcpy(shorts.data(), bytes.data(), bytes.size());
+  bool same = true;
+
+  for (size_t r = 0; r < ROWS; ++r) {
+    const size_t row = ROWS - 1 - r;
+    for (size_t x = 0; x < ROW; ++x) {
+      const float v = values[row * ROW + x];
+      same &= (shorts[r * ROW + x] == IOHmrg::toHmrgValue(v, UNAVAILABLE, MISSING, SCALE));
+    }
+  }
+  BOOST_CHECK(same);
+
+  // Out of range values are clamped
+  short int big = shorts[(ROWS - 1 - 2) * ROW + 1], small = shorts[(ROWS - 1 - 2) * ROW + 2];
+
+  ON_BIG_ENDIAN(OS::byteswap(big));
+  ON_BIG_ENDIAN(OS::byteswap(small));
+  BOOST_CHECK_EQUAL(big, 32767);
+  BOOST_CHECK_EQUAL(small, -32768);
+
+  // Block reader matches the per cell reader and flips back
+  MemoryStreamBuffer in(std::vector<char>(bytes.begin(), bytes.end()));
+  std::vector<float> back(values.size());
+
+  IOHmrg::readHmrgRows(in, back.data(), ROW, ROWS, true, UNAVAILABLE, MISSING, SCALE);
+  same = true;
+  for (size_t r = 0; r < ROWS; ++r) {
+    const size_t row = ROWS - 1 - r;
+    for (size_t x = 0; x < ROW; ++x) {
+      same &= (back[row * ROW + x] == IOHmrg::fromHmrgValue(shorts[r * ROW + x], UNAVAILABLE, MISSING, SCALE));
+    }
+  }
+  BOOST_CHECK(same);
+
+  // Round trip keeps sentinels and values to the scale
+  bool good = true;
+
+  for (size_t i = 0; i < values.size(); ++i) {
+    const float v = values[i];
+    if ((v == Constants::MissingData) || (v == Constants::DataUnavailable)) {
+      good &= (back[i] == v);
+    } else if ((v * SCALE < 32767) && (v * SCALE > -32768)) {
+      good &= (std::abs(back[i] - v) < 1.0 / SCALE + 1e-4);
+    }
+  }
+  BOOST_CHECK(good);
+  BOOST_CHECK_EQUAL(back[3], Constants::MissingData);
+  BOOST_CHECK_EQUAL(back[9], Constants::DataUnavailable);
+  BOOST_CHECK_CLOSE(back[15], 32767 / SCALE, 1e-3);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
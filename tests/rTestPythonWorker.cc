@@ -0,0 +1,106 @@
+// Add this at top for any BOOST test
+#include "rBOOSTTest.h"
+
+#include "../modules/iopython/rPythonWorker.h"
+#include "rIOJSON.h"
+#include "rFactory.h"
+#include "rOS.h"
+
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <fstream>
+
+using namespace rapio;
+
+namespace {
+/** Write a text file */
+void
+writeText(const std::string& path, const std::string& text)
+{
+  std::ofstream out(path);
+
+  out << text;
+}
+
+/** Is a line in the output? */
+bool
+hasLine(const std::vector<std::string>& output, const std::string& line)
+{
+  return (std::find(output.begin(), output.end(), line) != output.end());
+}
+}
+
+BOOST_AUTO_TEST_SUITE(PYTHON_WORKER)
+
+BOOST_AUTO_TEST_CASE(PYTHON_WORKER_RUN)
+{
+  if (OS::validateExe("python3").empty()) {
+    BOOST_TEST_MESSAGE("No python3 found, skipping python worker test");
+    return;
+  }
+
+  // The worker gets its metadata as JSON
+  Factory<IODataType>::introduce("json", std::make_shared<IOJSON>());
+
+  // The real worker with a RAPIOPY stub, so we don't need numpy.  The
+  // script reads its JSON from shared memory and reports back.
+  const std::string dir = OS::getUniqueTemporaryFile("pythonworker");
+
+  OS::ensureDirectory(dir + "/RAPIOPY");
+  BOOST_REQUIRE(OS::copyFile("worker.py", dir + "/RAPIOPY/worker.py"));
+  writeText(dir + "/RAPIOPY/__init__.py", "");
+  writeText(dir + "/RAPIOPY/RAPIO.py", "rapioJSONKey=None\nrapioJSONLength=0\n");
+  writeText(dir + "/script.py",
+    "import json, os\n"
+    "import RAPIOPY.RAPIO as RAPIO\n"
+    "with open('/dev/shm/'+RAPIO.rapioJSONKey, 'rb') as f:\n"
+    "  meta = json.loads(f.read(RAPIO.rapioJSONLength).decode())\n"
+    "base = meta['RAPIOOutput']['filebase']\n"
+    "if base == 'die':\n"
+    "  os._exit(3)\n"
+    "RAPIO.calls = getattr(RAPIO, 'calls', 0)+1\n"
+    "print('RAPIO_FILE_OUT:'+base+'.out')\n"
+    "print('calls '+str(RAPIO.calls))\n");
+  OS::setEnvVar("PYTHONPATH", dir);
+
+  auto data = DataGrid::Create("Test", "dBZ", LLH(), Time(), { 3 }, { "X" });
+
+  data->addFloat1D("values", "dBZ", { 0 });
+  {
+    PythonWorker worker("python3", dir + "/script.py", "rapiotest-" + std::to_string(OS::getProcessID()));
+
+    // The interpreter stays up between products
+    std::vector<std::string> output;
+
+    BOOST_CHECK(worker.run("first", data, output) == PythonWorker::Result::RAN);
+    BOOST_CHECK(hasLine(output, "RAPIO_FILE_OUT:first.out"));
+    BOOST_CHECK(hasLine(output, "calls 1"));
+
+    output.clear();
+    BOOST_CHECK(worker.run("second", data, output) == PythonWorker::Result::RAN);
+    BOOST_CHECK(hasLine(output, "RAPIO_FILE_OUT:second.out"));
+    BOOST_CHECK(hasLine(output, "calls 2"));
+
+    // Dying part way fails the product, it doesn't say to run it again
+    output.clear();
+    BOOST_CHECK(worker.run("die", data, output) == PythonWorker::Result::DIED);
+    BOOST_CHECK(!hasLine(output, "RAPIO_FILE_OUT:die.out"));
+
+    // Next product restarts the worker
+    output.clear();
+    BOOST_CHECK(worker.run("again", data, output) == PythonWorker::Result::RAN);
+    BOOST_CHECK(hasLine(output, "RAPIO_FILE_OUT:again.out"));
+    BOOST_CHECK(hasLine(output, "calls 1"));
+  }
+
+  // A worker that can't start never took the job
+  PythonWorker missing("rapio-no-such-python", dir + "/script.py", "rapiotest-missing");
+  std::vector<std::string> output;
+
+  BOOST_CHECK(missing.run("first", data, output) == PythonWorker::Result::UNAVAILABLE);
+  BOOST_CHECK(output.empty());
+
+  boost::filesystem::remove_all(dir);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,279 @@
+// Add this at top for any BOOST test
+#include "rBOOSTTest.h"
+
+/** Test the batched record queue. */
+#include "rRecordQueue.h"
+#include "rXMLIndex.h"
+#include "rConfigRecord.h"
+#include "rRecordJournal.h"
+#include "rOS.h"
+
+#include <set>
+#include <sstream>
+#include <thread>
+#include <atomic>
+
+using namespace rapio;
+
+namespace {
+/** Algorithm that records what the queue hands it */
+class RecordRecorder : public RAPIOAlgorithm {
+public:
+  virtual void
+  handleRecordEvent(const Record& rec) override
+  {
+    myHandled.push_back(rec.getTime().getSecondsSinceEpoch());
+  }
+
+  virtual void
+  handleEndDatasetEvent() override { myEnds++; }
+
+  virtual bool
+  isRecordCoalescable(const Record& rec) override
+  {
+    return (rec.getDataType() == "Latest");
+  }
+
+  std::vector<time_t> myHandled;
+  size_t myEnds = 0;
+};
+
+Record
+makeRecord(const std::string& file, time_t t, const std::string& type)
+{
+  std::vector<std::string> params = { "netcdf", file };
+
+  return Record(params, "netcdf", Time::SecondsSinceEpoch(t), type, "00.50");
+}
+}
+
+BOOST_AUTO_TEST_SUITE(RECORDQUEUE)
+
+BOOST_AUTO_TEST_CASE(RECORDQUEUE_BATCH)
+{
+  RecordRecorder alg;
+  auto q = std::make_shared<RecordQueue>(&alg);
+
+  q->setBatchSize(4);
+  q->setLatencyBudgetMS(10000);
+
+  std::vector<Record> records;
+
+  for (time_t t = 10; t > 0; --t) {
+    records.push_back(makeRecord("r" + std::to_string(t), t, "Reflectivity"));
+  }
+  q->addRecords(std::move(records));
+
+  // Identical record already waiting is dropped
+  q->addRecord(makeRecord("r5", 5, "Reflectivity"));
+  BOOST_CHECK_EQUAL(q->size(), 10);
+
+  // Newest of a coalesced product wins
+  q->addRecord(makeRecord("a", 3, "Latest"));
+  q->addRecord(makeRecord("b", 20, "Latest"));
+  q->addRecord(makeRecord("c", 7, "Latest"));
+
+  // Batches of 4, in time order
+  q->action();
+  BOOST_CHECK_EQUAL(alg.myHandled.size(), 4);
+  BOOST_CHECK_EQUAL(alg.myEnds, 0);
+  while (q->size() > 0) {
+    q->action();
+  }
+  BOOST_CHECK_EQUAL(alg.myEnds, 1);
+
+  std::vector<time_t> want = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 20 };
+
+  BOOST_CHECK_EQUAL_COLLECTIONS(alg.myHandled.begin(), alg.myHandled.end(),
+    want.begin(), want.end());
+
+  // Once processed the same record can come again
+  q->addRecord(makeRecord("r5", 5, "Reflectivity"));
+  BOOST_CHECK_EQUAL(q->size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(RECORDQUEUE_XML_STREAM)
+{
+  // Slightly out of order index, as merged radars tend to be
+  const std::vector<time_t> times = { 5, 3, 4, 1, 2, 9, 7, 8, 6, 10 };
+  std::stringstream ss;
+
+  ss << "<codeindex>\n";
+  for (auto t:times) {
+    std::vector<std::string> params = { "netcdf", "/data/" + std::to_string(t) + ".netcdf" };
+    Record r(params, "netcdf", Time::SecondsSinceEpoch(t), "Reflectivity", "00.50");
+    ss << "<item>\n";
+    ConfigRecord::constructXMLString(r, ss, "");
+    ss << "</item>\n";
+  }
+  ss << "</codeindex>\n";
+  const std::string text = ss.str();
+
+  RecordRecorder alg;
+  auto q = std::make_shared<RecordQueue>(&alg);
+
+  q->setBatchSize(2);
+
+  // Enough look ahead to sort, and we only hold a few at a time
+  auto in     = std::make_shared<std::istringstream>(text);
+  auto stream = std::make_shared<XMLRecordStream>(in, "", 0, 4);
+
+  q->addSource(stream);
+  q->action();
+  BOOST_CHECK_EQUAL(alg.myHandled.size(), 2);
+  BOOST_CHECK(q->size() < times.size());
+
+  // Resuming at the offset loses nothing not yet handled, even records
+  // held back or waiting in the queue
+  {
+    auto in3 = std::make_shared<std::istringstream>(text);
+    XMLRecordStream resumed(in3, "", 0, 4, stream->getResumeOffset());
+    std::set<time_t> seen(alg.myHandled.begin(), alg.myHandled.end());
+    Record r;
+    bool wanted;
+    while (resumed.readNext(r, wanted)) {
+      seen.insert(r.getTime().getSecondsSinceEpoch());
+    }
+    BOOST_CHECK_EQUAL(seen.size(), times.size());
+  }
+  for (size_t i = 0; (i < 100) && (alg.myEnds == 0); ++i) {
+    q->action();
+  }
+  BOOST_CHECK_EQUAL(alg.myEnds, 1);
+
+  std::vector<time_t> want = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+
+  BOOST_CHECK_EQUAL_COLLECTIONS(alg.myHandled.begin(), alg.myHandled.end(),
+    want.begin(), want.end());
+
+  // Resume part way, partial item is skipped
+  const size_t offset = text.find("<item", text.find("<item") + 1) + 3;
+  auto in2 = std::make_shared<std::istringstream>(text);
+  XMLRecordStream resumed(in2, "", 0, 4, offset);
+  Record r;
+  bool wanted;
+  size_t count = 0;
+
+  while (resumed.readNext(r, wanted)) {
+    if (count++ == 0) {
+      BOOST_CHECK_EQUAL(r.getTime().getSecondsSinceEpoch(), 4);
+    }
+  }
+  BOOST_CHECK_EQUAL(count, times.size() - 2);
+}
+
+BOOST_AUTO_TEST_CASE(RECORDQUEUE_JOURNAL)
+{
+  const std::string dir = OS::getUniqueTemporaryFile("journal");
+
+  // Small segments so we rotate
+  RecordJournalWriter writer(dir, 256, 100);
+
+  for (time_t t = 1; t <= 10; ++t) {
+    BOOST_REQUIRE(writer.append(makeRecord("/data", t, "Reflectivity"), "/data"));
+  }
+  BOOST_CHECK(RecordJournal::getSegments(dir).size() > 1);
+
+  // Everything from the start, index path replaced by the reader's
+  RecordJournalReader reader(dir, "/other", 0);
+
+  BOOST_REQUIRE(reader.open(true));
+  std::vector<Record> out;
+
+  BOOST_CHECK_EQUAL(reader.read(out, 100), 10);
+  BOOST_REQUIRE_EQUAL(out.size(), 10);
+  BOOST_CHECK_EQUAL(out[3].getTime().getSecondsSinceEpoch(), 4);
+  BOOST_CHECK_EQUAL(out[3].getDataType(), "Reflectivity");
+  BOOST_CHECK_EQUAL(out[3].getSubType(), "00.50");
+  BOOST_CHECK_EQUAL(out[3].getParams()[1], "/other");
+  BOOST_CHECK(!reader.hasNew());
+
+  // A follower only sees what comes after it opens
+  RecordJournalReader follower(dir, "/data", 0);
+
+  BOOST_REQUIRE(follower.open(false));
+  writer.append(makeRecord("/data", 11, "Velocity"), "/data");
+  BOOST_CHECK(reader.hasNew());
+  out.clear();
+  BOOST_CHECK_EQUAL(follower.read(out, 100), 1);
+  BOOST_REQUIRE_EQUAL(out.size(), 1);
+  BOOST_CHECK_EQUAL(out[0].getDataType(), "Velocity");
+  BOOST_CHECK_EQUAL(out[0].getParams()[1], "/data");
+  out.clear();
+  BOOST_CHECK_EQUAL(reader.read(out, 100), 1);
+
+  // Corrupt bytes don't decode
+  std::vector<char> bytes;
+
+  RecordJournal::encode(makeRecord("x", 1, "Zdr"), "", bytes);
+  Record r;
+
+  BOOST_CHECK(RecordJournal::decode(bytes.data(), bytes.size() - 1, "", 0, r) == 0);
+  bytes[RecordJournal::RECORD_HEADER] ^= 0x5A;
+  BOOST_CHECK(RecordJournal::decode(bytes.data(), bytes.size(), "", 0, r) < 0);
+
+  for (auto s:RecordJournal::getSegments(dir)) {
+    OS::deleteFile(RecordJournal::getSegmentPath(dir, s));
+  }
+  OS::deleteFile(dir + "/" + RecordJournal::SEQUENCE_FILE);
+  rmdir(dir.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(RECORDQUEUE_JOURNAL_WRITERS)
+{
+  const std::string dir = OS::getUniqueTemporaryFile("journal");
+  const time_t perWriter = 200;
+
+  // Two writers sharing small segments, with a reader following along
+  // while they rotate
+  std::atomic<bool> done(false);
+  std::set<time_t> seen;
+  size_t total = 0;
+
+  RecordJournalWriter first(dir, 512, 10000);
+
+  BOOST_REQUIRE(first.append(makeRecord("/data", 0, "Reflectivity"), "/data"));
+  RecordJournalReader reader(dir, "/data", 0);
+
+  BOOST_REQUIRE(reader.open(true));
+
+  std::thread follow([&](){
+    std::vector<Record> out;
+    for (;;) {
+      const bool last = done;
+      while (reader.read(out, 100) > 0) { }
+      for (auto& r:out) {
+        seen.insert(r.getTime().getSecondsSinceEpoch());
+      }
+      total += out.size();
+      out.clear();
+      if (last) { break; }
+    }
+  });
+
+  auto write = [&](RecordJournalWriter& w, time_t start){
+      for (time_t t = start; t < start + perWriter; ++t) {
+        BOOST_REQUIRE(w.append(makeRecord("/data", t, "Reflectivity"), "/data"));
+      }
+    };
+  RecordJournalWriter second(dir, 512, 10000);
+  std::thread a(write, std::ref(first), 1);
+  std::thread b(write, std::ref(second), 1001);
+
+  a.join();
+  b.join();
+  done = true;
+  follow.join();
+
+  BOOST_CHECK(RecordJournal::getSegments(dir).size() > 2);
+  BOOST_CHECK_EQUAL(total, 2 * perWriter + 1);
+  BOOST_CHECK_EQUAL(seen.size(), 2 * perWriter + 1);
+
+  for (auto s:RecordJournal::getSegments(dir)) {
+    OS::deleteFile(RecordJournal::getSegmentPath(dir, s));
+  }
+  OS::deleteFile(dir + "/" + RecordJournal::SEQUENCE_FILE);
+  rmdir(dir.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END();
@@ -3,9 +3,128 @@
 
 /** Test fusion stage2 data. */
 #include "../programs/fusion/rStage2Data.h"
+#include "../programs/fusion/rFusionDatabase.h"
+
+#include <cstdio>
 
 using namespace rapio;
 
+namespace {
+const char * STAGE2_PATH = "/tmp/stage2_delta_test.raw";
+const size_t DNUMX       = 20;
+const size_t DNUMY       = 10;
+const size_t DNUMZ       = 3;
+
+/** Create a merge grid, with the weights layer merging uses */
+std::shared_ptr<LLHGridN2D>
+createGrid()
+{
+  auto grid = LLHGridN2D::Create("Test", "dBZ", Time(), LLH(40, -100, 0), 0.01, 0.01, DNUMY, DNUMX, DNUMZ);
+
+  for (size_t z = 0; z < DNUMZ; ++z) {
+    grid->get(z)->addFloat2D("weights", "Dimensionless", { 0, 1 });
+  }
+  grid->fillPrimary(Constants::DataUnavailable);
+  return grid;
+}
+
+/** Write what the delta adds to a file as stage two does, then read it back
+ * and ingest it as a reader would */
+size_t
+sendDelta(Stage2Delta& delta, LLHGridN2D& grid, FusionDatabase& db, time_t t, bool& full)
+{
+  FusionBinaryTable out;
+
+  out.setString("Sourcename", "Fusion2Partition1");
+  out.setString("Radarname", "Fusion2Partition1");
+  out.setString("Typename", "Reflectivity");
+  out.setUnits("dBZ");
+  out.setLong("xBase", 0);
+  out.setLong("yBase", 0);
+  out.setTime(Time(t, 0));
+  const size_t rows = delta.add(grid, out, full);
+
+  FILE * fp = fopen(STAGE2_PATH, "wb");
+
+  BOOST_REQUIRE(fp != nullptr);
+  BOOST_CHECK(out.writeBlock(fp));
+  fclose(fp);
+
+  FusionBinaryTable::myStreamRead = true;
+  auto in = std::make_shared<FusionBinaryTable>();
+
+  fp = fopen(STAGE2_PATH, "rb");
+  BOOST_REQUIRE(fp != nullptr);
+  BOOST_CHECK(in->readBlock(STAGE2_PATH, fp));
+  fclose(fp);
+
+  Stage2Data data(in, { in->getValueSize(), in->getMissingSize() });
+  size_t missing, points, total;
+
+  db.ingestNewData(data, t - 600, missing, points, total);
+  return rows;
+}
+
+/** Check the reader merge matches what the writer had */
+void
+checkRebuilt(FusionDatabase& db, LLHGridN2D& want, time_t t)
+{
+  auto merged = createGrid();
+
+  db.mergeTo(merged, t - 600, 0, 0, -1);
+  size_t bad = 0;
+
+  for (size_t z = 0; z < DNUMZ; ++z) {
+    auto& a = want.get(z)->getFloat2DRef();
+    auto& b = merged->get(z)->getFloat2DRef();
+    for (size_t y = 0; y < DNUMY; ++y) {
+      for (size_t x = 0; x < DNUMX; ++x) {
+        if (a[y][x] != b[y][x]) {
+          if (bad++ == 0) {
+            BOOST_CHECK_EQUAL(a[y][x], b[y][x]); // just one actual check or we'll spam
+          }
+        }
+      }
+    }
+  }
+  BOOST_CHECK_EQUAL(bad, 0);
+}
+
+/** Stage2Data with its partition storage visible */
+class TestStage2Data : public Stage2Data {
+public:
+
+  /** Get the storage of a partition */
+  std::shared_ptr<Stage2Storage>
+  getStorage(size_t i)
+  {
+    return myStorage[i];
+  }
+};
+
+/** Add a height layer of values, missing and unavailable, split into two partitions */
+void
+addLayer(Stage2Data& data, const LLCoverageArea& grid, size_t z)
+{
+  VolumeValueWeightAverage vv;
+
+  for (size_t y = 0; y < grid.getNumY(); ++y) {
+    for (size_t x = 0; x < grid.getNumX(); ++x) {
+      const size_t k = (x + (y * 3) + z) % 9;
+      if (k == 0) {
+        vv.topSum = Constants::MissingData;
+      } else if (k == 4) {
+        vv.topSum = Constants::DataUnavailable;
+      } else {
+        vv.topSum    = x + (y * 0.5f) + (z * 10);
+        vv.bottomSum = 1 + (x % 3);
+      }
+      data.add(&vv, x, y, z, (x < grid.getNumX() / 2) ? 0 : 1);
+    }
+  }
+}
+}
+
 BOOST_AUTO_TEST_SUITE(STAGE2DATA)
 
 /** Test a rSparseVector */
@@ -93,4 +212,140 @@ BOOST_AUTO_TEST_CASE(STAGE2DATA_READWRITE)
   BOOST_CHECK_EQUAL(passed, true);
   #endif // if 0
 }
+
+BOOST_AUTO_TEST_CASE(STAGE2DATA_MERGE)
+{
+  LLCoverageArea grid;
+
+  BOOST_REQUIRE(grid.parse("nw(37, -100) se(36.8, -99.7) h(0.5,3,NMQWD) s(0.01, 0.01)"));
+  BOOST_REQUIRE(grid.getNumZ() > 2);
+
+  PartitionInfo info;
+
+  info.setPartitionType("tile");
+  info.set2DDimensions(2, 1);
+  BOOST_REQUIRE(info.partition(grid));
+
+  const LLH center(36.9, -99.85, 0);
+
+  // Serial fill of every layer into one
+  TestStage2Data serial;
+
+  serial.initForSend("KTLX", "Reflectivity", "dBZ", center, false, info, grid);
+  for (size_t z = 0; z < grid.getNumZ(); ++z) {
+    addLayer(serial, grid, z);
+  }
+
+  // Each layer filled on its own, then merged in height order
+  std::vector<std::shared_ptr<TestStage2Data> > layers;
+
+  for (size_t z = 0; z < grid.getNumZ(); ++z) {
+    auto l = std::make_shared<TestStage2Data>();
+    l->initForSend("KTLX", "Reflectivity", "dBZ", center, false, info, grid);
+    addLayer(*l, grid, z);
+    layers.push_back(l);
+  }
+  for (size_t z = 1; z < layers.size(); ++z) {
+    layers[0]->merge(*layers[z]);
+  }
+
+  for (size_t i = 0; i < info.size(); ++i) {
+    auto a = serial.getStorage(i);
+    auto b = layers[0]->getStorage(i);
+    BOOST_CHECK_EQUAL(a->getAddedValueCount(), b->getAddedValueCount());
+    BOOST_CHECK_EQUAL(a->getAddedMissingCount(), b->getAddedMissingCount());
+    BOOST_CHECK(a->getAddedValueCount() > 0);
+    BOOST_CHECK(a->getAddedMissingCount() > 0);
+
+    // Missing bits only become runs on send
+    a->RLE();
+    b->RLE();
+    auto& ta = *a->getTable();
+    auto& tb = *b->getTable();
+    BOOST_CHECK_EQUAL(ta.getValueSize(), tb.getValueSize());
+    BOOST_CHECK_EQUAL(ta.getMissingSize(), tb.getMissingSize());
+    BOOST_CHECK(ta.myNums == tb.myNums);
+    BOOST_CHECK(ta.myDems == tb.myDems);
+    BOOST_CHECK(ta.myXs == tb.myXs);
+    BOOST_CHECK(ta.myYs == tb.myYs);
+    BOOST_CHECK(ta.myZs == tb.myZs);
+    BOOST_CHECK(ta.myXMissings == tb.myXMissings);
+    BOOST_CHECK(ta.myYMissings == tb.myYMissings);
+    BOOST_CHECK(ta.myZMissings == tb.myZMissings);
+    BOOST_CHECK(ta.myLMissings == tb.myLMissings);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(STAGE2DATA_DELTA)
+{
+  // Writer merged grid with values, missing and no coverage
+  auto grid = createGrid();
+
+  for (size_t z = 0; z < DNUMZ; ++z) {
+    auto& g = grid->get(z)->getFloat2DRef();
+    for (size_t y = 0; y < DNUMY; ++y) {
+      for (size_t x = 0; x < DNUMX; ++x) {
+        if (x % 7 == 3) {
+          g[y][x] = Constants::MissingData;
+        } else if (x % 5 != 4) {
+          g[y][x] = (x * 0.5f) + y + (z * 10);
+        }
+      }
+    }
+  }
+
+  FusionDatabase db(DNUMX, DNUMY, DNUMZ);
+  Stage2Delta delta(DNUMX, DNUMY, DNUMZ, 3);
+  bool full;
+  time_t t = 10000;
+
+  // First write is full
+  BOOST_CHECK_EQUAL(sendDelta(delta, *grid, db, t, full), delta.getNumRows());
+  BOOST_CHECK(full);
+  checkRebuilt(db, *grid, t);
+
+  // Nothing changed is nothing sent, and readers keep it all
+  t += 120;
+  BOOST_CHECK_EQUAL(sendDelta(delta, *grid, db, t, full), 0);
+  BOOST_CHECK(!full);
+  checkRebuilt(db, *grid, t);
+
+  // Change two rows.  A value changes, a value loses coverage, coverage
+  // is gained and a missing becomes a value.
+  auto& g0 = grid->get(0)->getFloat2DRef();
+  auto& g2 = grid->get(2)->getFloat2DRef();
+
+  g0[2][0] = 55;
+  g0[2][1] = Constants::DataUnavailable;
+  g0[2][4] = 12;
+  g2[9][3] = 7;
+
+  t += 120;
+  BOOST_CHECK_EQUAL(sendDelta(delta, *grid, db, t, full), 2);
+  BOOST_CHECK(!full);
+
+  // Lost coverage was sent as missing, so the old value is dropped
+  auto want = createGrid();
+
+  for (size_t z = 0; z < DNUMZ; ++z) {
+    auto& from = grid->get(z)->getFloat2DRef();
+    auto& to   = want->get(z)->getFloat2DRef();
+    for (size_t y = 0; y < DNUMY; ++y) {
+      for (size_t x = 0; x < DNUMX; ++x) {
+        to[y][x] = from[y][x];
+      }
+    }
+  }
+  want->get(0)->getFloat2DRef()[2][1] = Constants::MissingData;
+  checkRebuilt(db, *want, t);
+
+  // Third write is full again, refreshing everything
+  t += 120;
+  BOOST_CHECK_EQUAL(sendDelta(delta, *grid, db, t, full), delta.getNumRows());
+  BOOST_CHECK(full);
+  checkRebuilt(db, *want, t);
+
+  FusionBinaryTable::myStreamRead = false;
+  std::remove(STAGE2_PATH);
+}
 BOOST_AUTO_TEST_SUITE_END();
@@ -0,0 +1,135 @@
+// Add this at top for any BOOST test
+#include "rBOOSTTest.h"
+
+/** Test the background output writers. */
+#include "rRAPIOAlgorithm.h"
+#include "rDataGrid.h"
+#include "rLatLonGrid.h"
+#include "rImageDataType.h"
+
+using namespace rapio;
+
+namespace {
+/** Algorithm that records writes instead of writing files */
+class WriteRecorder : public RAPIOAlgorithm {
+public:
+  virtual void
+  writeOutputProductNow(const std::string& key,
+    std::shared_ptr<DataType>            outputData,
+    std::map<std::string, std::string>   & outputParams,
+    const std::string                    & productName) override
+  {
+    // Slow disk...
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    std::lock_guard<std::mutex> lock(myLock);
+    myWrites[key].push_back(std::stoi(outputParams["id"]));
+  }
+
+  std::mutex myLock;
+  std::map<std::string, std::vector<int> > myWrites;
+};
+}
+
+BOOST_AUTO_TEST_SUITE(THREADGROUP)
+
+BOOST_AUTO_TEST_CASE(WRITE_OUTPUT_POOL)
+{
+  WriteRecorder alg;
+  auto data = DataGrid::Create("Test", "dBZ", LLH(), Time(), { 1 }, { "X" });
+  const std::vector<std::string> keys = { "Reflectivity", "Velocity", "Zdr" };
+  const int count = 20;
+
+  {
+    // Small queue so the writers push back on us
+    WriteOutputPool pool(2, 1);
+
+    for (int i = 0; i < count; ++i) {
+      for (auto& k:keys) {
+        std::map<std::string, std::string> params;
+        params["id"] = std::to_string(i);
+        pool.enqueue(std::make_shared<WriteOutputThreadTask>(&alg, &pool, k, data, params, k));
+      }
+    }
+    pool.drain();
+    BOOST_CHECK_EQUAL(pool.getPending(), 0);
+    BOOST_CHECK_EQUAL(pool.getCompleted(), count * keys.size());
+  }
+
+  // Each product written once and in the order given
+  for (auto& k:keys) {
+    auto& w = alg.myWrites[k];
+    BOOST_REQUIRE_EQUAL(w.size(), count);
+    for (int i = 0; i < count; ++i) {
+      BOOST_CHECK_EQUAL(w[i], i);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(WRITE_OUTPUT_COPY)
+{
+  // Background writers get a deep copy of the same type
+  auto grid = LatLonGrid::Create("Test", "dBZ", LLH(35, -100, 0), Time(), 0.01, 0.01, 10, 20);
+
+  grid->getFloat2DRef()[2][3] = 5.0;
+  std::shared_ptr<DataType> copy = grid->cloneDataType();
+  auto copyGrid = std::dynamic_pointer_cast<LatLonGrid>(copy);
+
+  BOOST_REQUIRE(copyGrid != nullptr);
+  grid->getFloat2DRef()[2][3] = 6.0;
+  grid->setTypeName("Changed");
+  BOOST_CHECK_EQUAL(copyGrid->getFloat2DRef()[2][3], 5.0);
+  BOOST_CHECK_EQUAL(copyGrid->getTypeName(), "Test");
+
+  // Types that can't be copied are written by the caller
+  auto image = std::make_shared<ImageDataType>();
+
+  BOOST_CHECK(image->cloneDataType() == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(PARALLEL_FOR)
+{
+  ThreadGroup group(3, 64);
+  const size_t count = 1000;
+  std::vector<std::atomic<int> > hits(count);
+
+  for (auto& h:hits) { h = 0; }
+
+  // Uneven work, every index exactly once
+  group.parallelFor(0, count, 7, [&](size_t start, size_t end){
+    for (size_t i = start; i < end; ++i) {
+      if (i % 100 == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      hits[i]++;
+    }
+  });
+  size_t bad = 0;
+
+  for (auto& h:hits) {
+    if (h != 1) { bad++; }
+  }
+  BOOST_CHECK_EQUAL(bad, 0);
+
+  // Nested from within the workers doesn't deadlock
+  std::atomic<size_t> inner(0);
+
+  group.parallelFor(0, 6, 1, [&](size_t, size_t){
+    group.parallelFor(0, 10, 1, [&](size_t s, size_t e){
+      inner += (e - s);
+    });
+  });
+  BOOST_CHECK_EQUAL(inner, 60);
+
+  // Exceptions come back to the caller
+  BOOST_CHECK_THROW(group.parallelFor(0, 10, 1, [&](size_t s, size_t){
+    if (s == 5) { throw std::runtime_error("bad range"); }
+  }), std::runtime_error);
+
+  // Shared group lives on between calls
+  ThreadGroup::setSharedThreadCount(2);
+  auto shared = ThreadGroup::getShared();
+  BOOST_CHECK_EQUAL(shared->getNumWorkers(), 2);
+  BOOST_CHECK(shared == ThreadGroup::getShared());
+}
+
+BOOST_AUTO_TEST_SUITE_END();
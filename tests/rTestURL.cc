@@ -2,6 +2,11 @@
 #include "rBOOSTTest.h"
 
 #include "rURL.h"
+#include "rIOURL.h"
+#include "rDataFilter.h"
+#include "rOS.h"
+
+#include <fstream>
 
 using namespace rapio;
 
@@ -85,4 +90,54 @@ BOOST_AUTO_TEST_CASE(_URL_FIELDS_)
   // getSuffixLC -- I might remove this
 }
 
+BOOST_AUTO_TEST_CASE(_IOURL_READ_VIEW_)
+{
+  DataFilter::introduceSelf();
+
+  std::vector<char> raw;
+
+  for (size_t i = 0; i < 100000; ++i) {
+    raw.push_back('a' + (i * 7) % 26);
+  }
+  const std::string plain = OS::getUniqueTemporaryFile("test-view-");
+  const std::string gz    = plain + ".gz";
+
+  std::ofstream(plain, std::ios::binary).write(raw.data(), raw.size());
+  std::map<std::string, std::string> params;
+
+  BOOST_REQUIRE(DataFilter::getDataFilter("gz")->applyURL(URL(plain), URL(gz), params));
+
+  // Local uncompressed is mapped with no copy
+  auto v = IOURL::readView(URL(plain));
+
+  BOOST_REQUIRE(v != nullptr);
+  BOOST_CHECK(v->isMapped());
+  BOOST_REQUIRE_EQUAL(v->size(), raw.size());
+  BOOST_CHECK(std::equal(raw.begin(), raw.end(), v->data()));
+
+  // Compressed is uncompressed into the view
+  auto z = IOURL::readView(URL(gz));
+
+  BOOST_REQUIRE(z != nullptr);
+  BOOST_CHECK(!z->isMapped());
+  BOOST_REQUIRE_EQUAL(z->size(), raw.size());
+  BOOST_CHECK(std::equal(raw.begin(), raw.end(), z->data()));
+
+  // Streaming uncompress matches
+  auto s = IOURL::openStream(URL(gz));
+
+  BOOST_REQUIRE(s != nullptr);
+  std::string streamed((std::istreambuf_iterator<char>(*s)), std::istreambuf_iterator<char>());
+
+  BOOST_CHECK(streamed == std::string(raw.begin(), raw.end()));
+
+  // Missing file has nothing
+  auto m = IOURL::readView(URL(plain + ".missing"));
+
+  BOOST_CHECK((m == nullptr) || m->empty());
+
+  OS::deleteFile(plain);
+  OS::deleteFile(gz);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -0,0 +1,89 @@
+// Add this at top for any BOOST test
+#include "rBOOSTTest.h"
+
+/** Test the wgrib2 catalog read from a sidecar .idx */
+#include "../modules/iowgrib/rWgribDataTypeImp.h"
+#include "rOS.h"
+
+#include <fstream>
+#include <utime.h>
+
+using namespace rapio;
+
+namespace {
+const std::string GRIB_PATH = "/tmp/wgrib_catalog_test.grib2";
+const std::string IDX_PATH  = GRIB_PATH + ".idx";
+
+/** Write a file with a modification time of when */
+void
+writeFile(const std::string& path, const std::string& text, time_t when)
+{
+  std::ofstream out(path);
+
+  out << text;
+  out.close();
+  struct utimbuf t;
+
+  t.actime  = when;
+  t.modtime = when;
+  utime(path.c_str(), &t);
+}
+
+/** Inventory of three messages, the last with two fields */
+const char * IDX =
+  "1:0:d=2024010100:TMP:500 mb:anl:\n"
+  "2:1200:d=2024010100:TMP:700 mb:anl:\n"
+  "3.1:2400:d=2024010100:UGRD:500 mb:anl:\n"
+  "3.2:2400:d=2024010100:VGRD:500 mb:anl:\n";
+}
+
+BOOST_AUTO_TEST_SUITE(WGRIB)
+
+BOOST_AUTO_TEST_CASE(WGRIB_IDX_CATALOG)
+{
+  const time_t now = time(nullptr);
+
+  writeFile(GRIB_PATH, "GRIB", now - 100);
+  writeFile(IDX_PATH, IDX, now);
+
+  // A current idx is read and parsed
+  GribCatalogCache catalog{ URL(GRIB_PATH) };
+  std::vector<std::string> lines;
+
+  BOOST_REQUIRE(catalog.readIDXLines(lines));
+  BOOST_REQUIRE_EQUAL(lines.size(), 4);
+  BOOST_REQUIRE(catalog.parseCatalog(lines));
+  BOOST_CHECK_EQUAL(catalog.getFieldCount(1), 1);
+  BOOST_CHECK_EQUAL(catalog.getFieldCount(3), 2);
+
+  // Levels come back in the order asked for, without running wgrib2
+  auto keys = catalog.match3D("TMP", { "700 mb", "500 mb" });
+
+  BOOST_REQUIRE_EQUAL(keys.size(), 2);
+  BOOST_CHECK_EQUAL(keys[0], "2.1");
+  BOOST_CHECK_EQUAL(keys[1], "1.1");
+
+  // Single field messages match by message, others by message.field
+  BOOST_CHECK_EQUAL(catalog.getLayerMatch({ "2.1", "1.1", "3.2" }), "^(2|1|3\\.2):");
+
+  // A key without a field part is field 1
+  BOOST_CHECK_EQUAL(catalog.getLayerMatch({ "3", "1" }), "^(3\\.1|1):");
+
+  // Out of order or short lines don't parse
+  GribCatalogCache bad{ URL(GRIB_PATH) };
+
+  BOOST_CHECK(!bad.parseCatalog({ "2:0:d=2024010100:TMP:500 mb:anl:" }));
+  BOOST_CHECK(!bad.parseCatalog({ "1:0:d=2024010100" }));
+
+  // An idx older than the grib2 file is stale
+  writeFile(IDX_PATH, IDX, now - 200);
+  lines.clear();
+  BOOST_CHECK(!catalog.readIDXLines(lines));
+
+  // No idx at all
+  OS::deleteFile(IDX_PATH);
+  BOOST_CHECK(!catalog.readIDXLines(lines));
+  OS::deleteFile(GRIB_PATH);
+}
+
+BOOST_AUTO_TEST_SUITE_END();